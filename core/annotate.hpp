@@ -10,6 +10,7 @@
 #include "ann_place.hpp"
 #include "ann_ssa.hpp"
 #include "attribute.hpp"
+#include "name_bimap.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
 
@@ -31,8 +32,7 @@ struct Ann_name {
 
 using Ann_node_pin_offset = Attribute<Ann_name::offset, Node_pin, mmap_lib::map<Node_pin::Compact_class_driver, Bits_t> >;
 
-using Ann_node_pin_name
-    = Attribute<Ann_name::pin_name, Node_pin, mmap_lib::bimap<Node_pin::Compact_class_driver, std::string_view> >;
+using Ann_node_pin_name = Attribute<Ann_name::pin_name, Node_pin, Name_bimap<Node_pin::Compact_class_driver> >;
 
 using Ann_node_pin_prp_vname
     = Attribute<Ann_name::prp_vname, Node_pin, mmap_lib::map<Node_pin::Compact_class_driver, std::string_view> >;
@@ -45,7 +45,7 @@ using Ann_node_pin_flag_positive = Attribute<Ann_name::flag_positive, Node_pin,
 
 using Ann_node_pin_io_unsign = Attribute<Ann_name::io_unsign, Node_pin, mmap_lib::map<Node_pin::Compact_driver, bool> >;
 
-using Ann_node_name = Attribute<Ann_name::nodename, Node, mmap_lib::bimap<Node::Compact_class, std::string_view> >;
+using Ann_node_name = Attribute<Ann_name::nodename, Node, Name_bimap<Node::Compact_class> >;
 
 using Ann_node_place = Attribute<Ann_name::nodeplace, Node, mmap_lib::map<Node::Compact, Ann_place> >;
 
@@ -72,6 +72,23 @@ struct Ann_support {
     Ann_node_color::clear(lg);
   };
 
+  // fn(key) returns the remapped key (see Attribute::remap)
+  template <typename FN>
+  static void remap(LGraph *lg, FN fn) {
+    Ann_node_pin_delay::remap(lg, fn);
+    Ann_node_pin_io_unsign::remap(lg, fn);
+    Ann_node_pin_offset::remap(lg, fn);
+    Ann_node_pin_name::remap(lg, fn);
+    Ann_node_pin_prp_vname::remap(lg, fn);
+    Ann_node_pin_ssa::remap(lg, fn);
+
+    Ann_node_name::remap(lg, fn);
+    Ann_node_place::remap(lg, fn);
+    Ann_node_file_loc::remap(lg, fn);
+    Ann_node_tree_pos::remap(lg, fn);
+    Ann_node_color::remap(lg, fn);
+  };
+
   static void sync(LGraph *lg) {
     Ann_node_pin_delay::sync(lg);
     Ann_node_pin_io_unsign::sync(lg);
@@ -86,4 +103,37 @@ struct Ann_support {
     Ann_node_tree_pos::sync(lg);
     Ann_node_color::sync(lg);
   };
+
+  // Parallel passes (LGraph::each_node_parallel) can read the lg annotations
+  // without locking between begin and end. No annotation can be set, cleared
+  // or synced in the meantime.
+  static void begin_concurrent_read(const LGraph *lg) {
+    Ann_node_pin_delay::begin_concurrent_read(lg);
+    Ann_node_pin_io_unsign::begin_concurrent_read(lg);
+    Ann_node_pin_offset::begin_concurrent_read(lg);
+    Ann_node_pin_name::begin_concurrent_read(lg);
+    Ann_node_pin_prp_vname::begin_concurrent_read(lg);
+    Ann_node_pin_ssa::begin_concurrent_read(lg);
+
+    Ann_node_name::begin_concurrent_read(lg);
+    Ann_node_place::begin_concurrent_read(lg);
+    Ann_node_file_loc::begin_concurrent_read(lg);
+    Ann_node_tree_pos::begin_concurrent_read(lg);
+    Ann_node_color::begin_concurrent_read(lg);
+  };
+
+  static void end_concurrent_read(const LGraph *lg) {
+    Ann_node_pin_delay::end_concurrent_read(lg);
+    Ann_node_pin_io_unsign::end_concurrent_read(lg);
+    Ann_node_pin_offset::end_concurrent_read(lg);
+    Ann_node_pin_name::end_concurrent_read(lg);
+    Ann_node_pin_prp_vname::end_concurrent_read(lg);
+    Ann_node_pin_ssa::end_concurrent_read(lg);
+
+    Ann_node_name::end_concurrent_read(lg);
+    Ann_node_place::end_concurrent_read(lg);
+    Ann_node_file_loc::end_concurrent_read(lg);
+    Ann_node_tree_pos::end_concurrent_read(lg);
+    Ann_node_color::end_concurrent_read(lg);
+  };
 };
@@ -2,16 +2,48 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "lgraph.hpp"
 #include "mmap_bimap.hpp"
+#include "mmap_concurrent_map.hpp"
 #include "mmap_map.hpp"
 
 template <const char *Name, typename Base, typename Attr_data>
 class Attribute {
-  inline static absl::flat_hash_map<std::string, Attr_data *> lg2attr;
-  inline static const LGraph *           last_lg   = nullptr;
-  inline static Attr_data *              last_attr = nullptr;
+  // lg2attr is shared (guarded by lg2attr_lock: shared for lookups, unique
+  // to insert). Each template instance is one Name, so the key is just the
+  // graph unique name (path/lgid). The tables of a library are dropped when
+  // it is deleted (Graph_library::shutdown). The last few lookups are cached
+  // per thread, so parallel readers seldom touch the lock and code
+  // alternating between graphs does not miss. clear/sync bump the generation
+  // to drop the caches in other threads.
+  struct Table {
+    Attr_data *          attr;
+    const Graph_library *lib;
+  };
+
+  inline static absl::flat_hash_map<std::string, Table> lg2attr;
+  inline static absl::flat_hash_map<std::string, int>   n_readers;  // begin_concurrent_read nesting per graph
+  inline static std::shared_mutex                       lg2attr_lock;
+  inline static std::atomic<uint64_t>                   generation{0};
+  inline static bool                                    drop_hook_added = false;  // lg2attr_lock
+
+  struct Cache_entry {
+    const LGraph *lg;
+    Attr_data *   attr;
+  };
+  static constexpr int n_cache_entries = 4;
+
+  inline static thread_local std::array<Cache_entry, n_cache_entries> cache{};
+  inline static thread_local uint64_t                                 cache_generation = 0;
+  inline static thread_local int                                      cache_next       = 0;
 
   static std::string_view get_base() {
     if constexpr (std::is_same<Base, Node>::value) {
@@ -24,62 +56,186 @@ class Attribute {
 
   static std::string get_filename(Lg_type_id lgid) { return absl::StrCat("lg_", std::to_string(lgid), get_base(), Name); };
 
-  static void setup_table(const LGraph *lg) {
-    last_lg  = lg;
+  static const std::string &get_key(const LGraph *lg) { return lg->get_unique_name(); }
+
+  static Attr_data *find_table(const LGraph *lg) {
+    auto it = lg2attr.find(get_key(lg));
+    if (it == lg2attr.end())
+      return nullptr;
+    return it->second.attr;
+  }
+
+  static Attr_data *setup_table_int(const LGraph *lg) {
+    auto *attr = find_table(lg);
+    if (attr == nullptr) {
+      if (!drop_hook_added) {
+        Graph_library::add_drop_hook(drop_library);
+        drop_hook_added = true;
+      }
+      attr                 = new Attr_data(lg->get_path(), get_filename(lg->get_lgid()));
+      lg2attr[get_key(lg)] = Table{attr, &lg->get_library()};
+    }
+    return attr;
+  }
+
+  static void drop_library(const Graph_library *lib) {
+    std::unique_lock<std::shared_mutex> guard(lg2attr_lock);
 
-    const auto key = absl::StrCat(lg->get_unique_name(), Name);
-    //fmt::print("key:{} attr:{} lg:{}\n", key, Name, (void *)lg);
+    std::vector<std::string> keys;
+    for (const auto &it : lg2attr) {
+      if (it.second.lib == lib)
+        keys.emplace_back(it.first);
+    }
+    if (keys.empty())
+      return;
 
-    auto it = lg2attr.find(key);
-    if (likely(it != lg2attr.end())) {
-      last_attr = it->second;
-    }else{
-      last_attr  = new Attr_data(lg->get_path(), get_filename(lg->get_lgid()));
-      lg2attr[key] = last_attr;
+    generation.fetch_add(1, std::memory_order_release);
+    for (const auto &key : keys) {
+      I(!n_readers.contains(key));
+      auto it = lg2attr.find(key);
+      delete it->second.attr;
+      lg2attr.erase(it);
     }
+  }
+
+  static Attr_data *setup_table(const LGraph *lg) {
+    auto gen = generation.load(std::memory_order_acquire);
+    if (cache_generation != gen) {
+      cache.fill(Cache_entry{nullptr, nullptr});
+      cache_generation = gen;
+    }
+
+    Attr_data *attr;
+    {
+      std::shared_lock<std::shared_mutex> guard(lg2attr_lock);
+      attr = find_table(lg);
+    }
+    if (attr == nullptr) {
+      std::unique_lock<std::shared_mutex> guard(lg2attr_lock);
+      attr = setup_table_int(lg);
+    }
+
+    cache[cache_next] = Cache_entry{lg, attr};
+    cache_next        = (cache_next + 1) % n_cache_entries;
+
+    return attr;
   };
 
+  static Attr_data *find_cached(const LGraph *lg) {
+    if (unlikely(cache_generation != generation.load(std::memory_order_relaxed)))
+      return nullptr;
+    for (const auto &e : cache) {
+      if (e.lg == lg)
+        return e.attr;
+    }
+    return nullptr;
+  }
+
   static_assert(std::is_same<Base, Node_pin>::value || std::is_same<Base, Node>::value, "Base should be Node or Node_pin");
 
-public:
-  static Attr_data *ref(const Base &obj) {
-    if (unlikely(obj.get_top_lgraph() != last_lg))
-      setup_table(obj.get_top_lgraph());
-    return last_attr;
+  // mmap_lib::map uses get, mmap_lib::bimap get_val
+  template <typename M, typename It>
+  static auto get_value(const M *data, const It &it) -> decltype(data->get_val(it)) {
+    return data->get_val(it);
+  }
+  template <typename M, typename It>
+  static auto get_value(const M *data, const It &it) -> decltype(data->get(it)) {
+    return data->get(it);
   }
+
+public:
+  static Attr_data *ref(const Base &obj) { return ref(obj.get_top_lgraph()); }
   static Attr_data *ref(const LGraph *lg) {
-    if (unlikely(lg != last_lg))
-      setup_table(lg);
-    return last_attr;
+    auto *attr = find_cached(lg);
+    if (likely(attr != nullptr))
+      return attr;
+    return setup_table(lg);
+  }
+
+  // Concurrent read mode for the lg table. Between begin and end, any
+  // thread can read it (ref + get/has/find). The table is mapped upfront
+  // because mmap_lib maps lazily, and pinned so that mmap_gc does not
+  // recycle it. Nobody may modify, clear, remap or sync it in the meantime.
+  // The tables of other graphs are not affected.
+  static void begin_concurrent_read(const LGraph *lg) {
+    std::unique_lock<std::shared_mutex> guard(lg2attr_lock);
+
+    auto *attr = setup_table_int(lg);
+    attr->preload();
+    if (n_readers[get_key(lg)]++ == 0)
+      attr->gc_pin();
+  }
+  static void end_concurrent_read(const LGraph *lg) {
+    std::unique_lock<std::shared_mutex> guard(lg2attr_lock);
+
+    auto it = n_readers.find(get_key(lg));
+    I(it != n_readers.end());
+    if (--it->second == 0) {
+      n_readers.erase(it);
+      find_table(lg)->gc_unpin();
+    }
+  }
+  static bool is_concurrent_read(const LGraph *lg) {
+    std::shared_lock<std::shared_mutex> guard(lg2attr_lock);
+    return n_readers.contains(get_key(lg));
   }
 
   static void clear(const LGraph *lg) {
-    setup_table(lg);
+    I(!is_concurrent_read(lg));
+
+    std::unique_lock<std::shared_mutex> guard(lg2attr_lock);
 
-    I(last_lg == lg); // setup table forces this
+    auto *attr = setup_table_int(lg);
+    lg2attr.erase(get_key(lg));
+    generation.fetch_add(1, std::memory_order_release);
 
-    const auto key = absl::StrCat(lg->get_unique_name(), Name);
-    I(lg2attr[key] == last_attr);
-    lg2attr.erase(key);
+    attr->clear();
+    delete attr;  // Delete does not clear
+  }
 
-    last_attr->clear();
-    delete last_attr;  // Delete does not clear
+  // Rewrites all the keys (LGraph::compact renumbers the nodes). fn returns
+  // the new key, an invalid key drops the entry.
+  template <typename FN>
+  static void remap(const LGraph *lg, FN fn) {
+    I(!is_concurrent_read(lg));
 
-    last_lg   = nullptr;
-    last_attr = nullptr;
+    Attr_data *attr;
+    {
+      std::shared_lock<std::shared_mutex> guard(lg2attr_lock);
+      attr = find_table(lg);  // no table, no attribute to remap (do not create the files)
+    }
+    if (attr == nullptr)
+      return;
+    const Attr_data *data = attr;
+
+    using Key   = std::decay_t<decltype(data->get_key(data->begin()))>;
+    using Value = std::decay_t<decltype(get_value(data, data->begin()))>;
+    using Copy  = std::conditional_t<std::is_same_v<Value, std::string_view>, std::string, Value>;
+
+    std::vector<std::pair<Key, Copy>> entries;
+    entries.reserve(data->size());
+    for (auto it = data->begin(), end = data->end(); it != end; ++it) {
+      auto key = fn(data->get_key(it));
+      if (!key.is_invalid())
+        entries.emplace_back(key, Copy(get_value(data, it)));
+    }
+
+    attr->clear();
+    for (const auto &[key, val] : entries) {
+      attr->set(key, Value(val));
+    }
   }
 
   static void sync(const LGraph *lg) {
-    if (last_lg == lg) {
-      last_lg   = nullptr;
-      last_attr = nullptr;
-    }
+    I(!is_concurrent_read(lg));
+
+    std::unique_lock<std::shared_mutex> guard(lg2attr_lock);
 
-    const auto key = absl::StrCat(lg->get_unique_name(), Name);
-    auto it = lg2attr.find(key);
+    auto it = lg2attr.find(get_key(lg));
     if (it == lg2attr.end())
       return;
-    delete it->second;
+    generation.fetch_add(1, std::memory_order_release);
+    delete it->second.attr;
     lg2attr.erase(it);
   }
 };
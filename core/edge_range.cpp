@@ -0,0 +1,216 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "edge_range.hpp"
+
+#include "iassert.hpp"
+#include "lgraph.hpp"
+
+XEdge_range::XEdge_range(const Node &node, bool _out)
+    : top_g(node.get_top_lgraph())
+    , current_g(node.get_class_lgraph())
+    , hidx(node.get_hidx())
+    , first_idx(node.get_nid())
+    , pid(0)
+    , out(_out)
+    , pin_scope(false)
+    , hier(node.is_hierarchical())
+    , use_materialized(false) {
+  I(current_g->node_internal[first_idx].is_master_root());
+
+  if (hier && ((out && node.is_graph_output()) || (!out && node.is_graph_input()))) {
+    // Edges go through the parent graph, not worth doing it in place
+    materialized     = out ? current_g->out_edges(node) : current_g->inp_edges(node);
+    use_materialized = true;
+  }
+}
+
+XEdge_range::XEdge_range(const Node_pin &pin, bool _out)
+    : top_g(pin.get_top_lgraph())
+    , current_g(pin.get_class_lgraph())
+    , hidx(pin.get_hidx())
+    , first_idx(pin.get_root_idx())
+    , pid(pin.get_pid())
+    , out(_out)
+    , pin_scope(true)
+    , hier(pin.is_hierarchical())
+    , use_materialized(false) {
+  GI(out, pin.is_driver());
+  GI(!out, pin.is_sink() || pin.is_graph_input());
+}
+
+XEdge_range::Iter XEdge_range::begin() const {
+  if (use_materialized) {
+    Iter it(this, 0);
+    if (!materialized.empty()) {
+      it.idx2   = 1;  // any non-zero, expand_pos tracks the position
+      it.driver = materialized[0].driver;
+      it.sink   = materialized[0].sink;
+    }
+    return it;
+  }
+
+  Iter it(this, first_idx);
+  it.load_entry();
+  it.skip_empty();
+  it.settle();
+
+  return it;
+}
+
+XEdge_range::Iter::Iter(const XEdge_range *r, Index_ID idx)
+    : range(r), idx2(idx), redge_off(0), hyper(false), pos(0), num(0), expand_pos(0) {}
+
+const Edge_raw *XEdge_range::Iter::get_redge() const {
+  I(!hyper);
+  const auto &    node_int = range->current_g->node_internal[idx2];
+  const Edge_raw *base     = range->out ? node_int.get_output_begin() : node_int.get_input_begin();
+  return base + redge_off;
+}
+
+const Graph_hyper::Sink &XEdge_range::Iter::get_hsink() const {
+  I(hyper);
+  auto sinks = range->current_g->hyper.get_sinks(idx2);
+  I(pos < sinks.size());
+  return sinks.begin()[pos];
+}
+
+void XEdge_range::Iter::load_entry() {
+  const auto &node_int = range->current_g->node_internal[idx2];
+
+  pos       = 0;
+  redge_off = 0;
+  hyper     = false;
+  if (range->out) {
+    if (range->current_g->is_hyper_root(idx2)) {
+      I(node_int.get_num_local_outputs() == 0);  // all moved to Graph_hyper
+      num   = range->current_g->hyper.get_num_sinks(idx2);
+      hyper = true;
+      return;
+    }
+    num = node_int.get_num_local_outputs();
+  } else {
+    num = node_int.get_num_local_inputs();
+  }
+}
+
+void XEdge_range::Iter::next_entry() {
+  const auto &node_internal = range->current_g->node_internal;
+
+  while (true) {
+    if (node_internal[idx2].is_last_state()) {
+      idx2 = 0;
+      pos  = 0;
+      return;
+    }
+    idx2 = node_internal[idx2].get_next();
+    if (!range->pin_scope)
+      return;
+    if (idx2 == range->first_idx) {  // same walk as LGraph::each_pin
+      idx2 = 0;
+      pos  = 0;
+      return;
+    }
+    if (node_internal[idx2].get_dst_pid() == range->pid)
+      return;
+  }
+}
+
+void XEdge_range::Iter::advance() {
+  if (!hyper)
+    redge_off += get_redge()->next_node_inc();
+  pos++;
+}
+
+void XEdge_range::Iter::skip_empty() {
+  while (idx2 && pos >= num) {
+    next_entry();
+    if (idx2)
+      load_entry();
+  }
+}
+
+bool XEdge_range::Iter::setup_edge() {
+  I(pos < num);
+
+  auto *      lg   = range->current_g;
+  const auto &hidx = range->hidx;
+  auto        dpid = lg->node_internal[idx2].get_dst_pid();
+
+  if (range->out) {
+    driver = Node_pin(range->top_g, lg, hidx, idx2, dpid, false);
+    if (hyper) {
+      const auto &hsink = get_hsink();
+      sink              = Node_pin(range->top_g, lg, hidx, hsink.idx, hsink.pid, true);
+    } else {
+      sink = get_redge()->get_inp_pin(range->top_g, lg, hidx, idx2);
+    }
+
+    if (range->hier && ((sink.is_graph_output() && sink.is_down_node()) || sink.get_node().is_type_sub_present())) {
+      // Same boundary test as LGraph::trace_forward2sink
+      expand.clear();
+      lg->trace_forward2sink(expand, driver, sink);
+      if (expand.empty())
+        return false;
+      expand_pos = 0;
+      driver     = expand[0].driver;
+      sink       = expand[0].sink;
+    }
+  } else {
+    sink   = Node_pin(range->top_g, lg, hidx, idx2, dpid, true);
+    driver = get_redge()->get_out_pin(range->top_g, lg, hidx, idx2);
+
+    if (range->hier && ((driver.is_graph_input() && driver.is_down_node()) || driver.get_node().is_type_sub_present())) {
+      // Same boundary test as LGraph::trace_back2driver
+      Node_pin_iterator piter;
+      lg->trace_back2driver(piter, driver);
+      if (piter.empty())
+        return false;
+      expand.clear();
+      for (const auto &dpin : piter) {
+        expand.emplace_back(dpin, sink);
+      }
+      expand_pos = 0;
+      driver     = expand[0].driver;
+    }
+  }
+
+  return true;
+}
+
+void XEdge_range::Iter::settle() {
+  while (idx2 && !setup_edge()) {
+    advance();
+    skip_empty();
+  }
+}
+
+XEdge_range::Iter &XEdge_range::Iter::operator++() {
+  I(idx2);  // ++ after end
+
+  if (range->use_materialized) {
+    ++expand_pos;
+    if (expand_pos >= range->materialized.size()) {
+      idx2       = 0;
+      expand_pos = 0;
+    } else {
+      driver = range->materialized[expand_pos].driver;
+      sink   = range->materialized[expand_pos].sink;
+    }
+    return *this;
+  }
+
+  if (expand_pos + 1 < expand.size()) {
+    ++expand_pos;
+    driver = expand[expand_pos].driver;
+    sink   = expand[expand_pos].sink;
+    return *this;
+  }
+  expand.clear();
+  expand_pos = 0;
+
+  advance();
+  skip_empty();
+  settle();
+
+  return *this;
+}
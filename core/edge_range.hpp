@@ -0,0 +1,93 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <iterator>
+
+#include "edge.hpp"
+#include "graph_hyper.hpp"
+#include "node.hpp"
+#include "node_pin.hpp"
+
+// Lazy range over the edges of a node (or a pin). Unlike XEdge_iterator, it
+// does not allocate: it walks the SEdge/LEdge storage in Node_internal (and
+// the Graph_hyper sinks of high fan-out pins) in place and yields XEdge by
+// value. The graph must not be modified while
+// iterating (use out_edges/inp_edges to delete edges in a loop).
+//
+// The loop body may open other mmaps (attributes, sub graphs), and mmap_gc
+// may then remap node_internal or the hyper sinks. The iterator only keeps
+// positions (entry, edge offset, sink pos) and re-derives the pointers on
+// each step.
+//
+// Hierarchical traversals keep the out_edges/inp_edges semantic. Only the
+// edges crossing a hierarchy boundary (sub or graph IO) are expanded in a
+// side buffer.
+class XEdge_range {
+protected:
+  LGraph *        top_g;
+  LGraph *        current_g;
+  Hierarchy_index hidx;
+  Index_ID        first_idx;  // master_root nid (node) or root idx (pin)
+  Port_ID         pid;
+  bool            out;        // driver side (out_edges) or sink side (inp_edges)
+  bool            pin_scope;  // only the edges of pid
+  bool            hier;
+
+  XEdge_iterator materialized;  // hierarchical graph IO nodes are not walked in place
+  bool           use_materialized;
+
+public:
+  class Iter {
+  protected:
+    friend class XEdge_range;
+
+    const XEdge_range *range;
+    Index_ID           idx2;       // current Node_internal entry, 0 when done
+    uint32_t           redge_off;  // Edge_raw offset of the current edge in idx2
+    bool               hyper;      // idx2 is a hyper driver, pos indexes its Graph_hyper sinks
+    uint32_t           pos;
+    uint32_t           num;
+
+    Node_pin driver;
+    Node_pin sink;
+
+    XEdge_iterator expand;  // edges of the current redge crossing a hierarchy boundary
+    size_t         expand_pos;
+
+    const Edge_raw *         get_redge() const;
+    const Graph_hyper::Sink &get_hsink() const;
+
+    void load_entry();
+    void next_entry();
+    void advance();
+    void skip_empty();
+    bool setup_edge();
+    void settle();
+
+    Iter(const XEdge_range *r, Index_ID idx);
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = XEdge;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const XEdge *;
+    using reference         = XEdge;
+
+    XEdge operator*() const { return XEdge(driver, sink); }
+
+    Iter &operator++();
+
+    bool operator==(const Iter &other) const {
+      return idx2 == other.idx2 && pos == other.pos && expand_pos == other.expand_pos;
+    }
+    bool operator!=(const Iter &other) const { return !(*this == other); }
+  };
+
+  XEdge_range(const Node &node, bool out);
+  XEdge_range(const Node_pin &pin, bool out);
+
+  Iter begin() const;
+  Iter end() const { return Iter(this, 0); }
+
+  bool empty() const { return begin() == end(); }
+};
@@ -1,6 +1,435 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
 #include "graph_core.hpp"
 
-Graph_core::Graph_core(std::string_view path, std::string_view name) {
-  // todo
+#include "iassert.hpp"
+
+Index_iter::Fast_iter Index_iter::begin() const {
+  Fast_iter it(gc, id, inp);
+  if (id)
+    gc->first_edge(it);
+  return it;
+}
+
+Index_iter::Fast_iter &Index_iter::Fast_iter::operator++() {
+  I(id);  // ++ after end
+  gc->next_edge(*this);
+  return *this;
+}
+
+Graph_core::Graph_core(std::string_view path, std::string_view name) : table(path, name) {
+  setup_table();
+}
+
+void Graph_core::setup_table() {
+  if (table.size())
+    return;
+
+  // Row zero is reserved so that Index_ID zero is never a valid id
+  table.emplace_back();
+  table.ref(0)->clear();
+  *ref_next16_free() = 0;
+  *ref_next64_free() = 0;
+}
+
+void Graph_core::clear() {
+  table.clear();
+  setup_table();
+}
+
+Index_ID Graph_core::alloc16() {
+  auto *free16 = ref_next16_free();
+  if (*free16) {
+    Index_ID id  = *free16;
+    auto *   ent = ref16(id);
+    I(!ent->is_valid());
+    *free16 = ent->get_next();
+    ent->clear();
+    return id;
+  }
+
+  uint32_t row = table.size();
+  table.emplace_back();  // may remap, get pointers after
+  table.ref(row)->clear();
+
+  // Return the first slot, and leave the rest in the free list (popped in order)
+  free16 = ref_next16_free();
+  for (uint32_t i = 3; i > 0; --i) {
+    Index_ID id  = (row << 2) + i;
+    auto *   ent = ref16(id);
+    ent->next    = *free16;
+    *free16      = id;
+  }
+
+  return row << 2;
+}
+
+uint32_t Graph_core::alloc64() {
+  auto *   free64 = ref_next64_free();
+  uint32_t row;
+  if (*free64) {
+    row     = *free64;
+    *free64 = ref64(row)->get_overflow();
+  } else {
+    row = table.size();
+    table.emplace_back();
+  }
+
+  auto *ent = table.ref(row);
+  ent->clear();
+  ent->entry64 = 1;
+
+  return row;
+}
+
+void Graph_core::free16(const Index_ID id) {
+  auto *ent = ref16(id);
+  ent->clear();
+
+  auto *free16 = ref_next16_free();
+  ent->next    = *free16;
+  *free16      = id;
+}
+
+void Graph_core::free64(uint32_t row) {
+  auto *ent = ref64(row);
+  ent->clear();
+  ent->entry64 = 1;
+
+  auto *free64 = ref_next64_free();
+  ent->next    = *free64;
+  *free64      = row;
+}
+
+void Graph_core::add_edge_int(const Index_ID id, uint32_t val) {
+  I(val);
+
+  auto *ent = ref16(id);
+  if (ent->edge[0] == 0) {
+    ent->edge[0] = val;
+    return;
+  }
+
+  if (!ent->overflow) {
+    if (ent->edge[1] == 0) {
+      ent->edge[1] = val;
+      return;
+    }
+
+    auto row = alloc64();
+    ent      = ref16(id);  // alloc64 can remap the table
+
+    auto *ovf    = ref64(row);
+    ovf->edge[0] = ent->edge[1];
+    ovf->edge[1] = val;
+
+    ent->edge[1]  = row;
+    ent->overflow = 1;
+    return;
+  }
+
+  // Only the head of the overflow chain can have space. Other rows are full.
+  uint32_t head = ent->edge[1];
+  auto *   ovf  = ref64(head);
+  auto     n    = ovf->get_num_used();
+  if (n < Entry64::Num_edges) {
+    ovf->edge[n] = val;
+    return;
+  }
+
+  auto row = alloc64();
+  ent      = ref16(id);
+
+  ovf          = ref64(row);
+  ovf->edge[0] = val;
+  ovf->next    = head;
+
+  ent->edge[1] = row;
+}
+
+bool Graph_core::del_edge_int(const Index_ID id, uint32_t val) {
+  auto *ent = ref16(id);
+  if (ent->edge[0] == val) {
+    ent->edge[0] = 0;
+    return true;
+  }
+
+  if (!ent->overflow) {
+    if (ent->edge[1] == val) {
+      ent->edge[1] = 0;
+      return true;
+    }
+    return false;
+  }
+
+  uint32_t head   = ent->edge[1];
+  auto *   hovf   = ref64(head);
+  auto     h_last = hovf->get_num_used() - 1;
+  I(h_last >= 0);  // empty rows are released
+
+  for (uint32_t row = head; row; row = ref64(row)->get_overflow()) {
+    auto *ovf = ref64(row);
+    for (int i = 0; i < Entry64::Num_edges; ++i) {
+      if (ovf->edge[i] != val)
+        continue;
+
+      // swap-remove with the last edge in the head to keep all the rows packed
+      ovf->edge[i]         = hovf->edge[h_last];
+      hovf->edge[h_last]   = 0;
+
+      if (h_last == 0) {
+        auto next = hovf->get_overflow();
+        free64(head);
+        if (next) {
+          ent->edge[1] = next;
+        } else {
+          ent->edge[1]  = 0;
+          ent->overflow = 0;
+        }
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void Graph_core::del_all_edges(const Index_ID id) {
+  std::vector<uint32_t> edges;
+
+  auto *ent = ref16(id);
+  uint32_t e0 = ent->edge[0];
+  uint32_t e1 = ent->edge[1];
+  if (e0)
+    edges.emplace_back(e0);
+  if (!ent->overflow && e1)
+    edges.emplace_back(e1);
+
+  uint32_t row = ent->get_overflow();
+  while (row) {
+    auto *ovf = ref64(row);
+    for (int i = 0; i < Entry64::Num_edges && ovf->edge[i]; ++i) {
+      uint32_t val = ovf->edge[i];
+      edges.emplace_back(val);
+    }
+    auto next = ovf->get_overflow();
+    free64(row);
+    row = next;
+  }
+
+  ent->edge[0]  = 0;
+  ent->edge[1]  = 0;
+  ent->overflow = 0;
+
+  for (auto val : edges) {
+    Index_ID other = val & Index_mask;
+    if (other == id)
+      continue;  // self loop, already gone
+
+    bool found;
+    if (val & Input_bit)
+      found = del_edge_int(other, id);  // other is driver, remove the output
+    else
+      found = del_edge_int(other, id | Input_bit);
+    I(found);
+    (void)found;
+  }
+}
+
+void Graph_core::scan_edge(Index_iter::Fast_iter &it) const {
+  const auto *ent = ref16(it.id);
+
+  if (it.row == 0) {
+    int n_inline = ent->overflow ? 1 : 2;
+    for (; it.pos < n_inline; ++it.pos) {
+      auto val = ent->edge[it.pos];
+      if (val && ((val & Input_bit) != 0) == it.inp) {
+        it.val = val & Index_mask;
+        return;
+      }
+    }
+    it.row = ent->get_overflow();
+    it.pos = 0;
+  }
+
+  while (it.row) {
+    const auto *ovf = ref64(it.row);
+    for (; it.pos < Entry64::Num_edges; ++it.pos) {
+      auto val = ovf->edge[it.pos];
+      if (val == 0)
+        break;  // rows are packed
+      if (((val & Input_bit) != 0) == it.inp) {
+        it.val = val & Index_mask;
+        return;
+      }
+    }
+    it.row = ovf->get_overflow();
+    it.pos = 0;
+  }
+
+  it.id  = 0;
+  it.pos = 0;
+  it.val = 0;
+}
+
+void Graph_core::add_edge(const Index_ID sink_id, const Index_ID driver_id) {
+  I(is_valid(sink_id) && is_valid(driver_id));
+
+  add_edge_int(driver_id, sink_id);
+  add_edge_int(sink_id, driver_id | Input_bit);
+
+  ref16(driver_id)->driver_set = 1;
+  ref16(sink_id)->sink_set     = 1;
+}
+
+void Graph_core::del_edge(const Index_ID sink_id, const Index_ID driver_id) {
+  I(is_valid(sink_id) && is_valid(driver_id));
+
+  bool found_out = del_edge_int(driver_id, sink_id);
+  bool found_inp = del_edge_int(sink_id, driver_id | Input_bit);
+  I(found_out == found_inp);
+  (void)found_out;
+  (void)found_inp;
+}
+
+const std::vector<Index_ID> Graph_core::get_setup_drivers(const Index_ID master_root_id) const {
+  I(ref16(master_root_id)->is_master_root());
+
+  std::vector<Index_ID> v;
+  Index_ID              id = master_root_id;
+  do {
+    const auto *ent = ref16(id);
+    if (ent->is_driver_set())
+      v.emplace_back(id);
+    id = ent->get_next();
+  } while (id != master_root_id);
+
+  return v;
+}
+
+const std::vector<Index_ID> Graph_core::get_setup_sinks(const Index_ID master_root_id) const {
+  I(ref16(master_root_id)->is_master_root());
+
+  std::vector<Index_ID> v;
+  Index_ID              id = master_root_id;
+  do {
+    const auto *ent = ref16(id);
+    if (ent->is_sink_set())
+      v.emplace_back(id);
+    id = ent->get_next();
+  } while (id != master_root_id);
+
+  return v;
+}
+
+Index_ID Graph_core::fast_next(Index_ID start) const {
+  const uint32_t sz = table.size();
+
+  uint32_t id = start + 1;
+  while ((id >> 2) < sz) {
+    uint32_t row = id >> 2;
+    if (row == 0 || is_entry64_row(row)) {
+      id = (row + 1) << 2;
+      continue;
+    }
+    const auto *ent = ref16(id);
+    if (ent->is_valid() && ent->is_master_root())
+      return id;
+    ++id;
+  }
+
+  return 0;
+}
+
+uint8_t Graph_core::get_type(const Index_ID master_root_id) const {
+  return ref16(get_master_root(master_root_id))->get_type();
+}
+
+void Graph_core::set_type(const Index_ID master_root_id, uint8_t type) {
+  ref16(get_master_root(master_root_id))->pid_or_type = type;
+}
+
+Port_ID Graph_core::get_pid(const Index_ID master_root_id) const {
+  I(is_valid(master_root_id));
+  return ref16(master_root_id)->get_pid();
+}
+
+Index_ID Graph_core::get_master_root(const Index_ID id) const {
+  I(is_valid(id));
+
+  Index_ID cur = id;
+  while (!ref16(cur)->is_master_root()) {
+    cur = ref16(cur)->get_next();
+    I(cur != id);  // ring without master_root
+  }
+
+  return cur;
+}
+
+Index_ID Graph_core::find_master(const Index_ID master_root_id, const Port_ID pid) const {
+  I(ref16(master_root_id)->is_master_root());
+  if (pid == 0)
+    return master_root_id;
+
+  for (Index_ID id = ref16(master_root_id)->get_next(); id != master_root_id; id = ref16(id)->get_next()) {
+    if (ref16(id)->get_pid() == pid)
+      return id;
+  }
+
+  return 0;
+}
+
+Index_ID Graph_core::create_master_root(uint8_t type) {
+  auto  id  = alloc16();
+  auto *ent = ref16(id);
+
+  ent->valid       = 1;
+  ent->master_root = 1;
+  ent->pid_or_type = type;
+  ent->next        = id;
+
+  return id;
+}
+
+Index_ID Graph_core::create_master(const Index_ID master_root_id, const Port_ID pid) {
+  I(pid);  // pid zero is the master_root
+  I(ref16(master_root_id)->is_master_root());
+  I(find_master(master_root_id, pid) == 0);
+
+  auto  id   = alloc16();
+  auto *ent  = ref16(id);
+  auto *root = ref16(master_root_id);
+
+  ent->valid       = 1;
+  ent->pid_or_type = pid;
+  ent->next        = root->next;
+  root->next       = id;
+
+  return id;
+}
+
+void Graph_core::del(const Index_ID s) {
+  I(is_valid(s));
+
+  auto *ent = ref16(s);
+  if (!ent->is_master_root()) {
+    Index_ID prev = s;
+    while (ref16(prev)->get_next() != s) prev = ref16(prev)->get_next();
+    ref16(prev)->next = ent->get_next();
+
+    del_all_edges(s);
+    free16(s);
+    return;
+  }
+
+  Index_ID id = ent->get_next();
+  while (id != s) {
+    auto next = ref16(id)->get_next();
+    del_all_edges(id);
+    free16(id);
+    id = next;
+  }
+
+  del_all_edges(s);
+  free16(s);
 }
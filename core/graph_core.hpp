@@ -2,6 +2,7 @@
 #pragma once
 
 #include "lgraph_base_core.hpp"
+#include "mmap_vector.hpp"
 
 #include <cassert>
 #include <vector>
@@ -9,113 +10,186 @@
 
 class Graph_core;
 
+// Iterates over the inputs (drivers) or outputs (sinks) of a single Entry16.
+// Edges must not be deleted from the entry while iterating (collect them
+// first), nodes/masters can be created.
 class Index_iter {
 protected:
   Graph_core     *gc;
+  const Index_ID  id;
+  const bool      inp;
 
 public:
   class Fast_iter {
   private:
     Graph_core     *gc;
-    Index_ID        id;
-    // May need to add extra data here
+    Index_ID        id;   // Entry16 being traversed (0 for end)
+    uint32_t        row;  // Entry64 overflow row, zero while in the Entry16 inline edges
+    uint8_t         pos;  // edge position in the Entry16 or Entry64
+    bool            inp;
+    Index_ID        val;  // cached other side of the edge
+
+    friend class Graph_core;
 
   public:
-    constexpr Fast_iter(Graph_core *_gc, const Index_ID _id ) : gc(_gc), id(_id)   {}
-    constexpr Fast_iter(const Fast_iter &it) : gc(it.gc), id(it.id) {}
+    constexpr Fast_iter(Graph_core *_gc, const Index_ID _id, bool _inp) : gc(_gc), id(_id), row(0), pos(0), inp(_inp), val(0) {}
+    constexpr Fast_iter(const Fast_iter &it) : gc(it.gc), id(it.id), row(it.row), pos(it.pos), inp(it.inp), val(it.val) {}
 
     constexpr Fast_iter &operator=(const Fast_iter &it) {
-      gc = it.gc;
-      id = it.id;
+      gc  = it.gc;
+      id  = it.id;
+      row = it.row;
+      pos = it.pos;
+      inp = it.inp;
+      val = it.val;
       return *this;
     }
 
-    Fast_iter &operator++(); // call Graph_core::xx if needed
+    Fast_iter &operator++(); // call Graph_core::next_edge
 
-    constexpr bool operator!=(const Fast_iter &other) const { assert(gc==other.gc); return id != other.id; }
-    constexpr bool operator==(const Fast_iter &other) const { assert(gc==other.gc); return id == other.id; }
+    constexpr bool operator!=(const Fast_iter &other) const { assert(gc==other.gc); return id != other.id || row != other.row || pos != other.pos; }
+    constexpr bool operator==(const Fast_iter &other) const { assert(gc==other.gc); return id == other.id && row == other.row && pos == other.pos; }
 
-    constexpr Index_ID operator*() const { return id; }
+    constexpr Index_ID operator*() const { return val; }
   };
 
   Index_iter() = delete;
-  explicit Index_iter(Graph_core *_gc) : gc(_gc) {}
+  explicit Index_iter(Graph_core *_gc, const Index_ID _id, bool _inp) : gc(_gc), id(_id), inp(_inp) {}
 
-  Fast_iter begin() const; // Find first elemnt in Graph_core
-  Fast_iter end() const { return Fast_iter(gc, 0); } // More likely 0 ID for end
+  Fast_iter begin() const; // Find first edge in Graph_core
+  Fast_iter end() const { return Fast_iter(gc, 0, inp); }
 };
 
+// Graph_core packs 4 Entry16 (master_root or master) per 64 byte table row.
+// Edges that do not fit in the Entry16 spill to a chain of Entry64 overflow
+// rows in the same table. Index_ID for Entry16 is row*4+slot (row 0 is
+// reserved, so Index_ID zero is never used).
+//
+// Each edge is a 32bit word: 31 bits for the other Index_ID, and the MSB set
+// when the edge is an input (the other side is the driver). Zero is an empty
+// edge slot.
 class Graph_core {
 protected:
+  static constexpr uint32_t Input_bit  = (1UL << Index_bits);
+  static constexpr uint32_t Index_mask = Input_bit - 1;
+
   class __attribute__((packed)) Entry64 { // AKA Overflow Entry
-    uint8_t  edge_storage[64-1];
-    uint8_t  last_byte;
-  protected:
-    constexpr Entry64() : edge_storage{0,},last_byte(0) {
-    }
-    void set_input()  { last_byte |= 0x80; } // set 8th bit
-    void set_output() { last_byte &= 0x7F; } // clear 8th bit
+  public:
+    static constexpr int Num_edges = 15;
+
+    uint32_t next:31;                 // next Entry64 row in the overflow chain, zero if last
+    uint32_t entry64:1;               // always 1 (shares the bit with Entry16::entry64)
+    uint32_t edge[Num_edges];
 
-    constexpr Index_ID get_overflow() const; // returns the next Entry64 if overflow, zero otherwise
+    void clear() {
+      next    = 0;
+      entry64 = 0;
+      for (int i = 0; i < Num_edges; ++i) edge[i] = 0;
+    }
 
-    void fill_inp(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    void fill_out(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    bool try_add_driver(Index_ID id); // return false if there was no space
-    bool try_add_sink(Index_ID id); // return false if there was no space
+    constexpr uint32_t get_overflow() const { return next; }
 
+    int get_num_used() const { // edges are kept packed at the front
+      for (int i = 0; i < Num_edges; ++i) {
+        if (edge[i] == 0) return i;
+      }
+      return Num_edges;
+    }
   };
 
   class __attribute__((packed)) Entry16 { // AKA master or master_root entry
-    uint8_t  edge_storage[16-5];
-    uint16_t edge_storate_or_pid_bits; // edge_store in master_root, 16 pid bits in master
-    uint8_t  pid_bits_or_type:6;       // type in master_root, 6 pid bits in master
-    uint8_t  driver_set:1;
-    uint8_t  sink_set:1;               // different from inp_mask!=0 because bidirectional edges
-    uint8_t  ptrs;                     // master_next in master_root (master_prev in master) and overflow_next
-    uint8_t  inp_mask:7;               // 7bits inp_mask (8 or 0b111 means not used)
-    uint8_t  master_root:1;            // for speed good to remember root vs master (pid==0?)
-  protected:
-    constexpr Entry16() : edge_storage{0,}, edge_storate_or_pid_bits(0), pid_bits_or_type(0), driver_set(0), sink_set(0), ptrs(0xFF), inp_mask(0), master_root(0) {
+  public:
+    uint32_t pid_or_type:22;          // type in master_root, pid in master
+    uint32_t driver_set:1;
+    uint32_t sink_set:1;              // different from having inputs because bidirectional edges
+    uint32_t overflow:1;              // edge[1] points to the first Entry64 row
+    uint32_t master_root:1;           // for speed good to remember root vs master (pid==0?)
+    uint32_t valid:1;                 // zero when in the free list
+    uint32_t unused:4;
+    uint32_t entry64:1;               // always 0 (the row is Entry16 when the first slot has it clear)
+    uint32_t next;                    // master ring (root->master->...->root), or next free Entry16
+    uint32_t edge[2];
+
+    void clear() {
+      pid_or_type = 0;
+      driver_set  = 0;
+      sink_set    = 0;
+      overflow    = 0;
+      master_root = 0;
+      valid       = 0;
+      unused      = 0;
+      entry64     = 0;
+      next        = 0;
+      edge[0]     = 0;
+      edge[1]     = 0;
     }
 
-    void set_master_root();
-    void set_master();
-
-    constexpr Index_ID get_overflow() const; // returns the next Entry64 if overflow, zero otherwise
-    constexpr Index_ID get_next() const;     // returns the next Entry16 that is master, zero if none
+    constexpr uint32_t get_overflow() const { return overflow ? edge[1] : 0; }
+    constexpr uint32_t get_next() const { return next; }
 
     constexpr bool is_driver_set()  const { return driver_set; }
     constexpr bool is_sink_set()    const { return sink_set; }
     constexpr bool is_master_root() const { return master_root; }
+    constexpr bool is_valid()       const { return valid; }
 
-    constexpr uint8_t  get_type()   const { return pid_bits_or_type; }
+    constexpr uint8_t  get_type()   const { assert(master_root); return pid_or_type; }
     constexpr uint32_t get_pid()    const {
       if(is_master_root())
         return 0;
 
-      uint32_t pid = pid_bits_or_type;
-      pid <<=16;
-      pid  |= edge_storate_or_pid_bits;
-
-      return pid; //22 bits PID
+      return pid_or_type; //22 bits PID
     }
+  };
 
-    constexpr Index_ID get_master_root() const; // ptr to master root (zero if itself is root)
+  static_assert(sizeof(Entry64) == 64);
+  static_assert(sizeof(Entry16) == 16);
 
-    void fill_inp(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    void fill_out(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    bool try_add_driver(Index_ID id); // return false if there was no space
-    bool try_add_sink(Index_ID id); // return false if there was no space
+  mmap_lib::vector<Entry64> table;
 
-  };
+  // free list heads persisted in the table header
+  uint64_t *ref_next16_free() const { return table.ref_config_data(8);  } // Pointer to free Entry16
+  uint64_t *ref_next64_free() const { return table.ref_config_data(16); } // Pointer to free Entry64 rows
+
+  bool is_entry64_row(uint32_t row) const { return table[row].entry64; }
+
+  Entry16 *ref16(const Index_ID id) {
+    assert(id && (id >> 2) < table.size());
+    return reinterpret_cast<Entry16 *>(table.ref(id >> 2)) + (id & 3);
+  }
+  const Entry16 *ref16(const Index_ID id) const {
+    assert(id && (id >> 2) < table.size());
+    return reinterpret_cast<const Entry16 *>(table.ref(id >> 2)) + (id & 3);
+  }
+  Entry64 *ref64(uint32_t row) {
+    assert(row && is_entry64_row(row));
+    return table.ref(row);
+  }
+  const Entry64 *ref64(uint32_t row) const {
+    assert(row && is_entry64_row(row));
+    return table.ref(row);
+  }
+
+  Index_ID alloc16();
+  uint32_t alloc64();
+  void     free16(const Index_ID id);
+  void     free64(uint32_t row);
+
+  void add_edge_int(const Index_ID id, uint32_t val);
+  bool del_edge_int(const Index_ID id, uint32_t val);
+  void del_all_edges(const Index_ID id);
 
-  std::vector<Entry64> table; // to be replaced by mmap_lib::vector once it works
+  void setup_table();
 
-  Index_ID next12_free;       // Pointer to 12byte free chunks
-  Index_ID next48_free;       // Pointer to 48byte free chunks
+  void scan_edge(Index_iter::Fast_iter &it) const;
+  void first_edge(Index_iter::Fast_iter &it) const { it.row = 0; it.pos = 0; scan_edge(it); }
+  void next_edge(Index_iter::Fast_iter &it)  const { it.pos++; scan_edge(it); }
+
+  friend class Index_iter;
+  friend class Index_iter::Fast_iter;
 
 public:
   Graph_core(std::string_view path, std::string_view name);
+
   void add_edge(const Index_ID sink_id, const Index_ID driver_id); // Add edge from s->d and d->s
   void del_edge(const Index_ID sink_id, const Index_ID driver_id); // Remove both s->d and d->s
 
@@ -124,19 +198,24 @@ public:
   const std::vector<Index_ID> get_setup_sinks(const Index_ID master_root_id) const;    // the sinks set for master_root_id
 
   // unlike the const iterator, it should allow to delete edges/nodes while
-  //   // traversing
-  Index_ID fast_next(Index_ID start); // faster iterator returning all the master_root Index_ID (0 if last)
+  // traversing
+  Index_ID fast_next(Index_ID start) const; // faster iterator returning all the master_root Index_ID (0 if last)
+  Index_ID fast_first() const { return fast_next(0); }
 
   // Unlike get_setup_drivers, this returns all the drivers/sinks that reach
   // the s index. This can be a large list, so it is not a short vector but an
   // iterator.
-  Index_iter out_ids(const Index_ID s);  // Iterate over the out edges of s (*it is Index_ID)
-  Index_iter inp_ids(const Index_ID s);  // Iterate over the inp edges of s
+  Index_iter out_ids(const Index_ID s) { return Index_iter(this, s, false); } // Iterate over the out edges of s (*it is Index_ID)
+  Index_iter inp_ids(const Index_ID s) { return Index_iter(this, s, true);  } // Iterate over the inp edges of s
 
   uint8_t get_type(const Index_ID master_root_id) const;  // set/get type on the master_root id (s or pointed by s)
-  void    set_type(const Index_ID master_root_id);
+  void    set_type(const Index_ID master_root_id, uint8_t type);
+
+  Port_ID  get_pid(const Index_ID master_root_id) const; // pid for master or 0 for master_root
+  Index_ID get_master_root(const Index_ID id) const;     // id itself if it is a master_root
+  Index_ID find_master(const Index_ID master_root_id, const Port_ID pid) const; // 0 if the pid was never created
 
-  Port_ID get_pid(const Index_ID master_root_id) const; // pid for master or 0 for master_root
+  bool is_valid(const Index_ID id) const { return id && (id >> 2) < table.size() && !is_entry64_row(id >> 2) && ref16(id)->is_valid(); }
 
   // Create a master root node
   Index_ID create_master_root(uint8_t type);
@@ -144,6 +223,8 @@ public:
   Index_ID create_master(const Index_ID master_root_id, const Port_ID pid);
   // Delete node s, all related edges and masters (if master root)
   void del(const Index_ID s);
-};
 
+  void clear();
+  size_t size_bytes() const { return table.size() * sizeof(Entry64); }
+};
 
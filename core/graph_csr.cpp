@@ -0,0 +1,110 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_csr.hpp"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "iassert.hpp"
+#include "lgraph.hpp"
+
+Graph_csr::Graph_csr(std::string_view path, Lg_type_id lgid)
+    : out_offset(path, absl::StrCat("lg_", std::to_string(lgid), "_csr_out_offset"))
+    , out(path, absl::StrCat("lg_", std::to_string(lgid), "_csr_out"))
+    , inp_offset(path, absl::StrCat("lg_", std::to_string(lgid), "_csr_inp_offset"))
+    , inp(path, absl::StrCat("lg_", std::to_string(lgid), "_csr_inp"))
+    , out_bits(path, absl::StrCat("lg_", std::to_string(lgid), "_csr_out_bits"))
+    , inp_bits(path, absl::StrCat("lg_", std::to_string(lgid), "_csr_inp_bits")) {}
+
+void Graph_csr::clear() {
+  out_offset.clear();
+  out.clear();
+  inp_offset.clear();
+  inp.clear();
+  out_bits.clear();
+  inp_bits.clear();
+}
+
+void Graph_csr::build(const LGraph *lg, bool with_bits) {
+  clear();
+
+  const auto &node_internal = lg->node_internal;
+  const auto  sz            = node_internal.size();
+
+  std::vector<Edge> out_tmp;
+  std::vector<Edge> inp_tmp;
+
+  for (Index_ID nid = 0; nid < sz; nid.value++) {
+    out_offset.emplace_back(out.size());
+    inp_offset.emplace_back(inp.size());
+
+    if (!node_internal[nid].is_valid() || !node_internal[nid].is_master_root())
+      continue;
+
+    out_tmp.clear();
+    inp_tmp.clear();
+
+    Index_ID idx2 = nid;
+    while (true) {
+      const auto &node_int = node_internal[idx2];
+      const auto  self_idx = lg->get_root_idx(idx2);
+      const auto  self_pid = node_int.get_dst_pid();
+
+      auto            n_out = node_int.get_num_local_outputs();
+      const Edge_raw *redge = node_int.get_output_begin();
+      for (uint8_t i = 0; i < n_out; i++, redge += redge->next_node_inc()) {
+        out_tmp.emplace_back(self_idx, self_pid, redge->get_idx(), redge->get_inp_pid());
+      }
+      if (lg->is_hyper_root(idx2)) {
+        for (const auto &s : lg->hyper.get_sinks(idx2)) {
+          out_tmp.emplace_back(self_idx, self_pid, s.idx, s.pid);
+        }
+      }
+
+      auto n_inp = node_int.get_num_local_inputs();
+      redge      = node_int.get_input_begin();
+      for (uint8_t i = 0; i < n_inp; i++, redge += redge->next_node_inc()) {
+        inp_tmp.emplace_back(redge->get_idx(), redge->get_inp_pid(), self_idx, self_pid);
+      }
+
+      if (node_int.is_last_state())
+        break;
+      idx2 = node_int.get_next();
+    }
+
+    // stable: keeps the insertion order of the edges on the same pin
+    std::stable_sort(out_tmp.begin(), out_tmp.end(), [](const Edge &a, const Edge &b) { return a.driver_pid < b.driver_pid; });
+    std::stable_sort(inp_tmp.begin(), inp_tmp.end(), [](const Edge &a, const Edge &b) { return a.sink_pid < b.sink_pid; });
+
+    for (const auto &e : out_tmp) out.emplace_back(e);
+    for (const auto &e : inp_tmp) inp.emplace_back(e);
+  }
+
+  out_offset.emplace_back(out.size());
+  inp_offset.emplace_back(inp.size());
+
+  if (with_bits) {
+    for (const auto &e : out) out_bits.emplace_back(lg->get_bits(e.driver_idx));
+    for (const auto &e : inp) inp_bits.emplace_back(lg->get_bits(e.driver_idx));
+  }
+
+  *ref_edit_epoch() = lg->get_edit_epoch();
+  *ref_bits_epoch() = lg->get_bits_epoch();
+  *ref_built()      = 1;
+  *ref_bits_built() = with_bits ? 1 : 0;
+}
+
+Graph_csr::Span Graph_csr::out_edges(const Node &node) const {
+  return out_edges(node.get_compact_class().get_nid());
+}
+
+Graph_csr::Span Graph_csr::inp_edges(const Node &node) const {
+  return inp_edges(node.get_compact_class().get_nid());
+}
+
+XEdge Graph_csr::get_xedge(LGraph *lg, const Edge &e) const {
+  Node_pin dpin(lg, lg, Hierarchy_tree::invalid_index(), e.driver_idx, e.driver_pid, false);
+  Node_pin spin(lg, lg, Hierarchy_tree::invalid_index(), e.sink_idx, e.sink_pid, true);
+
+  return XEdge(dpin, spin);
+}
@@ -0,0 +1,96 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include "lgraph_base_core.hpp"
+#include "mmap_vector.hpp"
+
+class LGraph;
+class Node;
+class XEdge;
+
+// Immutable compressed-sparse-row view of a (non-hierarchical) LGraph.
+//
+// All the edges of a node are contiguous, sorted by pid (driver pid for
+// outputs, sink pid for inputs). The view is built by LGraph::freeze() and it
+// is mmap persisted next to the lgdb. It stays valid only while the LGraph
+// edit epoch does not change (any node/pin/edge add or delete).
+class Graph_csr {
+public:
+  struct __attribute__((packed)) Edge {
+    uint32_t driver_idx;  // root idx of the driver pin
+    uint32_t sink_idx;    // root idx of the sink pin
+    Port_ID  driver_pid;
+    Port_ID  sink_pid;
+
+    constexpr Edge() : driver_idx(0), sink_idx(0), driver_pid(0), sink_pid(0) {}
+    constexpr Edge(uint32_t d_idx, Port_ID d_pid, uint32_t s_idx, Port_ID s_pid)
+        : driver_idx(d_idx), sink_idx(s_idx), driver_pid(d_pid), sink_pid(s_pid) {}
+  };
+
+  class Span {
+  protected:
+    const Edge *b;
+    const Edge *e;
+
+  public:
+    constexpr Span(const Edge *_b, const Edge *_e) : b(_b), e(_e) {}
+
+    constexpr const Edge *begin() const { return b; }
+    constexpr const Edge *end() const { return e; }
+    constexpr size_t      size() const { return e - b; }
+    constexpr bool        empty() const { return b == e; }
+  };
+
+protected:
+  mmap_lib::vector<uint32_t> out_offset;  // out_offset[nid]..out_offset[nid+1] edges in out (nid is master_root)
+  mmap_lib::vector<Edge>     out;
+  mmap_lib::vector<uint32_t> inp_offset;
+  mmap_lib::vector<Edge>     inp;
+  mmap_lib::vector<Bits_t>   out_bits;  // Optional, driver pin bits for each out edge
+  mmap_lib::vector<Bits_t>   inp_bits;  // Optional, driver pin bits for each inp edge
+
+  // header persisted in out_offset
+  uint64_t *ref_edit_epoch() const { return out_offset.ref_config_data(8); }
+  uint64_t *ref_bits_epoch() const { return out_offset.ref_config_data(16); }
+  uint64_t *ref_built() const { return out_offset.ref_config_data(24); }
+  uint64_t *ref_bits_built() const { return out_offset.ref_config_data(32); }
+
+  friend class LGraph;
+
+  void build(const LGraph *lg, bool with_bits);
+
+public:
+  Graph_csr(std::string_view path, Lg_type_id lgid);
+
+  void clear();
+
+  bool is_fresh(uint64_t edit_epoch) const { return *ref_built() && *ref_edit_epoch() == edit_epoch; }
+  bool has_bits(uint64_t bits_epoch) const { return *ref_bits_built() && *ref_bits_epoch() == bits_epoch; }
+
+  size_t get_num_edges() const { return out.size(); }
+
+  Span out_edges(Index_ID nid) const {
+    I(nid + 1 < out_offset.size());
+    const auto *base = out.begin();
+    return Span(base + out_offset[nid], base + out_offset[nid + 1]);
+  }
+  Span inp_edges(Index_ID nid) const {
+    I(nid + 1 < inp_offset.size());
+    const auto *base = inp.begin();
+    return Span(base + inp_offset[nid], base + inp_offset[nid + 1]);
+  }
+
+  // Class (non-hierarchical) edges of node, the hierarchy index is ignored
+  Span out_edges(const Node &node) const;
+  Span inp_edges(const Node &node) const;
+
+  Bits_t get_bits(const Edge *e) const {  // e must come from out_edges/inp_edges of a freeze(true) view
+    I(*ref_bits_built());                  // a view frozen without bits does not have them
+    if (e >= out.begin() && e < out.end())
+      return out_bits[e - out.begin()];
+    I(e >= inp.begin() && e < inp.end());
+    return inp_bits[e - inp.begin()];
+  }
+
+  XEdge get_xedge(LGraph *lg, const Edge &e) const;  // Materialize as a non-hierarchical XEdge
+};
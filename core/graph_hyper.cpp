@@ -0,0 +1,225 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_hyper.hpp"
+
+#include "absl/strings/str_cat.h"
+
+Graph_hyper::Graph_hyper(std::string_view _path, Lg_type_id lgid)
+    : id2block(_path, absl::StrCat("lg_", std::to_string(lgid), "_hyper"))
+    , sinks(_path, absl::StrCat("lg_", std::to_string(lgid), "_hyper_sinks"))
+    , loaded(false) {}
+
+void Graph_hyper::load() const {
+  for (uint32_t id = 1; id < id2block.size(); ++id) {
+    if (id2block[id].driver)
+      driver2id[id2block[id].driver] = id;
+  }
+  loaded = true;
+}
+
+uint32_t Graph_hyper::get_id(Index_ID driver_idx) const {
+  if (!loaded)
+    load();
+
+  auto it = driver2id.find(driver_idx.value);
+  if (it == driver2id.end())
+    return 0;
+  return it->second;
+}
+
+uint32_t Graph_hyper::get_free_id(bool with_block) const {
+  for (uint32_t id = 1; id < id2block.size(); ++id) {
+    const auto &block = id2block[id];
+    if (block.driver == 0 && (block.capacity != 0) == with_block)
+      return id;
+  }
+  return 0;
+}
+
+uint32_t Graph_hyper::alloc_block(uint32_t capacity) {
+  uint32_t offset = sinks.size();
+  sinks.reserve(offset + capacity);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    sinks.emplace_back();
+  }
+  return offset;
+}
+
+void Graph_hyper::begin_concurrent_read() const {
+  if (!loaded)
+    load();
+  (void)id2block.size();  // maps them
+  (void)sinks.size();
+  id2block.gc_pin();
+  sinks.gc_pin();
+}
+
+void Graph_hyper::end_concurrent_read() const {
+  sinks.gc_unpin();
+  id2block.gc_unpin();
+}
+
+void Graph_hyper::clear() {
+  id2block.clear();
+  sinks.clear();
+  driver2id.clear();
+  id2pos.clear();
+  loaded = true;
+}
+
+void Graph_hyper::create(Index_ID driver_idx) {
+  I(!is_hyper(driver_idx));
+
+  if (id2block.size() == 0)
+    id2block.emplace_back();  // id 0 is the not found case
+
+  auto id = get_free_id(true);
+  if (id) {
+    auto *block   = id2block.ref(id);
+    block->driver = driver_idx.value;
+    block->size   = 0;
+  } else {
+    auto offset = alloc_block(min_capacity);
+    id          = get_free_id(false);
+    if (id == 0) {
+      id = id2block.size();
+      id2block.emplace_back();
+    }
+    id2block.set(id, driver_idx.value, offset, min_capacity);
+  }
+
+  driver2id[driver_idx.value] = id;
+}
+
+void Graph_hyper::erase(Index_ID driver_idx) {
+  auto id = get_id(driver_idx);
+  I(id);
+
+  auto *block   = id2block.ref(id);
+  block->driver = 0;  // free id, the block stays for the next create/grow
+  block->size   = 0;
+  driver2id.erase(driver_idx.value);
+  id2pos.erase(id);
+}
+
+void Graph_hyper::grow(uint32_t id) {
+  const auto old = id2block[id];
+  I(old.size == old.capacity);
+
+  const uint32_t capacity = 2 * old.capacity;
+
+  if (old.offset + old.capacity == sinks.size()) {  // last block, grow in place
+    alloc_block(old.capacity);
+    id2block.ref(id)->capacity = capacity;
+    return;
+  }
+
+  uint32_t offset;
+  uint32_t free_id = 0;
+  for (uint32_t i = 1; i < id2block.size(); ++i) {
+    if (id2block[i].driver == 0 && id2block[i].capacity == capacity) {
+      free_id = i;
+      break;
+    }
+  }
+  if (free_id) {  // swap blocks with the free id
+    offset = id2block[free_id].offset;
+  } else {
+    offset  = alloc_block(capacity);
+    free_id = get_free_id(false);
+    if (free_id == 0) {
+      free_id = id2block.size();
+      id2block.emplace_back();
+    }
+  }
+
+  for (uint32_t i = 0; i < old.size; ++i) {
+    const auto s = sinks[old.offset + i];
+    sinks.set(offset + i, s);
+  }
+
+  id2block.set(free_id, 0, old.offset, old.capacity);
+
+  auto *block     = id2block.ref(id);
+  block->offset   = offset;
+  block->capacity = capacity;
+}
+
+void Graph_hyper::add(Index_ID driver_idx, Index_ID sink_idx, Port_ID sink_pid) {
+  auto id = get_id(driver_idx);
+  I(id);
+
+  if (id2block[id].size == id2block[id].capacity)
+    grow(id);
+
+  auto *block = id2block.ref(id);
+
+  auto it = id2pos.find(id);
+  if (it != id2pos.end())
+    it->second.try_emplace(get_key(sink_idx.value, sink_pid), block->size);  // first one wins with multi-edges
+
+  sinks.set(block->offset + block->size, sink_idx.value, sink_pid);
+  block->size++;
+}
+
+void Graph_hyper::del_pos(uint32_t id, uint32_t pos) {
+  auto *block = id2block.ref(id);
+  I(pos < block->size);
+
+  auto it = id2pos.find(id);
+
+  const auto s   = sinks[block->offset + pos];
+  const auto key = get_key(s.idx, s.pid);
+  if (it != id2pos.end()) {
+    auto it2 = it->second.find(key);
+    if (it2 != it->second.end() && it2->second == pos)
+      it->second.erase(it2);
+  }
+
+  uint32_t last = block->size - 1;
+  if (pos != last) {
+    const auto moved = sinks[block->offset + last];
+    sinks.set(block->offset + pos, moved);
+    if (it != id2pos.end()) {
+      auto it2 = it->second.find(get_key(moved.idx, moved.pid));
+      if (it2 != it->second.end() && it2->second == last)
+        it2->second = pos;
+    }
+  }
+  block->size--;
+}
+
+bool Graph_hyper::del(Index_ID driver_idx, Index_ID sink_idx, Port_ID sink_pid) {
+  auto id = get_id(driver_idx);
+  I(id);
+
+  const auto &block = id2block[id];
+
+  auto it = id2pos.find(id);
+  if (it == id2pos.end()) {
+    it = id2pos.try_emplace(id).first;
+    it->second.reserve(block.size);
+    for (uint32_t pos = 0; pos < block.size; ++pos) {
+      const auto &s = sinks[block.offset + pos];
+      it->second.try_emplace(get_key(s.idx, s.pid), pos);
+    }
+  }
+
+  const auto key = get_key(sink_idx.value, sink_pid);
+  auto       it2 = it->second.find(key);
+  if (it2 != it->second.end()) {
+    del_pos(id, it2->second);
+    return true;
+  }
+
+  // Multi-edges to the same sink only keep the first position, find the rest
+  for (uint32_t pos = 0; pos < block.size; ++pos) {
+    const auto &s = sinks[block.offset + pos];
+    if (s.idx == sink_idx.value && s.pid == sink_pid) {
+      del_pos(id, pos);
+      return true;
+    }
+  }
+
+  return false;
+}
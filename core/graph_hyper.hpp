@@ -0,0 +1,134 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "iassert.hpp"
+#include "lgraph_base_core.hpp"
+#include "mmap_vector.hpp"
+
+// Driver side storage for high fan-out nets (clock, reset, enable...).
+//
+// Node_internal keeps a handful of edges per entry, so a driver pin with
+// thousands of sinks becomes a long overflow chain: each add walks it for
+// space, and each delete walks it for the edge. Once a driver pin reaches
+// threshold out edges, LGraph_Base moves its sinks to a hyper edge: a
+// contiguous block per driver (add is an append, delete is a swap-remove).
+// Only the driver side moves, the sink pins still keep the input edge in
+// Node_internal. The pin root is flagged (Node_internal::is_hyper) so that the
+// edge walkers visit the block transparently.
+//
+// All the blocks share one mmap sinks vector. A full block moves to a block
+// twice as large, and the old one is left to a free id for reuse (free ids
+// keep their block, so the free space is persisted too). There are only a
+// few hyper edges per graph, the id table is scanned linearly.
+class Graph_hyper {
+public:
+  struct __attribute__((packed)) Sink {
+    uint32_t idx;  // root idx of the sink pin
+    Port_ID  pid;
+
+    constexpr Sink() : idx(0), pid(0) {}
+    constexpr Sink(uint32_t _idx, Port_ID _pid) : idx(_idx), pid(_pid) {}
+  };
+
+  class Span {
+  protected:
+    const Sink *b;
+    const Sink *e;
+
+  public:
+    constexpr Span(const Sink *_b, const Sink *_e) : b(_b), e(_e) {}
+
+    constexpr const Sink *begin() const { return b; }
+    constexpr const Sink *end() const { return e; }
+    constexpr size_t      size() const { return e - b; }
+    constexpr bool        empty() const { return b == e; }
+  };
+
+  // Out edges in a driver pin to become a hyper edge
+  static constexpr uint32_t threshold = 256;
+
+protected:
+  struct Block {
+    uint32_t driver;    // root idx of the driver pin (0 for free ids)
+    uint32_t offset;    // first sink in sinks
+    uint32_t size;      // sinks in use
+    uint32_t capacity;  // 0 if the id has no block
+
+    constexpr Block() : driver(0), offset(0), size(0), capacity(0) {}
+    constexpr Block(uint32_t _driver, uint32_t _offset, uint32_t _capacity)
+        : driver(_driver), offset(_offset), size(0), capacity(_capacity) {}
+  };
+
+  // Sinks in a new block (blocks double when full)
+  static constexpr uint32_t min_capacity = 2 * threshold;
+
+  mmap_lib::vector<Block> id2block;  // hyper id to its sinks block (id 0 unused)
+  mmap_lib::vector<Sink>  sinks;     // sinks of all the hyper edges
+
+  // Built on the first lookup. Not thread safe: begin_concurrent_read builds
+  // it before parallel readers use get_id.
+  mutable bool                                    loaded;
+  mutable absl::flat_hash_map<uint32_t, uint32_t> driver2id;
+
+  // Sink position in the hyper edge, built on the first delete of each id
+  absl::flat_hash_map<uint32_t, absl::flat_hash_map<uint64_t, uint32_t>> id2pos;
+
+  static constexpr uint64_t get_key(uint32_t idx, Port_ID pid) { return (static_cast<uint64_t>(idx) << 32) | pid; }
+
+  void     load() const;
+  uint32_t get_id(Index_ID driver_idx) const;
+  uint32_t get_free_id(bool with_block) const;  // 0 if none
+  uint32_t alloc_block(uint32_t capacity);      // offset of a new block at the end of sinks
+  void     grow(uint32_t id);
+  void     del_pos(uint32_t id, uint32_t pos);
+
+public:
+  Graph_hyper(std::string_view path, Lg_type_id lgid);
+
+  void clear();
+
+  // Between begin and end, any thread can read the hyper edges (no edits):
+  // the driver table is built and the sinks are mapped and pinned upfront.
+  void begin_concurrent_read() const;
+  void end_concurrent_read() const;
+
+  bool is_hyper(Index_ID driver_idx) const { return get_id(driver_idx) != 0; }
+
+  void create(Index_ID driver_idx);
+  void erase(Index_ID driver_idx);  // driver deleted, drop all its sinks
+
+  void add(Index_ID driver_idx, Index_ID sink_idx, Port_ID sink_pid);
+  bool del(Index_ID driver_idx, Index_ID sink_idx, Port_ID sink_pid);
+
+  // Delete the sinks where fn(sink) is true, returns the number deleted
+  template <typename FN>
+  size_t del_if(Index_ID driver_idx, FN fn) {
+    auto id = get_id(driver_idx);
+    I(id);
+    size_t n_deleted = 0;
+    for (auto pos = id2block[id].size; pos > 0; --pos) {
+      if (fn(sinks[id2block[id].offset + pos - 1])) {
+        del_pos(id, pos - 1);
+        ++n_deleted;
+      }
+    }
+    return n_deleted;
+  }
+
+  Span get_sinks(Index_ID driver_idx) const {
+    auto id = get_id(driver_idx);
+    if (id == 0)
+      return Span(nullptr, nullptr);
+    const auto &block = id2block[id];
+    const auto *base  = sinks.begin() + block.offset;
+    return Span(base, base + block.size);
+  }
+
+  size_t get_num_sinks(Index_ID driver_idx) const {
+    auto id = get_id(driver_idx);
+    return id ? id2block[id].size : 0;
+  }
+};
@@ -0,0 +1,43 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_journal.hpp"
+
+#include <sys/stat.h>
+
+#include "absl/strings/str_cat.h"
+
+Graph_journal::Graph_journal(std::string_view path, Lg_type_id lgid)
+    : name(absl::StrCat(path, "/lg_", std::to_string(lgid), "_journal"))
+    , log(path, absl::StrCat("lg_", std::to_string(lgid), "_journal"))
+    , loaded(false)
+    , enabled(false)
+    , paused(false) {}
+
+void Graph_journal::load() const {
+  // Opening the mmap creates the file, check first (most graphs have no journal)
+  struct stat sb;
+  enabled = stat(name.c_str(), &sb) == 0 && log.size() > 0;
+  loaded  = true;
+}
+
+void Graph_journal::enable() {
+  if (is_enabled())
+    return;
+
+  log.emplace_back(Op::Reset, 0, 0);  // version 0 is never valid
+  enabled = true;
+}
+
+void Graph_journal::disable() {
+  log.clear();
+  enabled = false;
+  loaded  = true;
+}
+
+bool Graph_journal::get_dirty(uint64_t since_version, absl::flat_hash_set<uint32_t> &dirty) const {
+  return each(since_version, [&dirty](const Entry &e) {
+    dirty.insert(e.nid);
+    if (e.op == Op::Add_edge || e.op == Op::Del_edge)
+      dirty.insert(e.other);
+  });
+}
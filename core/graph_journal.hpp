@@ -0,0 +1,93 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <string>
+
+#include "absl/container/flat_hash_set.h"
+#include "iassert.hpp"
+#include "lgraph_base_core.hpp"
+#include "mmap_vector.hpp"
+
+// Append-only edit journal of a LGraph (optional, off by default).
+//
+// Once enabled, every node create/delete, edge add/delete, type and bits
+// change appends an entry to a mmap array next to node_internal, so it
+// survives across runs. The version is the number of entries: a pass keeps
+// the version when it finishes, and later asks for the nodes changed since
+// (incremental passes, live edits). A clear or compact renumbers the nids
+// and appends a Reset, anything older than it can not be answered.
+class Graph_journal {
+public:
+  enum class Op : uint8_t {
+    Reset,        // enable, clear, compact (nids before are meaningless)
+    Create_node,  // nid
+    Del_node,     // nid
+    Add_edge,     // nid is the sink node, other the driver node
+    Del_edge,     // nid is the sink node, other the driver node
+    Del_pin,      // nid
+    Set_bits,     // nid, other is the bits
+    Set_type      // nid, other is the Ntype_op
+  };
+
+  struct __attribute__((packed)) Entry {
+    uint32_t nid;
+    uint32_t other;
+    Op       op;
+
+    constexpr Entry(Op _op, uint32_t _nid, uint32_t _other) : nid(_nid), other(_other), op(_op) {}
+  };
+
+protected:
+  const std::string       name;  // file to check without creating it
+  mmap_lib::vector<Entry> log;
+
+  mutable bool loaded;
+  mutable bool enabled;
+  bool         paused;
+
+  void load() const;
+
+public:
+  Graph_journal(std::string_view path, Lg_type_id lgid);
+
+  bool is_enabled() const {
+    if (!loaded)
+      load();
+    return enabled;
+  }
+
+  void enable();
+  void disable();  // drops the journal, versions start again
+
+  // Not recorded while paused (LGraph::compact rebuilds the whole graph)
+  void pause(bool p) { paused = p; }
+
+  uint64_t get_version() const { return is_enabled() ? log.size() : 0; }
+
+  void add(Op op, Index_ID nid, uint32_t other = 0) {
+    if (likely(!is_enabled() || paused))
+      return;
+    log.emplace_back(op, static_cast<uint32_t>(nid.value), other);
+  }
+
+  void reset() { add(Op::Reset, 0); }
+
+  // fn(const Entry &) for each entry since version. False (and no call) if
+  // the journal does not cover it (disabled, or reset since).
+  template <typename FN>
+  bool each(uint64_t since_version, FN fn) const {
+    if (!is_enabled() || since_version == 0 || since_version > log.size())
+      return false;
+    for (auto v = since_version; v < log.size(); ++v) {
+      if (log[v].op == Op::Reset)
+        return false;
+    }
+    for (auto v = since_version; v < log.size(); ++v) {
+      fn(log[v]);
+    }
+    return true;
+  }
+
+  // Nodes created, deleted or with a type/bits/edge change since version
+  bool get_dirty(uint64_t since_version, absl::flat_hash_set<uint32_t> &dirty) const;
+};
@@ -0,0 +1,111 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_level.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "iassert.hpp"
+#include "lgraph.hpp"
+
+Graph_level::Graph_level(LGraph *_lg, std::string_view path, Lg_type_id lgid)
+    : lg(_lg)
+    , order(path, absl::StrCat("lg_", std::to_string(lgid), "_level_order"))
+    , level_offset(path, absl::StrCat("lg_", std::to_string(lgid), "_level_offset"))
+    , level(path, absl::StrCat("lg_", std::to_string(lgid), "_level")) {}
+
+void Graph_level::clear() {
+  order.clear();
+  level_offset.clear();
+  level.clear();
+}
+
+void Graph_level::build() {
+  const auto &csr = lg->freeze();  // before clear, freeze may rebuild
+
+  clear();
+
+  const auto &node_internal = lg->node_internal;
+  const auto  sz            = node_internal.size();
+
+  // 0: not a node (or graph IO), 1: combinational node, 2: loop breaker
+  std::vector<uint8_t>  kind(sz, 0);
+  std::vector<uint32_t> pending(sz, 0);  // combinational drivers not levelized yet
+  std::vector<uint32_t> lvl(sz, invalid_level);
+
+  auto get_master_nid = [&node_internal](uint32_t idx) -> uint32_t { return node_internal[idx].get_nid(); };
+
+  std::vector<uint32_t> frontier;
+  for (Index_ID nid = 0; nid < sz; nid.value++) {
+    if (nid == Hardcoded_input_nid || nid == Hardcoded_output_nid)
+      continue;
+    if (!node_internal[nid].is_valid() || !node_internal[nid].is_master_root())
+      continue;
+
+    Node node(lg, Node::Compact_class(nid));
+    kind[nid] = node.is_type_loop_breaker() ? 2 : 1;
+  }
+
+  for (Index_ID nid = 0; nid < sz; nid.value++) {
+    if (kind[nid] == 1) {
+      for (const auto &e : csr.inp_edges(nid)) {
+        if (kind[get_master_nid(e.driver_idx)] == 1)
+          pending[nid]++;
+      }
+    }
+    if (kind[nid] && pending[nid] == 0)
+      frontier.emplace_back(nid);
+  }
+
+  std::vector<uint32_t> next;
+  uint32_t              current_level = 0;
+  while (!frontier.empty()) {
+    level_offset.emplace_back(order.size());
+
+    next.clear();
+    for (auto nid : frontier) {
+      order.emplace_back(nid);
+      lvl[nid] = current_level;
+
+      if (kind[nid] != 1)
+        continue;  // loop breakers do not propagate (their sinks do not wait for them)
+
+      for (const auto &e : csr.out_edges(nid)) {
+        auto sink_nid = get_master_nid(e.sink_idx);
+        if (kind[sink_nid] != 1)
+          continue;
+        I(pending[sink_nid]);
+        if (--pending[sink_nid] == 0)
+          next.emplace_back(sink_nid);
+      }
+    }
+
+    std::sort(next.begin(), next.end());
+    std::swap(frontier, next);
+    ++current_level;
+  }
+
+  // Whatever is left, is in (or after) a combinational loop
+  uint64_t num_loop_nodes = 0;
+  for (uint32_t nid = 0; nid < sz; ++nid) {
+    if (kind[nid] == 0 || lvl[nid] != invalid_level)
+      continue;
+
+    if (num_loop_nodes == 0)
+      level_offset.emplace_back(order.size());
+    order.emplace_back(nid);
+    lvl[nid] = current_level;
+    ++num_loop_nodes;
+  }
+
+  level_offset.emplace_back(order.size());
+
+  for (auto l : lvl) {
+    level.emplace_back(l);
+  }
+
+  *ref_edit_epoch()     = lg->get_edit_epoch();
+  *ref_built()          = 1;
+  *ref_num_loop_nodes() = num_loop_nodes;
+}
@@ -0,0 +1,151 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <iterator>
+
+#include "lgraph_base_core.hpp"
+#include "mmap_vector.hpp"
+#include "node.hpp"
+
+class LGraph;
+
+// Cached topological levelization of a (non-hierarchical) LGraph.
+//
+// Level 0 has the nodes without combinational drivers (driven only by graph
+// inputs, constants, or loop breakers like flops and subs). Any other node is
+// one level after its deepest combinational driver. Nodes in a combinational
+// loop can not be levelized, they are all placed in an extra last level.
+//
+// Nodes in the same level do not depend on each other, so a pass can process
+// a level (wavefront) in parallel. The order is computed by
+// LGraph::get_levelization(), it is mmap persisted next to the lgdb and it is
+// recomputed only when the LGraph edit epoch changes.
+class Graph_level {
+public:
+  class Span {
+  protected:
+    LGraph *        lg;
+    const uint32_t *b;
+    const uint32_t *e;
+
+  public:
+    class Iter {
+    protected:
+      LGraph *        lg;
+      const uint32_t *ptr;
+
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type        = Node;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const Node *;
+      using reference         = Node;
+
+      constexpr Iter(LGraph *_lg, const uint32_t *_ptr) : lg(_lg), ptr(_ptr) {}
+
+      Node operator*() const { return Node(lg, Node::Compact_class(*ptr)); }
+
+      Node operator[](difference_type n) const { return Node(lg, Node::Compact_class(ptr[n])); }
+
+      Iter &operator++() {
+        ++ptr;
+        return *this;
+      }
+      Iter operator++(int) {
+        Iter tmp(*this);
+        ++ptr;
+        return tmp;
+      }
+      Iter &operator--() {
+        --ptr;
+        return *this;
+      }
+      Iter operator--(int) {
+        Iter tmp(*this);
+        --ptr;
+        return tmp;
+      }
+
+      Iter &operator+=(difference_type n) {
+        ptr += n;
+        return *this;
+      }
+      Iter &operator-=(difference_type n) {
+        ptr -= n;
+        return *this;
+      }
+      Iter operator+(difference_type n) const { return Iter(lg, ptr + n); }
+      Iter operator-(difference_type n) const { return Iter(lg, ptr - n); }
+      friend Iter operator+(difference_type n, const Iter &it) { return it + n; }
+
+      difference_type operator-(const Iter &other) const { return ptr - other.ptr; }
+
+      bool operator==(const Iter &other) const { return ptr == other.ptr; }
+      bool operator!=(const Iter &other) const { return ptr != other.ptr; }
+      bool operator<(const Iter &other) const { return ptr < other.ptr; }
+      bool operator>(const Iter &other) const { return ptr > other.ptr; }
+      bool operator<=(const Iter &other) const { return ptr <= other.ptr; }
+      bool operator>=(const Iter &other) const { return ptr >= other.ptr; }
+    };
+
+    constexpr Span(LGraph *_lg, const uint32_t *_b, const uint32_t *_e) : lg(_lg), b(_b), e(_e) {}
+
+    Iter begin() const { return Iter(lg, b); }
+    Iter end() const { return Iter(lg, e); }
+
+    Node operator[](size_t pos) const {
+      I(b + pos < e);
+      return Node(lg, Node::Compact_class(b[pos]));
+    }
+
+    constexpr size_t size() const { return e - b; }
+    constexpr bool   empty() const { return b == e; }
+  };
+
+  static constexpr uint32_t invalid_level = 0xFFFFFFFF;
+
+protected:
+  LGraph *lg;
+
+  mmap_lib::vector<uint32_t> order;         // master root nids sorted by level (nid order inside a level)
+  mmap_lib::vector<uint32_t> level_offset;  // level_offset[l]..level_offset[l+1] nodes in order
+  mmap_lib::vector<uint32_t> level;         // level for each nid (invalid_level for non master roots and graph IO)
+
+  // header persisted in level_offset
+  uint64_t *ref_edit_epoch() const { return level_offset.ref_config_data(8); }
+  uint64_t *ref_built() const { return level_offset.ref_config_data(16); }
+  uint64_t *ref_num_loop_nodes() const { return level_offset.ref_config_data(24); }
+
+  friend class LGraph;
+
+  void build();
+
+public:
+  Graph_level(LGraph *_lg, std::string_view path, Lg_type_id lgid);
+
+  void clear();
+
+  bool is_fresh(uint64_t edit_epoch) const { return *ref_built() && *ref_edit_epoch() == edit_epoch; }
+
+  size_t get_num_levels() const { return level_offset.size() == 0 ? 0 : level_offset.size() - 1; }
+  size_t get_num_nodes() const { return order.size(); }
+
+  // Nodes in a combinational loop (last level). Zero if the graph has no loops
+  size_t get_num_loop_nodes() const { return *ref_num_loop_nodes(); }
+
+  Span get_order() const { return Span(lg, order.begin(), order.end()); }
+
+  Span get_level_nodes(size_t lvl) const {
+    I(lvl + 1 < level_offset.size());
+    const auto *base = order.begin();
+    return Span(lg, base + level_offset[lvl], base + level_offset[lvl + 1]);
+  }
+
+  uint32_t get_level(Index_ID nid) const {
+    if (nid >= level.size())
+      return invalid_level;
+    return level[nid];
+  }
+
+  uint32_t get_level(const Node &node) const { return get_level(node.get_compact_class().get_nid()); }
+};
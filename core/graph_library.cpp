@@ -13,6 +13,7 @@
 #endif
 
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <regex>
 #include <set>
@@ -42,17 +43,30 @@ static Cleanup_graph_library private_instance;
 void Graph_library::shutdown() {
   absl::flat_hash_set<LGraph *> lg_deleted;
 
-  for (auto it : global_name2lgraph) {
-    for (auto it2 : it.second) {
-      if (lg_deleted.contains(it2.second))
-        continue;
-      lg_deleted.insert(it2.second);
-
-      delete it2.second; // delete lgraphs (may be inserted many times different paths)
+  std::vector<LGraph *> lgs;
+  {
+    std::lock_guard<std::mutex> guard(global_lock);
+    for (const auto &it : global_name2lgraph) {
+      for (const auto &it2 : it.second) {
+        lgs.emplace_back(it2.second);
+      }
     }
   }
-  global_name2lgraph.clear();
+  for (auto *lg : lgs) {  // not under global_lock (~LGraph unregisters)
+    if (lg_deleted.contains(lg))
+      continue;
+    lg_deleted.insert(lg);
 
+    delete lg; // delete lgraphs (may be inserted many times different paths)
+  }
+
+  std::lock_guard<std::mutex> guard(global_lock);
+#ifndef NDEBUG
+  for (const auto &it : global_name2lgraph) {
+    I(it.second.empty());  // ~LGraph opened another lgraph, it would outlive its library
+  }
+#endif
+  global_name2lgraph.clear();
 
   absl::flat_hash_set<Graph_library *> gl_deleted;
 
@@ -69,22 +83,161 @@ void Graph_library::shutdown() {
 }
 
 void Graph_library::sync_all() {
-  for (auto &it : global_name2lgraph) {
-    for (auto &it2 : it.second) {
-      it2.second->sync();
+  std::vector<LGraph *>        lgs;
+  std::vector<Graph_library *> libs;
+  {
+    std::lock_guard<std::mutex> guard(global_lock);
+    for (const auto &it : global_name2lgraph) {
+      for (const auto &it2 : it.second) {
+        lgs.emplace_back(it2.second);
+      }
+    }
+    for (const auto &it : global_instances) {
+      libs.emplace_back(it.second);
     }
   }
-  for (auto &it : global_instances) {
-    it.second->clean_library();
+
+  for (auto *lg : lgs) {
+    lg->sync();
+  }
+  for (auto *lib : libs) {
+    lib->sync();
   }
 }
 
 void Graph_library::clean_library() {
-#if 0
-  // Possible to call sub_nodes directly and miss this update
-  if (graph_library_clean)
+  if (dirty_id.empty())
     return;
-#endif
+
+  uint64_t garbage = *ref_blob_garbage();
+
+  for (auto id : dirty_id) {
+    while (index.size() <= id) {
+      index.emplace_back(Library_entry{});
+    }
+
+    if (id < attributes.size() && attributes[id].version != 0 && !sub_nodes[id].is_invalid())
+      load_pins(id);  // before the old bytes become garbage
+
+    auto *entry = index.ref(id);
+    if (id >= attributes.size() || attributes[id].version == 0 || sub_nodes[id].is_invalid()) {
+      if (entry->version)
+        garbage += entry->name_size + entry->source_size + entry->pins_size;
+      *entry = Library_entry{};  // free (recycled) lgid
+      continue;
+    }
+
+    std::string data(sub_nodes[id].get_name());
+    data.append(attributes[id].source);
+    sub_nodes[id].to_binary(data);
+
+    if (entry->version) {
+      auto old_size = entry->name_size + entry->source_size + entry->pins_size;
+      if (entry->version == attributes[id].version && old_size == data.size()
+          && memcmp(blob.ref(entry->blob_pos), data.data(), data.size()) == 0)
+        continue;  // dirty (ref_sub, setup_sub) but not changed
+      garbage += old_size;
+    }
+
+    entry->version     = attributes[id].version;
+    entry->name_size   = sub_nodes[id].get_name().size();
+    entry->source_size = attributes[id].source.size();
+    entry->pins_size   = data.size() - entry->name_size - entry->source_size;
+    entry->blob_pos    = append_blob(data);
+  }
+  dirty_id.clear();
+
+  *ref_format()           = 1;
+  *ref_max_next_version() = max_next_version.value;
+  *ref_blob_garbage()     = garbage;
+
+  if (garbage > (1 << 16) && 2 * garbage > blob.size())
+    compact_blob();
+}
+
+uint64_t Graph_library::append_blob(std::string_view data) {
+  auto pos = blob.size();
+  blob.append(data.data(), data.size());
+  return pos;
+}
+
+void Graph_library::compact_blob() {
+  // The live entries go, in lgid order, to a new file that is renamed over the
+  // blob. The new positions are the running sum of the entry sizes. A crash
+  // before the rename leaves the old blob, after it reload recomputes them.
+  std::string compact_name;
+  bool        live = false;
+  {
+    mmap_lib::vector<char> compacted(path, "graph_library_blob_compact");
+    compacted.clear();
+    compacted.reserve(blob.size() - *ref_blob_garbage());
+
+    for (size_t id = 1; id < index.size(); ++id) {
+      const auto &entry = index[id];
+      if (entry.version == 0)
+        continue;
+
+      compacted.append(blob.ref(entry.blob_pos), entry.name_size + entry.source_size + entry.pins_size);
+    }
+    compact_name = compacted.get_name();
+    live         = !compacted.empty();
+  }  // unmapped, the file stays if not empty
+
+  if (!live) {
+    blob.clear();
+    *ref_blob_garbage() = 0;
+    return;
+  }
+
+  *ref_blob_compacting() = 1;
+  blob.unmap();
+  if (rename(compact_name.c_str(), std::string(blob.get_name()).c_str()) != 0) {
+    *ref_blob_compacting() = 0;  // the old blob is still valid
+    unlink(compact_name.c_str());
+    LGraph::error("graph_library::compact_blob could not replace {}", blob.get_name());
+    return;
+  }
+
+  set_compacted_positions();
+}
+
+void Graph_library::set_compacted_positions() {
+  uint64_t pos = 0;
+  for (size_t id = 1; id < index.size(); ++id) {
+    auto *entry = index.ref(id);
+    if (entry->version == 0)
+      continue;
+
+    entry->blob_pos = pos;
+    pos += entry->name_size + entry->source_size + entry->pins_size;
+  }
+
+  *ref_blob_garbage()    = 0;
+  *ref_blob_compacting() = 0;
+}
+
+void Graph_library::load_pins_int(Lg_type_id lgid) const {
+  I(pins_pending[lgid]);
+  pins_pending[lgid] = false;
+
+  const auto &entry = index[lgid];
+  I(entry.version);
+  std::string_view pins(blob.ref(entry.blob_pos + entry.name_size + entry.source_size), entry.pins_size);
+
+  // Decoded once, on the first access (the library is logically const)
+  const_cast<Sub_node &>(sub_nodes[lgid]).from_binary(pins);
+}
+
+void Graph_library::load_all_pins() const {
+  for (auto id = 1u; id < pins_pending.size(); ++id) {
+    if (pins_pending[id])
+      load_pins_int(id);
+  }
+}
+
+void Graph_library::export_json(std::string_view file) const {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+  load_all_pins();
 
   rapidjson::StringBuffer                          s;
   rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
@@ -150,20 +303,20 @@ void Graph_library::clean_library() {
   {
     std::ofstream fs;
 
-    fs.open(library_file, std::ios::out | std::ios::trunc);
+    fs.open(std::string(file), std::ios::out | std::ios::trunc);
     if (!fs.is_open()) {
-      LGraph::error("graph_library::clean_library could not open graph_library file {}", library_file);
+      LGraph::error("graph_library::export_json could not open file {}", file);
       return;
     }
     fs << s.GetString() << std::endl;
     fs.close();
   }
-
-  graph_library_clean = true;
 }
 
 
 Graph_library *Graph_library::instance(std::string_view path) {
+  std::lock_guard<std::mutex> guard(global_lock);
+
   auto it1 = Graph_library::global_instances.find(path);
   if (it1 != Graph_library::global_instances.end()) {
     return it1->second;
@@ -198,20 +351,13 @@ Graph_library *Graph_library::instance(std::string_view path) {
   global_instances.insert(std::make_pair(std::string(full_path), graph_library));
   global_instances.insert(std::make_pair(std::string(path), graph_library));
 
-  auto it2 = global_name2lgraph.find(graph_library->path);
-  if (it2 == global_name2lgraph.end()) {
-    auto &glib = global_name2lgraph[graph_library->path]; // insert
-    I(glib.empty());
-  }
-
   return graph_library;
 }
 
 Lg_type_id Graph_library::reset_id(std::string_view name, std::string_view source) {
-  graph_library_clean = false;
-
   const auto &it = name2id.find(name);
   if (it != name2id.end()) {
+    set_dirty(it->second);
     // Maybe it was a sub before, or reloaded, or the ID got recycled
     attributes[it->second].version = max_next_version.value++;
     if (attributes[it->second].source != source) {
@@ -232,33 +378,26 @@ Lg_type_id Graph_library::reset_id(std::string_view name, std::string_view sourc
     }
     return it->second;
   }
-  return add_name(name, source);
+  return add_name_int(name, source);
 }
 
 bool Graph_library::exists(std::string_view path, std::string_view name) {
   const Graph_library *lib = instance(path);
 
-  return lib->name2id.find(name) != lib->name2id.end();
+  return lib->has_name(name);
 }
 
 LGraph *Graph_library::try_find_lgraph(std::string_view path, std::string_view name) {
   const Graph_library *lib = instance(path);  // path must be full path
 
-  const auto &glib2 = global_name2lgraph[lib->path];  // WARNING: This inserts name too when needed
-  const auto  it    = glib2.find(name);
-  if (it != glib2.end()) {
-    return it->second;
-  }
-
-  return nullptr;
+  return lib->try_find_lgraph(name);
 }
 
 LGraph *Graph_library::try_find_lgraph(std::string_view name) const {
-  I(global_name2lgraph.find(path) != global_name2lgraph.end());
+  std::shared_lock<std::shared_mutex> guard(lib_lock);
 
-  const auto &glib2 = global_name2lgraph[path];
-  const auto  it    = glib2.find(name);
-  if (it != glib2.end()) {
+  const auto it = name2lg->find(name);
+  if (it != name2lg->end()) {
     return it->second;
   }
 
@@ -266,6 +405,11 @@ LGraph *Graph_library::try_find_lgraph(std::string_view name) const {
 }
 
 LGraph *Graph_library::try_find_lgraph(Lg_type_id lgid) const {
+  std::shared_lock<std::shared_mutex> guard(lib_lock);
+  return try_find_lgraph_int(lgid);
+}
+
+LGraph *Graph_library::try_find_lgraph_int(Lg_type_id lgid) const {
   if (lgid >= attributes.size())
     return nullptr;
 
@@ -273,10 +417,10 @@ LGraph *Graph_library::try_find_lgraph(Lg_type_id lgid) const {
 
 #ifndef NDEBUG
   // Check consistency across
-  auto name = get_name(lgid);
+  auto name = get_name_int(lgid);
 
-  if (global_name2lgraph[path].find(name) != global_name2lgraph[path].end()) {
-    I(lg == global_name2lgraph[path][name]);
+  if (name2lg->find(name) != name2lg->end()) {
+    I(lg == name2lg->at(name));
   } else {
     I(lg == nullptr);
   }
@@ -290,37 +434,77 @@ LGraph *Graph_library::try_find_lgraph(std::string_view path, Lg_type_id lgid) {
   return lib->try_find_lgraph(lgid);
 }
 
+Sub_node *Graph_library::ref_sub(Lg_type_id lgid) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
+  I(lgid > 0);  // 0 is invalid lgid
+  I(attributes.size() > lgid);
+  I(attributes.size() == sub_nodes.size());
+  I(sub_nodes[lgid].get_lgid() == lgid);
+  load_pins(lgid);
+  set_dirty(lgid);
+  return &sub_nodes[lgid];
+}
+
+const Sub_node &Graph_library::get_sub(Lg_type_id lgid) const {
+  {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
+
+    I(lgid > 0);  // 0 is invalid lgid
+    I(attributes.size() > lgid);
+    I(attributes.size() == sub_nodes.size());
+    I(sub_nodes[lgid].get_lgid() == lgid);
+    if (!pins_pending[lgid])
+      return sub_nodes[lgid];
+  }
+
+  std::unique_lock<std::shared_mutex> guard(lib_lock);  // first access decodes the pins
+  load_pins(lgid);
+  return sub_nodes[lgid];
+}
+
 Sub_node &Graph_library::reset_sub(std::string_view name, std::string_view source) {
-  graph_library_clean = false;
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
 
-  Lg_type_id lgid = get_lgid(name);
+  Lg_type_id lgid = get_lgid_int(name);
   if (lgid) {
+    set_dirty(lgid);
     if (attributes[lgid].source != source) {
       // LGraph::info("module {} changed source changed from {} to {}\n", name, attributes[lgid].source, source);
       attributes[lgid].source = source;
     }
+    pins_pending[lgid] = false;  // no need to decode pins about to be reset
     auto &sub = sub_nodes[lgid];
     sub.reset_pins();
     return sub;
   }
 
-  lgid = add_name(name, source);
+  lgid = add_name_int(name, source);
   I(lgid);
   return sub_nodes[lgid];
 }
 
 Sub_node &Graph_library::setup_sub(std::string_view name, std::string_view source) {
-  Lg_type_id lgid = get_lgid(name);
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
+  Lg_type_id lgid = get_lgid_int(name);
   if (lgid) {
+    load_pins(lgid);
+    set_dirty(lgid);
     return sub_nodes[lgid];
   }
 
-  lgid = add_name(name, source);
+  lgid = add_name_int(name, source);
   I(lgid);
   return sub_nodes[lgid];
 }
 
 Lg_type_id Graph_library::add_name(std::string_view name, std::string_view source) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+  return add_name_int(name, source);
+}
+
+Lg_type_id Graph_library::add_name_int(std::string_view name, std::string_view source) {
   I(source != "");
 
   Lg_type_id id = try_get_recycled_id();
@@ -328,6 +512,7 @@ Lg_type_id Graph_library::add_name(std::string_view name, std::string_view sourc
     id = attributes.size();
     attributes.emplace_back();
     sub_nodes.emplace_back();
+    pins_pending.emplace_back(false);
   }
 
   I(id < attributes.size());
@@ -336,7 +521,7 @@ Lg_type_id Graph_library::add_name(std::string_view name, std::string_view sourc
   attributes[id].source  = source;
   attributes[id].version = max_next_version.value++;
 
-  graph_library_clean = false;
+  set_dirty(id);
 
   I(name2id.find(name) == name2id.end());
   I(id);
@@ -346,6 +531,8 @@ Lg_type_id Graph_library::add_name(std::string_view name, std::string_view sourc
 }
 
 bool Graph_library::rename_name(std::string_view orig, std::string_view dest) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
   auto it = name2id.find(orig);
   if (it == name2id.end()) {
     LGraph::error("graph_library: file to rename {} does not exit", orig);
@@ -355,19 +542,19 @@ bool Graph_library::rename_name(std::string_view orig, std::string_view dest) {
 
   auto dest_it = name2id.find(dest);
   if (dest_it != name2id.end()) {
-    auto it2 = global_name2lgraph[path].find(dest);
-    I(it2 != global_name2lgraph[path].end());
-    expunge(dest);
+    auto it2 = name2lg->find(dest);
+    I(it2 != name2lg->end());
+    expunge_int(dest);
   }
 
-  auto it2 = global_name2lgraph[path].find(orig);
-  if (it2 != global_name2lgraph[path].end()) {  // orig around, but not open
-    global_name2lgraph[path].erase(it2);
+  auto it2 = name2lg->find(orig);
+  if (it2 != name2lg->end()) {  // orig around, but not open
+    name2lg->erase(it2);
   }
-  name2id.erase(it);
+  name2id.erase(orig);  // it may be stale after expunge
   I(name2id.find(orig) == name2id.end());
 
-  graph_library_clean = false;
+  set_dirty(id);
   sub_nodes[id].rename(dest);
   I(sub_nodes[id].get_lgid() == id);
 
@@ -379,21 +566,22 @@ bool Graph_library::rename_name(std::string_view orig, std::string_view dest) {
 }
 
 void Graph_library::update(Lg_type_id lgid) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
   I(lgid < attributes.size());
 
   if (attributes[lgid].version == (max_next_version - 1))
     return;
 
-  graph_library_clean      = false;
+  set_dirty(lgid);
   attributes[lgid].version = max_next_version.value++;
 }
 
 void Graph_library::reload() {
-  I(graph_library_clean);
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+  I(dirty_id.empty());
 
   max_next_version = 1;
-  std::ifstream graph_list;
-
   // FIXME: BEGIN DELETE THIS and replace with json reload
 
   liberty_list.push_back("fake_bad.lib");  // FIXME
@@ -403,15 +591,63 @@ void Graph_library::reload() {
   name2id.clear();
   attributes.resize(1);  // 0 is not a valid ID
   sub_nodes.resize(1);   // 0 is not a valid ID
+  pins_pending.assign(1, false);
 
-  if (access(library_file.c_str(), F_OK) == -1) {
-    mkdir(path.c_str(), 0755);  // At least make sure directory exists for future
+  struct stat sb;
+  if (stat(std::string(index.get_name()).c_str(), &sb) != 0) {
+    reload_json();  // old lgdb (or empty)
     return;
   }
+  if (*ref_format() != 1) {
+    LGraph::error("graph_library::reload {} has an unknown format", index.get_name());
+    return;
+  }
+
+  max_next_version = *ref_max_next_version();
+
+  if (*ref_blob_compacting()) {  // compact_blob did not finish
+    auto compact_name = absl::StrCat(path, "/graph_library_blob_compact");
+    if (access(compact_name.c_str(), F_OK) == 0) {
+      unlink(compact_name.c_str());  // not renamed, the old blob is valid
+      *ref_blob_compacting() = 0;
+    } else {
+      set_compacted_positions();
+    }
+  }
+
+  auto n = index.size();
+  attributes.resize(n);
+  sub_nodes.resize(n);
+  pins_pending.resize(n, false);
+
+  for (auto id = 1u; id < n; ++id) {
+    const auto &entry = index[id];
+    if (entry.version == 0) {
+      recycled_id.insert(id);
+      continue;
+    }
+
+    const char *     base = blob.ref(entry.blob_pos);
+    std::string_view name(base, entry.name_size);
+
+    attributes[id].source.assign(base + entry.name_size, entry.source_size);
+    attributes[id].version = entry.version;
+
+    sub_nodes[id].reset(name, id);
+    pins_pending[id] = entry.pins_size != 0;
+
+    name2id[name] = id;
+  }
+}
+
+bool Graph_library::reload_json() {
+  if (access(library_file.c_str(), F_OK) == -1) {
+    return false;
+  }
   FILE *pFile = fopen(library_file.c_str(), "rb");
   if (pFile == 0) {
     LGraph::error("graph_library::reload could not open graph {} file", library_file);
-    return;
+    return false;
   }
   char                      buffer[65536];
   rapidjson::FileReadStream is(pFile, buffer, sizeof(buffer));
@@ -423,7 +659,8 @@ void Graph_library::reload() {
                   library_file,
                   static_cast<unsigned>(document.GetErrorOffset()),
                   rapidjson::GetParseError_En(document.GetParseError()));
-    return;
+    fclose(pFile);
+    return false;
   }
 
   I(document.HasMember("lgraph"));
@@ -440,6 +677,7 @@ void Graph_library::reload() {
     if (id >= attributes.size()) {
       attributes.resize(id + 1);
       sub_nodes.resize(id + 1);
+      pins_pending.resize(id + 1, false);
     }
 
     auto version = lg_entry["version"].GetUint64();
@@ -458,17 +696,43 @@ void Graph_library::reload() {
       // NOTE: must use attributes to keep the string in memory
       name2id[sub_nodes[id].get_name()] = id;
       I(sub_nodes[id].get_lgid() == id);  // for consistency
+
+      set_dirty(id);  // converted to the binary index on the next sync
     } else {
       recycled_id.insert(id);
     }
   }
+  fclose(pFile);
+
+  return true;
 }
 
-Graph_library::Graph_library(std::string_view _path) : path(_path), library_file(path + "/" + "graph_library.json") {
-  graph_library_clean = true;
+Graph_library::Graph_library(std::string_view _path)
+    : path(_path)
+    , library_file(path + "/" + "graph_library.json")
+    , name2lg(&global_name2lgraph[path])
+    , index(path, "graph_library_index")
+    , blob(path, "graph_library_blob")
+    , names(path, "graph_library_names") {
   reload();
 }
 
+Graph_library::~Graph_library() {
+  std::vector<Drop_hook> hooks;
+  {
+    std::lock_guard<std::mutex> guard(drop_hooks_lock);
+    hooks = drop_hooks;
+  }
+  for (auto fn : hooks) {
+    fn(this);
+  }
+}
+
+void Graph_library::add_drop_hook(Drop_hook fn) {
+  std::lock_guard<std::mutex> guard(drop_hooks_lock);
+  drop_hooks.emplace_back(fn);
+}
+
 Lg_type_id Graph_library::try_get_recycled_id() {
   if (recycled_id.empty())
     return 0;
@@ -485,21 +749,29 @@ Lg_type_id Graph_library::try_get_recycled_id() {
 void Graph_library::recycle_id(Lg_type_id lgid) { recycled_id.insert(lgid); }
 
 void Graph_library::expunge(std::string_view name) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+  expunge_int(name);
+}
+
+void Graph_library::expunge_int(std::string_view name) {
   auto it2 = name2id.find(name);
   if (it2 == name2id.end()) {
-    I(global_name2lgraph[path].find(name) == global_name2lgraph[path].end());
+    I(name2lg->find(name) == name2lg->end());
     return;  // already gone
   }
 
-  auto it3 = global_name2lgraph[path].find(name);
-  if (it3 != global_name2lgraph[path].end()) {
-    global_name2lgraph[path].erase(it3);
+  auto it3 = name2lg->find(name);
+  if (it3 != name2lg->end()) {
+    name2lg->erase(it3);
   }
 
   auto id = it2->second;
+  name2id.erase(it2);  // the lgid is recycled, the name must not find it
 
   attributes[id].expunge();
   recycle_id(id);
+  set_dirty(id);
+  pins_pending[id] = false;
 
   DIR *dr = opendir(path.c_str());
   if (dr == NULL) {
@@ -523,17 +795,23 @@ void Graph_library::expunge(std::string_view name) {
 }
 
 void Graph_library::clear(Lg_type_id lgid) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
   I(lgid < attributes.size());
 
+  set_dirty(lgid);
+  pins_pending[lgid] = false;
   sub_nodes[lgid].reset_pins();
 }
 
 Lg_type_id Graph_library::copy_lgraph(std::string_view name, std::string_view new_name) {
-  graph_library_clean = false;
-  auto it2            = global_name2lgraph[path].find(name);
-  if (it2 != global_name2lgraph[path].end()) {  // orig around, but not open
-    it2->second->sync();
+  auto *lg_orig = try_find_lgraph(name);
+  if (lg_orig) {  // orig around, but not open
+    lg_orig->sync();  // not under lib_lock (syncs the library too)
   }
+
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
   const auto &it = name2id.find(name);
   I(it != name2id.end());
   auto id_orig = it->second;
@@ -542,6 +820,8 @@ Lg_type_id Graph_library::copy_lgraph(std::string_view name, std::string_view ne
   Lg_type_id id_new = reset_id(new_name, attributes[id_orig].source);
 
   attributes[id_new] = attributes[id_orig];
+  load_pins(id_orig);
+  pins_pending[id_new] = false;
   sub_nodes[id_new].copy_from(new_name, id_new, sub_nodes[id_orig]);
 
   DIR *dr = opendir(path.c_str());
@@ -591,17 +871,18 @@ Lg_type_id Graph_library::copy_lgraph(std::string_view name, std::string_view ne
 }
 
 Lg_type_id Graph_library::register_lgraph(std::string_view name, std::string_view source, LGraph *lg) {
-  if (global_name2lgraph[path].find(name) != global_name2lgraph[path].end()) {
-    I(global_name2lgraph[path][name] == lg);
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
+  if (name2lg->find(name) != name2lg->end()) {
+    I(name2lg->at(name) == lg);
     I(attributes.size() > lg->get_lgid());
     I(attributes[lg->get_lgid()].lg == lg);
     return lg->get_lgid();
   }
 
-  GI(global_name2lgraph[path].find(name) != global_name2lgraph[path].end(), global_name2lgraph[path][name] == lg);
   Lg_type_id id = reset_id(name, source);
 
-  global_name2lgraph[path][name] = lg;
+  (*name2lg)[name] = lg;
 
   attributes[id].lg = lg; // It could be already set if there was a copy
 
@@ -615,23 +896,34 @@ Lg_type_id Graph_library::register_lgraph(std::string_view name, std::string_vie
 }
 
 void Graph_library::unregister(std::string_view name, Lg_type_id lgid, LGraph *lg) {
+  std::unique_lock<std::shared_mutex> guard(lib_lock);
+
   I(attributes.size() > (size_t)lgid);
-  auto it = global_name2lgraph[path].find(name);
+  auto it = name2lg->find(name);
   if (lg) {
-    I(it != global_name2lgraph[path].end());
+    I(it != name2lg->end());
     I(it->second == lg);
-    global_name2lgraph[path].erase(it);
+    name2lg->erase(it);
     attributes[lgid].lg = 0;
   } else {
-    I(it == global_name2lgraph[path].end());
+    I(it == name2lg->end());
   }
 
   if (sub_nodes[lgid].is_invalid())
-    expunge(name);
+    expunge_int(name);
 }
 
 void Graph_library::each_lgraph(std::function<void(Lg_type_id lgid, std::string_view name)> f1) const {
-  for (const auto &[name, id] : name2id) {
+  std::vector<std::pair<Lg_type_id, std::string>> lgs;  // f1 can open/create lgraphs, not under lib_lock
+  {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
+    lgs.reserve(name2id.size());
+    for (const auto &[name, id] : name2id) {
+      lgs.emplace_back(id, name);
+    }
+  }
+
+  for (const auto &[id, name] : lgs) {
     f1(id, name);
   }
 }
@@ -640,11 +932,27 @@ void Graph_library::each_lgraph(std::string_view match, std::function<void(Lg_ty
   const std::string string_match(match);  // NOTE: regex does not support string_view, c++20 may fix this missing feature
   const std::regex  txt_regex(string_match);
 
-  for (const auto &[name, id] : name2id) {
+  each_lgraph([&txt_regex, &f1](Lg_type_id id, std::string_view name) {
     const std::string line(name);
     if (!std::regex_search(line, txt_regex))
-      continue;
+      return;
 
     f1(id, name);
+  });
+}
+
+void Graph_library::each_sub(std::function<void(const Sub_node &sub)> f1) const {
+  std::vector<const Sub_node *> subs;
+  {
+    std::unique_lock<std::shared_mutex> guard(lib_lock);
+    load_all_pins();
+    for (auto id = 1u; id < sub_nodes.size(); ++id) {
+      if (!sub_nodes[id].is_invalid())
+        subs.emplace_back(&sub_nodes[id]);
+    }
+  }
+
+  for (const auto *sub : subs) {
+    f1(*sub);
   }
 }
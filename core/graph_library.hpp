@@ -3,16 +3,22 @@
 
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
 #include "absl/types/span.h"
 #include "lgraphbase.hpp"
+#include "mmap_str_arena.hpp"
+#include "mmap_vector.hpp"
 #include "sub_node.hpp"
 #include "tech_library.hpp"
 
@@ -21,6 +27,24 @@ class LGraph;
 // FIXME: lgid keep increasing. We may want a garbage collector once the lgraph is shutdown to remap
 // or at least find holes in lgids no longer used
 
+// The library is persisted in two mmap files under the lgdb path:
+//
+// graph_library_index: one fixed entry per lgid (version and where its bytes are)
+// graph_library_blob:  name, source and io pins of each lgid
+// graph_library_names: interned strings of all the lgraphs (node and pin names)
+//
+// Opening a lgdb only walks the index to build the name map, the IO pins are
+// decoded the first time a Sub_node is accessed. A sync appends only the
+// entries changed since the last sync (the blob is compacted to a new file
+// when most of it is stale). graph_library.json is only read once to convert an old lgdb, and
+// written on demand (export_json).
+//
+// Registration and lookups are thread safe (many threads creating modules):
+// a reader/writer lock per library, and a global lock for the instances.
+// Entries never move (deque), so a returned Sub_node or name stays valid while
+// other threads add modules. The contents of a Sub_node are not locked, each
+// module is expected to be populated by one thread.
+
 class Graph_library {
 protected:
   struct Graph_attributes {
@@ -36,6 +60,14 @@ protected:
     }
   };
 
+  struct __attribute__((packed)) Library_entry {  // graph_library_index, position is the lgid
+    uint64_t version;  // 0 if the lgid is free (recycled)
+    uint64_t blob_pos;
+    uint32_t name_size;
+    uint32_t source_size;
+    uint32_t pins_size;
+  };
+
   // BEGIN: common attributes or properties shared across all graphs in this library
   std::vector<std::string> liberty_list;
   std::vector<std::string> sdc_list;
@@ -45,34 +77,95 @@ protected:
   std::vector<Tech_via>   via_list;    // only for routing
   // END: common attributes
 
+  using Name2lgraph        = absl::flat_hash_map<std::string, LGraph *>;
   using Global_instances   = absl::flat_hash_map<std::string, Graph_library *>;
-  using Global_name2lgraph = absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, LGraph *>>;
+  using Global_name2lgraph = absl::node_hash_map<std::string, Name2lgraph>;  // node: name2lg pointers are stable
   using Name2id            = absl::flat_hash_map<std::string, Lg_type_id::type>;
   using Recycled_id        = absl::flat_hash_set<uint64_t>;
+  using Dirty_id           = absl::flat_hash_set<uint32_t>;
 
   Lg_type_id        max_next_version;
   const std::string path;
-  const std::string library_file;
+  const std::string library_file;  // legacy JSON, only to convert old lgdbs
+
+  Name2id                      name2id;
+  Recycled_id                  recycled_id;
+  std::deque<Graph_attributes> attributes;
+  std::deque<Sub_node>         sub_nodes;
+  Name2lgraph *                name2lg;  // open lgraphs (global_name2lgraph[path])
+
+  mmap_lib::vector<Library_entry> index;
+  mmap_lib::vector<char>          blob;
+  Dirty_id                        dirty_id;      // lgids to write in the next sync
+  mutable std::vector<bool>       pins_pending;  // IO pins still in the blob (lazy decode)
+
+  mutable std::shared_mutex lib_lock;
+
+  mmap_lib::str_arena       names;
+  mutable std::shared_mutex names_lock;
 
-  Name2id                       name2id;
-  Recycled_id                   recycled_id;
-  std::vector<Graph_attributes> attributes;
-  std::vector<Sub_node>         sub_nodes;
+  // LGraph::create/open find-or-insert. It can not be lib_lock, the LGraph
+  // constructor registers itself under lib_lock.
+  std::mutex open_lock;
 
   static Global_instances   global_instances;
   static Global_name2lgraph global_name2lgraph;
+  inline static std::mutex  global_lock;  // global_instances and global_name2lgraph
 
-  bool graph_library_clean;
+  using Drop_hook = void (*)(const Graph_library *);
+  inline static std::vector<Drop_hook> drop_hooks;
+  inline static std::mutex             drop_hooks_lock;
 
-  Graph_library() { max_next_version = 1; }
+  uint64_t *ref_format() const { return index.ref_config_data(8); }
+  uint64_t *ref_max_next_version() const { return index.ref_config_data(16); }
+  uint64_t *ref_blob_garbage() const { return index.ref_config_data(24); }
+  uint64_t *ref_blob_compacting() const { return index.ref_config_data(32); }  // compact_blob started the rename
 
-  explicit Graph_library(std::string_view _path);
+  Graph_library() : name2lg(nullptr) { max_next_version = 1; }
 
-  void clean_library();
+  explicit Graph_library(std::string_view _path);  // global_lock held (instance)
 
-  ~Graph_library() { }
+  void set_dirty(Lg_type_id lgid) {
+    I(lgid);
+    dirty_id.insert(lgid.value);
+  }
+
+  void load_pins(Lg_type_id lgid) const {
+    if (lgid < pins_pending.size() && pins_pending[lgid])
+      load_pins_int(lgid);
+  }
+  void load_pins_int(Lg_type_id lgid) const;
+  void load_all_pins() const;
+
+  // lib_lock held
+  void     clean_library();
+  uint64_t append_blob(std::string_view data);
+  void     compact_blob();
+  void     set_compacted_positions();
+  bool     reload_json();
 
+  ~Graph_library();
+
+  // lib_lock held
+  Lg_type_id add_name_int(std::string_view name, std::string_view source);
   Lg_type_id reset_id(std::string_view name, std::string_view source);
+  void       expunge_int(std::string_view name);
+  LGraph *   try_find_lgraph_int(Lg_type_id lgid) const;
+
+  std::string_view get_name_int(Lg_type_id lgid) const {
+    I(lgid > 0);  // 0 is invalid lgid
+    I(sub_nodes.size() > lgid);
+    I(sub_nodes[lgid].get_lgid() == lgid);
+    return sub_nodes[lgid].get_name();
+  }
+
+  Lg_type_id get_lgid_int(std::string_view name) const {
+    const auto &it = name2id.find(name);
+    if (it != name2id.end()) {
+      return it->second;
+    }
+    return 0;  // Invalid ID
+  }
 
   Lg_type_id try_get_recycled_id();
   void       recycle_id(Lg_type_id lgid);
@@ -88,6 +181,7 @@ public:
   LGraph *       try_find_lgraph(Lg_type_id lgid) const;
 
   bool exists(Lg_type_id lgid) const {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
     if (attributes.size() <= lgid || lgid.is_invalid())
       return false;
     I(attributes.size() == sub_nodes.size());
@@ -98,22 +192,8 @@ public:
   Sub_node &setup_sub(std::string_view name, std::string_view source);
   Sub_node &setup_sub(std::string_view name) { return setup_sub(name, "-"); }
 
-  Sub_node *ref_sub(Lg_type_id lgid) {
-    graph_library_clean = false;
-    I(lgid > 0);  // 0 is invalid lgid
-    I(attributes.size() > lgid);
-    I(attributes.size() == sub_nodes.size());
-    I(sub_nodes[lgid].get_lgid() == lgid);
-    return &sub_nodes[lgid];
-  }
-
-  const Sub_node &get_sub(Lg_type_id lgid) const {
-    I(lgid > 0);  // 0 is invalid lgid
-    I(attributes.size() > lgid);
-    I(attributes.size() == sub_nodes.size());
-    I(sub_nodes[lgid].get_lgid() == lgid);
-    return sub_nodes[lgid];
-  }
+  Sub_node *      ref_sub(Lg_type_id lgid);
+  const Sub_node &get_sub(Lg_type_id lgid) const;
 
   Sub_node *      ref_sub(std::string_view name) { return ref_sub(get_lgid(name)); }
   const Sub_node &get_sub(std::string_view name) const { return get_sub(get_lgid(name)); }
@@ -122,21 +202,17 @@ public:
   bool       rename_name(std::string_view orig, std::string_view dest);
 
   std::string_view get_name(Lg_type_id lgid) const {
-    I(lgid > 0);  // 0 is invalid lgid
-    I(sub_nodes.size() > lgid);
-    I(sub_nodes[lgid].get_lgid() == lgid);
-    return sub_nodes[lgid].get_name();
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
+    return get_name_int(lgid);
   }
 
   Lg_type_id get_lgid(std::string_view name) const {
-    const auto &it = name2id.find(name);
-    if (it != name2id.end()) {
-      return it->second;
-    }
-    return 0;  // Invalid ID
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
+    return get_lgid_int(name);
   }
 
   std::string_view get_source(Lg_type_id lgid) const {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
     assert(lgid > 0);  // 0 is invalid lgid
     assert(attributes.size() > lgid);
     return attributes[lgid].source;
@@ -149,18 +225,25 @@ public:
   void update(Lg_type_id lgid);
 
   Lg_type_id get_version(Lg_type_id lgid) const {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
     if (attributes.size() < lgid)
       return 0;  // Invalid ID
 
     return attributes[lgid].version;
   }
 
-  bool has_name(std::string_view name) const { return name2id.find(name) != name2id.end(); }
+  bool has_name(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
+    return name2id.find(name) != name2id.end();
+  }
 
   // TODO: Change to Graph_library &instance...
   static Graph_library *instance(std::string_view path);
 
+  std::mutex &ref_open_lock() { return open_lock; }
+
   Lg_type_id get_max_version() const {
+    std::shared_lock<std::shared_mutex> guard(lib_lock);
     assert(max_next_version > 0);
     return max_next_version - 1;
   }
@@ -187,15 +270,20 @@ public:
 
   void clear(Lg_type_id lgid);
 
-  void sync() { clean_library(); }
+  void sync() {
+    std::unique_lock<std::shared_mutex> guard(lib_lock);
+    clean_library();
+  }
+  void export_json(std::string_view file) const;  // the whole library in the legacy JSON format
 
   static void sync_all();  // Called when running out of mmaps
+
+  // Per lgraph tables not owned by the LGraph (Attribute) register a hook to
+  // drop the entries of a library when it is deleted.
+  static void add_drop_hook(Drop_hook fn);
   static void shutdown();  // Called on program exit to clean pointers (asan)
 
-  absl::Span<const Sub_node> get_sub_nodes() const {
-    I(sub_nodes.size() >= 1);
-    return absl::MakeSpan(sub_nodes).subspan(1);
-  };
+  void each_sub(std::function<void(const Sub_node &sub)> f1) const;  // valid (not expunged) subs
 
   absl::Span<const std::string> get_liberty() const { return absl::MakeSpan(liberty_list); };
   absl::Span<const std::string> get_sdc() const { return absl::MakeSpan(sdc_list); };
@@ -208,4 +296,25 @@ public:
   void each_lgraph(std::string_view match, std::function<void(Lg_type_id lgid, std::string_view name)> f1) const;
 
   void reload();
+
+  // Strings interned once per lgdb. The id is stable, the string_view may
+  // move when a new string is added (same as mmap_lib::map string values).
+  uint32_t intern(std::string_view str) {
+    std::unique_lock<std::shared_mutex> guard(names_lock);
+    return names.intern(str);
+  }
+  uint32_t find_interned(std::string_view str) const {  // 0 if never interned
+    std::shared_lock<std::shared_mutex> guard(names_lock);
+    return names.find(str);
+  }
+  std::string_view get_interned(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> guard(names_lock);
+    return names.get(id);
+  }
+  void preload_interned() const {
+    std::shared_lock<std::shared_mutex> guard(names_lock);
+    names.preload();
+  }
+  void gc_pin_interned() const { names.gc_pin(); }
+  void gc_unpin_interned() const { names.gc_unpin(); }
 };
@@ -0,0 +1,80 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "cell.hpp"
+#include "lgraph_base_core.hpp"
+
+// Structural hash (strash) index of a LGraph: from (op, bits, sorted
+// sink_pid/driver pin list) to a nid. Constants are in the LGraph constant
+// pool instead.
+//
+// The index is in memory only. It is built on the first
+// LGraph::find_or_create, and from then on the edits touch the nodes whose
+// key may change (add/del edge, set_type, set_bits, del_node). The touched
+// nodes are re-hashed on the next lookup. A hit is always checked against
+// the node, so a stale entry can cause a miss (a duplicate node) but never a
+// wrong node.
+class Graph_strash {
+protected:
+  bool active;
+
+  absl::flat_hash_map<uint64_t, uint32_t> hash2nid;
+  absl::flat_hash_map<uint32_t, uint64_t> nid2hash;
+  absl::flat_hash_set<uint32_t>           dirty;
+
+  friend class LGraph;
+
+public:
+  Graph_strash() : active(false) {}
+
+  // Combinational cells only. Constants go through the constant pool,
+  // flops/subs/memories have side effects or names that should not be merged.
+  static constexpr bool is_strash_op(Ntype_op op) {
+    return op != Ntype_op::Invalid && static_cast<int>(op) < static_cast<int>(Ntype_op::LUT);
+  }
+
+  static uint64_t get_hash(const std::vector<uint64_t> &key) { return absl::Hash<std::vector<uint64_t>>{}(key); }
+
+  bool is_active() const { return active; }
+
+  void touch(Index_ID nid) {
+    if (active)
+      dirty.insert(nid.value);
+  }
+
+  void clear() {
+    active = false;
+    hash2nid.clear();
+    nid2hash.clear();
+    dirty.clear();
+  }
+
+  Index_ID find(uint64_t h) const {
+    auto it = hash2nid.find(h);
+    if (it == hash2nid.end())
+      return 0;
+    return it->second;
+  }
+
+  void insert(uint64_t h, Index_ID nid) {
+    hash2nid[h]         = nid.value;  // a duplicate structure keeps the latest node
+    nid2hash[nid.value] = h;
+  }
+
+  void erase(Index_ID nid) {
+    auto it = nid2hash.find(nid.value);
+    if (it == nid2hash.end())
+      return;
+    auto it2 = hash2nid.find(it->second);
+    if (it2 != hash2nid.end() && it2->second == nid.value)
+      hash2nid.erase(it2);
+    nid2hash.erase(it);
+  }
+
+  size_t size() const { return hash2nid.size(); }
+};
@@ -2,13 +2,22 @@
 
 #include "hierarchy.hpp"
 
+#include <sys/stat.h>
+
 #include "annotate.hpp"
 #include "lgraph.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
 
 Hierarchy_tree::Hierarchy_tree(LGraph *_top)
-    : mmap_lib::tree<Hierarchy_data>(_top->get_path(), absl::StrCat(_top->get_name(), "_htree")), top(_top) {}
+    : mmap_lib::tree<Hierarchy_data>(_top->get_path(), absl::StrCat(_top->get_name(), "_htree"))
+    , top(_top)
+    , saved(_top->get_path(), absl::StrCat("lg_", std::to_string(_top->get_lgid()), "_htree")) {}
+
+Hierarchy_tree::~Hierarchy_tree() {
+  std::lock_guard<std::mutex> guard(materialized_lock);
+  materialized.erase(this);
+}
 
 LGraph *Hierarchy_tree::ref_lgraph(const Hierarchy_index &hidx) const {
   I(!hidx.is_invalid()); // no hierarchical should not call this
@@ -43,53 +52,390 @@ Node Hierarchy_tree::get_instance_up_node(const Hierarchy_index &hidx) const {
   return Node(top, lg, up_hidx, data.up_nid);
 }
 
-void Hierarchy_tree::regenerate_step(LGraph *lg, const Hierarchy_index &parent) {
+void Hierarchy_tree::expand(const Hierarchy_index &hidx) {
+  if (unlikely(has_pending.load(std::memory_order_acquire)))
+    apply_pending();
+
+  if (unlikely(!saved_epoch.empty()))
+    check_saved_epoch(hidx);
+
+  if (expanded.contains(hidx))
+    return;
+
+  expand_int(hidx);
+}
+
+void Hierarchy_tree::expand_int(const Hierarchy_index &hidx) {
+  I(!expanded.contains(hidx));
+  I(mmap_lib::tree<Hierarchy_data>::is_leaf(hidx));
+
+  set_expanded(hidx);
+
+  auto *lg       = hidx.is_root() ? top : ref_lgraph(hidx);
   auto *tree_pos = Ann_node_tree_pos::ref(lg);
 
-  int conta = 0;
+  std::vector<std::pair<Node::Compact_class, Hierarchy_data>> subs;
   for (auto it : lg->get_down_nodes_map()) {
-
     auto child_lgid = lg->get_type_sub(it.first.get_nid());
 
-    auto node = it.first.get_node(lg);
 #ifndef NDEBUG
+    auto node = it.first.get_node(lg);
     I(node.is_type_sub());
     I(child_lgid == node.get_type_sub());
 #endif
 
-    auto *child_lg  = lg->get_library().try_find_lgraph(child_lgid);
-    if (child_lg==nullptr) {
-      I(!node.is_type_sub_present());
+    auto *child_lg = lg->get_library().try_find_lgraph(child_lgid);
+    if (child_lg == nullptr) {
       continue;
     }
 
-    //Hierarchy_data data(child_lgid, node.get_nid());
-    auto      child = add_child(parent, {child_lgid, node.get_nid()});
+    subs.emplace_back(it.first, Hierarchy_data(child_lgid, it.first.get_nid()));
+  }
+
+  // A Sub node keeps its tree_pos (shared by all the instances of lg) if it
+  // still fits, the new ones take the holes.
+  const int         n = subs.size();
+  std::vector<int>  sub_pos(n, -1);
+  std::vector<bool> used(n, false);
+  for (int i = 0; i < n; ++i) {
+    if (!tree_pos->has(subs[i].first))
+      continue;
+    auto p = tree_pos->get(subs[i].first);
+    if (p < static_cast<uint32_t>(n) && !used[p]) {
+      sub_pos[i] = p;
+      used[p]    = true;
+    }
+  }
+  int next_free = 0;
+  for (int i = 0; i < n; ++i) {
+    if (sub_pos[i] != -1)
+      continue;
+    while (used[next_free]) ++next_free;
+    sub_pos[i]      = next_free;
+    used[next_free] = true;
+    tree_pos->set(subs[i].first, next_free);
+  }
+
+  auto first_child = set_children(hidx, n);
+  for (int i = 0; i < n; ++i) {
+    set_child(Hierarchy_index(first_child.level, first_child.pos + sub_pos[i]), subs[i].second);  // see Node_pin::get_down_pin
+  }
+}
+
+mmap_lib::Tree_pos Hierarchy_tree::alloc_block(mmap_lib::Tree_level level, int32_t n_chunks) {
+  auto &free = free_blocks[level];
+  auto  it   = free.lower_bound(n_chunks);
+  if (it != free.end()) {
+    auto first = it->second.back();
+    auto sz    = it->first;
+    it->second.pop_back();
+    if (it->second.empty())
+      free.erase(it);
+    if (sz > n_chunks)
+      free[sz - n_chunks].emplace_back(first + 4 * n_chunks);  // the tail stays free
+    return first;
+  }
+
+  mmap_lib::Tree_pos first = data_stack[level].size();
+  data_stack[level].resize(first + 4 * n_chunks);
+  pointers_stack[level].resize(pointers_stack[level].size() + n_chunks);
+  I(4 * pointers_stack[level].size() == data_stack[level].size());
+
+  return first;
+}
+
+void Hierarchy_tree::release_block(mmap_lib::Tree_level level, const Child_block &block) {
+  for (int i = 0; i < 4 * block.n_chunks; ++i) {
+    drop_instance(Hierarchy_index(level, block.first + i));
+  }
+  free_blocks[level][block.n_chunks].emplace_back(block.first);
+}
 
-    I(child.pos == conta+get_first_child(parent).pos);
-    tree_pos->set(it.first, conta);
+void Hierarchy_tree::drop_instance(const Hierarchy_index &hidx) {
+  const auto &data = get_data(hidx);
+  if (data.is_invalid())
+    return;
 
-    regenerate_step(child_lg, child);
+  expanded.erase(hidx);
+  lgid2expanded[data.lgid.value].erase(hidx);
 
-    conta++;
+  auto it = child_block.find(hidx);
+  if (it != child_block.end()) {
+    auto block = it->second;
+    child_block.erase(it);
+    release_block(hidx.level + 1, block);
+  }
+
+  set_data(hidx, Hierarchy_data());  // stale keys pointing here fail (I(data.lgid))
+}
+
+Hierarchy_index Hierarchy_tree::set_children(const Hierarchy_index &hidx, int n) {
+  const auto level = hidx.level + 1;
+  adjust_to_level(level);
+  if (free_blocks.size() <= static_cast<size_t>(level))
+    free_blocks.resize(level + 1);
+
+  const int32_t n_chunks = (n + 3) / 4;
+
+  int32_t old_chunks = 0;
+  auto    it         = child_block.find(hidx);
+  if (it != child_block.end() && it->second.n_chunks < n_chunks) {
+    auto block = it->second;  // outgrown, the children get new indexes
+    old_chunks = block.n_chunks;
+    child_block.erase(it);
+    release_block(level, block);
+    it = child_block.end();
+  }
+  if (it == child_block.end()) {
+    if (n == 0) {
+      I(get_first_child_pos(hidx) == -1);
+      return invalid_index();
+    }
+    auto cap = std::max(n_chunks, 2 * old_chunks);  // grow geometrically
+    it       = child_block.emplace(hidx, Child_block{alloc_block(level, cap), cap}).first;
+  }
+
+  const auto block = it->second;
+  for (int i = n; i < 4 * block.n_chunks; ++i) {
+    drop_instance(Hierarchy_index(level, block.first + i));  // deleted Sub nodes
+  }
+
+  if (n == 0) {
+    *ref_first_child_pos(hidx) = -1;
+    *ref_last_child_pos(hidx)  = -1;
+    return invalid_index();
+  }
+
+  for (int32_t c = 0; c < n_chunks; ++c) {
+    auto &ptrs = pointers_stack[level][(block.first >> 2) + c];
+    ptrs       = Tree_pointers(hidx.pos);  // children collapsed (blocks kept in child_block)
+    if (c + 1 < n_chunks)
+      ptrs.next_sibling = block.first + 4 * (c + 1);  // full chunk, and the next one
+    else
+      ptrs.next_sibling = n & 3;  // 0 is a full chunk
+  }
+
+  *ref_first_child_pos(hidx) = block.first;
+  *ref_last_child_pos(hidx)  = block.first + n - 1;
+
+  return Hierarchy_index(level, block.first);
+}
+
+void Hierarchy_tree::set_child(const Hierarchy_index &child, const Hierarchy_data &data) {
+  // Same lgid (maybe a renumbered up_nid after compact): the collapsed subtree
+  // is still right. Otherwise it goes away.
+  if (get_data(child).lgid != data.lgid)
+    drop_instance(child);
+
+  set_data(child, data);
+}
+
+void Hierarchy_tree::set_expanded(const Hierarchy_index &hidx) {
+  expanded.insert(hidx);
+  lgid2expanded[get_data(hidx).lgid.value].insert(hidx);
+}
+
+void Hierarchy_tree::collapse(const Hierarchy_index &hidx) {
+  if (!expanded.contains(hidx))
+    return;
+
+  auto fc = get_first_child_pos(hidx);
+  if (fc != -1) {
+    for (Hierarchy_index child(hidx.level + 1, fc); !child.is_invalid(); child = get_sibling_next(child)) {
+      collapse(child);
+    }
+  }
+
+  // The block stays in child_block, the next expand reuses it
+  *ref_first_child_pos(hidx) = -1;
+  *ref_last_child_pos(hidx)  = -1;
+  expanded.erase(hidx);
+  lgid2expanded[get_data(hidx).lgid.value].erase(hidx);
+}
+
+void Hierarchy_tree::collapse_lgid(Lg_type_id lgid) {
+  auto it = lgid2expanded.find(lgid.value);
+  if (it == lgid2expanded.end())
+    return;
+
+  std::vector<Hierarchy_index> instances(it->second.begin(), it->second.end());
+  for (const auto &hidx : instances) {
+    collapse(hidx);  // no-op if a previous one was an ancestor
+  }
+}
+
+void Hierarchy_tree::check_saved_epoch(const Hierarchy_index &hidx) {
+  auto lgid = get_data(hidx).lgid;
+  auto it   = saved_epoch.find(lgid.value);
+  if (it == saved_epoch.end())
+    return;
+
+  auto *lg = hidx.is_root() ? top : ref_lgraph(hidx);
+  if (lg->get_edit_epoch() != it->second)
+    collapse_lgid(lgid);
+
+  saved_epoch.erase(it);
+}
+
+void Hierarchy_tree::expand_all() {
+  for (auto hidx = root_index(); !hidx.is_invalid(); hidx = get_depth_preorder_next(hidx)) {
+  }
+}
+
+void Hierarchy_tree::apply_pending() {
+  std::vector<uint32_t> lgids;
+  {
+    std::lock_guard<std::mutex> guard(pending_lock);
+    lgids.swap(pending_collapse);
+    has_pending.store(false, std::memory_order_release);
+  }
+
+  for (auto lgid : lgids) {
+    collapse_lgid(Lg_type_id(lgid));
+  }
+}
+
+void Hierarchy_tree::sub_changed(Lg_type_id lgid) {
+  std::lock_guard<std::mutex> guard(materialized_lock);
+  for (auto *tree : materialized) {
+    std::lock_guard<std::mutex> tree_guard(tree->pending_lock);
+    tree->pending_collapse.emplace_back(lgid.value);
+    tree->has_pending.store(true, std::memory_order_release);
   }
 }
 
 void Hierarchy_tree::regenerate() {
+  I(empty());
+
+  if (load())
+    return;
+
   Hierarchy_data data(top->get_lgid(), 0);
   set_root(data);
 
-  regenerate_step(top, Hierarchy_tree::root_index());
+  std::lock_guard<std::mutex> guard(materialized_lock);
+  materialized.insert(this);
 }
 
-Hierarchy_index Hierarchy_tree::go_down(const Node &node) const {
+void Hierarchy_tree::clear() {
+  mmap_lib::tree<Hierarchy_data>::clear();
+  expanded.clear();
+  lgid2expanded.clear();
+  saved_epoch.clear();
+  child_block.clear();
+  free_blocks.clear();
+  {
+    std::lock_guard<std::mutex> guard(materialized_lock);
+    materialized.erase(this);
+  }
+  {
+    std::lock_guard<std::mutex> guard(pending_lock);
+    pending_collapse.clear();
+    has_pending.store(false, std::memory_order_release);
+  }
+
+  saved.clear();
+}
+
+bool Hierarchy_tree::load() {
+  struct stat sb;
+  if (stat(std::string(saved.get_name()).c_str(), &sb) != 0)
+    return false;  // never saved (do not create the file)
+
+  if (saved.empty() || saved[0].lgid != top->get_lgid().value) {
+    saved.clear();
+    return false;
+  }
+
+  set_root(Hierarchy_data(top->get_lgid(), 0));
+  {
+    std::lock_guard<std::mutex> guard(materialized_lock);
+    materialized.insert(this);
+  }
+
+  size_t pos = 0;
+  load_step(root_index(), pos);
+  I(pos == saved.size());
+
+  return true;
+}
+
+void Hierarchy_tree::load_step(const Hierarchy_index &hidx, size_t &pos) {
+  const auto entry = saved[pos++];
+
+  saved_epoch.try_emplace(entry.lgid, entry.edit_epoch);
+
+  if (entry.n_children < 0)
+    return;
+
+  set_expanded(hidx);
+  auto first_child = set_children(hidx, entry.n_children);
+  for (int i = 0; i < entry.n_children; ++i) {
+    const auto &child_entry = saved[pos];
+    Hierarchy_index child(first_child.level, first_child.pos + i);
+    set_child(child, {Lg_type_id(child_entry.lgid), Index_ID(child_entry.up_nid)});
+    load_step(child, pos);
+  }
+}
+
+void Hierarchy_tree::save_step(const Hierarchy_index &hidx) {
+  const auto &data = get_data(hidx);
+
+  int32_t n_children = -1;
+  if (expanded.contains(hidx)) {
+    n_children = 0;
+    auto fc    = get_first_child_pos(hidx);
+    if (fc != -1) {
+      for (Hierarchy_index child(hidx.level + 1, fc); !child.is_invalid(); child = get_sibling_next(child)) {
+        ++n_children;
+      }
+    }
+  }
+
+  // Not checked since the load, keep the old epoch (it may be stale). sync
+  // runs from ~LGraph (also in Graph_library::shutdown), it must not open
+  // the sub lgraphs.
+  auto     it = saved_epoch.find(data.lgid.value);
+  uint64_t epoch;
+  if (it != saved_epoch.end())
+    epoch = it->second;
+  else if (hidx.is_root())
+    epoch = top->get_edit_epoch();
+  else
+    epoch = LGraph_Base::peek_edit_epoch(get_path(), data.lgid);
+
+  saved.emplace_back(Saved_entry{data.lgid.value, static_cast<uint32_t>(data.up_nid.value), n_children, epoch});
+
+  if (n_children <= 0)
+    return;
+
+  for (Hierarchy_index child(hidx.level + 1, get_first_child_pos(hidx)); !child.is_invalid(); child = get_sibling_next(child)) {
+    save_step(child);
+  }
+}
+
+void Hierarchy_tree::sync() {
+  if (empty())
+    return;
+
+  if (has_pending.load(std::memory_order_acquire))
+    apply_pending();
+
+  saved.clear();
+  save_step(root_index());
+}
+
+Hierarchy_index Hierarchy_tree::go_down(const Node &node) {
+  auto first_child = get_first_child(node.get_hidx());  // expands, and sets the tree_pos
+  I(!first_child.is_invalid());
+
   auto *tree_pos = Ann_node_tree_pos::ref(node.get_class_lgraph());
   I(tree_pos);
   I(tree_pos->has(node.get_compact_class()));
   auto pos = tree_pos->get(node.get_compact_class());
 
-  I(!is_leaf(node.get_hidx()));
-  Hierarchy_index child(node.get_hidx().level + 1, pos);
+  Hierarchy_index child(first_child.level, first_child.pos + pos);
+  I(get_parent(child) == node.get_hidx());
   return child;
 }
 
@@ -97,7 +443,7 @@ Hierarchy_index Hierarchy_tree::go_up(const Node &node) const { return get_paren
 bool            Hierarchy_tree::is_root(const Node &node) const { return node.get_hidx().is_root(); }
 
 /* LCOV_EXCL_START */
-void Hierarchy_tree::dump() const {
+void Hierarchy_tree::dump() {
   for (const auto &index : depth_preorder()) {
     std::string indent(index.level, ' ');
     const auto &index_data = get_data(index);
@@ -2,32 +2,149 @@
 
 #pragma once
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "mmap_tree.hpp"
+#include "mmap_vector.hpp"
 #include "lgraph_base_core.hpp"
 
 class Node;
 class LGraph;
 
+// Instance tree of a top LGraph.
+//
+// The tree is lazy: a tree node gets its children (the sub instances of its
+// LGraph) the first time something goes down (is_leaf, get_first_child,
+// get_depth_preorder_next, go_down...). Adding or deleting a Sub node in a
+// LGraph only collapses the expanded instances of that LGraph, they expand
+// again on the next go down (the collapse is queued, and the tree applies it
+// on its next access). LGraph::sync persists the expanded part, and a
+// reopen loads it back. An instance whose LGraph changed since (edit epoch)
+// is collapsed on the first visit.
+//
+// The children of a tree node sit in one block of contiguous chunks (4
+// slots each, see go_down). A collapsed node keeps its block, and the next
+// expand rewrites it in place: a Sub node that keeps its tree_pos keeps its
+// Hierarchy_index, so attribute keys stay valid. A block that is outgrown,
+// or that belonged to a dropped instance, goes to a free list for the level
+// and its slots become invalid (Hierarchy_data::is_invalid).
 class Hierarchy_tree : public mmap_lib::tree<Hierarchy_data> {
 protected:
+  struct __attribute__((packed)) Saved_entry {  // preorder of the expanded part
+    uint32_t lgid;
+    uint32_t up_nid;
+    int32_t  n_children;  // -1 if not expanded
+    uint64_t edit_epoch;  // of lgid when saved
+  };
+
+  struct Child_block {
+    mmap_lib::Tree_pos first;     // pos of the first slot (chunk aligned)
+    int32_t            n_chunks;  // capacity, 4 slots per chunk
+  };
+
   LGraph *top;
 
-  void regenerate_step(LGraph *lg, const Hierarchy_index &parent);
+  mmap_lib::vector<Saved_entry> saved;
+
+  absl::flat_hash_set<Hierarchy_index>                                 expanded;
+  absl::flat_hash_map<uint32_t, absl::flat_hash_set<Hierarchy_index>> lgid2expanded;  // expanded instances per lgid
+  absl::flat_hash_map<uint32_t, uint64_t>                              saved_epoch;    // lgid to edit epoch when loaded, until checked
+
+  absl::flat_hash_map<Hierarchy_index, Child_block>               child_block;  // expanded or collapsed tree nodes
+  std::vector<std::map<int32_t, std::vector<mmap_lib::Tree_pos>>> free_blocks;  // per level, n_chunks to first pos
+
+  inline static absl::flat_hash_set<Hierarchy_tree *> materialized;  // non empty trees (Sub changes patch them)
+  inline static std::mutex                            materialized_lock;
+
+  // sub_changed runs from any thread, it only queues the lgid. The owner
+  // applies the collapse on its next expand (or sync).
+  std::mutex            pending_lock;
+  std::vector<uint32_t> pending_collapse;
+  std::atomic<bool>     has_pending{false};
+
+  void apply_pending();
+
+  void expand(const Hierarchy_index &hidx);
+  void expand_int(const Hierarchy_index &hidx);
+  void set_expanded(const Hierarchy_index &hidx);
+  void collapse(const Hierarchy_index &hidx);
+  void collapse_lgid(Lg_type_id lgid);
+  void check_saved_epoch(const Hierarchy_index &hidx);
+
+  mmap_lib::Tree_pos alloc_block(mmap_lib::Tree_level level, int32_t n_chunks);
+  void               release_block(mmap_lib::Tree_level level, const Child_block &block);
+  void               drop_instance(const Hierarchy_index &hidx);
+  Hierarchy_index    set_children(const Hierarchy_index &hidx, int n);
+  void               set_child(const Hierarchy_index &child, const Hierarchy_data &data);
+
+  bool load();
+  void load_step(const Hierarchy_index &hidx, size_t &pos);
+  void save_step(const Hierarchy_index &hidx);
 
 public:
   Hierarchy_tree(LGraph *top);
+  ~Hierarchy_tree();
+
+  void regenerate();  // Triggered when the tree is empty (load or lazy root)
+  void clear();       // drops the saved tree too
+  void sync();        // persist the expanded part
 
-  void regenerate();  // Triggered when the hierarchy may have changed
+  void expand_all();
+
+  // A Sub node was added, deleted or changed in lgid (or lgid was compacted)
+  static void sub_changed(Lg_type_id lgid);
+
+  // mmap_lib::tree accessors, expanding the tree node first (not const)
+  bool is_leaf(const Hierarchy_index &hidx) {
+    expand(hidx);
+    return mmap_lib::tree<Hierarchy_data>::is_leaf(hidx);
+  }
+  Hierarchy_index get_first_child(const Hierarchy_index &hidx) {
+    expand(hidx);
+    return mmap_lib::tree<Hierarchy_data>::get_first_child(hidx);
+  }
+  Hierarchy_index get_last_child(const Hierarchy_index &hidx) {
+    expand(hidx);
+    return mmap_lib::tree<Hierarchy_data>::get_last_child(hidx);
+  }
+  Hierarchy_index get_depth_preorder_next(const Hierarchy_index &hidx) {
+    expand(hidx);
+    return mmap_lib::tree<Hierarchy_data>::get_depth_preorder_next(hidx);
+  }
+  Tree_sibling_iterator children(const Hierarchy_index &hidx) {
+    expand(hidx);
+    return mmap_lib::tree<Hierarchy_data>::children(hidx);
+  }
+  Tree_depth_preorder_iterator depth_preorder() {
+    expand_all();
+    return mmap_lib::tree<Hierarchy_data>::depth_preorder();
+  }
+  Tree_depth_postorder_iterator depth_postorder() {
+    expand_all();
+    return mmap_lib::tree<Hierarchy_data>::depth_postorder();
+  }
 
   // Lg_type_id get_lgid(const Hierarchy_index &hidx) const { return get_data(hidx).lgid; }
+
+  // lgid of the hidx instance, 0 if hidx is not in the tree (it does not expand)
+  Lg_type_id find_lgid(const Hierarchy_index &hidx) const {
+    if (hidx.is_invalid() || !is_valid(hidx))
+      return 0;
+    return get_data(hidx).lgid;
+  }
   Node get_instance_up_node(const Hierarchy_index &hidx) const;
 
   LGraph *ref_lgraph(const Hierarchy_index &hidx) const;
 
-  Hierarchy_index go_down(const Node &node) const;
+  Hierarchy_index go_down(const Node &node);
 
   Hierarchy_index go_up(const Node &node) const;
   bool            is_root(const Node &node) const;
 
-  void dump() const;
+  void dump();
 };
@@ -92,6 +92,7 @@ protected:
   friend class LGraph;
   friend class Node_internal;
   friend class Node_pin;
+  friend class Graph_csr;
 
   uint64_t snode : 1;
   uint64_t input : 1;  // Same position for SEdge and LEdge
@@ -254,7 +255,7 @@ public:
   SEdge                sedge[Num_SEdges];  // WARNING: Must not be the last field in struct or iterators fail
 private:
   // Start byte 8*17*3=59
-  uint16_t unused_bit1 : 1;
+  uint16_t hyper : 1;  // root only, the outputs are in Graph_hyper
   uint16_t unused_bit2 : 1;
   uint16_t inp_pos : 3;
   uint16_t out_pos : 3;
@@ -340,6 +341,7 @@ public:
     out_long     = 0;
     nid          = 0;
     type         = 0;
+    hyper        = 0;
   }
 
   bool is_deleted() const {
@@ -496,6 +498,20 @@ public:
       inp_pos++;
     }
   }
+  void clear_outputs() {  // outputs moved somewhere else (Graph_hyper)
+    out_pos  = 0;
+    out_long = 0;
+  }
+
+  bool is_hyper() const {
+    I(is_root());
+    return hyper;
+  }
+  void set_hyper(bool h) {
+    I(is_root());
+    hyper = h;
+  }
+
   bool has_local_edges() const { return inp_pos>0 || out_pos>0; }
   bool has_local_inputs() const { return inp_pos > 0; }
   bool has_local_outputs() const { return out_pos > 0; }
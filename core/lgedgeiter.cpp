@@ -77,12 +77,18 @@ Fast_edge_iterator::Fast_iter Fast_edge_iterator::begin() const {
 }
 
 Flow_base_iterator::Flow_base_iterator(bool _visit_sub)
-    : global_it(Fast_edge_iterator::Fast_iter(_visit_sub)), visit_sub(_visit_sub) {
+    : global_it(Fast_edge_iterator::Fast_iter(_visit_sub))
+    , visit_sub(_visit_sub)
+    , unvisited(_visit_sub, 0)
+    , pending_loop_detect(_visit_sub, 0) {
   linear_phase = true;
 }
 
 Flow_base_iterator::Flow_base_iterator(LGraph *lg, bool _visit_sub)
-    : global_it(lg->fast(_visit_sub).begin()), visit_sub(_visit_sub) {
+    : global_it(lg->fast(_visit_sub).begin())
+    , visit_sub(_visit_sub)
+    , unvisited(_visit_sub, lg->size())
+    , pending_loop_detect(_visit_sub, lg->size()) {
   linear_phase = true;
 }
 
@@ -97,7 +103,7 @@ void Fwd_edge_iterator::Fwd_iter::topo_add_chain_down(const Node_pin &dst_pin) {
 
   for (auto &edge2 : down_pin.inp_edges()) {  // fwd
     I(edge2.sink.get_pid() == down_pin.get_pid());
-    if (!unvisited.count(edge2.driver.get_node().get_compact()))
+    if (!unvisited.contains(edge2.driver.get_node().get_compact()))
       continue;
 
     topo_add_chain_fwd(edge2.driver);
@@ -106,7 +112,7 @@ void Fwd_edge_iterator::Fwd_iter::topo_add_chain_down(const Node_pin &dst_pin) {
 
 void Fwd_edge_iterator::Fwd_iter::topo_add_chain_fwd(const Node_pin &dst_pin) {
   const auto dst_node = dst_pin.get_node();
-  I(unvisited.count(dst_node.get_compact()));
+  I(unvisited.contains(dst_node.get_compact()));
 
   if (visit_sub) {
     if (dst_node.is_type_sub_present()) {  // DOWN??
@@ -122,7 +128,7 @@ void Fwd_edge_iterator::Fwd_iter::topo_add_chain_fwd(const Node_pin &dst_pin) {
 
         for (auto &edge2 : up_pin.inp_edges()) {  // fwd
           I(edge2.sink.get_pid() == up_pin.get_pid());
-          if (!unvisited.count(edge2.driver.get_node().get_compact()))
+          if (!unvisited.contains(edge2.driver.get_node().get_compact()))
             continue;
 
           topo_add_chain_fwd(edge2.driver);
@@ -150,7 +156,7 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_linear(LGraph *top) {
       if (visit_sub && next_node.is_type_sub())
         is_topo_sorted = false;
     } else {
-      for (const auto &edge : next_node.inp_edges()) {
+      for (const auto &edge : next_node.inp_edges_range()) {
         auto driver_node = edge.driver.get_node();
 
         if (driver_node.is_graph_input())
@@ -164,7 +170,7 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_linear(LGraph *top) {
           break;
         }
 
-        if (unvisited.count(driver_node.get_compact())) {  // fwd
+        if (unvisited.contains(driver_node.get_compact())) {  // fwd
           is_topo_sorted = false;
           break;
         }
@@ -190,7 +196,7 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_pending() {
     while (!pending_stack.empty()) {
       auto node = pending_stack.back();
 
-      if (!unvisited.count(node.get_compact())) {
+      if (!unvisited.contains(node.get_compact())) {
         pending_stack.pop_back();
         continue;
       }
@@ -219,7 +225,7 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_pending() {
       if (likely(!any_propagated && !node.is_graph_io() && (!visit_sub || !node.is_type_sub_present()))) {
         can_be_visited = true;
 
-        auto dpin_list = node.inp_drivers(unvisited);
+        auto dpin_list = node.inp_drivers();
 
         if (!dpin_list.empty()) {         // Something got added, track potential combinational loops
           for (auto &dpin : dpin_list) {  // fwd
@@ -227,12 +233,12 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_pending() {
               topo_add_chain_fwd(dpin);
           }
 
-          auto it = pending_loop_detect.find(node.get_compact());
-          if (it == pending_loop_detect.end()) {
-            pending_loop_detect[node.get_compact()] = node.get_num_out_edges();
+          auto *cnt = pending_loop_detect.find(node.get_compact());
+          if (cnt == nullptr) {
+            pending_loop_detect.set(node.get_compact(), node.get_num_out_edges());
           } else {
-            it->second--;
-            if (it->second <= 0) {  // Loop
+            (*cnt)--;
+            if (*cnt <= 0) {  // Loop
               pending_loop_detect.clear();
               pending_stack.push_back(node);  // to force loop break
             }
@@ -262,9 +268,9 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_pending() {
     }
 
     I(!(*global_it).is_graph_io());  // NOTE: should we propagate IO for going up?
-    if (unvisited.count((*global_it).get_compact())) {
+    if (unvisited.contains((*global_it).get_compact())) {
       pending_stack.push_back(*global_it);
-      for (auto &dpin : (*global_it).inp_drivers(unvisited)) {  // fwd
+      for (auto &dpin : (*global_it).inp_drivers()) {  // fwd
         if (unvisited.contains(dpin.get_node().get_compact()))
           topo_add_chain_fwd(dpin);
       }
@@ -1,6 +1,10 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include "lgedge.hpp"
 #include "lgraph.hpp"
 #include "node.hpp"
@@ -70,6 +74,128 @@ public:
   Fast_iter end() const { return Fast_iter(visit_sub); }
 };
 
+// Node set used by the flow iterators. Non-hierarchical traversals stay in
+// one LGraph, and the Index_ID are dense, so a bitmap indexed by nid is
+// enough. Hierarchical traversals mix hidx and fallback to a hash set.
+class Flow_node_set {
+protected:
+  const bool                         dense;
+  std::vector<uint64_t>              bitmap;
+  size_t                             num;
+  absl::flat_hash_set<Node::Compact> hset;
+
+  void grow(size_t nid) { bitmap.resize(std::max(bitmap.size() * 2, (nid >> 6) + 1), 0); }
+
+public:
+  Flow_node_set(bool hier, size_t sz) : dense(!hier), num(0) {
+    if (dense)
+      bitmap.resize((sz >> 6) + 1, 0);
+  }
+
+  bool contains(const Node::Compact &node) const {
+    if (!dense)
+      return hset.contains(node);
+
+    size_t nid = node.get_nid();
+    if ((nid >> 6) >= bitmap.size())
+      return false;
+    return (bitmap[nid >> 6] >> (nid & 63)) & 1;
+  }
+
+  void insert(const Node::Compact &node) {
+    if (!dense) {
+      hset.insert(node);
+      return;
+    }
+
+    size_t nid = node.get_nid();
+    if ((nid >> 6) >= bitmap.size())
+      grow(nid);  // nodes created during the traversal
+
+    uint64_t mask = uint64_t(1) << (nid & 63);
+    num += (bitmap[nid >> 6] & mask) ? 0 : 1;
+    bitmap[nid >> 6] |= mask;
+  }
+
+  void erase(const Node::Compact &node) {
+    if (!dense) {
+      hset.erase(node);
+      return;
+    }
+
+    size_t nid = node.get_nid();
+    if ((nid >> 6) >= bitmap.size())
+      return;
+
+    uint64_t mask = uint64_t(1) << (nid & 63);
+    num -= (bitmap[nid >> 6] & mask) ? 1 : 0;
+    bitmap[nid >> 6] &= ~mask;
+  }
+
+  bool empty() const { return dense ? num == 0 : hset.empty(); }
+};
+
+// Per node counter used by the flow iterators (same dense/hash split as
+// Flow_node_set). The dense array remembers the touched entries, so clear()
+// does not scan the whole graph.
+class Flow_node_counter {
+protected:
+  static constexpr int32_t                no_entry = std::numeric_limits<int32_t>::min();
+  const bool                              dense;
+  std::vector<int32_t>                    counter;
+  std::vector<uint32_t>                   touched;
+  absl::flat_hash_map<Node::Compact, int> hmap;
+
+public:
+  Flow_node_counter(bool hier, size_t sz) : dense(!hier) {
+    if (dense)
+      counter.resize(sz, no_entry);
+  }
+
+  // Returns nullptr if the node does not have a counter
+  int32_t *find(const Node::Compact &node) {
+    if (!dense) {
+      auto it = hmap.find(node);
+      if (it == hmap.end())
+        return nullptr;
+      return &it->second;
+    }
+
+    size_t nid = node.get_nid();
+    if (nid >= counter.size() || counter[nid] == no_entry)
+      return nullptr;
+    return &counter[nid];
+  }
+
+  void set(const Node::Compact &node, int32_t val) {
+    I(val != no_entry);
+    if (!dense) {
+      hmap[node] = val;
+      return;
+    }
+
+    size_t nid = node.get_nid();
+    if (nid >= counter.size())
+      counter.resize(std::max(counter.size() * 2, nid + 1), no_entry);
+    if (counter[nid] == no_entry)
+      touched.emplace_back(nid);
+    counter[nid] = val;
+  }
+
+  bool empty() const { return dense ? touched.empty() : hmap.empty(); }
+
+  void clear() {
+    if (!dense) {
+      hmap.clear();
+      return;
+    }
+    for (auto nid : touched) {
+      counter[nid] = no_entry;
+    }
+    touched.clear();
+  }
+};
+
 class Flow_base_iterator {
 protected:
   bool                          linear_phase;
@@ -77,10 +203,10 @@ protected:
   Fast_edge_iterator::Fast_iter global_it;
 
   // State built during iteration
-  const bool                              visit_sub;
-  absl::flat_hash_set<Node::Compact>      unvisited;
-  std::vector<Node>                       pending_stack;
-  absl::flat_hash_map<Node::Compact, int> pending_loop_detect;
+  const bool        visit_sub;
+  Flow_node_set     unvisited;
+  std::vector<Node> pending_stack;
+  Flow_node_counter pending_loop_detect;
 
   Flow_base_iterator(LGraph *lg, bool _visit_sub);
   Flow_base_iterator(bool _visit_sub);
@@ -90,7 +216,7 @@ public:
 
   void add_node(const Node &node) {
     bool all_inputs_visited=true;
-    for(auto e:node.inp_edges()) {
+    for(auto e:node.inp_edges_range()) {
       if (unvisited.contains(e.driver.get_node().get_compact())) {
         all_inputs_visited = false;
         break;
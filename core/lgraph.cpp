@@ -5,6 +5,7 @@
 #include <dirent.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <set>
@@ -16,7 +17,9 @@
 LGraph::LGraph(std::string_view _path, std::string_view _name, std::string_view _source)
     : LGraph_Base(_path, _name, Graph_library::instance(_path)->register_lgraph(_name, _source, this))
     , LGraph_Node_Type(_path, _name, get_lgid())
-    , htree(this) {
+    , htree(this)
+    , csr(_path, get_lgid())
+    , levels(this, _path, get_lgid()) {
   I(_name.find('/') == std::string::npos);  // No path in name
 
   I(_name == get_name());
@@ -30,7 +33,11 @@ LGraph::~LGraph() {
 bool LGraph::exists(std::string_view path, std::string_view name) { return Graph_library::try_find_lgraph(path, name) != nullptr; }
 
 LGraph *LGraph::create(std::string_view path, std::string_view name, std::string_view source) {
-  LGraph *lg = Graph_library::try_find_lgraph(path, name);
+  auto *lib = Graph_library::instance(path);
+
+  std::lock_guard<std::mutex> guard(lib->ref_open_lock());  // one LGraph per name across threads
+
+  LGraph *lg = lib->try_find_lgraph(name);
   if (lg == nullptr) {
     lg = new LGraph(path, name, source);
   }
@@ -61,11 +68,254 @@ LGraph *LGraph::clone_skeleton(std::string_view new_lg_name) {
   return new_lg;
 }
 
+namespace {
+
+// Driver pin on an extract cut: the graph IO name and the sinks on the other
+// side (inside sinks for inputs, outside sinks for outputs).
+struct Cut_pin {
+  Node_pin              dpin;
+  std::string           name;
+  std::vector<Node_pin> sinks;
+};
+
+// Same nodes and IO (names, order) for the same node set, so that stitch_back
+// finds the cut created by extract.
+size_t extract_cut(LGraph *lg, const LGraph::Node_set &nodes, std::vector<Node> &inside, std::vector<Cut_pin> &inputs,
+                   std::vector<Cut_pin> &outputs) {
+  inside.reserve(nodes.size());
+  for (const auto &compact : nodes) {
+    inside.emplace_back(lg, compact);
+    I(!inside.back().is_graph_io());
+  }
+  std::sort(inside.begin(), inside.end(), [](const Node &a, const Node &b) {
+    return a.get_compact_class().get_nid() < b.get_compact_class().get_nid();
+  });
+
+  absl::flat_hash_map<Node_pin::Compact_class_driver, size_t> inp_pos;
+  absl::flat_hash_map<Node_pin::Compact_class_driver, size_t> out_pos;
+
+  auto add_cut = [](absl::flat_hash_map<Node_pin::Compact_class_driver, size_t> &pos, std::vector<Cut_pin> &cut,
+                    const Node_pin &dpin, std::string_view prefix) -> Cut_pin & {
+    auto [it, inserted] = pos.emplace(dpin.get_compact_class_driver(), cut.size());
+    if (inserted) {
+      auto name = dpin.has_name() ? std::string(dpin.get_name()) : absl::StrCat(prefix, std::to_string(cut.size()));
+      cut.emplace_back(Cut_pin{dpin, name, {}});
+    }
+    return cut[it->second];
+  };
+
+  size_t n_pins = 0;
+  for (const auto &node : inside) {
+    for (auto &e : node.inp_edges_ordered()) {
+      ++n_pins;
+      if (nodes.contains(e.driver.get_node().get_compact_class()))
+        continue;
+      add_cut(inp_pos, inputs, e.driver, "extract_in_").sinks.emplace_back(e.sink);
+    }
+    for (auto &e : node.out_edges_ordered()) {
+      if (nodes.contains(e.sink.get_node().get_compact_class()))
+        continue;
+      ++n_pins;
+      add_cut(out_pos, outputs, e.driver, "extract_out_").sinks.emplace_back(e.sink);
+    }
+  }
+
+  return n_pins;
+}
+
+// A const with a name or an offset can not come from the const pool: the
+// pooled node may already drive other nodes in dst.
+bool has_own_attrs(const Node &node) {
+  if (node.has_name())
+    return true;
+  for (const auto &dpin : node.out_connected_pins()) {
+    if (dpin.has_name() || dpin.get_offset())
+      return true;
+  }
+  return false;
+}
+
+// Copies the nodes (type, names, bits, offsets) and the edges between them to
+// dst. A pin name already used in dst is not copied.
+void copy_nodes(LGraph *dst, const std::vector<Node> &src, absl::flat_hash_map<Node::Compact_class, Node> &old2new) {
+  for (const auto &old_node : src) {
+    Node new_node;
+    if (old_node.is_type_const() && has_own_attrs(old_node)) {
+      new_node = dst->create_node();
+      new_node.set_type_const(old_node.get_type_const());
+      new_node.setup_driver_pin().set_bits(old_node.get_driver_pin().get_bits());
+    } else {
+      new_node = dst->create_node(old_node);
+    }
+    if (old_node.has_name() && !new_node.has_name())
+      new_node.set_name(old_node.get_name());
+
+    for (const auto &old_dpin : old_node.out_connected_pins()) {
+      auto new_dpin = new_node.setup_driver_pin_raw(old_dpin.get_pid());
+      new_dpin.set_offset(old_dpin.get_offset());
+      if (old_dpin.has_name() && !new_dpin.has_name() && Node_pin::find_driver_pin(dst, old_dpin.get_name()).is_invalid())
+        new_dpin.set_name(old_dpin.get_name());
+    }
+
+    old2new.emplace(old_node.get_compact_class(), new_node);
+  }
+
+  for (const auto &old_node : src) {
+    auto &new_node = old2new[old_node.get_compact_class()];
+    for (auto &e : old_node.inp_edges()) {
+      const auto it = old2new.find(e.driver.get_node().get_compact_class());
+      if (it == old2new.end())
+        continue;
+      dst->add_edge(it->second.setup_driver_pin_raw(e.driver.get_pid()), new_node.setup_sink_pin_raw(e.sink.get_pid()));
+    }
+  }
+}
+
+}  // namespace
+
+void LGraph::add_cone(const Node &node, bool fanin, Node_set &nodes) {
+  std::vector<Node> pending;
+  pending.emplace_back(node);
+  nodes.insert(node.get_compact_class());
+
+  while (!pending.empty()) {
+    auto cur = pending.back();
+    pending.pop_back();
+
+    if (cur != node && Ntype::is_loop_breaker(cur.get_type_op()))
+      continue;
+
+    for (auto &e : fanin ? cur.inp_edges() : cur.out_edges()) {
+      auto next = fanin ? e.driver.get_node() : e.sink.get_node();
+      if (next.is_graph_io())
+        continue;
+      if (nodes.insert(next.get_compact_class()).second)
+        pending.emplace_back(next);
+    }
+  }
+}
+
+LGraph *LGraph::extract(const Node_set &nodes, std::string_view new_name) {
+  std::vector<Node>    inside;
+  std::vector<Cut_pin> inputs;
+  std::vector<Cut_pin> outputs;
+  auto                 n_pins = extract_cut(this, nodes, inside, inputs, outputs);
+
+  std::string lg_source{get_library().get_source(get_lgid())};  // string, create can free it
+  LGraph     *new_lg = LGraph::create(get_path(), new_name, lg_source);
+
+  new_lg->reserve_nodes(inside.size() + n_pins);
+
+  Port_ID pos = 1;
+  std::vector<Node_pin> new_inputs;
+  new_inputs.reserve(inputs.size());
+  for (const auto &inp : inputs) {
+    auto dpin = new_lg->add_graph_input(inp.name, pos++, inp.dpin.get_bits());
+    dpin.set_offset(inp.dpin.get_offset());
+    new_inputs.emplace_back(dpin);
+  }
+  std::vector<Node_pin> new_outputs;
+  new_outputs.reserve(outputs.size());
+  for (const auto &out : outputs) {
+    new_outputs.emplace_back(new_lg->add_graph_output(out.name, pos++, out.dpin.get_bits()));
+  }
+
+  absl::flat_hash_map<Node::Compact_class, Node> old2new;
+  copy_nodes(new_lg, inside, old2new);
+
+  for (auto i = 0u; i < inputs.size(); ++i) {
+    for (const auto &spin : inputs[i].sinks) {
+      auto &new_node = old2new[spin.get_node().get_compact_class()];
+      new_lg->add_edge(new_inputs[i], new_node.setup_sink_pin_raw(spin.get_pid()));
+    }
+  }
+  for (auto i = 0u; i < outputs.size(); ++i) {
+    const auto &new_node = old2new[outputs[i].dpin.get_node().get_compact_class()];
+    new_lg->add_edge(new_node.setup_driver_pin_raw(outputs[i].dpin.get_pid()), new_outputs[i]);
+  }
+
+  return new_lg;
+}
+
+void LGraph::stitch_back(const Node_set &nodes, LGraph *region) {
+  I(region != this);
+
+  std::vector<Node>    inside;
+  std::vector<Cut_pin> inputs;
+  std::vector<Cut_pin> outputs;
+  extract_cut(this, nodes, inside, inputs, outputs);
+
+  // Check the outputs first, the graph is not changed on error
+  for (const auto &out : outputs) {
+    if (!region->is_graph_output(out.name) || region->get_graph_output(out.name).inp_edges().empty())
+      error("stitch_back region {} output {} has no driver ({} sinks in {})", region->get_name(), out.name, out.sinks.size(), get_name());
+  }
+
+  absl::flat_hash_map<std::string_view, const Cut_pin *> name2input;
+  for (const auto &inp : inputs) {
+    name2input.emplace(inp.name, &inp);
+  }
+
+  // Names are a bimap, free them for the region pins
+  for (auto &node : inside) {
+    for (auto &dpin : node.out_connected_pins()) {
+      if (dpin.has_name())
+        dpin.del_name();
+    }
+    node.del_node();
+  }
+
+  std::vector<Node> src;
+  for (auto node : region->fast()) {
+    if (!node.is_graph_io())
+      src.emplace_back(node);
+  }
+  reserve_nodes(2 * src.size());
+
+  absl::flat_hash_map<Node::Compact_class, Node> old2new;
+  copy_nodes(this, src, old2new);
+
+  // Region driver to driver in this graph
+  auto get_driver = [&](const Node_pin &dpin) -> Node_pin {
+    if (dpin.get_node().is_graph_input()) {
+      const auto it = name2input.find(dpin.get_name());
+      I(it != name2input.end());  // region input not in the cut
+      return it->second->dpin;
+    }
+    return old2new[dpin.get_node().get_compact_class()].setup_driver_pin_raw(dpin.get_pid());
+  };
+
+  region->each_graph_input([&](Node_pin &pin) {
+    for (auto &e : pin.out_edges()) {
+      if (e.sink.is_graph_output())
+        continue;  // feed-through, done with the outputs
+      auto &new_node = old2new[e.sink.get_node().get_compact_class()];
+      add_edge(get_driver(e.driver), new_node.setup_sink_pin_raw(e.sink.get_pid()));
+    }
+  });
+
+  for (const auto &out : outputs) {
+    auto spin = region->get_graph_output(out.name);
+    for (auto &e : spin.inp_edges()) {
+      auto dpin = get_driver(e.driver);
+      for (const auto &outside_spin : out.sinks) {
+        add_edge(dpin, outside_spin);
+      }
+      if (dpin.get_node().is_type_const())
+        continue;  // unnamed consts are pooled, other nodes may use it
+      if (!dpin.has_name() && Node_pin::find_driver_pin(this, out.name).is_invalid())
+        dpin.set_name(out.name);
+    }
+  }
+}
+
 LGraph *LGraph::open(std::string_view path, Lg_type_id lgid) {
   auto *lib = Graph_library::instance(path);
   if (unlikely(lib == nullptr))
     return nullptr;
 
+  std::lock_guard<std::mutex> guard(lib->ref_open_lock());
+
   LGraph *lg = lib->try_find_lgraph(lgid);
   if (likely(lg != nullptr)) {
     return lg;
@@ -81,15 +331,17 @@ LGraph *LGraph::open(std::string_view path, Lg_type_id lgid) {
 }
 
 LGraph *LGraph::open(std::string_view path, std::string_view name) {
-  LGraph *lg = Graph_library::try_find_lgraph(path, name);
-  if (lg) {
-    return lg;
-  }
-
   auto *lib = Graph_library::instance(path);
   if (lib == nullptr)
     return nullptr;
 
+  std::lock_guard<std::mutex> guard(lib->ref_open_lock());
+
+  LGraph *lg = lib->try_find_lgraph(name);
+  if (lg) {
+    return lg;
+  }
+
   if (unlikely(!lib->has_name(name)))
     return nullptr;
 
@@ -98,6 +350,27 @@ LGraph *LGraph::open(std::string_view path, std::string_view name) {
   return new LGraph(path, name, source);
 }
 
+bool LGraph::is_empty() const {
+  if (node_internal.is_mapped())
+    return fast_first() == 0;
+
+  // Same check as fast_first. A master root after the graph IO nids is not
+  // IO, and the non-empty graphs have one in the first page.
+  constexpr size_t page_entries = 4096 / sizeof(Node_internal);
+  alignas(4096) uint8_t buffer[4096];
+  const auto *page = reinterpret_cast<const Node_internal *>(buffer);
+
+  for (size_t pos = 0;; pos += page_entries) {
+    auto n = node_internal.peek(pos, page_entries, reinterpret_cast<Node_internal *>(buffer));
+    for (size_t i = 0; i < n; ++i) {
+      if (pos + i > Hardcoded_output_nid.value && page[i].is_valid() && page[i].is_master_root())
+        return false;
+    }
+    if (n < page_entries)
+      return true;
+  }
+}
+
 void LGraph::rename(std::string_view path, std::string_view orig, std::string_view dest) {
   bool valid = Graph_library::instance(path)->rename_name(orig, dest);
   if (valid)
@@ -123,11 +396,13 @@ void LGraph::clear() {
   set_type(nid2, Ntype_op::IO);
 
   htree.clear();
-
-  std::fill(memoize_const_hint.begin(), memoize_const_hint.end(), 0);  // Not needed but neat
+  csr.clear();
+  levels.clear();
 }
 
 void LGraph::sync() {
+  htree.sync();
+
   Ann_support::sync(this);
 
   LGraph_Node_Type::sync();
@@ -265,7 +540,9 @@ Node_pin_iterator LGraph::out_connected_pins(const Node &node) const {
   auto pid = node_internal[idx2].get_dst_pid();
   while (true) {
     I(!xiter_set.contains(pid));
-    auto n = node_internal[idx2].get_num_local_outputs();
+    size_t n = node_internal[idx2].get_num_local_outputs();
+    if (is_hyper_root(idx2))
+      n += hyper.get_num_sinks(idx2);
     if (n > 0) {
       auto root_idx = idx2;
       if (!node_internal[idx2].is_root())
@@ -335,7 +612,7 @@ Node_pin_iterator LGraph::inp_connected_pins(const Node &node) const {
   return xiter;
 }
 
-Node_pin_iterator LGraph::inp_drivers(const Node &node, const absl::flat_hash_set<Node::Compact> &restrict_to) const {
+Node_pin_iterator LGraph::inp_drivers(const Node &node) const {
   I(node.get_class_lgraph() == this);
 
   Node_pin_iterator xiter;
@@ -361,9 +638,6 @@ Node_pin_iterator LGraph::inp_drivers(const Node &node, const absl::flat_hash_se
         auto driver_master_nid = node_internal[driver_pin_idx].get_nid();
         I(node_internal[driver_master_nid].is_master_root());
 
-//        if (!restrict_to.contains(Node::Compact(node.get_hidx(), driver_master_nid)))
-//          continue;
-
         Node_pin dpin(node.get_top_lgraph(), node.get_class_lgraph(), node.get_hidx(), driver_pin_idx, driver_pin_pid, false);
 
         if (hier) {
@@ -434,6 +708,21 @@ XEdge_iterator LGraph::out_edges(const Node &node) const {
         }
       }
     }
+    if (is_hyper_root(idx2)) {
+      Node_pin dpin(node.get_top_lgraph(),
+                    node.get_class_lgraph(),
+                    node.get_hidx(),
+                    idx2,
+                    node_internal[idx2].get_dst_pid(),
+                    false);
+      for (const auto &s : hyper.get_sinks(idx2)) {
+        Node_pin spin(node.get_top_lgraph(), node.get_class_lgraph(), node.get_hidx(), s.idx, s.pid, true);
+        if (hier)
+          trace_forward2sink(xiter, dpin, spin);
+        else
+          xiter.emplace_back(dpin, spin);
+      }
+    }
     if (node_internal[idx2].is_last_state())
       break;
     Index_ID tmp = node_internal[idx2].get_next();
@@ -524,6 +813,30 @@ XEdge_iterator LGraph::out_edges_ordered(const Node &node) const {
   return iter;
 }
 
+XEdge_small_iterator LGraph::inp_edges_ordered_small(const Node &node) const {
+  XEdge_small_iterator iter;
+  for (const auto &e : XEdge_range(node, false)) {
+    iter.emplace_back(e);
+  }
+
+  std::sort(iter.begin(), iter.end(), [](const XEdge &a, const XEdge &b) -> bool { return a.sink.get_pid() < b.sink.get_pid(); });
+
+  return iter;
+}
+
+XEdge_small_iterator LGraph::out_edges_ordered_small(const Node &node) const {
+  XEdge_small_iterator iter;
+  for (const auto &e : XEdge_range(node, true)) {
+    iter.emplace_back(e);
+  }
+
+  std::sort(iter.begin(), iter.end(), [](const XEdge &a, const XEdge &b) -> bool {
+    return a.driver.get_pid() < b.driver.get_pid();
+  });
+
+  return iter;
+}
+
 XEdge_iterator LGraph::inp_edges_ordered_reverse(const Node &node) const {
   auto iter = inp_edges(node);
 
@@ -563,6 +876,17 @@ XEdge_iterator LGraph::out_edges(const Node_pin &dpin) const {
       }
     }
 
+    if (is_hyper_root(idx2)) {
+      for (const auto &s : hyper.get_sinks(idx2)) {
+        Node_pin spin(dpin.get_top_lgraph(), dpin.get_class_lgraph(), dpin.get_hidx(), s.idx, s.pid, true);
+        if (dpin.is_hierarchical()) {
+          trace_forward2sink(xiter, dpin, spin);
+        } else {
+          xiter.emplace_back(dpin, spin);
+        }
+      }
+    }
+
     return true; // continue the iterations
   });
 
@@ -628,6 +952,8 @@ bool LGraph::has_outputs(const Node &node) const {
   while (true) {
     if (node_internal[idx2].has_local_outputs())
       return true;
+    if (is_hyper_root(idx2) && hyper.get_num_sinks(idx2))
+      return true;
 
     if (node_internal[idx2].is_last_state())
       return false;
@@ -653,6 +979,9 @@ bool LGraph::has_outputs(const Node_pin &pin) const {
   I(pin.is_driver());
   auto idx = pin.get_root_idx();
 
+  if (is_hyper_root(idx) && hyper.get_num_sinks(idx))
+    return true;
+
   auto idx2 = pin.get_root_idx();
   while (true) {
     if (node_internal[idx2].get_dst_pid() == pin.get_pid())
@@ -689,6 +1018,8 @@ int LGraph::get_num_out_edges(const Node &node) const {
   int total = 0;
   while (true) {
     total += node_internal[idx2].get_num_local_outputs();
+    if (is_hyper_root(idx2))
+      total += hyper.get_num_sinks(idx2);
 
     if (node_internal[idx2].is_last_state())
       return total;
@@ -717,6 +1048,8 @@ int LGraph::get_num_edges(const Node &node) const {
   int total = 0;
   while (true) {
     total += node_internal[idx2].get_num_local_edges();
+    if (is_hyper_root(idx2))
+      total += hyper.get_num_sinks(idx2);
 
     if (node_internal[idx2].is_last_state())
       return total;
@@ -730,6 +1063,8 @@ int LGraph::get_num_out_edges(const Node_pin &pin) const {
   I(pin.is_driver());
   int total = 0;
   auto idx = pin.get_root_idx();
+  if (is_hyper_root(idx))
+    total += hyper.get_num_sinks(idx);
 
   auto idx2 = pin.get_root_idx();
   while (true) {
@@ -764,6 +1099,9 @@ int LGraph::get_num_inp_edges(const Node_pin &pin) const {
 void LGraph::del_pin(const Node_pin &pin) {
   Node_pin inv;
 
+  bump_edit_epoch();
+  journal.add(Graph_journal::Op::Del_pin, pin.get_node().get_nid());
+
   if (pin.is_graph_io()) {
     ref_self_sub_node()->del_pin(pin.get_pid());
   }
@@ -773,6 +1111,10 @@ void LGraph::del_pin(const Node_pin &pin) {
   }else{
     del_edge_sink_int(inv, pin);
   }
+
+#ifdef LGRAPH_GRAPH_CORE
+  gcore_del_pin(pin.get_root_idx(), pin.is_driver());
+#endif
 }
 
 void LGraph::del_node(const Node &node) {
@@ -789,11 +1131,20 @@ void LGraph::del_node(const Node &node) {
     lut_map.erase(node.get_compact_class());
   } else if (op == Ntype_op::Sub) {
     subid_map.erase(node.get_compact_class());
+    Hierarchy_tree::sub_changed(get_lgid());
   }
 
   // In hierarchy, not allowed to remove nodes (mark as deleted attribute?)
   I(node.get_class_lgraph() == node.get_top_lgraph());
 
+  bump_edit_epoch();
+  strash.touch(idx2);
+  journal.add(Graph_journal::Op::Del_node, idx2);
+
+#ifdef LGRAPH_GRAPH_CORE
+  gcore_del_node(idx2);
+#endif
+
   while (true) {
     auto *node_int_ptr = node_internal.ref(idx2);
 
@@ -827,6 +1178,7 @@ void LGraph::del_node(const Node &node) {
         I(dpin_pid == node_internal[dpin_idx].get_dst_pid());
         Node_pin dpin(this, this, Hierarchy_tree::invalid_index(), dpin_idx, dpin_pid, false);
         del_edge_driver_int(dpin, spin);
+        journal.add(Graph_journal::Op::Del_edge, node.get_nid(), get_master_nid(dpin_idx));
 #endif
       }
     }
@@ -851,6 +1203,22 @@ void LGraph::del_node(const Node &node) {
 
         Node other_sink(this, this, Hierarchy_tree::invalid_index(), other_nid);
         del_sink2node_int(node, other_sink);
+        journal.add(Graph_journal::Op::Del_edge, other_nid, node.get_nid());
+      }
+
+      if (is_hyper_root(idx2)) {
+        for (const auto &s : hyper.get_sinks(idx2)) {
+          auto other_nid = node_internal[s.idx].get_nid();
+          if (deleted.count(other_nid))
+            continue;
+          deleted.insert(other_nid);
+
+          Node other_sink(this, this, Hierarchy_tree::invalid_index(), other_nid);
+          del_sink2node_int(node, other_sink);
+          journal.add(Graph_journal::Op::Del_edge, other_nid, node.get_nid());
+        }
+        hyper.erase(idx2);
+        node_int_ptr->set_hyper(false);
       }
     }
 
@@ -887,6 +1255,10 @@ void LGraph::del_driver2node_int(Node &driver, const Node &sink) {
   Index_ID last_idx = idx2;
 
   while (true) {
+    if (is_hyper_root(idx2)) {
+      hyper.del_if(idx2, [this, &sink](const Graph_hyper::Sink &s) { return node_internal[s.idx].get_nid() == sink.get_nid(); });
+    }
+
     auto            n = node_int_ptr->get_num_local_outputs();
     if (n) {
       uint8_t         i;
@@ -928,6 +1300,7 @@ void LGraph::del_sink2node_int(const Node &driver, Node &sink) {
   Index_ID idx2         = sink.get_nid();
   auto *   node_int_ptr = node_internal.ref(idx2);
   node_int_ptr->clear_full_hint();
+  strash.touch(idx2);
 
   Index_ID last_idx = idx2;
 
@@ -1001,6 +1374,17 @@ bool LGraph::del_edge_driver_int(const Node_pin &dpin, const Node_pin &spin) {
   if (!spin.is_invalid())
     spin_root_idx = spin.get_root_idx();
 
+  if (is_hyper_root(dpin.get_root_idx())) {
+    if (spin_root_idx == 0) {
+      hyper.del_if(dpin.get_root_idx(), [](const Graph_hyper::Sink &s) {
+        (void)s;
+        return true;
+      });
+    } else if (hyper.del(dpin.get_root_idx(), spin_root_idx, spin.get_pid())) {
+      return true;
+    }
+  }
+
   while (true) {
     I(node_int_ptr->get_dst_pid() == dpin.get_pid());
 
@@ -1050,6 +1434,7 @@ bool LGraph::del_edge_sink_int(const Node_pin &dpin, const Node_pin &spin) {
   Index_ID idx2         = spin.get_idx();
   auto *   node_int_ptr = node_internal.ref(idx2);
   node_internal.ref(spin.get_root_idx())->clear_full_hint();
+  strash.touch(spin.get_node().get_nid());
 
   Index_ID dpin_root_idx = 0;
   if (!dpin.is_invalid())
@@ -1103,14 +1488,99 @@ bool LGraph::del_edge(const Node_pin &dpin, const Node_pin &spin) {
   found = del_edge_sink_int(dpin, spin);
   I(found);
 
+  bump_edit_epoch();
+  journal.add(Graph_journal::Op::Del_edge, spin.get_node().get_nid(), dpin.get_node().get_nid());
+
+#ifdef LGRAPH_GRAPH_CORE
+  gcore.del_edge(get_gcore_idx(spin.get_root_idx()), get_gcore_idx(dpin.get_root_idx()));
+#endif
+
   return true;
 }
 
-Node LGraph::create_node() {
+const Graph_csr &LGraph::freeze(bool with_bits) {
+  if (!csr.is_fresh(get_edit_epoch()) || (with_bits && !csr.has_bits(get_bits_epoch())))
+    csr.build(this, with_bits);
+
+  return csr;
+}
+
+const Graph_level &LGraph::get_levelization() {
+  if (!levels.is_fresh(get_edit_epoch()))
+    levels.build();
+
+  return levels;
+}
+
+bool LGraph::get_dirty_nodes(uint64_t since_version, std::vector<Node> &dirty) {
+  absl::flat_hash_set<uint32_t> nids;
+  if (!journal.get_dirty(since_version, nids))
+    return false;
+
+  std::vector<uint32_t> sorted(nids.begin(), nids.end());
+  std::sort(sorted.begin(), sorted.end());  // deterministic order for the passes
+
+  dirty.clear();
+  for (auto nid : sorted) {
+    if (nid < node_internal.size() && node_internal[nid].is_valid() && node_internal[nid].is_master_root())
+      dirty.emplace_back(this, Hierarchy_tree::root_index(), Index_ID(nid));
+  }
+
+  return true;
+}
+
+Index_ID LGraph::create_node_nid() {
   Index_ID nid = create_node_int();
-  return Node(this, Hierarchy_tree::root_index(), nid);
+  journal.add(Graph_journal::Op::Create_node, nid);
+  return nid;
+}
+
+Index_ID LGraph::create_node_nid(const Ntype_op op) {
+  I(op != Ntype_op::IO);     // Special case, must use add input/output API
+  I(op != Ntype_op::Sub);    // Do not build by steps. call create_node_sub
+  I(op != Ntype_op::Const);  // Hash-consed, call create_node_const
+
+  Index_ID nid = create_node_nid();
+  set_type(nid, op);
+  return nid;
+}
+
+Index_ID LGraph::create_node_const_nid(const Lconst &value) {
+  // Hash-consed: the same value (and bits) is always the same node
+  if (unlikely(!const_pool_checked)) {
+    const_pool_checked = true;
+    if (const_pool.empty() && !const_map.empty())
+      rebuild_const_pool();  // lgdb from before the pool
+  }
+
+  auto nid = find_type_const(value);
+  if (nid == 0) {
+    nid = create_node_nid();
+    set_type_const(nid, value);
+  }
+
+  I(node_internal[nid].get_dst_pid() == 0);
+  I(node_internal[nid].is_master_root());
+
+  return nid;
 }
 
+Index_ID LGraph::create_node_lut_nid(const Lconst &lut) {
+  auto nid = create_node_nid();
+  set_type_lut(nid, lut);
+  return nid;
+}
+
+Index_ID LGraph::create_node_sub_nid(Lg_type_id sub_id) {
+  I(get_lgid() != sub_id);  // It can not point to itself (in fact, no recursion of any type)
+
+  auto nid = create_node_nid();
+  set_type_sub(nid, sub_id);
+  return nid;
+}
+
+Node LGraph::create_node() { return Node(this, Hierarchy_tree::root_index(), create_node_nid()); }
+
 Node LGraph::create_node(const Node &old_node) {
   // TODO: We can just copy the node_type_table AND update the tracking (graphio, consts)
 
@@ -1141,15 +1611,7 @@ Node LGraph::create_node(const Node &old_node) {
   return new_node;
 }
 
-Node LGraph::create_node(const Ntype_op op) {
-  Index_ID nid = create_node_int();
-  set_type(nid, op);
-
-  I(op != Ntype_op::IO);   // Special case, must use add input/output API
-  I(op != Ntype_op::Sub);  // Do not build by steps. call create_node_sub
-
-  return Node(this, Hierarchy_tree::root_index(), nid);
-}
+Node LGraph::create_node(const Ntype_op op) { return Node(this, Hierarchy_tree::root_index(), create_node_nid(op)); }
 
 Node LGraph::create_node(const Ntype_op op, Bits_t bits) {
   auto node = create_node(op);
@@ -1161,51 +1623,32 @@ Node LGraph::create_node(const Ntype_op op, Bits_t bits) {
 }
 
 Node LGraph::create_node_const(const Lconst &value) {
-  // WARNING: There is a const_map, but it is NOT a bimap (speed). Just from
-  // nid to const.
-  Index_ID nid = memoize_const_hint[value.hash() % memoize_const_hint.size()];
-  if (nid == 0
-      || nid >= node_internal.size()
-      || !node_internal[nid].is_valid()
-      || node_internal[nid].get_type() != Ntype_op::Const
-      || get_type_const(nid) != value
-      || get_type_const(nid).get_bits() != value.get_bits()) {
-    nid = create_node_int();
-    set_type_const(nid, value);
-    memoize_const_hint[value.hash() % memoize_const_hint.size()] = nid;
-  }
-
-  I(node_internal[nid].get_dst_pid() == 0);
-  I(node_internal[nid].is_master_root());
-
-  return Node(this, Hierarchy_tree::root_index(), nid);
+  return Node(this, Hierarchy_tree::root_index(), create_node_const_nid(value));
 }
 
-Node LGraph::create_node_lut(const Lconst &lut) {
-
-  auto nid = create_node().get_nid();
-  set_type_lut(nid, lut);
-
-  return Node(this, Hierarchy_tree::root_index(), nid);
+void LGraph::rebuild_const_pool() {
+  const_pool.clear();
+  for (auto nid = fast_first(); nid; nid = fast_next(nid)) {
+    if (node_internal[nid].get_type() != Ntype_op::Const)
+      continue;
+    auto v = const_map.get(Node::Compact_class(nid));
+    if (node_internal[nid].get_bits() == Lconst(v).get_bits())  // not resized after creation
+      const_pool.set(v, Node::Compact_class(nid));
+  }
+  const_pool_checked = true;
 }
 
-Node LGraph::create_node_sub(Lg_type_id sub_id) {
-  I(get_lgid() != sub_id);  // It can not point to itself (in fact, no recursion of any type)
-
-  auto nid = create_node().get_nid();
-  set_type_sub(nid, sub_id);
+Node LGraph::create_node_lut(const Lconst &lut) { return Node(this, Hierarchy_tree::root_index(), create_node_lut_nid(lut)); }
 
-  return Node(this, Hierarchy_tree::root_index(), nid);
+Node LGraph::create_node_sub(Lg_type_id sub_id) {
+  return Node(this, Hierarchy_tree::root_index(), create_node_sub_nid(sub_id));
 }
 
 Node LGraph::create_node_sub(std::string_view sub_name) {
   I(name != sub_name);  // It can not point to itself (in fact, no recursion of any type)
 
-  auto  nid = create_node().get_nid();
   auto &sub = library->setup_sub(sub_name);
-  set_type_sub(nid, sub.get_lgid());
-
-  return Node(this, Hierarchy_tree::root_index(), nid);
+  return Node(this, Hierarchy_tree::root_index(), create_node_sub_nid(sub.get_lgid()));
 }
 
 const Sub_node &LGraph::get_self_sub_node() const { return library->get_sub(get_lgid()); }
@@ -2,7 +2,11 @@
 #pragma once
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "edge.hpp"
+#include "edge_range.hpp"
+#include "graph_csr.hpp"
+#include "graph_level.hpp"
 #include "graph_library.hpp"
 #include "hierarchy.hpp"
 #include "lgedge.hpp"
@@ -22,11 +26,14 @@ protected:
   friend class Fwd_edge_iterator;
   friend class Bwd_edge_iterator;
   friend class Fast_edge_iterator;
-
-  // Memoize tables that provide hints (not certainty because add/del operations)
-  std::array<Index_ID, 16> memoize_const_hint;
+  friend class Graph_csr;
+  friend class Graph_level;
+  friend class LGraph_builder;
+  friend class XEdge_range;
 
   Hierarchy_tree htree;
+  Graph_csr      csr;
+  Graph_level    levels;
 
   explicit LGraph(std::string_view _path, std::string_view _name, std::string_view _source);
 
@@ -44,10 +51,18 @@ protected:
     return idx;
   }
 
+  // Node creation shared by the create_node* calls and LGraph_builder (the
+  // journal entry, the type maps and the const pool are only handled here)
+  Index_ID create_node_nid();
+  Index_ID create_node_nid(const Ntype_op op);
+  Index_ID create_node_const_nid(const Lconst &value);
+  Index_ID create_node_lut_nid(const Lconst &lut);
+  Index_ID create_node_sub_nid(Lg_type_id sub_id);
+
   Node_pin_iterator out_connected_pins(const Node &node) const;
   Node_pin_iterator inp_connected_pins(const Node &node) const;
 
-  Node_pin_iterator inp_drivers(const Node &node, const absl::flat_hash_set<Node::Compact> &exclude) const;
+  Node_pin_iterator inp_drivers(const Node &node) const;
 
   XEdge_iterator out_edges(const Node &node) const;
   XEdge_iterator inp_edges(const Node &node) const;
@@ -58,6 +73,9 @@ protected:
   XEdge_iterator out_edges_ordered_reverse(const Node &node) const;
   XEdge_iterator inp_edges_ordered_reverse(const Node &node) const;
 
+  XEdge_small_iterator out_edges_ordered_small(const Node &node) const;
+  XEdge_small_iterator inp_edges_ordered_small(const Node &node) const;
+
   XEdge_iterator out_edges(const Node_pin &pin) const;
   XEdge_iterator inp_edges(const Node_pin &pin) const;
 
@@ -137,13 +155,31 @@ protected:
   void trace_back2driver(Node_pin_iterator &xiter, const Node_pin &dpin) const;
   void trace_forward2sink(XEdge_iterator &xiter, const Node_pin &dpin, const Node_pin &spin) const;
 
+public:
+  enum class Compact_order {
+    Keep,         // Same relative order, only removes the deleted entries
+    BFS,          // Breadth first from the graph inputs
+    Topological   // Levelization order (see get_levelization)
+  };
+
+protected:
+  void compact_order(Compact_order order, std::vector<Index_ID> &nids);
+
+  static uint64_t strash_input(Index_ID driver_idx, Port_ID driver_pid, Port_ID sink_pid) {
+    return (static_cast<uint64_t>(driver_idx.value) << (2 * Port_bits)) | (static_cast<uint64_t>(sink_pid) << Port_bits) | driver_pid;
+  }
+  void     strash_key(Index_ID nid, std::vector<uint64_t> &key) const;
+  void     strash_sync();
+
 public:
   LGraph()               = delete;
   LGraph(const LGraph &) = delete;
 
   virtual ~LGraph();
 
-  bool is_empty() const { return fast_first() == 0; }
+  // True if there are no nodes besides the graph IO. An lgraph just opened
+  // does not map the node table for it (only the first pages are read).
+  bool is_empty() const;
 
   void regenerate_htree() {
     htree.clear();
@@ -155,7 +191,7 @@ public:
       htree.regenerate();
     return &htree;
   }
-  const Hierarchy_tree &get_htree() {
+  Hierarchy_tree &get_htree() {  // not const, the tree expands lazily
     if (htree.empty())
       htree.regenerate();
     return htree;
@@ -174,12 +210,56 @@ public:
     set_bits(dpin.get_root_idx(), bits);
   }
 
+  // Immutable CSR snapshot of the (non-hierarchical) graph. Rebuilt only when
+  // the graph changed since the last freeze. Any edit invalidates the spans.
+  const Graph_csr &freeze(bool with_bits = false);
+
+  // Cached topological levels of the (non-hierarchical) graph. Recomputed only
+  // when the graph changed, otherwise it is a linear scan of the level order.
+  const Graph_level &get_levelization();
+
+  // Garbage collects the deleted node_internal entries and renumbers the
+  // nodes (and pins) in the given order, so that related nodes are close in
+  // memory. The node/pin attributes (annotate.hpp), the const/lut/sub tables,
+  // and the hierarchy trees of the open graphs are remapped. So are the
+  // hierarchical attributes of the open graphs instantiating this one (keep
+  // them open). Any Node, Node_pin or XEdge held before the call is invalid
+  // after it.
+  void compact(Compact_order order = Compact_order::Topological);
+
+  // Edit journal (off by default, see Graph_journal). A pass keeps
+  // get_journal_version() and later asks for the nodes created or changed
+  // (type, bits, edges) since then. Deleted nodes are not returned, their
+  // neighbors are. False if the journal can not tell (disabled, cleared or
+  // compacted since), the pass must assume that everything changed.
+  void     enable_journal() { journal.enable(); }
+  void     disable_journal() { journal.disable(); }
+  uint64_t get_journal_version() const { return journal.get_version(); }
+  bool     get_dirty_nodes(uint64_t since_version, std::vector<Node> &dirty);
+
   Fwd_edge_iterator  forward(bool visit_sub = false);
   Bwd_edge_iterator  backward(bool visit_sub = false);
   Fast_edge_iterator fast(bool visit_sub = false);
 
   LGraph *clone_skeleton(std::string_view new_lg_name);
 
+  using Node_set = absl::flat_hash_set<Node::Compact_class>;
+
+  // Adds to nodes the fan-in (or fan-out) cone of node. The cone stops at
+  // graph IO and loop breakers (flops, memories, subs, consts), which are
+  // added but not crossed. The start node is always crossed.
+  void add_cone(const Node &node, bool fanin, Node_set &nodes);
+
+  // Copies nodes (no graph IO) to a new LGraph in the same path. Each driver
+  // pin on the cut becomes a graph input (outside driver) or a graph output
+  // (inside driver), named after the pin or extract_in_N/extract_out_N.
+  // Node and pin names, bits and offsets are kept.
+  LGraph *extract(const Node_set &nodes, std::string_view new_name);
+
+  // Replaces nodes by the contents of region, a graph created by extract with
+  // the same nodes (and optimized since). The cut is reconnected by IO name.
+  void stitch_back(const Node_set &nodes, LGraph *region);
+
   static bool    exists(std::string_view path, std::string_view name);
   static LGraph *create(std::string_view path, std::string_view name, std::string_view source);
   static LGraph *open(std::string_view path, Lg_type_id lgid);
@@ -208,6 +288,22 @@ public:
   Node create_node_sub(Lg_type_id sub);
   Node create_node_sub(std::string_view sub_name);
 
+  // Preallocates the node_internal entries for n more nodes/pins, so that a
+  // bulk creation does not grow the mmap entry by entry.
+  void reserve_nodes(size_t n) { node_internal.reserve(node_internal.size() + n); }
+
+  // Structural hashing. Returns the node with the same op, bits and drivers
+  // (sink pid, driver pin) if there is one, otherwise it creates it and
+  // connects the drivers. Only for combinational cells
+  // (Graph_strash::is_strash_op). The first call builds the strash index.
+  // Constants are always deduplicated (create_node_const).
+  Node find_or_create(Ntype_op op, const std::vector<std::pair<Port_ID, Node_pin>> &drivers, Bits_t bits = 0);
+  Node find_or_create(const Lconst &value) { return create_node_const(value); }
+
+  // Points the constant pool to the current Const nodes (one per value).
+  // Needed after merging duplicate constants (pass.constdedup).
+  void rebuild_const_pool();
+
   const Sub_node &get_self_sub_node() const;  // Access all input/outputs
   Sub_node *      ref_self_sub_node();        // Access all input/outputs
 
@@ -231,6 +327,18 @@ public:
   void each_graph_input(std::function<void(Node_pin &pin)> f1, bool hierarchical=false);
   void each_graph_output(std::function<void(Node_pin &pin)> f1, bool hierarchical=false);
 
+  // Visits the same nodes as fast() (non-hierarchical), but the nid space is
+  // split in page aligned chunks of grain entries dispatched to a Thread_pool.
+  // Order is not guaranteed. fn may read the graph and its annotations (in
+  // Ann_support concurrent read mode), but it must not modify the graph or
+  // read other graph annotations. A nested call from fn runs sequentially.
+  void each_node_parallel(const std::function<void(const Node &)> fn, size_t grain = 4096);
+
+  // Between begin and end, several threads can read the graph (nodes, edges,
+  // types and annotations) at once. Nothing can modify it. Calls nest.
+  void begin_concurrent_read();
+  void end_concurrent_read();
+
   void each_sub_fast_direct(const std::function<bool(Node &, Lg_type_id)>);
   void each_sub_unique_fast(const std::function<bool(Node &, Lg_type_id)> fn);
 
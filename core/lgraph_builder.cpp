@@ -0,0 +1,191 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "lgraph_builder.hpp"
+
+#include <algorithm>
+
+#include "iassert.hpp"
+#include "lgraph.hpp"
+
+LGraph_builder::Handle LGraph_builder::add_node(Ntype_op op) {
+  I(!committed);
+  I(op != Ntype_op::IO);     // Special case, must use add input/output API and add_node(const Node &)
+  I(op != Ntype_op::Sub);    // use add_node_sub
+  I(op != Ntype_op::Const);  // use add_node_const
+  I(op != Ntype_op::LUT);    // use add_node_lut
+
+  nodes.emplace_back(Node_entry{op, 0, 0});
+  return nodes.size() - 1;
+}
+
+LGraph_builder::Handle LGraph_builder::add_node_const(const Lconst &value) {
+  I(!committed);
+
+  nodes.emplace_back(Node_entry{Ntype_op::Const, static_cast<uint32_t>(const_pool.size()), 0});
+  const_pool.emplace_back(value);
+  return nodes.size() - 1;
+}
+
+LGraph_builder::Handle LGraph_builder::add_node_lut(const Lconst &lut) {
+  I(!committed);
+
+  nodes.emplace_back(Node_entry{Ntype_op::LUT, static_cast<uint32_t>(const_pool.size()), 0});
+  const_pool.emplace_back(lut);
+  return nodes.size() - 1;
+}
+
+LGraph_builder::Handle LGraph_builder::add_node_sub(Lg_type_id sub_id) {
+  I(!committed);
+
+  nodes.emplace_back(Node_entry{Ntype_op::Sub, sub_id.value, 0});
+  return nodes.size() - 1;
+}
+
+LGraph_builder::Handle LGraph_builder::add_node(const Node &node) {
+  I(!committed);
+  I(node.get_class_lgraph() == lg);
+
+  nodes.emplace_back(Node_entry{node.get_type_op(), 0, node.get_compact_class().get_nid()});
+  return nodes.size() - 1;
+}
+
+void LGraph_builder::commit() {
+  I(!committed);
+  committed = true;
+
+  const size_t n_nodes = nodes.size();
+
+  // Pins used by the edges, bucketed per node (counting sort, pid 0 is the
+  // master root itself). pin_pid[pin_begin[h]..pin_end[h]) is sorted.
+  std::vector<uint32_t> pin_begin(n_nodes + 1, 0);
+  for (const auto &e : edges) {
+    pin_begin[e.driver + 1]++;
+    pin_begin[e.sink + 1]++;
+  }
+  for (size_t h = 0; h < n_nodes; ++h) {
+    pin_begin[h + 1] += pin_begin[h];
+  }
+
+  std::vector<Port_ID>  pin_pid(pin_begin[n_nodes]);
+  std::vector<uint32_t> pin_end(pin_begin.begin(), pin_begin.end() - 1);  // fill cursor
+  for (const auto &e : edges) {
+    pin_pid[pin_end[e.driver]++] = e.driver_pid;
+    pin_pid[pin_end[e.sink]++]   = e.sink_pid;
+  }
+  // Edge ends per pin (pin_ends[pos] for pin_pid[pos] after the unique)
+  std::vector<uint32_t> pin_ends(pin_pid.size());
+  size_t                n_pins  = 0;
+  size_t                n_extra = 0;  // overflow entries placed with the pins
+  for (size_t h = 0; h < n_nodes; ++h) {
+    auto b = pin_begin[h];
+    std::sort(pin_pid.begin() + b, pin_pid.begin() + pin_end[h]);
+
+    auto out = b;
+    for (auto pos = b; pos < pin_end[h]; ++out) {
+      auto end = pos;
+      while (end < pin_end[h] && pin_pid[end] == pin_pid[pos]) ++end;
+      pin_pid[out]  = pin_pid[pos];
+      pin_ends[out] = end - pos;
+      n_extra += get_num_extra(pin_ends[out]);
+      pos = end;
+    }
+    pin_end[h] = out;
+    n_pins += out - b;
+  }
+
+  // Single pass placement: the node, its pins and the entries for the pin
+  // edges are reserved and created together, so the edge insertion below
+  // fills entries already in the chain of each node (no chain splits). Long
+  // edges (LEdge) take more space than estimated, add_edge_int grows the
+  // chain as usual for them.
+  size_t n_entries = n_nodes + n_pins + n_extra;
+  n_entries += n_entries / (4096 / sizeof(Node_internal)) + 1;
+  lg->node_internal.reserve(lg->node_internal.size() + n_entries);
+
+  std::vector<Index_ID> pin_idx(pin_pid.size());
+
+  for (Handle h = 0; h < n_nodes; ++h) {
+    auto &n = nodes[h];
+
+    const bool is_new = n.nid == 0;
+    if (is_new) {
+      if (n.op == Ntype_op::Const) {
+        n.nid = lg->create_node_const_nid(const_pool[n.aux]);
+      } else if (n.op == Ntype_op::LUT) {
+        n.nid = lg->create_node_lut_nid(const_pool[n.aux]);
+      } else if (n.op == Ntype_op::Sub) {
+        n.nid = lg->create_node_sub_nid(Lg_type_id(n.aux));
+      } else {
+        n.nid = lg->create_node_nid(n.op);
+      }
+    }
+
+    for (auto pos = pin_begin[h]; pos < pin_end[h]; ++pos) {
+      auto pid     = pin_pid[pos];
+      pin_idx[pos] = pid == 0 ? n.nid : lg->setup_idx_from_pid(n.nid, pid);
+
+      if (!is_new)
+        continue;  // existing chains (graph IO) grow on demand
+      for (auto i = get_num_extra(pin_ends[pos]); i > 0; --i) {
+        lg->create_node_space(pin_idx[pos], pid, n.nid, pin_idx[pos]);  // right after the pin root
+      }
+    }
+  }
+
+  auto find_pin = [&](Handle h, Port_ID pid) -> Index_ID {
+    auto b  = pin_pid.begin() + pin_begin[h];
+    auto it = std::lower_bound(b, pin_pid.begin() + pin_end[h], pid);
+    I(it != pin_pid.begin() + pin_end[h] && *it == pid);
+    return pin_idx[it - pin_pid.begin()];
+  };
+
+  // Edges sorted by driver node (counting sort), then by driver pid. Stable,
+  // so the edges of a pin keep the insertion order.
+  std::vector<uint32_t> edge_begin(n_nodes + 1, 0);
+  for (const auto &e : edges) {
+    edge_begin[e.driver + 1]++;
+  }
+  for (size_t h = 0; h < n_nodes; ++h) {
+    edge_begin[h + 1] += edge_begin[h];
+  }
+  std::vector<Edge_entry> sorted(edges.size());
+  for (const auto &e : edges) {
+    sorted[edge_begin[e.driver]++] = e;
+  }
+  edges.swap(sorted);
+
+  size_t pos = 0;
+  while (pos < edges.size()) {
+    auto driver = edges[pos].driver;
+    auto end    = pos;
+    while (end < edges.size() && edges[end].driver == driver) ++end;
+
+    std::stable_sort(edges.begin() + pos, edges.begin() + end,
+                     [](const Edge_entry &a, const Edge_entry &b) { return a.driver_pid < b.driver_pid; });
+
+    Port_ID  last_pid   = edges[pos].driver_pid;
+    Index_ID driver_idx = find_pin(driver, last_pid);
+    for (; pos < end; ++pos) {
+      const auto &e = edges[pos];
+      if (e.driver_pid != last_pid) {
+        last_pid   = e.driver_pid;
+        driver_idx = find_pin(driver, last_pid);
+      }
+
+      lg->add_edge_int(find_pin(e.sink, e.sink_pid), e.sink_pid, driver_idx, e.driver_pid);
+      if (e.bits)
+        lg->set_bits(driver_idx, e.bits);
+    }
+  }
+
+  edges.clear();
+  edges.shrink_to_fit();
+  const_pool.clear();
+}
+
+Node LGraph_builder::get_node(Handle h) const {
+  I(committed);
+  I(h < nodes.size());
+
+  return Node(lg, Hierarchy_tree::root_index(), Node::Compact_class(nodes[h].nid));
+}
@@ -0,0 +1,79 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <vector>
+
+#include "lconst.hpp"
+#include "lgraph_base_core.hpp"
+#include "node.hpp"
+
+class LGraph;
+
+// Batch construction of an LGraph. Front-ends record nodes and edges, and
+// commit() writes them in one go:
+//
+//  * node_internal is reserved once for the whole batch (no 1.5x remaps)
+//  * the master root, the pin roots and the overflow entries for the pin
+//    edges are placed in one pass, so the chain of each node is contiguous in
+//    node_internal
+//  * edges are inserted sorted by driver pin, so the SEdge/LEdge insertion
+//    keeps filling the same entries (idx_insert_cache hits)
+//
+// Handles returned by add_node* are only meaningful for this builder. Use
+// get_node after commit to get the LGraph Node.
+class LGraph_builder {
+public:
+  using Handle = uint32_t;
+
+protected:
+  struct Node_entry {
+    Ntype_op op;
+    uint32_t aux;  // const_pool pos (Const, LUT), sub lgid (Sub)
+    Index_ID nid;  // set for existing nodes, and by commit for the new ones
+  };
+
+  struct Edge_entry {
+    Handle   driver;
+    Handle   sink;
+    Port_ID  driver_pid;
+    Port_ID  sink_pid;
+    uint32_t bits;
+  };
+
+  LGraph *                lg;
+  std::vector<Node_entry> nodes;
+  std::vector<Edge_entry> edges;
+  std::vector<Lconst>     const_pool;
+  bool                    committed;
+
+  // Overflow entries for a pin with n_ends edges, assuming short edges (5 per
+  // entry with a next pointer, up to 7 in the root entry if it is the last)
+  static uint32_t get_num_extra(uint32_t n_ends) { return n_ends <= 7 ? 0 : (n_ends - 1) / 5; }
+
+public:
+  explicit LGraph_builder(LGraph *_lg) : lg(_lg), committed(false) {}
+
+  void reserve(size_t n_nodes, size_t n_edges) {
+    nodes.reserve(n_nodes);
+    edges.reserve(n_edges);
+  }
+
+  Handle add_node(Ntype_op op);
+  Handle add_node_const(const Lconst &value);
+  Handle add_node_lut(const Lconst &lut);
+  Handle add_node_sub(Lg_type_id sub_id);
+  Handle add_node(const Node &node);  // Already in the LGraph (graph IO, ...)
+
+  void add_edge(Handle driver, Port_ID driver_pid, Handle sink, Port_ID sink_pid, uint32_t bits = 0) {
+    I(driver < nodes.size());
+    I(sink < nodes.size());
+    edges.emplace_back(Edge_entry{driver, sink, driver_pid, sink_pid, bits});
+  }
+
+  size_t get_num_nodes() const { return nodes.size(); }
+  size_t get_num_edges() const { return edges.size(); }
+
+  void commit();
+
+  Node get_node(Handle h) const;
+};
@@ -0,0 +1,268 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <vector>
+
+#include "annotate.hpp"
+#include "graph_library.hpp"
+#include "lgraph.hpp"
+
+void LGraph::compact_order(Compact_order order, std::vector<Index_ID> &nids) {
+  nids.clear();
+  nids.emplace_back(Hardcoded_input_nid);
+  nids.emplace_back(Hardcoded_output_nid);
+
+  if (order == Compact_order::Topological) {
+    for (auto node : get_levelization().get_order()) {
+      nids.emplace_back(node.get_compact_class().get_nid());
+    }
+    return;
+  }
+
+  if (order == Compact_order::Keep) {
+    for (auto nid = fast_first(); nid; nid = fast_next(nid)) {
+      nids.emplace_back(nid);
+    }
+    return;
+  }
+
+  I(order == Compact_order::BFS);
+
+  const auto &g = freeze();
+
+  std::vector<bool> visited(node_internal.size(), false);
+  visited[Hardcoded_input_nid]  = true;
+  visited[Hardcoded_output_nid] = true;
+
+  auto visit_sinks = [&](Index_ID nid) {
+    for (const auto &e : g.out_edges(nid)) {
+      auto sink_nid = node_internal[e.sink_idx].get_nid();
+      if (visited[sink_nid])
+        continue;
+      visited[sink_nid] = true;
+      nids.emplace_back(sink_nid);
+    }
+  };
+
+  // BFS from the graph inputs. Nodes not reachable from them (constants,
+  // flops without inputs...) start a new BFS in nid order.
+  visit_sinks(Hardcoded_input_nid);
+  size_t pos = 2;
+  for (auto seed = fast_first(); true; seed = fast_next(seed)) {
+    for (; pos < nids.size(); ++pos) {
+      visit_sinks(nids[pos]);
+    }
+
+    while (seed && visited[seed]) {
+      seed = fast_next(seed);
+    }
+    if (seed == 0)
+      break;
+
+    visited[seed] = true;
+    nids.emplace_back(seed);
+  }
+}
+
+void LGraph::compact(Compact_order order) {
+  std::vector<Index_ID> nids;  // new order, nids[i] is the old nid of the i-th node
+  compact_order(order, nids);
+
+  const auto &g        = freeze();
+  const auto  old_size = node_internal.size();
+
+  constexpr uint32_t    no_pos = UINT32_MAX;
+  std::vector<uint32_t> nid2pos(old_size, no_pos);
+  for (size_t i = 0; i < nids.size(); ++i) {
+    nid2pos[nids[i]] = i;
+  }
+
+  // Pin roots (other than the master root), bucketed per node position
+  struct Pin_entry {
+    Index_ID idx;
+    Port_ID  pid;
+    uint32_t bits;
+  };
+  std::vector<uint32_t> pin_begin(nids.size() + 1, 0);
+  for (Index_ID idx = 0; idx < old_size; idx.value++) {
+    const auto &ni = node_internal[idx];
+    if (!ni.is_valid() || !ni.is_root() || ni.is_master_root() || nid2pos[ni.get_nid()] == no_pos)
+      continue;
+    pin_begin[nid2pos[ni.get_nid()] + 1]++;
+  }
+  for (size_t i = 0; i < nids.size(); ++i) {
+    pin_begin[i + 1] += pin_begin[i];
+  }
+  std::vector<Pin_entry> pins(pin_begin.back());
+  {
+    std::vector<uint32_t> cursor(pin_begin.begin(), pin_begin.end() - 1);
+    for (Index_ID idx = 0; idx < old_size; idx.value++) {
+      const auto &ni = node_internal[idx];
+      if (!ni.is_valid() || !ni.is_root() || ni.is_master_root() || nid2pos[ni.get_nid()] == no_pos)
+        continue;
+      pins[cursor[nid2pos[ni.get_nid()]]++] = Pin_entry{idx, ni.get_dst_pid(), ni.get_bits()};
+    }
+  }
+
+  // Node payload (type, bits, const/lut/sub) and edges in the new order
+  struct Node_entry {
+    Ntype_op   op;
+    uint32_t   bits;
+    Lg_type_id sub_lgid;
+    uint32_t   value_pos;  // values pos (Const, LUT)
+  };
+  std::vector<Node_entry>      entries;
+  std::vector<Lconst>          values;
+  std::vector<Graph_csr::Edge> edges;
+  entries.reserve(nids.size());
+  edges.reserve(g.get_num_edges());
+  for (auto nid : nids) {
+    const auto &ni = node_internal[nid];
+    I(ni.get_dst_pid() == 0);
+
+    Node_entry ent{ni.get_type(), ni.get_bits(), Lg_type_id(0), 0};
+    if (ent.op == Ntype_op::Const) {
+      ent.value_pos = values.size();
+      values.emplace_back(get_type_const(nid));
+    } else if (ent.op == Ntype_op::LUT) {
+      ent.value_pos = values.size();
+      values.emplace_back(get_type_lut(nid));
+    } else if (ent.op == Ntype_op::Sub) {
+      ent.sub_lgid = get_type_sub(nid);
+    }
+    entries.emplace_back(ent);
+
+    for (const auto &e : g.out_edges(nid)) {
+      edges.emplace_back(e);
+    }
+  }
+
+  // Rebuild node_internal. The edit/bits epochs live in the node_internal
+  // header, keep them monotonic so that stale views never look fresh.
+  const auto edit_epoch = get_edit_epoch();
+  const auto bits_epoch = get_bits_epoch();
+
+  idx_insert_cache.clear();
+  node_internal.clear();
+  hyper.clear();
+  hyper_hint.clear();
+  strash.clear();
+  journal.pause(true);  // the rebuild is one Reset, not an entry per node/edge
+  const_map.clear();
+  const_pool.clear();
+  subid_map.clear();
+  lut_map.clear();
+#ifdef LGRAPH_GRAPH_CORE
+  gcore.clear();
+  idx2gcore.clear();
+#endif
+  csr.clear();
+  levels.clear();
+
+  // A Node_internal keeps a few edges, each edge has 2 ends (and a page entry every 4KB)
+  size_t n_entries = nids.size() + pins.size() + (2 * edges.size()) / 4 + 1;
+  n_entries += n_entries / (4096 / sizeof(Node_internal)) + 1;
+  node_internal.reserve(n_entries);
+
+  std::vector<uint32_t> old2new(old_size, 0);  // idx remap (0 for deleted)
+
+  auto create_node = [&](size_t i) {
+    const auto &ent = entries[i];
+
+    auto nid         = create_node_int();
+    old2new[nids[i]] = nid;
+
+    if (ent.op == Ntype_op::Const) {
+      set_type_const(nid, values[ent.value_pos]);
+    } else if (ent.op == Ntype_op::LUT) {
+      set_type_lut(nid, values[ent.value_pos]);
+    } else if (ent.op == Ntype_op::Sub) {
+      set_type_sub(nid, ent.sub_lgid);
+    } else {
+      set_type(nid, ent.op);
+    }
+    node_internal.ref(nid)->set_bits(ent.bits);
+  };
+  auto create_pins = [&](size_t i) {
+    Index_ID nid = old2new[nids[i]];
+    for (auto p = pin_begin[i]; p < pin_begin[i + 1]; ++p) {
+      const auto &pin = pins[p];
+      auto        idx = setup_idx_from_pid(nid, pin.pid);
+      node_internal.ref(idx)->set_bits(pin.bits);
+      old2new[pin.idx] = idx;
+    }
+  };
+
+  // Graph IO nids are hardcoded, their pins go after both
+  create_node(0);
+  create_node(1);
+  create_pins(0);
+  create_pins(1);
+  for (size_t i = 2; i < nids.size(); ++i) {
+    create_node(i);
+    create_pins(i);
+  }
+  I(old2new[Hardcoded_input_nid] == Hardcoded_input_nid);
+  I(old2new[Hardcoded_output_nid] == Hardcoded_output_nid);
+
+  for (const auto &e : edges) {
+    I(old2new[e.driver_idx] && old2new[e.sink_idx]);
+    add_edge_int(old2new[e.sink_idx], e.sink_pid, old2new[e.driver_idx], e.driver_pid);
+  }
+
+  *ref_edit_epoch() = edit_epoch + 1;
+  *ref_bits_epoch() = bits_epoch + 1;
+
+  journal.pause(false);
+  journal.reset();
+
+  // Attributes: the keys of this graph nodes are renumbered. In the tables of
+  // this graph, the class keys and the root (or no hierarchy) keys. In the
+  // tables of the open graphs instantiating this one, the keys whose hidx is
+  // an instance of this graph. Any other hierarchical key points to another
+  // graph. The tables of the closed graphs are not remapped.
+  auto remap_idx   = [&old2new](uint32_t idx) -> uint32_t { return idx < old2new.size() ? old2new[idx] : 0; };
+  auto remap_table = [&remap_idx](LGraph *lg, auto is_instance) {
+    Ann_support::remap(lg, [&remap_idx, &is_instance](const auto &key) {
+      using Key = std::decay_t<decltype(key)>;
+      auto new_key(key);
+      if constexpr (std::is_same_v<Key, Node::Compact_class>) {
+        if (is_instance(Hierarchy_tree::invalid_index()))
+          new_key.nid = remap_idx(key.nid);
+      } else if constexpr (std::is_same_v<Key, Node::Compact>) {
+        if (is_instance(key.hidx))
+          new_key.nid = remap_idx(key.nid);
+      } else if constexpr (std::is_same_v<Key, Node_pin::Compact_class_driver>) {
+        if (is_instance(Hierarchy_tree::invalid_index()))
+          new_key.idx = remap_idx(key.idx);
+      } else if constexpr (std::is_same_v<Key, Node_pin::Compact_driver>) {
+        if (is_instance(key.hidx))
+          new_key.idx = remap_idx(key.idx);
+      } else {
+        static_assert(std::is_same_v<Key, Node::Compact_class>, "unsupported attribute key");
+      }
+      return new_key;
+    });
+  };
+
+  remap_table(this, [](const Hierarchy_index &hidx) { return hidx.is_invalid() || hidx.is_root(); });
+
+  std::vector<LGraph *> open_lgs;
+  get_library().each_lgraph([this, &open_lgs](Lg_type_id lgid, std::string_view name) {
+    (void)name;
+    auto *lg = get_library().try_find_lgraph(lgid);
+    if (lg && lg != this)
+      open_lgs.emplace_back(lg);
+  });
+  for (auto *lg : open_lgs) {
+    auto &lg_htree = lg->get_htree();  // before sub_changed collapses the instances
+    remap_table(lg, [this, &lg_htree](const Hierarchy_index &hidx) {
+      return !hidx.is_invalid() && !hidx.is_root() && lg_htree.find_lgid(hidx) == get_lgid();
+    });
+  }
+
+  // Hierarchy trees (this one, and the open graphs instantiating this one)
+  // collapse the instances of this graph, they expand again (with the new
+  // nids) on the next go down.
+  Hierarchy_tree::sub_changed(get_lgid());
+}
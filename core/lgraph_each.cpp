@@ -1,11 +1,16 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <algorithm>
+#include <mutex>
+
+#include "annotate.hpp"
 #include "mmap_map.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
 #include "sub_node.hpp"
+#include "thread_pool.hpp"
 
 void LGraph::each_sorted_graph_io(std::function<void(Node_pin &pin, Port_ID pos)> f1, bool hierarchical) {
   if (node_internal.size() < Hardcoded_output_nid)
@@ -115,6 +120,78 @@ void LGraph::each_graph_output(std::function<void(Node_pin &pin)> f1, bool hiera
   }
 }
 
+void LGraph::each_node_parallel(const std::function<void(const Node &)> fn, size_t grain) {
+  static Thread_pool       pool;       // Shared by all the lgraphs, workers block when idle
+  static std::mutex        pool_lock;  // The pool queue is single producer
+  static thread_local bool in_sweep = false;
+
+  // Node_internal_Page starts every 4KB of node_internal, keep chunks page aligned
+  constexpr size_t page_entries = 4096 / sizeof(Node_internal);
+  grain = std::max(page_entries, ((grain + page_entries - 1) / page_entries) * page_entries);
+
+  const size_t sz = node_internal.size();  // maps node_internal before the workers read it
+
+  auto sweep = [this, &fn, sz](size_t start, size_t end) {
+    end = std::min(end, sz);
+    for (Index_ID nid = start; nid < end; nid.value++) {
+      const auto &ni = node_internal[nid];
+      if (!ni.is_valid() || !ni.is_master_root() || is_graph_io(nid))
+        continue;
+
+      fn(Node(this, this, Hierarchy_tree::invalid_index(), nid));
+    }
+  };
+
+  if (in_sweep || sz <= grain) {
+    sweep(0, sz);
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(pool_lock);
+
+  begin_concurrent_read();
+
+  // The calling thread also runs chunks (inline adds and wait_all)
+  for (size_t start = 0; start < sz; start += grain) {
+    pool.add([&sweep, start, end = start + grain] {  // by value, Thread_pool::add keeps lvalue args as references
+      in_sweep = true;
+      sweep(start, end);
+      in_sweep = false;
+    });
+  }
+  pool.wait_all();
+
+  end_concurrent_read();
+}
+
+void LGraph::begin_concurrent_read() {
+  // The readers go through node_internal and the type maps with raw
+  // pointers: map them upfront (the lazy mmap setup is not thread safe), and
+  // pin them so that mmap_gc does not recycle them. Same for the hyper edges
+  // (out_edges of high fan-out drivers).
+  (void)node_internal.size();  // maps it
+  hyper.begin_concurrent_read();
+  const_map.preload();
+  lut_map.preload();
+  subid_map.preload();
+  node_internal.gc_pin();
+  const_map.gc_pin();
+  lut_map.gc_pin();
+  subid_map.gc_pin();
+
+  Ann_support::begin_concurrent_read(this);  // readers go to the annotations without locking
+}
+
+void LGraph::end_concurrent_read() {
+  Ann_support::end_concurrent_read(this);
+
+  subid_map.gc_unpin();
+  lut_map.gc_unpin();
+  const_map.gc_unpin();
+  node_internal.gc_unpin();
+  hyper.end_concurrent_read();
+}
+
 void LGraph::each_sub_fast_direct(const std::function<bool(Node &, Lg_type_id)> fn) {
   const auto &m = get_down_nodes_map();
   for (auto it = m.begin(), end = m.end(); it != end; ++it) {
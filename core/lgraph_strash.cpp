@@ -0,0 +1,91 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <vector>
+
+#include "lgraph.hpp"
+
+void LGraph::strash_key(Index_ID nid, std::vector<uint64_t> &key) const {
+  I(node_internal[nid].is_master_root());
+
+  key.clear();
+
+  const auto op = node_internal[nid].get_type();
+  key.emplace_back((static_cast<uint64_t>(op) << 32) | node_internal[nid].get_bits());
+
+  Index_ID idx2 = nid;
+  while (true) {
+    const auto &node_int = node_internal[idx2];
+
+    auto            n     = node_int.get_num_local_inputs();
+    const Edge_raw *redge = node_int.get_input_begin();
+    for (uint8_t i = 0; i < n; i++, redge += redge->next_node_inc()) {
+      key.emplace_back(strash_input(redge->get_idx(), redge->get_inp_pid(), node_int.get_dst_pid()));
+    }
+
+    if (node_int.is_last_state())
+      break;
+    idx2 = node_int.get_next();
+  }
+
+  std::sort(key.begin() + 1, key.end());
+}
+
+void LGraph::strash_sync() {
+  if (!strash.is_active()) {
+    strash.active = true;
+    for (auto nid = fast_first(); nid; nid = fast_next(nid)) {
+      strash.dirty.insert(nid.value);
+    }
+  }
+
+  std::vector<uint64_t> key;
+  for (auto nid : strash.dirty) {
+    strash.erase(nid);
+
+    if (!is_valid_node(nid))
+      continue;  // deleted
+
+    if (!Graph_strash::is_strash_op(node_internal[nid].get_type()))
+      continue;
+
+    strash_key(nid, key);
+    if (key.size() == 1)
+      continue;  // no drivers (yet)
+
+    strash.insert(Graph_strash::get_hash(key), nid);
+  }
+  strash.dirty.clear();
+}
+
+Node LGraph::find_or_create(Ntype_op op, const std::vector<std::pair<Port_ID, Node_pin>> &drivers, Bits_t bits) {
+  I(Graph_strash::is_strash_op(op));
+  I(!drivers.empty());
+
+  strash_sync();
+
+  std::vector<uint64_t> key;
+  key.emplace_back((static_cast<uint64_t>(op) << 32) | bits);
+  for (const auto &[sink_pid, dpin] : drivers) {
+    I(dpin.is_driver());
+    I(dpin.get_class_lgraph() == this);
+    key.emplace_back(strash_input(dpin.get_root_idx(), dpin.get_pid(), sink_pid));
+  }
+  std::sort(key.begin() + 1, key.end());
+
+  auto nid = strash.find(Graph_strash::get_hash(key));
+  if (nid && is_valid_node(nid)) {
+    std::vector<uint64_t> node_key;
+    strash_key(nid, node_key);
+    if (node_key == key)
+      return Node(this, Hierarchy_tree::root_index(), nid);
+  }
+
+  auto node = bits ? create_node(op, bits) : create_node(op);
+  for (const auto &[sink_pid, dpin] : drivers) {
+    dpin.connect_sink(node.setup_sink_pin_raw(sink_pid));
+  }
+  strash_sync();  // index the new node
+
+  return node;
+}
@@ -17,12 +17,29 @@
 // #define DEBUG_SLOW
 
 LGraph_Base::LGraph_Base(std::string_view _path, std::string_view _name, Lg_type_id _lgid) noexcept
-    : Lgraph_base_core(_path, _name, _lgid), node_internal(path, absl::StrCat("lg_", std::to_string(_lgid), "_nodes")) {
+    : Lgraph_base_core(_path, _name, _lgid)
+    , node_internal(path, absl::StrCat("lg_", std::to_string(_lgid), "_nodes"))
+    , hyper(path, _lgid)
+    , journal(path, _lgid)
+#ifdef LGRAPH_GRAPH_CORE
+    , gcore(path, absl::StrCat("lg_", std::to_string(_lgid), "_gcore"))
+    , idx2gcore(path, absl::StrCat("lg_", std::to_string(_lgid), "_idx2gcore"))
+#endif
+{
   I(lgid);  // No id zero allowed
 
   library = Graph_library::instance(path);
 }
 
+uint64_t LGraph_Base::peek_edit_epoch(std::string_view path, Lg_type_id lgid) {
+  auto *lg = Graph_library::instance(path)->try_find_lgraph(lgid);
+  if (lg)
+    return lg->get_edit_epoch();
+
+  mmap_lib::vector<Node_internal> nodes(path, absl::StrCat("lg_", std::to_string(lgid), "_nodes"));
+  return nodes.peek_config_data(8);  // ref_edit_epoch
+}
+
 LGraph_Base::~LGraph_Base() {
   // TODO: This is NOT a bug. The reason is that we need to preserve the
   // string pointers for graph name. Then, we can use string_view maps for all
@@ -44,6 +61,16 @@ void LGraph_Base::clear() {
 
   node_internal.clear();
 
+  hyper.clear();
+  hyper_hint.clear();
+  strash.clear();
+  journal.reset();
+
+#ifdef LGRAPH_GRAPH_CORE
+  gcore.clear();
+  idx2gcore.clear();
+#endif
+
   Lgraph_base_core::clear();
 
   library->clear(lgid);
@@ -83,9 +110,73 @@ Index_ID LGraph_Base::create_node_int() {
 
   I(node_internal[node_internal.size() - 1].get_dst_pid() == 0);
   I(node_internal[node_internal.size() - 1].get_nid() == node_internal.size() - 1);
+
+  bump_edit_epoch();
+
   return node_internal.size() - 1;
 }
 
+#ifdef LGRAPH_GRAPH_CORE
+Index_ID LGraph_Base::setup_gcore_idx(const Index_ID idx) {
+  I(node_internal[idx].is_root());
+
+  while (idx2gcore.size() <= idx) idx2gcore.emplace_back(0);
+
+  if (idx2gcore[idx])
+    return idx2gcore[idx];
+
+  Index_ID gc_idx;
+  auto     nid = get_master_nid(idx);
+  if (nid == idx) {
+    gc_idx = gcore.create_master_root(static_cast<uint8_t>(node_internal[nid].get_type()));
+  } else {
+    auto gc_nid = setup_gcore_idx(nid);
+    gc_idx      = gcore.create_master(gc_nid, node_internal[idx].get_dst_pid());
+  }
+  idx2gcore.set(idx, gc_idx);
+
+  return gc_idx;
+}
+
+void LGraph_Base::gcore_set_type(const Index_ID nid) {
+  gcore.set_type(setup_gcore_idx(nid), static_cast<uint8_t>(node_internal[nid].get_type()));
+}
+
+void LGraph_Base::gcore_del_node(const Index_ID nid) {
+  auto gc_nid = get_gcore_idx(nid);
+  if (gc_nid == 0)
+    return;
+
+  gcore.del(gc_nid);
+
+  // Clear all the pins (they are in the node_internal chain)
+  Index_ID idx = nid;
+  while (true) {
+    if (idx < idx2gcore.size())
+      idx2gcore.set(idx, 0);
+    if (node_internal[idx].is_last_state())
+      break;
+    idx = node_internal[idx].get_next();
+  }
+}
+
+void LGraph_Base::gcore_del_pin(const Index_ID idx, bool is_driver) {
+  auto gc_idx = get_gcore_idx(idx);
+  if (gc_idx == 0)
+    return;
+
+  std::vector<Index_ID> other;  // collect first, del_edge invalidates the iterator
+  for (auto id : is_driver ? gcore.out_ids(gc_idx) : gcore.inp_ids(gc_idx)) other.emplace_back(id);
+
+  for (auto id : other) {
+    if (is_driver)
+      gcore.del_edge(id, gc_idx);
+    else
+      gcore.del_edge(gc_idx, id);
+  }
+}
+#endif
+
 Index_ID LGraph_Base::create_node_space(const Index_ID last_idx, const Port_ID dst_pid, const Index_ID master_nid,
                                         const Index_ID root_idx) {
   Index_ID idx2 = create_node_int();
@@ -446,9 +537,15 @@ void LGraph_Base::add_edge_int(const Index_ID dst_idx, const Port_ID inp_pid, In
 
   Index_ID root_idx = src_idx;
 
-  bool out_done = false;
-  auto it       = idx_insert_cache.find(src_idx);
-  if (it != idx_insert_cache.end()) {
+  bool     out_done = false;
+  Index_ID out_idx  = 0;  // Node_internal entry with the new out edge
+  if (node_internal[src_idx].is_hyper()) {
+    hyper.add(src_idx, dst_idx, inp_pid);
+    out_done = true;
+  }
+
+  auto it = idx_insert_cache.find(src_idx);
+  if (!out_done && it != idx_insert_cache.end()) {
     auto idx = it->second;
     I(node_internal[idx].has_space_short());
 
@@ -471,6 +568,8 @@ void LGraph_Base::add_edge_int(const Index_ID dst_idx, const Port_ID inp_pid, In
         out_done = true;
       }
     }
+    if (out_done)
+      out_idx = idx;
 
     if (!node_internal[idx].has_space_short())
       idx_insert_cache.erase(it);
@@ -510,11 +609,21 @@ void LGraph_Base::add_edge_int(const Index_ID dst_idx, const Port_ID inp_pid, In
       node_internal.ref(idx)->inc_outputs(true);  // WARNING: Before next_free_output_pos to reserve space (decreasing insert)
     }
     I(node_internal[idx].get_dst_pid() == dst_pid);
+    out_idx = idx;
 
     if (node_internal[idx].has_space_short())
       idx_insert_cache[src_idx] = idx;
   }
 
+  if (out_idx && out_idx != src_idx) {
+    // An overflow entry edge (cached or not), check the fan-out once in a while
+    auto &n_slow = hyper_hint[src_idx];
+    if (++n_slow >= Graph_hyper::threshold) {
+      n_slow = 0;
+      try_create_hyper(src_idx);
+    }
+  }
+
   //-----------------------
   // Reverse from before:
   // ADD input edge in destination (dst_nid) with ANY inp_pid (0) to  (src_nid) with dst_pid
@@ -577,6 +686,14 @@ void LGraph_Base::add_edge_int(const Index_ID dst_idx, const Port_ID inp_pid, In
       idx_insert_cache[dst_idx] = idx;
   }
 
+  bump_edit_epoch();
+  strash.touch(node_internal[dst_idx].get_master_root_nid());
+  journal.add(Graph_journal::Op::Add_edge, node_internal[dst_idx].get_master_root_nid(), node_internal[src_idx].get_master_root_nid());
+
+#ifdef LGRAPH_GRAPH_CORE
+  gcore.add_edge(setup_gcore_idx(dst_idx), setup_gcore_idx(src_idx));
+#endif
+
 #ifdef DEBUG_SLOW
   Index_ID master_nid = src_nid;
   I(node_internal[master_nid].is_master_root());
@@ -621,6 +738,51 @@ void LGraph_Base::add_edge_int(const Index_ID dst_idx, const Port_ID inp_pid, In
   I(node_internal[root_idx].is_root());
 }
 
+void LGraph_Base::try_create_hyper(const Index_ID root_idx) {
+  I(node_internal[root_idx].is_root());
+  I(!node_internal[root_idx].is_hyper());
+
+  const auto pid = node_internal[root_idx].get_dst_pid();
+
+  // The pin edges can be in any entry of the node chain with the same pid
+  uint32_t n_out = 0;
+  Index_ID idx2  = node_internal[root_idx].get_master_root_nid();
+  while (true) {
+    if (node_internal[idx2].get_dst_pid() == pid)
+      n_out += node_internal[idx2].get_num_local_outputs();
+    if (node_internal[idx2].is_last_state())
+      break;
+    idx2 = node_internal[idx2].get_next();
+  }
+
+  if (n_out < Graph_hyper::threshold)
+    return;
+
+  hyper.create(root_idx);
+
+  idx2 = node_internal[root_idx].get_master_root_nid();
+  while (true) {
+    auto *ptr = node_internal.ref(idx2);
+    if (ptr->get_dst_pid() == pid && ptr->has_local_outputs()) {
+      auto            n = ptr->get_num_local_outputs();
+      uint8_t         i;
+      const Edge_raw *redge;
+      for (i = 0, redge = ptr->get_output_begin(); i < n; i++, redge += redge->next_node_inc()) {
+        hyper.add(root_idx, redge->get_idx(), redge->get_inp_pid());
+      }
+      ptr->clear_outputs();
+    }
+    if (ptr->is_last_state())
+      break;
+    idx2 = ptr->get_next();
+  }
+
+  node_internal.ref(root_idx)->set_hyper(true);
+  node_internal.ref(root_idx)->clear_full_hint();  // the emptied entries have space for inputs
+  hyper_hint.erase(root_idx.value);
+  idx_insert_cache.erase(root_idx.value);  // it points to an entry whose outputs were cleared
+}
+
 void LGraph_Base::warn_int(std::string_view text) { fmt::print("warning:{}\n", text); }
 
 void LGraph_Base::error_int(std::string_view text) {
@@ -7,6 +7,10 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "graph_core.hpp"
+#include "graph_hyper.hpp"
+#include "graph_journal.hpp"
+#include "graph_strash.hpp"
 #include "iassert.hpp"
 #include "lgedge.hpp"
 #include "lgraph_base_core.hpp"
@@ -27,6 +31,37 @@ protected:
 
   absl::flat_hash_map<uint32_t, uint32_t> idx_insert_cache;
 
+  // High fan-out driver pins (Node_internal::is_hyper) keep their out edges
+  // in hyper. hyper_hint counts the out edges added to overflow entries per
+  // driver pin since the last fan-out check.
+  Graph_hyper                             hyper;
+  absl::flat_hash_map<uint32_t, uint32_t> hyper_hint;
+
+  Graph_strash  strash;   // Optional, see LGraph::find_or_create
+  Graph_journal journal;  // Optional, see LGraph::get_dirty_nodes
+
+  // Persisted in the node_internal header. The edit epoch changes with any
+  // node/pin/edge add or delete (and node type change), the bits epoch with
+  // any set_bits. Derived views (Graph_csr, Graph_level) compare against them
+  // to know when to rebuild.
+  uint64_t *ref_edit_epoch() const { return node_internal.ref_config_data(8); }
+  uint64_t *ref_bits_epoch() const { return node_internal.ref_config_data(16); }
+  void      bump_edit_epoch() { (*ref_edit_epoch())++; }
+
+#ifdef LGRAPH_GRAPH_CORE
+  // Opt-in (--copt=-DLGRAPH_GRAPH_CORE) Graph_core backend. node_internal is
+  // still the reference storage (Node/Node_pin decode it directly), Graph_core
+  // mirrors every node/pin/edge so that passes and benchmarks can use it.
+  // Nodes and pins are mirrored lazily (first set_type or edge).
+  Graph_core                 gcore;
+  mmap_lib::vector<uint32_t> idx2gcore;  // node_internal root idx to Graph_core id (0 if not mirrored)
+
+  Index_ID setup_gcore_idx(const Index_ID idx);
+  void     gcore_set_type(const Index_ID nid);
+  void     gcore_del_node(const Index_ID nid);
+  void     gcore_del_pin(const Index_ID idx, bool is_driver);  // drop the pin edges, keep the pin
+#endif
+
   Index_ID create_node_space(const Index_ID idx, const Port_ID dst_pid, const Index_ID master_nid, const Index_ID root_nid);
   Index_ID get_space_output_pin(const Index_ID idx, const Port_ID dst_pid, Index_ID &root_nid);
   Index_ID get_space_output_pin(const Index_ID master_nid, const Index_ID idx, const Port_ID dst_pid, const Index_ID root_nid);
@@ -34,6 +69,7 @@ protected:
   Index_ID create_node_int();
 
   void add_edge_int(Index_ID dst_nid, Port_ID dst_pid, Index_ID src_nid, Port_ID inp_pid);
+  void try_create_hyper(const Index_ID root_idx);
 
   Port_ID recompute_io_ports(const Index_ID track_nid);
 
@@ -49,6 +85,8 @@ protected:
 
   Index_ID get_master_nid(Index_ID idx) const { return node_internal[idx].get_master_root_nid(); }
 
+  bool is_hyper_root(Index_ID idx) const { return node_internal[idx].is_root() && node_internal[idx].is_hyper(); }
+
   uint32_t get_bits(Index_ID idx) const {
     I(idx < node_internal.size());
     I(node_internal[idx].is_root());
@@ -59,6 +97,9 @@ protected:
     I(idx < node_internal.size());
     I(node_internal[idx].is_root());
     node_internal.ref(idx)->set_bits(bits);
+    (*ref_bits_epoch())++;
+    strash.touch(get_master_nid(idx));
+    journal.add(Graph_journal::Op::Set_bits, get_master_nid(idx), bits);
   }
 
 public:
@@ -121,6 +162,11 @@ public:
     return node_internal[idx].is_root();
   }
 
+  uint64_t get_edit_epoch() const { return *ref_edit_epoch(); }
+  // Same for an lgraph that may not be open (it is not opened, or mapped)
+  static uint64_t peek_edit_epoch(std::string_view path, Lg_type_id lgid);
+  uint64_t get_bits_epoch() const { return *ref_bits_epoch(); }
+
   static size_t max_size() { return (((size_t)1) << Index_bits) - 1; }
   size_t        size() const { return node_internal.size(); }
 
@@ -129,6 +175,13 @@ public:
     _init();
   } _static_initializer;
 
+#ifdef LGRAPH_GRAPH_CORE
+  Graph_core *ref_graph_core() { return &gcore; }
+  Index_ID    get_gcore_idx(const Index_ID idx) const { return idx < idx2gcore.size() ? idx2gcore[idx] : 0; }
+#endif
+
+  const Graph_journal &get_journal() const { return journal; }
+
   const Graph_library &get_library() const { return *library; }
   Graph_library *      ref_library() const { return library; }
 
@@ -0,0 +1,86 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <string_view>
+
+#include "graph_library.hpp"
+#include "mmap_bimap.hpp"
+
+// Key <-> name bimap (mmap_lib::bimap API) for the name annotations. The
+// bimap only has the interned ids, the strings are stored once per lgdb in
+// the Graph_library arena. The same hierarchical name in several lgraphs (or
+// as node and pin name) does not use more space.
+template <typename Key>
+class Name_bimap {
+protected:
+  using Ids = mmap_lib::bimap<Key, uint32_t>;
+
+  Ids            ids;
+  Graph_library *lib;
+
+public:
+  using iterator       = typename Ids::iterator;
+  using const_iterator = typename Ids::const_iterator;
+
+  explicit Name_bimap(std::string_view _path, std::string_view _map_name)
+      : ids(_path, _map_name), lib(Graph_library::instance(_path)) {}
+
+  void clear() { ids.clear(); }
+  void preload() const {
+    ids.preload();
+    lib->preload_interned();
+  }
+  void gc_pin() const {
+    ids.gc_pin();
+    lib->gc_pin_interned();
+  }
+  void gc_unpin() const {
+    lib->gc_unpin_interned();
+    ids.gc_unpin();
+  }
+  void reserve(size_t sz) { ids.reserve(sz); }
+
+  const_iterator set(const Key &key, std::string_view name) { return ids.set(key, lib->intern(name)); }
+
+  [[nodiscard]] bool has_key(const Key &key) const { return ids.has_key(key); }
+  [[nodiscard]] bool has_val(std::string_view name) const {
+    auto id = lib->find_interned(name);
+    return id && ids.has_val(id);
+  }
+
+  [[nodiscard]] std::string_view get_val(const Key &key) const { return lib->get_interned(ids.get_val(key)); }
+  [[nodiscard]] std::string_view get_val(const const_iterator &it) const { return lib->get_interned(ids.get_val(it)); }
+  [[nodiscard]] std::string_view get_val(const iterator &it) const { return lib->get_interned(ids.get_val(it)); }
+
+  [[nodiscard]] uint32_t get_val_id(const Key &key) const { return ids.get_val(key); }
+
+  [[nodiscard]] Key get_key(std::string_view name) const { return ids.get_key(lib->find_interned(name)); }
+  [[nodiscard]] Key get_key(const iterator &it) const { return ids.get_key(it); }
+  [[nodiscard]] Key get_key(const const_iterator &it) const { return ids.get_key(it); }
+
+  [[nodiscard]] iterator       find(const Key &key) { return ids.find(key); }
+  [[nodiscard]] const_iterator find(const Key &key) const { return ids.find(key); }
+  [[nodiscard]] const_iterator find_val(std::string_view name) const {
+    auto id = lib->find_interned(name);
+    if (id == 0)
+      return ids.end();
+    return ids.find_val(id);
+  }
+
+  [[nodiscard]] iterator       begin() { return ids.begin(); }
+  [[nodiscard]] const_iterator begin() const { return ids.begin(); }
+  [[nodiscard]] const_iterator cbegin() const { return ids.cbegin(); }
+
+  [[nodiscard]] iterator       end() { return ids.end(); }
+  [[nodiscard]] const_iterator end() const { return ids.end(); }
+  [[nodiscard]] const_iterator cend() const { return ids.cend(); }
+
+  iterator erase(const_iterator pos) { return ids.erase(pos); }
+  iterator erase(iterator pos) { return ids.erase(pos); }
+  size_t   erase_key(const Key &key) { return ids.erase_key(key); }
+
+  [[nodiscard]] size_t size() const { return ids.size(); }
+  [[nodiscard]] bool   empty() const { return ids.empty(); }
+  [[nodiscard]] size_t capacity() const { return ids.capacity(); }
+};
@@ -0,0 +1,66 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <string_view>
+
+#include "absl/container/flat_hash_map.h"
+#include "graph_library.hpp"
+
+// Drop-in for the absl::flat_hash_map<std::string, T> name maps of the
+// passes. The key is the name id interned in the lgdb (4 bytes, no heap copy,
+// hashed once), lookups of names never interned do not add them.
+//
+//   Name_map<Node_pin> name2dpin(Graph_library::instance(lg->get_path()));
+//   name2dpin["foo"] = dpin;
+//   auto it = name2dpin.find("foo");
+//   name2dpin.get_name(it->first);
+template <typename T>
+class Name_map {
+protected:
+  using Map = absl::flat_hash_map<uint32_t, T>;
+
+  Map            map;
+  Graph_library *lib;
+
+public:
+  using iterator       = typename Map::iterator;
+  using const_iterator = typename Map::const_iterator;
+
+  explicit Name_map(Graph_library *_lib) : lib(_lib) {}
+
+  T &operator[](std::string_view name) { return map[lib->intern(name)]; }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(std::string_view name, Args &&... args) {
+    return map.try_emplace(lib->intern(name), std::forward<Args>(args)...);
+  }
+
+  [[nodiscard]] iterator find(std::string_view name) {
+    auto id = lib->find_interned(name);
+    return id ? map.find(id) : map.end();
+  }
+  [[nodiscard]] const_iterator find(std::string_view name) const {
+    auto id = lib->find_interned(name);
+    return id ? map.find(id) : map.end();
+  }
+  [[nodiscard]] bool contains(std::string_view name) const { return find(name) != map.end(); }
+
+  size_t erase(std::string_view name) {
+    auto id = lib->find_interned(name);
+    return id ? map.erase(id) : 0;
+  }
+  void erase(const_iterator it) { map.erase(it); }
+
+  [[nodiscard]] std::string_view get_name(uint32_t id) const { return lib->get_interned(id); }
+
+  [[nodiscard]] iterator       begin() { return map.begin(); }
+  [[nodiscard]] const_iterator begin() const { return map.begin(); }
+  [[nodiscard]] iterator       end() { return map.end(); }
+  [[nodiscard]] const_iterator end() const { return map.end(); }
+
+  [[nodiscard]] size_t size() const { return map.size(); }
+  [[nodiscard]] bool   empty() const { return map.empty(); }
+  void                 clear() { map.clear(); }
+  void                 reserve(size_t sz) { map.reserve(sz); }
+};
@@ -407,6 +407,11 @@ Sub_node *Node::ref_type_sub_node() const { return current_g->ref_type_sub_node(
 
 Lconst Node::get_type_const() const { return current_g->get_type_const(nid); }
 
+void Node::set_type_const(const Lconst &val) {
+  I(!has_inputs());  // a constant has no inputs
+  current_g->set_type_const(nid, val);
+}
+
 void Node::nuke() {
   I(false);  // TODO:
 }
@@ -423,12 +428,18 @@ XEdge_iterator Node::inp_edges_ordered_reverse() const { return current_g->inp_e
 
 XEdge_iterator Node::out_edges_ordered_reverse() const { return current_g->out_edges_ordered_reverse(*this); }
 
+XEdge_range Node::inp_edges_range() const { return XEdge_range(*this, false); }
+
+XEdge_range Node::out_edges_range() const { return XEdge_range(*this, true); }
+
+XEdge_small_iterator Node::inp_edges_ordered_small() const { return current_g->inp_edges_ordered_small(*this); }
+
+XEdge_small_iterator Node::out_edges_ordered_small() const { return current_g->out_edges_ordered_small(*this); }
+
 Node_pin_iterator Node::inp_connected_pins() const { return current_g->inp_connected_pins(*this); }
 Node_pin_iterator Node::out_connected_pins() const { return current_g->out_connected_pins(*this); }
 
-Node_pin_iterator Node::inp_drivers(const absl::flat_hash_set<Node::Compact> &exclude) const {
-  return current_g->inp_drivers(*this, exclude);
-}
+Node_pin_iterator Node::inp_drivers() const { return current_g->inp_drivers(*this); }
 
 void Node::del_node() {
   current_g->del_node(*this);
@@ -2,7 +2,7 @@
 #pragma once
 
 #include "absl/container/flat_hash_set.h"
-//#include "absl/container/inlined_vector.h"
+#include "absl/container/inlined_vector.h"
 
 #include "mmap_map.hpp"
 #include "lconst.hpp"
@@ -28,6 +28,7 @@ protected:
   friend class XEdge;
   friend class Fast_edge_iterator;
   friend class Flow_base_iterator;
+  friend class XEdge_range;
   friend class Fwd_edge_iterator;
   friend class Bwd_edge_iterator;
   friend class Hierarchy_tree;
@@ -105,6 +106,7 @@ public:
     friend class Bwd_edge_iterator;
     friend class Hierarchy_tree;
     friend class mmap_lib::hash<Compact_class>;
+    friend class mmap_lib::dense_id<Compact_class>;
 
   public:
     //constexpr operator size_t() const { return nid; }
@@ -293,6 +295,9 @@ public:
   bool            is_type_sub_present() const;
 
   Lconst get_type_const() const;
+  // In place, the outputs stay. LGraph::create_node_const reuses the pool
+  // constant instead, this can leave duplicates (pass.constdedup).
+  void set_type_const(const Lconst &val);
 
   void connect_sink(const Node &n2)   const { setup_sink_pin().connect_driver(n2.setup_driver_pin()); }
   void connect_driver(const Node &n2) const { setup_driver_pin().connect_sink(n2.setup_sink_pin()); }
@@ -317,7 +322,13 @@ public:
   XEdge_iterator out_edges_ordered_reverse() const;  // Slower than inp_edges, but edges ordered by driver.pid
   XEdge_iterator inp_edges_ordered_reverse() const;  // Slower than inp_edges, but edges ordered by sink.pid
 
-  Node_pin_iterator inp_drivers(const absl::flat_hash_set<Node::Compact> &exclude) const;
+  XEdge_range out_edges_range() const;  // No allocation, do not modify the graph while iterating
+  XEdge_range inp_edges_range() const;
+
+  XEdge_small_iterator out_edges_ordered_small() const;  // Same as out_edges_ordered, inline buffer for small fan-out
+  XEdge_small_iterator inp_edges_ordered_small() const;  // Same as inp_edges_ordered, inline buffer for small fan-in
+
+  Node_pin_iterator inp_drivers() const;
 
   bool is_graph_io() const { return nid == Hardcoded_input_nid || nid == Hardcoded_output_nid; }
   bool is_graph_input() const { return nid == Hardcoded_input_nid; }
@@ -363,4 +374,10 @@ struct hash<Node::Compact_class> {
     return hash<uint32_t>{}(o.nid);
   }
 };
+
+template <>
+struct dense_id<Node::Compact_class> {
+  static constexpr bool enabled = true;
+  constexpr size_t operator()(Node::Compact_class const &o) const { return o.nid; }
+};
 }  // namespace mmap_lib
@@ -93,11 +93,16 @@ Node_pin Node_pin::get_driver_pin() const {
   if (is_invalid())
     return *this;
   I(is_sink() || is_graph_output());
-  auto piter = current_g->inp_driver(*this);
-  if (piter.empty())
+  XEdge_range range(*this, false);  // no allocation for the common case
+  auto        it = range.begin();
+  if (it == range.end())
     return Node_pin(); // disconnected driver
-  I(piter.size()==1); // If there can be many drivers, use the inp_driver iterator
-  return piter.back();
+  auto dpin = (*it).driver;
+#ifndef NDEBUG
+  ++it;
+  I(it == range.end()); // If there can be many drivers, use the inp_driver iterator
+#endif
+  return dpin;
 }
 
 Node_pin_iterator Node_pin::inp_driver() const {
@@ -431,21 +436,22 @@ Node_pin Node_pin::get_down_pin() const {
   I(node.is_type_sub_present());
 
   // 1st: Get down_hidx
+  auto       &htree       = top_g->get_htree();
+  auto        first_child = htree.get_first_child(hidx);  // lazy expand sets the tree_pos
+  I(!htree.is_leaf(hidx));
+
   const auto *tree_pos = Ann_node_tree_pos::ref(current_g);
   I(tree_pos);
   auto tree_it = tree_pos->find(node.get_compact_class());
   if (tree_it == tree_pos->end()) {
     top_g->regenerate_htree(); // force regenerate
+    first_child = htree.get_first_child(hidx);
     tree_it = tree_pos->find(node.get_compact_class());
     I(tree_it != tree_pos->end());
   }
 
   auto delta_pos = tree_pos->get(tree_it);
 
-  const auto &htree= top_g->get_htree();
-  I(!htree.is_leaf(hidx));
-  auto first_child = htree.get_first_child(hidx);
-
   Hierarchy_index down_hidx(first_child.level, first_child.pos + delta_pos);
   I(htree.get_parent(down_hidx) == hidx);
 
@@ -500,3 +506,7 @@ Node_pin Node_pin::get_up_pin() const {
 XEdge_iterator Node_pin::inp_edges() const { return current_g->inp_edges(*this); }
 
 XEdge_iterator Node_pin::out_edges() const { return current_g->out_edges(*this); }
+
+XEdge_range Node_pin::inp_edges_range() const { return XEdge_range(*this, false); }
+
+XEdge_range Node_pin::out_edges_range() const { return XEdge_range(*this, true); }
@@ -3,10 +3,13 @@
 
 class LGraph;
 class XEdge;
+class XEdge_range;
 class Node;
 
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
+
 #include "ann_ssa.hpp"
 #include "lgedge.hpp"
 #include "mmap_map.hpp"
@@ -15,6 +18,8 @@ class Node;
 using XEdge_iterator    = std::vector<XEdge>;
 using Node_pin_iterator = std::vector<Node_pin>;
 
+using XEdge_small_iterator = absl::InlinedVector<XEdge, 8>;  // no heap for the common small fan-in/out
+
 class Node_pin {
 protected:
   friend class LGraph;
@@ -26,6 +31,8 @@ protected:
   friend class Fwd_edge_iterator;
   friend class Bwd_edge_iterator;
   friend class Edge_raw;
+  friend class Graph_csr;
+  friend class XEdge_range;
 
   LGraph *        top_g;
   LGraph *        current_g;
@@ -151,6 +158,7 @@ public:
     friend class Fwd_edge_iterator;
     friend class Bwd_edge_iterator;
     friend class mmap_lib::hash<Node_pin::Compact_class>;
+    friend class mmap_lib::dense_id<Node_pin::Compact_class>;
 
   public:
     // constexpr operator size_t() const { I(0); return idx|(sink<<31); }
@@ -190,6 +198,7 @@ public:
     friend class Fwd_edge_iterator;
     friend class Bwd_edge_iterator;
     friend class mmap_lib::hash<Node_pin::Compact_class_driver>;
+    friend class mmap_lib::dense_id<Node_pin::Compact_class_driver>;
 
   public:
     // constexpr operator size_t() const { I(0); return idx|(sink<<31); }
@@ -377,6 +386,9 @@ public:
   XEdge_iterator out_edges() const;
   XEdge_iterator inp_edges() const;
 
+  XEdge_range out_edges_range() const;  // No allocation, do not modify the graph while iterating
+  XEdge_range inp_edges_range() const;
+
   Node_pin get_down_pin() const;
   Node_pin get_up_pin() const;
 };
@@ -412,4 +424,16 @@ template <>
 struct hash<Node_pin::Compact_class_driver> {
   size_t operator()(Node_pin::Compact_class_driver const &o) const { return hash<uint32_t>{}(o.idx); }
 };
+
+template <>
+struct dense_id<Node_pin::Compact_class> {
+  static constexpr bool enabled = true;
+  size_t operator()(Node_pin::Compact_class const &o) const { return (static_cast<size_t>(o.idx) << 1) + o.sink; }
+};
+
+template <>
+struct dense_id<Node_pin::Compact_class_driver> {
+  static constexpr bool enabled = true;
+  size_t operator()(Node_pin::Compact_class_driver const &o) const { return o.idx; }
+};
 }  // namespace mmap_lib
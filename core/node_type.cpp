@@ -10,19 +10,44 @@ static_assert(static_cast<int>(Ntype_op::Last_invalid) < 127, "lgedge has 8 bits
 LGraph_Node_Type::LGraph_Node_Type(std::string_view _path, std::string_view _name, Lg_type_id _lgid) noexcept
     : LGraph_Base(_path, _name, _lgid)
     , const_map(_path, absl::StrCat("lg_", std::to_string(_lgid), "_const"))
+    , const_pool(_path, absl::StrCat("lg_", std::to_string(_lgid), "_const_pool"))
     , subid_map(_path, absl::StrCat("lg_", std::to_string(_lgid), "_subid"))
     , lut_map(_path, absl::StrCat("lg_", std::to_string(_lgid), "_lut")) {}
 
 void LGraph_Node_Type::clear() {
   const_map.clear();
+  const_pool.clear();
   subid_map.clear();
   lut_map.clear();
 }
 
+void LGraph_Node_Type::drop_type_data(Index_ID nid, const Ntype_op new_op) {
+  auto op = node_internal[nid].get_type();
+  if (op == new_op)
+    return;
+
+  if (op == Ntype_op::Const) {
+    const_map.erase(Node::Compact_class(nid));  // the const_pool entry is checked on use
+  } else if (op == Ntype_op::LUT) {
+    lut_map.erase(Node::Compact_class(nid));
+  } else if (op == Ntype_op::Sub) {
+    subid_map.erase(Node::Compact_class(nid));
+    Hierarchy_tree::sub_changed(get_lgid());
+  }
+}
+
 void LGraph_Node_Type::set_type(Index_ID nid, const Ntype_op op) {
   I(node_internal[nid].is_master_root());
 
+  drop_type_data(nid, op);
+
   node_internal.ref(nid)->set_type(op);
+  bump_edit_epoch();  // a new type can add/remove a loop breaker
+  strash.touch(nid);
+  journal.add(Graph_journal::Op::Set_type, nid, static_cast<uint32_t>(op));
+#ifdef LGRAPH_GRAPH_CORE
+  gcore_set_type(nid);
+#endif
 }
 
 bool LGraph_Node_Type::is_type_const(Index_ID nid) const {
@@ -34,11 +59,18 @@ bool LGraph_Node_Type::is_type_const(Index_ID nid) const {
 void LGraph_Node_Type::set_type_sub(Index_ID nid, Lg_type_id subgraphid) {
   I(node_internal[nid].is_master_root());
 
+  drop_type_data(nid, Ntype_op::Sub);
   subid_map.set(Node::Compact_class(nid), subgraphid.value);
 
   // Ann_node_tree_pos::ref(static_cast<const LGraph *>(this))->set(Node::Compact_class(nid), subid_map.size());
 
   node_internal.ref(nid)->set_type(Ntype_op::Sub);
+  bump_edit_epoch();
+  Hierarchy_tree::sub_changed(get_lgid());
+  journal.add(Graph_journal::Op::Set_type, nid, static_cast<uint32_t>(Ntype_op::Sub));
+#ifdef LGRAPH_GRAPH_CORE
+  gcore_set_type(nid);
+#endif
 }
 
 Lg_type_id LGraph_Node_Type::get_type_sub(Index_ID nid) const {
@@ -70,8 +102,14 @@ Sub_node *LGraph_Node_Type::ref_type_sub_node(std::string_view sub_name) {
 }
 
 void LGraph_Node_Type::set_type_lut(Index_ID nid, const Lconst &lutid) {
+  drop_type_data(nid, Ntype_op::LUT);
+
   auto *ptr = node_internal.ref(nid);
   ptr->set_type(Ntype_op::LUT);
+  journal.add(Graph_journal::Op::Set_type, nid, static_cast<uint32_t>(Ntype_op::LUT));
+#ifdef LGRAPH_GRAPH_CORE
+  gcore_set_type(nid);
+#endif
 
   lut_map.set(Node::Compact_class(nid), lutid.serialize());
 }
@@ -88,11 +126,40 @@ Lconst LGraph_Node_Type::get_type_const(Index_ID nid) const {
   return Lconst(const_map.get(Node::Compact_class(nid)));
 }
 
+Index_ID LGraph_Node_Type::find_type_const(const Lconst &value) const {
+  const auto v  = value.serialize();
+  const auto it = const_pool.find(v);
+  if (it == const_pool.end())
+    return 0;
+
+  Index_ID nid = const_pool.get(it).nid;
+  if (nid >= node_internal.size() || !node_internal[nid].is_valid() || !node_internal[nid].is_master_root()
+      || node_internal[nid].get_type() != Ntype_op::Const)
+    return 0;
+  if (const_map.get(Node::Compact_class(nid)) != v)
+    return 0;
+  if (node_internal[nid].get_bits() != value.get_bits())
+    return 0;  // driver pin bits changed after creation (set_bits)
+
+  return nid;
+}
+
 void LGraph_Node_Type::set_type_const(Index_ID nid, const Lconst &value) {
-  const_map.set(Node::Compact_class(nid), value.serialize());
+  drop_type_data(nid, Ntype_op::Const);
+
+  auto v = value.serialize();
+  const_map.set(Node::Compact_class(nid), v);
+  const_pool.set(v, Node::Compact_class(nid));
+
   auto *ptr = node_internal.ref(nid);
   ptr->set_type(Ntype_op::Const);
   ptr->set_bits(value.get_bits());
+  bump_edit_epoch();  // Node::set_type_const retypes in place
+  strash.touch(nid);
+  journal.add(Graph_journal::Op::Set_type, nid, static_cast<uint32_t>(Ntype_op::Const));
+#ifdef LGRAPH_GRAPH_CORE
+  gcore_set_type(nid);
+#endif
 }
 
 void LGraph_Node_Type::set_type_const(Index_ID nid, std::string_view sv) { set_type_const(nid, Lconst(sv)); }
@@ -15,14 +15,24 @@ class LGraph_Node_Type : virtual public LGraph_Base {
 protected:
   using Node_value_map = mmap_lib::map<Node::Compact_class, Lconst::Container>;
   using Node_lut_map   = mmap_lib::map<Node::Compact_class, Lconst::Container>;
+  using Node_const_pool = mmap_lib::map<Lconst::Container, Node::Compact_class>;
 
-  Node_value_map const_map;  // bimap to avoid unnecessary constant replication
+  Node_value_map const_map;
+
+  // Constant pool: serialized value (with bits) to one Const node with it.
+  // Entries are checked on use, a deleted or retyped node is just a miss.
+  Node_const_pool const_pool;
+  bool            const_pool_checked = false;  // rebuilt once if empty (old lgdb)
 
   Node_down_map subid_map;
   Node_lut_map  lut_map;
 
   void clear();
 
+  // Before a retype of nid to new_op: drops the type data of the old op
+  // (subid_map, lut_map, const_map entries)
+  void drop_type_data(Index_ID nid, const Ntype_op new_op);
+
   void             set_type(Index_ID nid, const Ntype_op op);
   Ntype_op          get_type_op(Index_ID nid) const {
     I(node_internal[nid].is_master_root());
@@ -49,6 +59,8 @@ protected:
   // No const because Lconst created
   Lconst get_type_const(Index_ID nid) const;
 
+  Index_ID find_type_const(const Lconst &value) const;  // 0 if not in the pool (or other driver bits)
+
 public:
   LGraph_Node_Type() = delete;
   explicit LGraph_Node_Type(std::string_view path, std::string_view name, Lg_type_id lgid) noexcept;
@@ -2,6 +2,8 @@
 
 #include "sub_node.hpp"
 
+#include <cstring>
+
 void Sub_node::copy_from(std::string_view new_name, Lg_type_id new_lgid, const Sub_node &sub) {
   name = new_name;
   lgid = new_lgid;
@@ -112,6 +114,56 @@ void Sub_node::from_json(const rapidjson::Value &entry) {
   std::sort(deleted.begin(), deleted.end(), std::greater<>());
 }
 
+// Each pin (instance_pid order, deleted pins too): graph_io_pos(2) dir(1) name_size(4) name
+void Sub_node::to_binary(std::string &out) const {
+  for (auto i = 1u; i < io_pins.size(); ++i) {
+    const auto &pin  = io_pins[i];
+    Port_ID     pos  = pin.graph_io_pos;
+    uint8_t     dir  = static_cast<uint8_t>(pin.dir);
+    uint32_t    size = pin.name.size();
+
+    out.append(reinterpret_cast<const char *>(&pos), sizeof(pos));
+    out.append(reinterpret_cast<const char *>(&dir), sizeof(dir));
+    out.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.append(pin.name);
+  }
+}
+
+void Sub_node::from_binary(std::string_view pins) {
+  I(lgid);
+  I(io_pins.size() == 1);  // only after a reset
+
+  size_t off = 0;
+  while (off < pins.size()) {
+    Port_ID  pos;
+    uint8_t  dir;
+    uint32_t size;
+    I(off + sizeof(pos) + sizeof(dir) + sizeof(size) <= pins.size());
+    memcpy(&pos, pins.data() + off, sizeof(pos));
+    off += sizeof(pos);
+    memcpy(&dir, pins.data() + off, sizeof(dir));
+    off += sizeof(dir);
+    memcpy(&size, pins.data() + off, sizeof(size));
+    off += sizeof(size);
+    I(off + size <= pins.size());
+    auto io_name = pins.substr(off, size);
+    off += size;
+
+    Port_ID instance_pid = io_pins.size();
+    io_pins.emplace_back(io_name, static_cast<Direction>(dir), pos);
+
+    if (io_pins[instance_pid].is_invalid()) {
+      deleted.emplace_back(instance_pid);
+      continue;
+    }
+    name2id[io_name] = instance_pid;
+    if (pos != Port_invalid)
+      map_pin_int(instance_pid, pos);
+  }
+
+  std::sort(deleted.begin(), deleted.end(), std::greater<>());
+}
+
 /* LCOV_EXCL_START */
 void Sub_node::dump() const {
   fmt::print("lgid:{} name:{} #iopins:{}\n", lgid, name, io_pins.size());
@@ -102,6 +102,10 @@ public:
   void to_json(rapidjson::PrettyWriter<rapidjson::StringBuffer> &writer) const;
   void from_json(const rapidjson::Value &entry);
 
+  // IO pins for the binary Graph_library index (name and lgid are kept by the library)
+  void to_binary(std::string &out) const;
+  void from_binary(std::string_view pins);
+
   void reset_pins() {
     clear_io_pins();
     io_pins.clear();    // WARNING: Do NOT remove mappings, just port id. (allows to reload designs)
@@ -2,12 +2,17 @@
 
 #include "attribute.hpp"
 
+#include <unistd.h>
+
 #include <boost/multiprecision/cpp_int.hpp>
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "annotate.hpp"
 #include "lbench.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
@@ -92,3 +97,137 @@ TEST_F(Setup_attr_test, data_test1) {
     i++;
   }
 }
+
+TEST_F(Setup_attr_test, concurrent_read) {
+  // Two graphs, so that the readers alternate between tables
+  std::vector<Node> nodes[2];
+  LGraph *          lgs[2] = {top, subs[0]};
+  for (int n = 0; n < 2; ++n) {
+    for (int i = 0; i < 20000; i++) {
+      auto node = lgs[n]->create_node(Ntype_op::Sum, 8);
+      if (i % 3)
+        node.set_name(absl::StrCat("cr_", n, "_", i));
+      node.setup_driver_pin().set_offset(i & 0xFF);
+      nodes[n].emplace_back(node);
+    }
+  }
+
+  std::vector<Node> others;  // a graph not in concurrent read mode
+  for (int i = 0; i < 2000; i++) {
+    others.emplace_back(subs[1]->create_node(Ntype_op::Sum, 8));
+  }
+
+  Lbench b("core.ATTR_concurrent_read");
+
+  for (auto *lg : lgs) Ann_support::begin_concurrent_read(lg);
+
+  std::atomic<int>         n_named(0);
+  std::atomic<int>         n_bad(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = t; i < 20000; i += 4) {
+        for (int n = 0; n < 2; ++n) {
+          const auto &node = nodes[n][i];
+          if (node.has_name()) {
+            n_named++;
+            if (node.get_name() != absl::StrCat("cr_", n, "_", i))
+              n_bad++;
+          }
+          if (node.get_driver_pin().get_offset() != static_cast<Bits_t>(i & 0xFF))
+            n_bad++;
+        }
+      }
+    });
+  }
+  // Meanwhile, the same attributes on another graph go through the lock
+  threads.emplace_back([&] {
+    for (size_t i = 0; i < others.size(); ++i) {
+      others[i].set_name(absl::StrCat("other_", i));
+      if (others[i].get_name() != absl::StrCat("other_", i))
+        n_bad++;
+    }
+  });
+  for (auto &th : threads) th.join();
+
+  for (auto *lg : lgs) Ann_support::end_concurrent_read(lg);
+
+  EXPECT_EQ(n_bad, 0);
+  EXPECT_EQ(n_named, 2 * (20000 - (20000 + 2) / 3));
+
+  // Back to the locked mode
+  nodes[0][0].set_name("cr_0_0");
+  EXPECT_EQ(nodes[0][0].get_name(), "cr_0_0");
+}
+
+TEST_F(Setup_attr_test, concurrent_write) {
+  struct Data {
+    int  a;
+    char b;
+  };
+  static constexpr char name[] = "cwrite";
+  using cwrite                 = Attribute<name, Node, mmap_lib::concurrent_map<Node::Compact_class, Data> >;
+
+  std::vector<Node> nodes;
+  for (auto node : top->fast()) {
+    nodes.emplace_back(node);
+  }
+
+  Lbench b("core.ATTR_concurrent_write");
+
+  // Each thread sets (and checks) the attribute of its share of the nodes
+  std::atomic<int>         n_bad(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = t; i < nodes.size(); i += 4) {
+        auto *attr = cwrite::ref(nodes[i]);
+        attr->set(nodes[i].get_compact_class(), Data{static_cast<int>(i), static_cast<char>(i & 0xFF)});
+        if (attr->get(nodes[i].get_compact_class()).a != static_cast<int>(i))
+          n_bad++;
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+
+  EXPECT_EQ(n_bad, 0);
+  EXPECT_EQ(cwrite::ref(top)->size(), nodes.size());
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    auto d = cwrite::ref(nodes[i])->get(nodes[i].get_compact_class());
+    EXPECT_EQ(d.a, static_cast<int>(i));
+    EXPECT_EQ(d.b, static_cast<char>(i & 0xFF));
+  }
+
+  cwrite::clear(top);
+}
+
+TEST(Attr_library, drop_on_shutdown) {
+  static constexpr char name[] = "drop";
+  using drop_attr              = Attribute<name, Node, mmap_lib::map<Node::Compact_class, int> >;
+  static constexpr char other_name[] = "drop_other";
+  using other_attr                   = Attribute<other_name, Node, mmap_lib::map<Node::Compact_class, int> >;
+
+  auto *lg   = LGraph::create("lgdb_attr_drop", "drop", "-");
+  auto  cid  = lg->create_node(Ntype_op::Sum).get_compact_class();
+  auto  lgid = lg->get_lgid();
+  drop_attr::ref(lg)->set(cid, 7);
+
+  // remap does not create the tables of an attribute never set
+  other_attr::remap(lg, [](const Node::Compact_class &key) { return key; });
+  auto other_file = absl::StrCat("lgdb_attr_drop/lg_", std::to_string(lgid), "_node_", other_name);
+  EXPECT_NE(access(other_file.c_str(), F_OK), 0);
+
+  // The attribute tables go with the library. Nothing from the old table
+  // comes back after the files are removed.
+  Graph_library::shutdown();
+  unlink(absl::StrCat("lgdb_attr_drop/lg_", std::to_string(lgid), "_node_", name).c_str());
+
+  lg = LGraph::open("lgdb_attr_drop", "drop");
+  ASSERT_NE(lg, nullptr);
+  EXPECT_TRUE(drop_attr::ref(lg)->empty());
+  drop_attr::ref(lg)->set(cid, 3);
+  EXPECT_EQ(drop_attr::ref(lg)->get(cid), 3);
+
+  Graph_library::shutdown();
+}
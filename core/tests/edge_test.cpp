@@ -164,7 +164,23 @@ protected:
     return spin;
   }
 
+  static void check_range(const XEdge_iterator &ref, const XEdge_range &range) {
+    size_t pos = 0;
+    for (const auto &e : range) {
+      EXPECT_LT(pos, ref.size());
+      if (pos < ref.size())
+        EXPECT_EQ(e, ref[pos]);  // same walk, same order
+      ++pos;
+    }
+    EXPECT_EQ(pos, ref.size());
+  }
+
   void check_edges() {
+    check_range(n1.out_edges(), n1.out_edges_range());
+    check_range(n1.inp_edges(), n1.inp_edges_range());
+    check_range(n2.out_edges(), n2.out_edges_range());
+    check_range(n2.inp_edges(), n2.inp_edges_range());
+
     for (auto e : n1.inp_edges()) {
       (void)e;
       EXPECT_TRUE(false);
@@ -226,12 +242,28 @@ TEST_F(Edge_test, random_insert) {
     }
   }
 
+  check_edges();
+
   int conta = 0;
   for (auto &out : n1.out_edges()) {
     conta++;
     (void)out;
   }
   EXPECT_EQ(conta, track_edge_count.size());
+
+  for (const auto &pin : n2.inp_connected_pins()) {
+    check_range(pin.inp_edges(), pin.inp_edges_range());
+  }
+  for (const auto &pin : n1.out_connected_pins()) {
+    check_range(pin.out_edges(), pin.out_edges_range());
+  }
+
+  auto small = n2.inp_edges_ordered_small();
+  auto ref   = n2.inp_edges_ordered();
+  EXPECT_EQ(small.size(), ref.size());
+  EXPECT_TRUE(std::equal(small.begin(), small.end(), ref.begin(), ref.end(), [](const XEdge &a, const XEdge &b) {
+    return a.sink.get_pid() == b.sink.get_pid();
+  }));
   for (auto &out : n2.out_edges()) {
     I(false);
     (void)out;  // just to silence the warning
@@ -556,3 +588,43 @@ TEST_F(Edge_test, trivial_delete3) {
     EXPECT_NE(node, n2_copy);
   }
 }
+
+#ifdef LGRAPH_GRAPH_CORE
+TEST_F(Edge_test, graph_core_del_pin) {
+  auto *gc     = g->ref_graph_core();
+  auto  gc_pin = [this, gc](const Node &node, Port_ID pid) {
+    auto root = g->get_gcore_idx(node.get_compact_class().get_nid());
+    return pid ? gc->find_master(root, pid) : root;
+  };
+  auto n_edges = [](Index_iter it) {
+    int n = 0;
+    for (auto id : it) {
+      (void)id;
+      ++n;
+    }
+    return n;
+  };
+
+  auto dpin  = add_n1_setup_driver_pin("driver_pin1");
+  auto spin1 = add_n2_setup_sink_pin("sink_pin1");
+  auto spin2 = add_n2_setup_sink_pin("sink_pin2");
+
+  g->add_edge(dpin, spin1, 3);
+  g->add_edge(dpin, spin2, 3);
+
+  EXPECT_EQ(n_edges(gc->out_ids(gc_pin(n1, dpin.get_pid()))), 2);
+  EXPECT_EQ(n_edges(gc->inp_ids(gc_pin(n2, spin1.get_pid()))), 1);
+
+  spin1.del();  // LGraph::del_pin must keep the mirror in sync
+
+  EXPECT_EQ(n2.inp_edges().size(), 1);
+  EXPECT_EQ(n_edges(gc->out_ids(gc_pin(n1, dpin.get_pid()))), 1);
+  EXPECT_EQ(n_edges(gc->inp_ids(gc_pin(n2, spin1.get_pid()))), 0);
+
+  dpin.del();
+
+  EXPECT_EQ(n1.out_edges().size(), 0);
+  EXPECT_EQ(n_edges(gc->out_ids(gc_pin(n1, dpin.get_pid()))), 0);
+  EXPECT_EQ(n_edges(gc->inp_ids(gc_pin(n2, spin2.get_pid()))), 0);
+}
+#endif
@@ -3,8 +3,10 @@
 
 #include "Adjacency_list.hpp"
 #include "absl/container/flat_hash_map.h"
+#include "graph_core.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
+#include "lrand.hpp"
 
 using namespace std::chrono;
 using namespace std;
@@ -136,6 +138,102 @@ int traverse_boosted_graph_in_out(graph::Bi_adjacency_list* g) {
   return i;
 }
 
+// Node_internal (LGraph) vs Graph_core storage for the same random graph
+void bench_backends(int n_nodes, int n_edges) {
+  fmt::print("--------------------------Node_internal vs Graph_core--------------------\n");
+
+  Lrand<int> rng;
+  std::vector<std::pair<int, int>> edges;  // driver node, sink node
+  std::vector<Port_ID>             sink_pid;
+  for (int i = 0; i < n_edges; i++) {
+    edges.emplace_back(rng.max(n_nodes), rng.max(n_nodes));
+    sink_pid.emplace_back(1 + rng.max(3));
+  }
+
+  int micros = 1000000;
+
+  // insert
+  auto start = high_resolution_clock::now();
+
+  LGraph* lg = LGraph::create("lgdb_bench", "backend", "-");
+  std::vector<Node> nodes;
+  for (int i = 0; i < n_nodes; i++) nodes.emplace_back(lg->create_node(Ntype_op::Sum));
+  for (int i = 0; i < n_edges; i++) {
+    auto dpin = nodes[edges[i].first].setup_driver_pin();
+    auto spin = nodes[edges[i].second].setup_sink_pin_raw(sink_pid[i]);
+    lg->add_edge(dpin, spin);
+  }
+
+  auto stop     = high_resolution_clock::now();
+  auto duration = duration_cast<microseconds>(stop - start);
+  fmt::print("Insert Node_internal nodes:{} edges:{} took {}s\n", n_nodes, n_edges, (double)duration.count() / micros);
+
+  start = high_resolution_clock::now();
+
+  Graph_core gc("lgdb_bench", "backend_gcore");
+  gc.clear();
+  std::vector<Index_ID> gc_nodes;
+  for (int i = 0; i < n_nodes; i++) gc_nodes.emplace_back(gc.create_master_root(static_cast<uint8_t>(Ntype_op::Sum)));
+  for (int i = 0; i < n_edges; i++) {
+    auto root = gc_nodes[edges[i].second];
+    auto spin = gc.find_master(root, sink_pid[i]);
+    if (spin == 0)
+      spin = gc.create_master(root, sink_pid[i]);
+    gc.add_edge(spin, gc_nodes[edges[i].first]);
+  }
+
+  stop     = high_resolution_clock::now();
+  duration = duration_cast<microseconds>(stop - start);
+  fmt::print("Insert Graph_core    nodes:{} edges:{} took {}s\n", n_nodes, n_edges, (double)duration.count() / micros);
+
+  // forward traversal
+  int iterations = 100;
+  int x          = 0;
+
+  start = high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    x = traverse_lgraph_out(lg);
+  }
+  stop     = high_resolution_clock::now();
+  duration = duration_cast<microseconds>(stop - start);
+  fmt::print("Traverse Node_internal {} times edges:{} took {}s\n", iterations, x, (double)duration.count() / micros);
+
+  start = high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    x = 0;
+    for (auto id = gc.fast_first(); id; id = gc.fast_next(id)) {
+      for (auto dpin : gc.get_setup_drivers(id)) {
+        for (auto spin : gc.out_ids(dpin)) {
+          (void)spin;
+          x++;
+        }
+      }
+    }
+  }
+  stop     = high_resolution_clock::now();
+  duration = duration_cast<microseconds>(stop - start);
+  fmt::print("Traverse Graph_core    {} times edges:{} took {}s\n", iterations, x, (double)duration.count() / micros);
+
+  // delete half the nodes
+  start = high_resolution_clock::now();
+  for (int i = 0; i < n_nodes; i += 2) {
+    nodes[i].del_node();
+  }
+  stop     = high_resolution_clock::now();
+  duration = duration_cast<microseconds>(stop - start);
+  fmt::print("Delete Node_internal {} nodes took {}s\n", n_nodes / 2, (double)duration.count() / micros);
+
+  start = high_resolution_clock::now();
+  for (int i = 0; i < n_nodes; i += 2) {
+    gc.del(gc_nodes[i]);
+  }
+  stop     = high_resolution_clock::now();
+  duration = duration_cast<microseconds>(stop - start);
+  fmt::print("Delete Graph_core    {} nodes took {}s\n", n_nodes / 2, (double)duration.count() / micros);
+
+  fmt::print("Graph_core table {} bytes\n", gc.size_bytes());
+}
+
 int main(int argc, char** argv) {
   fmt::print("benchmark the graph\n");
 
@@ -232,5 +330,7 @@ int main(int argc, char** argv) {
   duration = duration_cast<microseconds>(stop - start);
   fmt::print("Traverse boosted graph {} times took {}s\n", iterations, duration.count() / micros);
 
+  bench_backends(100000, 400000);
+
   return 0;
 }
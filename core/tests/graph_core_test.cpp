@@ -2,6 +2,7 @@
 
 #include "graph_core.hpp"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -19,12 +20,145 @@ protected:
   void TearDown() override {
     // Graph_library::sync_all();
   }
+
+  static std::vector<Index_ID> collect(Index_iter it) {
+    std::vector<Index_ID> v;
+    for (auto id : it) v.emplace_back(id);
+    std::sort(v.begin(), v.end());
+    return v;
+  }
 };
 
 TEST_F(Setup_graph_core, shallow_tree) {
   Lbench b("core.GRAPH_CORE_shallow_tree");
 
   Graph_core c1("lgdb_gc", "shallow_tree");
+  c1.clear();
+
+  auto root = c1.create_master_root(3);
+  EXPECT_EQ(c1.get_type(root), 3);
+  EXPECT_EQ(c1.get_pid(root), 0);
+
+  std::vector<Index_ID> leafs;
+  for (int i = 0; i < 100; ++i) {
+    auto leaf = c1.create_master_root(1);
+    auto pin  = c1.create_master(leaf, 1);
+    EXPECT_EQ(c1.get_pid(pin), 1);
+    EXPECT_EQ(c1.get_master_root(pin), leaf);
+    EXPECT_EQ(c1.find_master(leaf, 1), pin);
+    c1.add_edge(pin, root);
+    leafs.emplace_back(pin);
+  }
+  std::sort(leafs.begin(), leafs.end());
+
+  EXPECT_EQ(collect(c1.out_ids(root)), leafs);
+  EXPECT_TRUE(collect(c1.inp_ids(root)).empty());
+  for (auto pin : leafs) {
+    EXPECT_EQ(collect(c1.inp_ids(pin)), std::vector<Index_ID>{root});
+    EXPECT_TRUE(collect(c1.out_ids(pin)).empty());
+  }
+
+  EXPECT_EQ(c1.get_setup_drivers(root), std::vector<Index_ID>{root});
+
+  int n_roots = 0;
+  for (auto id = c1.fast_first(); id; id = c1.fast_next(id)) {
+    ++n_roots;
+  }
+  EXPECT_EQ(n_roots, 101);
+}
+
+TEST_F(Setup_graph_core, add_del_edges) {
+  Lbench b("core.GRAPH_CORE_add_del_edges");
+
+  Graph_core c1("lgdb_gc", "add_del_edges");
+  c1.clear();
+
+  Lrand<int> rng;
+
+  std::vector<Index_ID> nodes;
+  for (int i = 0; i < 200; ++i) {
+    nodes.emplace_back(c1.create_master_root(i & 0xFF));
+  }
+
+  // random edges (no duplicates) and a shadow copy to check against
+  std::vector<std::vector<Index_ID>> shadow_out(nodes.size());
+  for (int i = 0; i < 4000; ++i) {
+    auto d = rng.max(nodes.size());
+    auto s = rng.max(nodes.size());
+    if (std::find(shadow_out[d].begin(), shadow_out[d].end(), nodes[s]) != shadow_out[d].end())
+      continue;
+    c1.add_edge(nodes[s], nodes[d]);
+    shadow_out[d].emplace_back(nodes[s]);
+  }
+
+  // delete half of the edges
+  for (size_t d = 0; d < nodes.size(); ++d) {
+    auto &v = shadow_out[d];
+    for (size_t j = 0; j < v.size(); j += 2) {
+      c1.del_edge(v[j], nodes[d]);
+    }
+    std::vector<Index_ID> keep;
+    for (size_t j = 1; j < v.size(); j += 2) keep.emplace_back(v[j]);
+    v = keep;
+  }
+
+  for (size_t d = 0; d < nodes.size(); ++d) {
+    auto v = shadow_out[d];
+    std::sort(v.begin(), v.end());
+    EXPECT_EQ(collect(c1.out_ids(nodes[d])), v);
+  }
+
+  // delete some nodes, the edges pointing to them must be gone
+  for (size_t d = 0; d < nodes.size(); d += 3) {
+    c1.del(nodes[d]);
+  }
+  for (size_t d = 0; d < nodes.size(); ++d) {
+    if ((d % 3) == 0) {
+      EXPECT_FALSE(c1.is_valid(nodes[d]));
+      continue;
+    }
+    for (auto other : c1.out_ids(nodes[d])) {
+      EXPECT_TRUE(c1.is_valid(other));
+    }
+    for (auto other : c1.inp_ids(nodes[d])) {
+      EXPECT_TRUE(c1.is_valid(other));
+    }
+  }
+
+  // freed entries are reused
+  auto n1 = c1.create_master_root(7);
+  EXPECT_TRUE(n1 <= nodes.back());
+}
+
+TEST_F(Setup_graph_core, del_pin) {
+  Graph_core c1("lgdb_gc", "del_pin");
+  c1.clear();
+
+  auto root = c1.create_master_root(3);
+  auto sink = c1.create_master_root(1);
+
+  std::vector<Index_ID> pins;
+  for (int i = 1; i < 4; ++i) {
+    auto pin = c1.create_master(root, i);
+    c1.add_edge(pin, sink);
+    pins.emplace_back(pin);
+  }
+
+  // Deleting a pin keeps the node and the other pins
+  c1.del(pins[1]);
+  EXPECT_FALSE(c1.is_valid(pins[1]));
+  EXPECT_TRUE(c1.is_valid(root));
+  EXPECT_EQ(c1.find_master(root, 2), 0);
+  EXPECT_EQ(c1.find_master(root, 1), pins[0]);
+  EXPECT_EQ(c1.find_master(root, 3), pins[2]);
+
+  std::vector<Index_ID> left = {pins[0], pins[2]};
+  std::sort(left.begin(), left.end());
+  EXPECT_EQ(collect(c1.out_ids(sink)), left);
 
-  // TEST now
+  // Deleting the node takes the remaining pins
+  c1.del(root);
+  EXPECT_FALSE(c1.is_valid(pins[0]));
+  EXPECT_FALSE(c1.is_valid(pins[2]));
+  EXPECT_TRUE(collect(c1.out_ids(sink)).empty());
 }
@@ -0,0 +1,163 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_csr.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+using testing::HasSubstr;
+
+class Setup_graph_csr : public ::testing::Test {
+protected:
+  LGraph *          g;
+  std::vector<Node> nodes;
+  Lrand<int>        rint;
+
+  void SetUp() override {
+    g = LGraph::create("lgdb_graph_csr", "csr_test", "test");
+
+    for (int i = 0; i < 8; ++i) {
+      g->add_graph_input(absl::StrCat("i", i), i + 1, 1 + i);
+      g->add_graph_output(absl::StrCat("o", i), 100 + i, 1 + i);
+    }
+
+    nodes.clear();
+    for (int i = 0; i < 200; ++i) {
+      nodes.emplace_back(g->create_node(Ntype_op::Mux));
+    }
+  }
+
+  void TearDown() override {}
+
+  void add_random_edges(int n) {
+    auto inp_node = g->get_graph_input_node();
+    auto out_node = g->get_graph_output_node();
+
+    for (int i = 0; i < n; ++i) {
+      auto &sink = nodes[rint.max(nodes.size())];
+
+      Port_ID pid = 1 + rint.max(6);
+      if (!Ntype::has_sink(Ntype_op::Mux, pid))
+        continue;
+
+      auto spin = sink.setup_sink_pin_raw(pid);
+      if ((i & 7) == 0) {
+        inp_node.setup_driver_pin_raw(1 + rint.max(8)).connect_sink(spin);
+      } else {
+        nodes[rint.max(nodes.size())].setup_driver_pin().connect_sink(spin);
+      }
+      if ((i & 15) == 0) {
+        sink.setup_driver_pin().connect_sink(out_node.setup_sink_pin_raw(100 + rint.max(8)));
+      }
+    }
+  }
+
+  void check_edges(const Graph_csr &csr, const XEdge_iterator &ref, const Graph_csr::Span &span, bool out) {
+    XEdge_iterator v;
+    Port_ID        last_pid = 0;
+    for (const auto &e : span) {
+      auto pid = out ? e.driver_pid : e.sink_pid;
+      EXPECT_GE(pid, last_pid);  // sorted by pin pid
+      last_pid = pid;
+
+      auto xe = csr.get_xedge(g, e);
+      EXPECT_EQ(xe.driver.get_pid(), e.driver_pid);
+      EXPECT_EQ(xe.sink.get_pid(), e.sink_pid);
+      v.emplace_back(xe);
+    }
+    EXPECT_EQ(v.size(), ref.size());
+    EXPECT_TRUE(std::is_permutation(v.begin(), v.end(), ref.begin(), ref.end()));
+  }
+
+  void check_node(const Graph_csr &csr, const Node &node) {
+    check_edges(csr, node.out_edges(), csr.out_edges(node), true);
+    check_edges(csr, node.inp_edges(), csr.inp_edges(node), false);
+  }
+
+  void check_all(const Graph_csr &csr) {
+    size_t n_edges = 0;
+    for (auto node : g->fast()) {
+      check_node(csr, node);
+      n_edges += node.get_num_out_edges();
+    }
+    check_node(csr, g->get_graph_input_node());
+    check_node(csr, g->get_graph_output_node());
+    n_edges += g->get_graph_input_node().get_num_out_edges();
+
+    EXPECT_EQ(csr.get_num_edges(), n_edges);
+  }
+};
+
+TEST_F(Setup_graph_csr, matches_lgraph) {
+  Lbench b("core.GRAPH_CSR_matches_lgraph");
+
+  add_random_edges(2000);
+
+  const auto &csr = g->freeze();
+  EXPECT_TRUE(csr.is_fresh(g->get_edit_epoch()));
+
+  check_all(csr);
+
+  for (const auto &e : csr.out_edges(nodes[3])) {
+    auto xe = csr.get_xedge(g, e);
+    EXPECT_EQ(xe.driver.get_node().get_compact_class(), nodes[3].get_compact_class());
+  }
+}
+
+TEST_F(Setup_graph_csr, invalidate) {
+  Lbench b("core.GRAPH_CSR_invalidate");
+
+  add_random_edges(500);
+
+  const auto *csr = &g->freeze();
+  auto        epoch = g->get_edit_epoch();
+  EXPECT_EQ(&g->freeze(), csr);  // no edits, no rebuild
+  EXPECT_EQ(g->get_edit_epoch(), epoch);
+
+  add_random_edges(100);
+  EXPECT_FALSE(csr->is_fresh(g->get_edit_epoch()));
+  check_all(g->freeze());
+
+  auto edges = nodes[7].inp_edges();
+  for (auto &e : edges) e.del_edge();
+  EXPECT_FALSE(csr->is_fresh(g->get_edit_epoch()));
+  EXPECT_TRUE(g->freeze().inp_edges(nodes[7]).empty());
+
+  nodes[9].del_node();
+  check_all(g->freeze());
+}
+
+TEST_F(Setup_graph_csr, bits) {
+  Lbench b("core.GRAPH_CSR_bits");
+
+  add_random_edges(500);
+
+  for (auto &node : nodes) {
+    node.setup_driver_pin().set_bits(1 + (rint.max(31)));
+  }
+
+  const auto &csr = g->freeze(true);
+  EXPECT_TRUE(csr.has_bits(g->get_bits_epoch()));
+  for (auto &node : nodes) {
+    for (const auto &e : csr.inp_edges(node)) {
+      auto xe = csr.get_xedge(g, e);
+      EXPECT_EQ(csr.get_bits(&e), xe.driver.get_bits());
+    }
+  }
+
+  nodes[0].setup_driver_pin().set_bits(77);
+  EXPECT_FALSE(csr.has_bits(g->get_bits_epoch()));
+  EXPECT_TRUE(csr.is_fresh(g->get_edit_epoch()));  // bits do not change the topology
+
+  const auto &csr2 = g->freeze(true);
+  for (const auto &e : csr2.out_edges(nodes[0])) {
+    EXPECT_EQ(csr2.get_bits(&e), 77);
+  }
+}
@@ -0,0 +1,151 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+
+class Setup_graph_journal : public ::testing::Test {
+protected:
+  LGraph * g;
+  Node_pin a;
+  Node_pin b;
+  Node     sum;
+  Node     and_node;
+
+  void SetUp() override {
+    g = LGraph::create("lgdb_graph_journal", "journal_top", "test");
+    a = g->add_graph_input("a", 1, 8);
+    b = g->add_graph_input("b", 2, 8);
+    g->add_graph_output("z", 3, 8);
+
+    sum = g->create_node(Ntype_op::Sum, 9);
+    a.connect_sink(sum.setup_sink_pin("A"));
+    b.connect_sink(sum.setup_sink_pin("A"));
+
+    and_node = g->create_node(Ntype_op::And, 8);
+    sum.setup_driver_pin().connect_sink(and_node.setup_sink_pin("A"));
+    a.connect_sink(and_node.setup_sink_pin("A"));
+  }
+
+  void TearDown() override { g->disable_journal(); }
+
+  std::vector<Node> get_dirty(uint64_t version) {
+    std::vector<Node> dirty;
+    EXPECT_TRUE(g->get_dirty_nodes(version, dirty));
+    return dirty;
+  }
+
+  static bool has(const std::vector<Node> &nodes, const Node &node) {
+    return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+  }
+};
+
+TEST_F(Setup_graph_journal, disabled) {
+  std::vector<Node> dirty;
+  EXPECT_FALSE(g->get_journal().is_enabled());
+  EXPECT_EQ(g->get_journal_version(), 0);
+  EXPECT_FALSE(g->get_dirty_nodes(0, dirty));
+
+  g->create_node(Ntype_op::Or, 4);
+  EXPECT_EQ(g->get_journal_version(), 0);
+}
+
+TEST_F(Setup_graph_journal, dirty_nodes) {
+  g->enable_journal();
+  auto v0 = g->get_journal_version();
+  EXPECT_GT(v0, 0);
+  EXPECT_TRUE(get_dirty(v0).empty());
+
+  // Bits change
+  and_node.get_driver_pin().set_bits(4);
+  auto v1    = g->get_journal_version();
+  auto dirty = get_dirty(v0);
+  EXPECT_GT(v1, v0);
+  EXPECT_EQ(dirty.size(), 1);
+  EXPECT_TRUE(has(dirty, and_node));
+
+  // New node and edge (both ends)
+  auto xor_node = g->create_node(Ntype_op::Xor, 8);
+  sum.setup_driver_pin().connect_sink(xor_node.setup_sink_pin("A"));
+  dirty = get_dirty(v1);
+  EXPECT_EQ(dirty.size(), 2);
+  EXPECT_TRUE(has(dirty, xor_node));
+  EXPECT_TRUE(has(dirty, sum));
+  EXPECT_FALSE(has(dirty, and_node));
+  EXPECT_EQ(get_dirty(v0).size(), 3);
+
+  // Deleted nodes are gone, their drivers and sinks are dirty
+  auto v2      = g->get_journal_version();
+  auto sum_key = sum.get_compact_class();
+  sum.del_node();
+  dirty = get_dirty(v2);
+  EXPECT_TRUE(has(dirty, xor_node));
+  EXPECT_TRUE(has(dirty, and_node));
+  EXPECT_TRUE(has(dirty, g->get_graph_input_node()));
+  for (const auto &node : dirty) {
+    EXPECT_TRUE(node.get_compact_class() != sum_key);
+  }
+
+  // Nothing since the last version
+  EXPECT_TRUE(get_dirty(g->get_journal_version()).empty());
+
+  // The entries replay the edits in order
+  std::vector<Graph_journal::Op> ops;
+  EXPECT_TRUE(g->get_journal().each(v1, [&ops](const Graph_journal::Entry &e) { ops.emplace_back(e.op); }));
+  ASSERT_GE(ops.size(), 3);
+  EXPECT_EQ(ops[0], Graph_journal::Op::Create_node);
+  EXPECT_EQ(ops[1], Graph_journal::Op::Set_type);
+  EXPECT_NE(std::find(ops.begin(), ops.end(), Graph_journal::Op::Del_node), ops.end());
+  EXPECT_EQ(ops.back(), Graph_journal::Op::Del_edge);
+}
+
+TEST_F(Setup_graph_journal, reset) {
+  g->enable_journal();
+  auto v0 = g->get_journal_version();
+
+  std::vector<Node> dirty;
+  EXPECT_FALSE(g->get_dirty_nodes(0, dirty));
+  EXPECT_FALSE(g->get_dirty_nodes(v0 + 100, dirty));
+
+  // Compact renumbers the nids, older versions can not be answered
+  and_node.del_node();
+  g->compact(LGraph::Compact_order::Keep);
+  EXPECT_FALSE(g->get_dirty_nodes(v0, dirty));
+
+  auto v1 = g->get_journal_version();
+  EXPECT_GT(v1, v0);
+  EXPECT_TRUE(get_dirty(v1).empty());
+
+  g->clear();
+  EXPECT_FALSE(g->get_dirty_nodes(v1, dirty));
+
+  g->disable_journal();
+  EXPECT_EQ(g->get_journal_version(), 0);
+}
+
+TEST_F(Setup_graph_journal, persistence) {
+  auto file = absl::StrCat(g->get_path(), "/lg_", std::to_string(g->get_lgid()), "_journal");
+
+  struct stat sb;
+  EXPECT_NE(stat(file.c_str(), &sb), 0);  // no file until enabled
+
+  g->enable_journal();
+  for (int i = 0; i < 1000; ++i) {
+    g->create_node(Ntype_op::Or, 4);
+  }
+  auto v1 = g->get_journal_version();
+  EXPECT_GT(v1, 3000);
+
+  // The entries live in the mmap file next to the nodes
+  EXPECT_EQ(stat(file.c_str(), &sb), 0);
+  EXPECT_GE(sb.st_size, v1 * sizeof(Graph_journal::Entry));
+
+  g->disable_journal();
+  EXPECT_EQ(g->get_journal_version(), 0);
+}
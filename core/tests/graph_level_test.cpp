@@ -0,0 +1,191 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_level.hpp"
+
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+class Setup_graph_level : public ::testing::Test {
+protected:
+  LGraph *          g;
+  std::vector<Node> nodes;  // combinational, edges only go from lower to higher position
+  std::vector<Node> flops;
+  Lrand<int>        rint;
+
+  void SetUp() override {
+    g = LGraph::create("lgdb_graph_level", "level_test", "test");
+
+    for (int i = 0; i < 4; ++i) {
+      g->add_graph_input(absl::StrCat("i", i), i + 1, 1);
+      g->add_graph_output(absl::StrCat("o", i), 100 + i, 1);
+    }
+
+    nodes.clear();
+    for (int i = 0; i < 300; ++i) {
+      nodes.emplace_back(g->create_node(Ntype_op::Sum));
+    }
+    flops.clear();
+    for (int i = 0; i < 20; ++i) {
+      flops.emplace_back(g->create_node(Ntype_op::Sflop));
+    }
+  }
+
+  void TearDown() override {}
+
+  void add_random_edges(int n) {
+    auto inp_node = g->get_graph_input_node();
+    auto out_node = g->get_graph_output_node();
+
+    for (int i = 0; i < n; ++i) {
+      auto pos  = 1 + rint.max(nodes.size() - 1);
+      auto spin = nodes[pos].setup_sink_pin("A");
+
+      if ((i & 7) == 0) {
+        inp_node.setup_driver_pin_raw(1 + rint.max(4)).connect_sink(spin);
+      } else if ((i & 7) == 1) {
+        flops[rint.max(flops.size())].setup_driver_pin().connect_sink(spin);
+      } else {
+        nodes[rint.max(pos)].setup_driver_pin().connect_sink(spin);
+      }
+
+      if ((i & 15) == 0) {
+        nodes[pos].setup_driver_pin().connect_sink(flops[rint.max(flops.size())].setup_sink_pin("din"));
+      }
+      if ((i & 31) == 0) {
+        nodes[pos].setup_driver_pin().connect_sink(out_node.setup_sink_pin_raw(100 + rint.max(4)));
+      }
+    }
+  }
+
+  void check_levels(const Graph_level &levels) {
+    EXPECT_EQ(levels.get_num_loop_nodes(), 0);
+
+    absl::flat_hash_set<Node::Compact_class> visited;
+
+    size_t n_nodes = 0;
+    for (size_t l = 0; l < levels.get_num_levels(); ++l) {
+      for (auto node : levels.get_level_nodes(l)) {
+        EXPECT_EQ(levels.get_level(node), l);
+        EXPECT_FALSE(node.is_graph_io());
+        visited.insert(node.get_compact_class());
+        ++n_nodes;
+
+        if (node.is_type_loop_breaker()) {
+          EXPECT_EQ(l, 0);
+          continue;
+        }
+
+        uint32_t max_driver = 0;
+        bool     any_driver = false;
+        for (auto &e : node.inp_edges()) {
+          auto dnode = e.driver.get_node();
+          if (dnode.is_graph_io() || dnode.is_type_loop_breaker())
+            continue;
+          // all the combinational drivers are in a previous level
+          EXPECT_TRUE(visited.contains(dnode.get_compact_class()));
+          EXPECT_LT(levels.get_level(dnode), l);
+          max_driver = std::max(max_driver, levels.get_level(dnode));
+          any_driver = true;
+        }
+        if (any_driver)
+          EXPECT_EQ(max_driver + 1, l);  // as early as possible
+        else
+          EXPECT_EQ(l, 0);
+      }
+    }
+
+    EXPECT_EQ(n_nodes, levels.get_num_nodes());
+    EXPECT_EQ(n_nodes, nodes.size() + flops.size());
+
+    size_t n_fwd = 0;
+    for (auto node : g->forward()) {
+      EXPECT_TRUE(visited.contains(node.get_compact_class()));
+      ++n_fwd;
+    }
+    EXPECT_EQ(n_fwd, n_nodes);
+  }
+};
+
+TEST_F(Setup_graph_level, levels) {
+  Lbench b("core.GRAPH_LEVEL_levels");
+
+  add_random_edges(3000);
+
+  const auto &levels = g->get_levelization();
+  EXPECT_TRUE(levels.is_fresh(g->get_edit_epoch()));
+  EXPECT_GT(levels.get_num_levels(), 1);
+
+  check_levels(levels);
+
+  size_t pos = 0;
+  for (auto node : levels.get_order()) {
+    EXPECT_EQ(node, levels.get_order()[pos]);
+    ++pos;
+  }
+  EXPECT_EQ(pos, levels.get_num_nodes());
+
+  // Random access (chunking the order for parallel sweeps)
+  auto order = levels.get_order();
+  auto it    = order.begin();
+  auto half  = it + order.size() / 2;
+  EXPECT_EQ(half - it, static_cast<std::ptrdiff_t>(order.size() / 2));
+  EXPECT_EQ(*half, order[order.size() / 2]);
+  EXPECT_EQ(it[3], order[3]);
+  EXPECT_TRUE(it < half);
+  it += order.size() / 2;
+  EXPECT_EQ(it, half);
+  EXPECT_EQ(order.end() - 1 - order.begin(), static_cast<std::ptrdiff_t>(order.size() - 1));
+}
+
+TEST_F(Setup_graph_level, invalidate) {
+  Lbench b("core.GRAPH_LEVEL_invalidate");
+
+  add_random_edges(500);
+
+  const auto *levels = &g->get_levelization();
+  auto        epoch  = g->get_edit_epoch();
+  EXPECT_EQ(&g->get_levelization(), levels);  // no edits, no rebuild
+  EXPECT_EQ(g->get_edit_epoch(), epoch);
+
+  add_random_edges(200);
+  EXPECT_FALSE(levels->is_fresh(g->get_edit_epoch()));
+  check_levels(g->get_levelization());
+
+  nodes[5].del_node();
+  nodes.erase(nodes.begin() + 5);
+  EXPECT_FALSE(levels->is_fresh(g->get_edit_epoch()));
+  check_levels(g->get_levelization());
+
+  // A flop breaks the path, its sinks move to level 0
+  auto flop = nodes[10];
+  flop.set_type(Ntype_op::Sflop);
+  EXPECT_FALSE(levels->is_fresh(g->get_edit_epoch()));
+  EXPECT_EQ(g->get_levelization().get_level(flop), 0);
+}
+
+TEST_F(Setup_graph_level, comb_loop) {
+  Lbench b("core.GRAPH_LEVEL_comb_loop");
+
+  add_random_edges(300);
+
+  nodes[0].setup_driver_pin().connect_sink(nodes[1].setup_sink_pin("A"));
+  nodes[1].setup_driver_pin().connect_sink(nodes[2].setup_sink_pin("A"));
+  nodes[2].setup_driver_pin().connect_sink(nodes[0].setup_sink_pin("A"));
+
+  const auto &levels = g->get_levelization();
+  EXPECT_GE(levels.get_num_loop_nodes(), 3);
+  EXPECT_EQ(levels.get_num_nodes(), nodes.size() + flops.size());
+
+  auto last = levels.get_num_levels() - 1;
+  EXPECT_EQ(levels.get_level(nodes[0]), last);
+  EXPECT_EQ(levels.get_level(nodes[1]), last);
+  EXPECT_EQ(levels.get_level(nodes[2]), last);
+  EXPECT_EQ(levels.get_level_nodes(last).size(), levels.get_num_loop_nodes());
+}
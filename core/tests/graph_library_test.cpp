@@ -0,0 +1,301 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "graph_library.hpp"
+#include "lbench.hpp"
+#include "lgraph.hpp"
+
+// Private library (not in the global instances) so that it can be reopened
+class Test_library : public Graph_library {
+public:
+  explicit Test_library(std::string_view path) : Graph_library(path) {}
+
+  size_t get_pending() const {
+    size_t n = 0;
+    for (auto p : pins_pending) {
+      if (p)
+        ++n;
+    }
+    return n;
+  }
+  size_t get_blob_size() const { return blob.size(); }
+
+  // A compact_blob that stopped after the rename (positions not updated)
+  void break_compact() {
+    *ref_blob_compacting() = 1;
+    for (size_t id = 1; id < index.size(); ++id) {
+      index.ref(id)->blob_pos = 0;
+    }
+  }
+};
+
+class Setup_graph_library : public ::testing::Test {
+protected:
+  static constexpr int n_subs = 5000;
+
+  void SetUp() override {
+    for (const auto *dir : {"lgdb_graph_library", "lgdb_graph_library_json"}) {
+      unlink(absl::StrCat(dir, "/graph_library_index").c_str());
+      unlink(absl::StrCat(dir, "/graph_library_blob").c_str());
+      unlink(absl::StrCat(dir, "/graph_library.json").c_str());
+    }
+  }
+
+  static std::string sub_name(int i) { return absl::StrCat("glib_sub_", std::to_string(i)); }
+
+  static void populate(Graph_library *lib) {
+    for (int i = 0; i < n_subs; ++i) {
+      auto &sub = lib->setup_sub(sub_name(i), "test.v");
+      sub.add_input_pin("a", 1);
+      sub.add_input_pin(absl::StrCat("b", std::to_string(i)), 2);
+      sub.add_output_pin("z", 3);
+    }
+  }
+
+  static void check_sub(const Graph_library *lib, int i, size_t n_pins = 3) {
+    auto lgid = lib->get_lgid(sub_name(i));
+    ASSERT_NE(lgid, 0);
+    const auto &sub = lib->get_sub(lgid);
+    EXPECT_EQ(sub.get_name(), sub_name(i));
+    EXPECT_EQ(sub.size(), n_pins);
+    EXPECT_TRUE(sub.is_input("a"));
+    EXPECT_TRUE(sub.is_output("z"));
+    EXPECT_EQ(sub.get_graph_pos(absl::StrCat("b", std::to_string(i))), 2);
+    EXPECT_EQ(sub.get_name_from_graph_pos(3), "z");
+  }
+};
+
+TEST_F(Setup_graph_library, reopen_lazy) {
+  auto *lib = new Test_library("lgdb_graph_library");
+  populate(lib);
+  lib->sync();
+  auto lgid = lib->get_lgid(sub_name(7));
+  delete lib;
+
+  {
+    Lbench b("core.GRAPH_LIBRARY_reopen");
+    lib = new Test_library("lgdb_graph_library");
+  }
+
+  // Names and lgids are back, no pin decoded yet
+  EXPECT_EQ(lib->get_pending(), n_subs);
+  EXPECT_EQ(lib->get_lgid(sub_name(7)), lgid);
+  EXPECT_EQ(lib->get_name(lgid), sub_name(7));
+  EXPECT_EQ(lib->get_source(lgid), "test.v");
+  EXPECT_EQ(lib->get_pending(), n_subs);
+
+  check_sub(lib, 7);
+  EXPECT_EQ(lib->get_pending(), n_subs - 1);
+
+  for (int i = 0; i < n_subs; i += 97) {
+    check_sub(lib, i);
+  }
+  delete lib;
+}
+
+TEST_F(Setup_graph_library, dirty_sync) {
+  auto *lib = new Test_library("lgdb_graph_library");
+  populate(lib);
+  lib->sync();
+  auto blob_size = lib->get_blob_size();
+
+  // Nothing changed, nothing written
+  lib->sync();
+  EXPECT_EQ(lib->get_blob_size(), blob_size);
+
+  // Marked dirty but not changed, nothing written either
+  (void)lib->ref_sub(lib->get_lgid(sub_name(2)));
+  lib->sync();
+  EXPECT_EQ(lib->get_blob_size(), blob_size);
+
+  // Only the changed entry is written
+  lib->ref_sub(lib->get_lgid(sub_name(3)))->add_output_pin("y", 4);
+  lib->sync();
+  EXPECT_GT(lib->get_blob_size(), blob_size);
+  EXPECT_LT(lib->get_blob_size(), blob_size + 100);
+
+  // Expunged lgids are free on reopen
+  auto lgid = lib->get_lgid(sub_name(5));
+  lib->expunge(sub_name(5));
+  lib->sync();
+  delete lib;
+
+  lib = new Test_library("lgdb_graph_library");
+  EXPECT_FALSE(lib->has_name(sub_name(5)));
+  EXPECT_TRUE(lib->get_sub(lib->get_lgid(sub_name(3))).is_output("y"));
+  EXPECT_EQ(lib->add_name("glib_new", "test.v"), lgid);  // recycled
+  delete lib;
+}
+
+TEST_F(Setup_graph_library, compact) {
+  auto *lib = new Test_library("lgdb_graph_library");
+  populate(lib);
+  lib->sync();
+  auto blob_size = lib->get_blob_size();
+
+  // Rewriting every entry twice makes most of the blob stale
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < n_subs; ++i) {
+      lib->ref_sub(lib->get_lgid(sub_name(i)))->add_output_pin(absl::StrCat("y", std::to_string(round)), 4 + round);
+    }
+    lib->sync();
+  }
+  EXPECT_LT(lib->get_blob_size(), 2 * blob_size);  // compacted (3 copies without it)
+  EXPECT_NE(access("lgdb_graph_library/graph_library_blob_compact", F_OK), 0);
+  for (int i = 0; i < n_subs; i += 97) {
+    check_sub(lib, i, 5);
+  }
+
+  lib->break_compact();
+  delete lib;
+
+  // The reopen finishes the compaction
+  lib = new Test_library("lgdb_graph_library");
+  for (int i = 0; i < n_subs; i += 97) {
+    check_sub(lib, i, 5);
+    EXPECT_TRUE(lib->get_sub(lib->get_lgid(sub_name(i))).is_output("y1"));
+  }
+  delete lib;
+}
+
+TEST_F(Setup_graph_library, json) {
+  auto *lib = new Test_library("lgdb_graph_library");
+  populate(lib);
+  lib->sync();
+
+  // An old lgdb (JSON only) is converted to the binary index on the next sync
+  mkdir("lgdb_graph_library_json", 0755);
+  lib->export_json("lgdb_graph_library_json/graph_library.json");
+  delete lib;
+
+  lib = new Test_library("lgdb_graph_library_json");
+  EXPECT_EQ(lib->get_pending(), 0);
+  check_sub(lib, 11);
+  lib->sync();
+  delete lib;
+
+  unlink("lgdb_graph_library_json/graph_library.json");
+  lib = new Test_library("lgdb_graph_library_json");
+  EXPECT_EQ(lib->get_pending(), n_subs);
+  for (int i = 0; i < n_subs; i += 101) {
+    check_sub(lib, i);
+  }
+  delete lib;
+}
+
+TEST_F(Setup_graph_library, concurrent) {
+  constexpr int n_threads = 16;
+  constexpr int n_per     = 500;
+
+  auto *lib = new Test_library("lgdb_graph_library");
+
+  auto name = [](int t, int i) { return absl::StrCat("glib_t", std::to_string(t), "_", std::to_string(i)); };
+
+  std::atomic<int>         n_bad(0);
+  std::vector<std::thread> threads;
+  {
+    Lbench b("core.GRAPH_LIBRARY_concurrent");
+    for (int t = 0; t < n_threads; ++t) {
+      threads.emplace_back([lib, t, &name, &n_bad] {
+        for (int i = 0; i < n_per; ++i) {
+          auto &sub = lib->setup_sub(name(t, i), "test.v");
+          sub.add_input_pin("a", 1);
+          sub.add_output_pin("z", 2);
+
+          // Lookups of modules created by other threads
+          auto other = name((t + 1) % n_threads, i / 2);
+          auto lgid  = lib->get_lgid(other);
+          if (lgid && lib->get_name(lgid) != other)
+            n_bad++;
+
+          // Expunged lgids are recycled by any thread
+          if (i % 50 == 49) {
+            lib->expunge(name(t, i - 1));
+            lib->add_name(absl::StrCat(name(t, i - 1), "_r"), "test.v");
+          }
+        }
+      });
+    }
+    for (auto &th : threads) {
+      th.join();
+    }
+  }
+  EXPECT_EQ(n_bad, 0);
+
+  absl::flat_hash_set<uint32_t> lgids;
+  for (int t = 0; t < n_threads; ++t) {
+    for (int i = 0; i < n_per; ++i) {
+      if (i % 50 == 48) {
+        EXPECT_FALSE(lib->has_name(name(t, i)));
+        EXPECT_TRUE(lib->has_name(absl::StrCat(name(t, i), "_r")));
+        continue;
+      }
+      auto lgid = lib->get_lgid(name(t, i));
+      ASSERT_NE(lgid, 0);
+      EXPECT_EQ(lib->get_name(lgid), name(t, i));
+      EXPECT_EQ(lib->get_sub(lgid).size(), 2);
+      EXPECT_TRUE(lgids.insert(lgid.value).second);
+    }
+  }
+
+  lib->sync();
+  delete lib;
+
+  lib = new Test_library("lgdb_graph_library");
+  EXPECT_EQ(lib->get_sub(lib->get_lgid(name(3, 7))).get_graph_pos("z"), 2);
+  delete lib;
+}
+
+TEST_F(Setup_graph_library, concurrent_open) {
+  constexpr int n_threads = 8;
+  constexpr int n_lgs     = 40;
+
+  auto name = [](int i) { return absl::StrCat("glib_lg_", std::to_string(i)); };
+
+  // Every thread creates or opens every graph: only one LGraph per name
+  std::vector<std::atomic<LGraph *>> lgs(n_lgs);
+  for (auto &lg : lgs) lg = nullptr;
+
+  std::atomic<int>         n_bad(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t) {
+    threads.emplace_back([t, &name, &lgs, &n_bad] {
+      for (int j = 0; j < n_lgs; ++j) {
+        auto i = (j + t) % n_lgs;
+
+        LGraph *lg = nullptr;
+        if (t & 1)
+          lg = LGraph::open("lgdb_graph_library", name(i));
+        if (lg == nullptr)
+          lg = LGraph::create("lgdb_graph_library", name(i), "test.v");
+
+        LGraph *expected = nullptr;
+        if (!lgs[i].compare_exchange_strong(expected, lg) && expected != lg)
+          n_bad++;
+
+        if (LGraph::open("lgdb_graph_library", lg->get_lgid()) != lg)
+          n_bad++;
+      }
+    });
+  }
+  for (auto &th : threads) {
+    th.join();
+  }
+  EXPECT_EQ(n_bad, 0);
+
+  for (int i = 0; i < n_lgs; ++i) {
+    EXPECT_EQ(LGraph::open("lgdb_graph_library", name(i)), lgs[i].load());
+    EXPECT_EQ(lgs[i].load()->get_name(), name(i));
+  }
+}
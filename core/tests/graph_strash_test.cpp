@@ -0,0 +1,152 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+class Setup_graph_strash : public ::testing::Test {
+protected:
+  LGraph * g;
+  Node_pin a;
+  Node_pin b;
+  Node_pin c;
+
+  void SetUp() override {
+    g = LGraph::create("lgdb_graph_strash", "strash_top", "test");
+    a = g->add_graph_input("a", 1, 8);
+    b = g->add_graph_input("b", 2, 8);
+    c = g->add_graph_input("c", 3, 8);
+    g->add_graph_output("z", 4, 8);
+  }
+
+  size_t num_nodes() const {
+    size_t n = 0;
+    for (auto node : g->fast()) {
+      (void)node;
+      ++n;
+    }
+    return n;
+  }
+};
+
+TEST_F(Setup_graph_strash, find_or_create) {
+  auto sum = g->find_or_create(Ntype_op::Sum, {{0, a}, {0, b}}, 9);
+  EXPECT_EQ(sum.get_type_op(), Ntype_op::Sum);
+  EXPECT_EQ(sum.get_num_inp_edges(), 2);
+  EXPECT_EQ(sum.get_driver_pin().get_bits(), 9);
+
+  // Same structure (any driver order)
+  EXPECT_EQ(g->find_or_create(Ntype_op::Sum, {{0, a}, {0, b}}, 9), sum);
+  EXPECT_EQ(g->find_or_create(Ntype_op::Sum, {{0, b}, {0, a}}, 9), sum);
+
+  // Different pid, bits, op or drivers
+  EXPECT_NE(g->find_or_create(Ntype_op::Sum, {{0, a}, {1, b}}, 9), sum);
+  EXPECT_NE(g->find_or_create(Ntype_op::Sum, {{0, a}, {0, b}}, 10), sum);
+  EXPECT_NE(g->find_or_create(Ntype_op::Or, {{0, a}, {0, b}}, 9), sum);
+  EXPECT_NE(g->find_or_create(Ntype_op::Sum, {{0, a}, {0, c}}, 9), sum);
+
+  // Chained on a strashed node
+  auto lt = g->find_or_create(Ntype_op::LT, {{0, sum.get_driver_pin()}, {1, c}}, 1);
+  EXPECT_EQ(g->find_or_create(Ntype_op::LT, {{1, c}, {0, sum.get_driver_pin()}}, 1), lt);
+
+  EXPECT_EQ(num_nodes(), 6);
+}
+
+TEST_F(Setup_graph_strash, existing_nodes) {
+  // Created before the first find_or_create, it is indexed too
+  auto node = g->create_node(Ntype_op::And, 8);
+  a.connect_sink(node.setup_sink_pin("A"));
+  b.connect_sink(node.setup_sink_pin("A"));
+
+  EXPECT_EQ(g->find_or_create(Ntype_op::And, {{0, a}, {0, b}}, 8), node);
+
+  // Edits after the index is built are tracked
+  auto node2 = g->create_node(Ntype_op::And, 8);
+  a.connect_sink(node2.setup_sink_pin("A"));
+  c.connect_sink(node2.setup_sink_pin("A"));
+  EXPECT_EQ(g->find_or_create(Ntype_op::And, {{0, c}, {0, a}}, 8), node2);
+
+  // Not the same structure after an edge delete
+  auto spin = node2.get_sink_pin("A");
+  c.del_sink(spin);
+  auto node3 = g->find_or_create(Ntype_op::And, {{0, c}, {0, a}}, 8);
+  EXPECT_NE(node3, node2);
+  EXPECT_EQ(g->find_or_create(Ntype_op::And, {{0, c}, {0, a}}, 8), node3);
+
+  // Deleted nodes are not found
+  node3.del_node();
+  auto node4 = g->find_or_create(Ntype_op::And, {{0, c}, {0, a}}, 8);
+  EXPECT_FALSE(node4.is_invalid());
+  EXPECT_EQ(node4.get_num_inp_edges(), 2);
+}
+
+TEST_F(Setup_graph_strash, constants) {
+  auto k5 = g->find_or_create(Lconst(5));
+  EXPECT_TRUE(k5.is_type_const());
+
+  // More constants than the memoize_const_hint entries
+  for (int i = 0; i < 100; ++i) {
+    g->create_node_const(Lconst(100 + i));
+  }
+  auto n = num_nodes();
+
+  EXPECT_EQ(g->create_node_const(Lconst(5)), k5);
+  EXPECT_EQ(g->find_or_create(Lconst(5)), k5);
+  for (int i = 0; i < 100; ++i) {
+    g->create_node_const(Lconst(100 + i));
+  }
+  EXPECT_EQ(num_nodes(), n);
+
+  EXPECT_NE(g->find_or_create(Lconst(6)), k5);
+}
+
+TEST_F(Setup_graph_strash, dedup) {
+  // Random expression trees with many repeated sub-expressions (like an
+  // unrolled elaboration)
+  Lrand<int> rint;
+
+  std::vector<Node_pin> leaves{a, b, c};
+  for (int i = 0; i < 8; ++i) {
+    leaves.emplace_back(g->find_or_create(Lconst(i)).setup_driver_pin());
+  }
+
+  auto build = [&](bool strash) {
+    std::vector<Node_pin> pins(leaves);
+    for (int i = 0; i < 20000; ++i) {
+      auto op = rint.max(2) ? Ntype_op::Sum : Ntype_op::And;
+      auto p0 = pins[rint.max(pins.size() < 64 ? pins.size() : 64)];
+      auto p1 = pins[rint.max(pins.size() < 64 ? pins.size() : 64)];
+      Node node;
+      if (strash) {
+        node = g->find_or_create(op, {{0, p0}, {0, p1}}, 8);
+      } else {
+        node = g->create_node(op, 8);
+        p0.connect_sink(node.setup_sink_pin_raw(0));
+        p1.connect_sink(node.setup_sink_pin_raw(0));
+      }
+      pins.emplace_back(node.setup_driver_pin());
+    }
+  };
+
+  auto n = num_nodes();
+  {
+    Lbench bench("core.GRAPH_STRASH_create");
+    build(false);
+  }
+  auto n_create = num_nodes() - n;
+
+  n = num_nodes();
+  {
+    Lbench bench("core.GRAPH_STRASH_find_or_create");
+    build(true);
+  }
+  auto n_strash = num_nodes() - n;
+
+  EXPECT_EQ(n_create, 20000);
+  EXPECT_LT(n_strash, n_create);
+}
@@ -0,0 +1,192 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+
+class Setup_hierarchy_lazy : public ::testing::Test {
+protected:
+  static constexpr int n_mid  = 200;
+  static constexpr int n_leaf = 50;
+
+  LGraph *top;
+  LGraph *mid;
+  LGraph *leaf;
+
+  void SetUp() override {
+    top  = LGraph::create("lgdb_hierarchy_lazy", "hlazy_top", "test");
+    mid  = LGraph::create("lgdb_hierarchy_lazy", "hlazy_mid", "test");
+    leaf = LGraph::create("lgdb_hierarchy_lazy", "hlazy_leaf", "test");
+
+    leaf->create_node(Ntype_op::And, 1);
+    for (int i = 0; i < n_leaf; ++i) {
+      mid->create_node_sub(leaf->get_lgid());
+    }
+    for (int i = 0; i < n_mid; ++i) {
+      top->create_node_sub(mid->get_lgid());
+    }
+  }
+
+  static size_t count_tree(Hierarchy_tree &htree) {
+    size_t n = 0;
+    for (const auto &hidx : htree.depth_preorder()) {
+      (void)hidx;
+      ++n;
+    }
+    return n;
+  }
+
+  static size_t count_children(Hierarchy_tree &htree, const Hierarchy_index &hidx) {
+    size_t n = 0;
+    for (const auto &child : htree.children(hidx)) {
+      (void)child;
+      ++n;
+    }
+    return n;
+  }
+
+  Node first_sub(LGraph *lg) {
+    for (auto node : lg->fast()) {
+      if (node.is_type_sub())
+        return Node(top, Hierarchy_tree::root_index(), node.get_compact_class());
+    }
+    return Node();
+  }
+};
+
+TEST_F(Setup_hierarchy_lazy, lazy_expand) {
+  top->regenerate_htree();
+  auto &htree = top->get_htree();
+
+  // Only the root until something goes down
+  EXPECT_EQ(htree.get_tree_width(1), 0);
+
+  auto node = first_sub(top);
+  auto hidx = node.hierarchy_go_down();
+  EXPECT_EQ(htree.get_data(hidx).lgid, mid->get_lgid());
+  EXPECT_EQ(htree.get_data(hidx).up_nid, node.get_compact_class().get_nid());
+  EXPECT_GE(htree.get_tree_width(1), n_mid);
+  EXPECT_EQ(htree.get_tree_width(2), 0);  // the mid instances are not expanded
+
+  EXPECT_EQ(count_children(htree, hidx), n_leaf);
+  EXPECT_GE(htree.get_tree_width(2), n_leaf);
+  EXPECT_LT(htree.get_tree_width(2), 2 * n_leaf);
+
+  {
+    Lbench b("core.HIERARCHY_LAZY_expand_all");
+    EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+  }
+}
+
+TEST_F(Setup_hierarchy_lazy, incremental) {
+  top->regenerate_htree();
+  auto &htree = top->get_htree();
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+
+  // A new leaf instance in mid patches all the mid instances
+  auto extra = mid->create_node_sub(leaf->get_lgid());
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * (n_leaf + 1));
+
+  // The hierarchical traversal sees it too
+  size_t n_and = 0;
+  for (auto node : top->fast(true)) {
+    if (node.get_type_op() == Ntype_op::And)
+      ++n_and;
+  }
+  EXPECT_EQ(n_and, n_mid * (n_leaf + 1));
+
+  extra.del_node();
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+
+  // A leaf edit without Sub changes does not touch the tree
+  leaf->create_node(Ntype_op::Or, 1);
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+}
+
+TEST_F(Setup_hierarchy_lazy, concurrent_sub_change) {
+  top->regenerate_htree();
+  auto &htree = top->get_htree();
+
+  // Sub changes in other graphs only queue a collapse in this tree, the
+  // traversal applies it on its next expand
+  auto *other = LGraph::create("lgdb_hierarchy_lazy", "hlazy_other", "test");
+  std::thread t([other, this] {
+    for (int i = 0; i < 200; ++i) {
+      other->create_node_sub(leaf->get_lgid());
+    }
+  });
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+  }
+  t.join();
+
+  // A queued change of mid collapses its instances on the next traversal
+  mid->create_node_sub(leaf->get_lgid());
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * (n_leaf + 1));
+}
+
+TEST_F(Setup_hierarchy_lazy, persistence) {
+  top->regenerate_htree();
+  EXPECT_EQ(count_tree(top->get_htree()), 1 + n_mid + n_mid * n_leaf);
+
+  auto top_lgid = top->get_lgid();
+  auto mid_lgid = mid->get_lgid();
+
+  // Reopen: the expanded tree is loaded back, no expansion needed
+  delete top;
+  top = LGraph::open("lgdb_hierarchy_lazy", top_lgid);
+  ASSERT_NE(top, nullptr);
+  {
+    Lbench b("core.HIERARCHY_LAZY_load");
+    auto  &htree = top->get_htree();
+    EXPECT_GE(htree.get_tree_width(2), n_mid * n_leaf);
+    EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+  }
+
+  // A graph changed while the tree was saved is expanded again
+  delete top;
+  mid->create_node_sub(leaf->get_lgid());
+  top = LGraph::open("lgdb_hierarchy_lazy", top_lgid);
+  EXPECT_EQ(count_tree(top->get_htree()), 1 + n_mid + n_mid * (n_leaf + 1));
+
+  auto hidx = first_sub(top).hierarchy_go_down();
+  EXPECT_EQ(top->get_htree().get_data(hidx).lgid, mid_lgid);
+  EXPECT_EQ(count_children(top->get_htree(), hidx), n_leaf + 1);
+}
+
+TEST_F(Setup_hierarchy_lazy, stable_slots) {
+  top->regenerate_htree();
+  auto &htree = top->get_htree();
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+
+  auto node  = first_sub(top);
+  auto hidx  = node.hierarchy_go_down();
+  auto first = htree.get_first_child(hidx);
+  auto width = htree.get_tree_width(2);
+
+  // Adding and deleting Sub nodes reuses the collapsed slots: the tree does
+  // not grow, and the surviving instances keep their index
+  for (int i = 0; i < 20; ++i) {
+    auto extra = mid->create_node_sub(leaf->get_lgid());
+    EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * (n_leaf + 1));
+    extra.del_node();
+    EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * n_leaf);
+  }
+  EXPECT_EQ(htree.get_tree_width(2), width);
+  EXPECT_EQ(node.hierarchy_go_down(), hidx);
+  EXPECT_EQ(htree.get_first_child(hidx), first);
+
+  // Outgrown blocks move, the old slots are freed (invalid) or reused
+  for (int i = 0; i < n_leaf; ++i) {
+    mid->create_node_sub(leaf->get_lgid());
+  }
+  EXPECT_EQ(count_tree(htree), 1 + n_mid + n_mid * 2 * n_leaf);
+  EXPECT_LE(htree.get_tree_width(2), width + 3 * n_mid * 2 * n_leaf);
+  EXPECT_EQ(count_children(htree, hidx), 2 * n_leaf);
+  EXPECT_NE(htree.get_first_child(hidx), first);
+}
@@ -0,0 +1,201 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+class Setup_hyper_edge : public ::testing::Test {
+protected:
+  static constexpr int n_flops = 100000;
+
+  LGraph *          g;
+  std::vector<Node> flops;
+  Lrand<int>        rint;
+
+  void SetUp() override {
+    g = LGraph::create("lgdb_hyper_edge", "hyper_top", "test");
+    g->add_graph_input("clk", 1, 1);
+    g->add_graph_input("rst", 2, 1);
+    g->add_graph_input("d", 3, 8);
+    g->add_graph_output("q", 4, 8);
+
+    auto clk = g->get_graph_input("clk");
+    auto rst = g->get_graph_input("rst");
+    auto d   = g->get_graph_input("d");
+
+    Lbench b("core.HYPER_EDGE_create");
+
+    flops.clear();
+    for (int i = 0; i < n_flops; ++i) {
+      auto flop = g->create_node(Ntype_op::Sflop, 8);
+      clk.connect_sink(flop.setup_sink_pin("clock"));
+      rst.connect_sink(flop.setup_sink_pin("reset"));
+      d.connect_sink(flop.setup_sink_pin("din"));
+      flops.emplace_back(flop);
+    }
+  }
+
+  static size_t count_range(const Node_pin &dpin) {
+    size_t n = 0;
+    for (auto e : dpin.out_edges_range()) {
+      EXPECT_EQ(e.driver, dpin);
+      ++n;
+    }
+    return n;
+  }
+
+  void check_fanout(int n) {
+    for (auto name : {"clk", "rst", "d"}) {
+      auto dpin = g->get_graph_input(name);
+      EXPECT_EQ(dpin.get_num_edges(), n);
+      EXPECT_EQ(dpin.out_edges().size(), n);
+      EXPECT_EQ(count_range(dpin), n);
+    }
+
+    auto inp = g->get_graph_input_node();
+    EXPECT_EQ(inp.get_num_out_edges(), 3 * n);
+    EXPECT_EQ(inp.out_edges().size(), 3 * n);
+    EXPECT_EQ(inp.out_connected_pins().size(), n ? 3 : 0);
+
+    size_t n_range = 0;
+    for (auto e : inp.out_edges_range()) {
+      (void)e;
+      ++n_range;
+    }
+    EXPECT_EQ(n_range, 3 * n);
+
+    const auto &csr = g->freeze();
+    EXPECT_EQ(csr.out_edges(inp).size(), 3 * n);
+  }
+};
+
+TEST_F(Setup_hyper_edge, fanout) {
+  check_fanout(n_flops);
+
+  // Every flop clock/reset/din still sees its driver
+  for (auto &flop : flops) {
+    EXPECT_EQ(flop.get_num_inp_edges(), 3);
+    for (auto &e : flop.inp_edges()) {
+      EXPECT_TRUE(e.driver.get_node().is_graph_input());
+      if (e.sink.get_pid() == 2) {
+        EXPECT_EQ(e.driver, g->get_graph_input("clk"));
+      }
+    }
+  }
+
+  // The sinks of a hyper edge are the flops (no duplicates)
+  std::vector<bool> seen(g->size(), false);
+  for (auto &e : g->get_graph_input("clk").out_edges()) {
+    auto nid = e.sink.get_node().get_compact_class().get_nid();
+    EXPECT_FALSE(seen[nid]);
+    seen[nid] = true;
+    EXPECT_EQ(e.sink.get_pid(), 2);
+  }
+}
+
+TEST_F(Setup_hyper_edge, del) {
+  // Delete a third of the flops (O(1) swap-remove in the clk/rst/din nets)
+  std::vector<Node> alive;
+  {
+    Lbench b("core.HYPER_EDGE_del_node");
+    for (size_t i = 0; i < flops.size(); ++i) {
+      if ((i % 3) == 0)
+        flops[i].del_node();
+      else
+        alive.emplace_back(flops[i]);
+    }
+  }
+  flops.swap(alive);
+  check_fanout(flops.size());
+
+  // Disconnect the clock from some flops
+  auto clk   = g->get_graph_input("clk");
+  int  n_del = 0;
+  {
+    Lbench b("core.HYPER_EDGE_del_edge");
+    for (size_t i = 0; i < flops.size(); i += 7) {
+      auto spin = flops[i].get_sink_pin("clock");
+      EXPECT_TRUE(clk.del_sink(spin));
+      EXPECT_FALSE(clk.del_sink(spin));
+      EXPECT_FALSE(spin.is_connected());
+      ++n_del;
+    }
+  }
+  EXPECT_EQ(clk.get_num_edges(), flops.size() - n_del);
+  EXPECT_EQ(count_range(clk), flops.size() - n_del);
+
+  // New sinks go straight to the hyper edge
+  auto flop = g->create_node(Ntype_op::Sflop, 8);
+  clk.connect_sink(flop.setup_sink_pin("clock"));
+  EXPECT_EQ(clk.get_num_edges(), flops.size() - n_del + 1);
+  EXPECT_EQ(flop.get_sink_pin("clock").inp_edges().size(), 1);
+}
+
+TEST_F(Setup_hyper_edge, del_driver) {
+  // A combinational high fan-out driver (not a graph input)
+  auto en = g->create_node(Ntype_op::Or, 1);
+  g->get_graph_input("rst").connect_sink(en.setup_sink_pin("A"));
+  auto en_dpin = en.setup_driver_pin();
+  for (int i = 0; i < 1000; ++i) {
+    en_dpin.connect_sink(flops[i].setup_sink_pin("enable"));
+  }
+  EXPECT_EQ(en_dpin.get_num_edges(), 1000);
+  EXPECT_EQ(en.get_num_out_edges(), 1000);
+
+  en.del_node();
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(flops[i].get_num_inp_edges(), 3);
+  }
+  check_fanout(n_flops);
+}
+
+TEST_F(Setup_hyper_edge, compact) {
+  for (size_t i = 0; i < flops.size(); i += 2) {
+    flops[i].del_node();
+  }
+  check_fanout(n_flops / 2);
+
+  g->compact(LGraph::Compact_order::Keep);
+  check_fanout(n_flops / 2);
+
+  g->clear();
+  EXPECT_EQ(g->get_graph_input_node().get_num_out_edges(), 0);
+}
+
+TEST_F(Setup_hyper_edge, shared_blocks) {
+  // Interleaved high fan-out drivers: their blocks grow and move in the
+  // shared sinks vector, and a deleted driver leaves its block for reuse
+  std::vector<Node_pin> en_dpins;
+  for (int j = 0; j < 4; ++j) {
+    auto en = g->create_node(Ntype_op::Or, 1);
+    en_dpins.emplace_back(en.setup_driver_pin());
+  }
+  for (int i = 0; i < 5000; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      if (j == 0 || (i % j) == 0)
+        en_dpins[j].connect_sink(flops[i].setup_sink_pin(j == 0 ? "enable" : "din"));
+    }
+  }
+  EXPECT_EQ(en_dpins[0].get_num_edges(), 5000);
+  EXPECT_EQ(count_range(en_dpins[0]), 5000);
+  for (int j = 1; j < 4; ++j) {
+    EXPECT_EQ(en_dpins[j].get_num_edges(), (5000 + j - 1) / j);
+    EXPECT_EQ(count_range(en_dpins[j]), (5000 + j - 1) / j);
+  }
+
+  en_dpins[1].get_node().del_node();
+  auto en = g->create_node(Ntype_op::Or, 1);
+  auto en_dpin = en.setup_driver_pin();
+  for (int i = 5000; i < 8000; ++i) {
+    en_dpin.connect_sink(flops[i].setup_sink_pin("enable"));
+  }
+  EXPECT_EQ(en_dpin.get_num_edges(), 3000);
+  EXPECT_EQ(en_dpins[0].get_num_edges(), 5000);
+  EXPECT_EQ(en_dpins[3].get_num_edges(), (5000 + 2) / 3);
+  check_fanout(n_flops);
+}
@@ -0,0 +1,208 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "lgraph_builder.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+class Setup_lgraph_builder : public ::testing::Test {
+protected:
+  struct Edge_spec {
+    int     driver;
+    Port_ID driver_pid;
+    int     sink;
+    Port_ID sink_pid;
+  };
+
+  // -1 graph input node, -2 graph output node
+  std::vector<Ntype_op>  ops;
+  std::vector<Edge_spec> specs;
+
+  using Edge_key = std::tuple<int, Port_ID, int, Port_ID>;
+
+  void SetUp() override {
+    Lrand<int> rint;
+
+    ops.clear();
+    for (int i = 0; i < 20000; ++i) {
+      int r = rint.max(10);
+      if (r == 0)
+        ops.emplace_back(Ntype_op::Sflop);
+      else if (r < 4)
+        ops.emplace_back(Ntype_op::Mux);
+      else
+        ops.emplace_back(Ntype_op::Sum);
+    }
+
+    specs.clear();
+    for (int i = 0; i < 60000; ++i) {
+      int sink = rint.max(ops.size());
+
+      Port_ID spid;
+      if (ops[sink] == Ntype_op::Mux)
+        spid = 1 + rint.max(3);
+      else if (ops[sink] == Ntype_op::Sflop)
+        spid = Ntype::get_sink_pid(Ntype_op::Sflop, "din");
+      else
+        spid = rint.max(2);
+
+      if ((i & 31) == 0)
+        specs.emplace_back(Edge_spec{-1, static_cast<Port_ID>(1 + rint.max(4)), sink, spid});
+      else
+        specs.emplace_back(Edge_spec{static_cast<int>(rint.max(ops.size())), 0, sink, spid});
+
+      if ((i & 63) == 0)
+        specs.emplace_back(Edge_spec{sink, 0, -2, static_cast<Port_ID>(10 + rint.max(4))});
+    }
+  }
+
+  LGraph *create_graph(std::string_view name) {
+    auto *lg = LGraph::create("lgdb_lgraph_builder", name, "test");
+    for (int i = 0; i < 4; ++i) {
+      lg->add_graph_input(absl::StrCat("i", i), 1 + i, 1);
+      lg->add_graph_output(absl::StrCat("o", i), 10 + i, 1);
+    }
+    return lg;
+  }
+
+  static int get_id(const absl::flat_hash_map<uint32_t, int> &nid2id, const Node &node) {
+    if (node.is_graph_input())
+      return -1;
+    if (node.is_graph_output())
+      return -2;
+    auto it = nid2id.find(node.get_compact_class().get_nid());
+    EXPECT_NE(it, nid2id.end());
+    return it->second;
+  }
+
+  std::vector<Edge_key> collect_edges(LGraph *lg, const std::vector<Node> &id2node) {
+    absl::flat_hash_map<uint32_t, int> nid2id;
+    for (size_t i = 0; i < id2node.size(); ++i) {
+      nid2id[id2node[i].get_compact_class().get_nid()] = i;
+    }
+
+    std::vector<Edge_key> v;
+    auto                  add = [&](const Node &node) {
+      for (auto &e : node.out_edges()) {
+        v.emplace_back(get_id(nid2id, e.driver.get_node()), e.driver.get_pid(), get_id(nid2id, e.sink.get_node()), e.sink.get_pid());
+      }
+    };
+    for (auto node : lg->fast()) add(node);
+    add(lg->get_graph_input_node());
+
+    std::sort(v.begin(), v.end());
+    return v;
+  }
+};
+
+TEST_F(Setup_lgraph_builder, same_as_incremental) {
+  std::vector<Node> inc_nodes;
+  auto *            inc_lg = create_graph("inc");
+  {
+    Lbench b("core.LGRAPH_BUILDER_incremental");
+
+    for (auto op : ops) {
+      inc_nodes.emplace_back(inc_lg->create_node(op));
+    }
+    auto get = [&](int id) {
+      if (id == -1)
+        return inc_lg->get_graph_input_node();
+      if (id == -2)
+        return inc_lg->get_graph_output_node();
+      return inc_nodes[id];
+    };
+    for (const auto &s : specs) {
+      inc_lg->add_edge(get(s.driver).setup_driver_pin_raw(s.driver_pid), get(s.sink).setup_sink_pin_raw(s.sink_pid));
+    }
+  }
+
+  std::vector<Node> bld_nodes;
+  auto *            bld_lg = create_graph("bld");
+  {
+    Lbench b("core.LGRAPH_BUILDER_builder");
+
+    LGraph_builder builder(bld_lg);
+    builder.reserve(ops.size() + 2, specs.size());
+
+    std::vector<LGraph_builder::Handle> handles;
+    for (auto op : ops) {
+      handles.emplace_back(builder.add_node(op));
+    }
+    auto inp = builder.add_node(bld_lg->get_graph_input_node());
+    auto out = builder.add_node(bld_lg->get_graph_output_node());
+    auto get = [&](int id) {
+      if (id == -1)
+        return inp;
+      if (id == -2)
+        return out;
+      return handles[id];
+    };
+    for (const auto &s : specs) {
+      builder.add_edge(get(s.driver), s.driver_pid, get(s.sink), s.sink_pid);
+    }
+
+    builder.commit();
+
+    for (auto h : handles) {
+      bld_nodes.emplace_back(builder.get_node(h));
+    }
+  }
+
+  ASSERT_EQ(bld_nodes.size(), inc_nodes.size());
+  for (size_t i = 0; i < ops.size(); ++i) {
+    EXPECT_EQ(bld_nodes[i].get_type_op(), ops[i]);
+  }
+
+  EXPECT_EQ(collect_edges(bld_lg, bld_nodes), collect_edges(inc_lg, inc_nodes));
+  // Placement in one pass: no chain splits, the edges fill the entries placed with the pins
+  EXPECT_LE(bld_lg->size(), inc_lg->size());
+}
+
+TEST_F(Setup_lgraph_builder, const_sub_bits) {
+  auto *lg  = create_graph("bld_const");
+  auto *sub = LGraph::create("lgdb_lgraph_builder", "bld_sub", "test");
+  sub->add_graph_input("a", 1, 4);
+  sub->add_graph_output("z", 2, 4);
+
+  LGraph_builder builder(lg);
+
+  auto c   = builder.add_node_const(Lconst(7));
+  auto s   = builder.add_node_sub(sub->get_lgid());
+  auto sum = builder.add_node(Ntype_op::Sum);
+  auto out = builder.add_node(lg->get_graph_output_node());
+
+  auto a_pid = lg->ref_library()->get_sub(sub->get_lgid()).get_instance_pid("a");
+  auto z_pid = lg->ref_library()->get_sub(sub->get_lgid()).get_instance_pid("z");
+
+  builder.add_edge(c, 0, s, a_pid, 3);
+  builder.add_edge(s, z_pid, sum, 0, 4);
+  builder.add_edge(sum, 0, out, 10);
+
+  builder.commit();
+
+  auto c_node   = builder.get_node(c);
+  auto s_node   = builder.get_node(s);
+  auto sum_node = builder.get_node(sum);
+
+  EXPECT_TRUE(c_node.is_type_const());
+  EXPECT_EQ(c_node.get_type_const(), Lconst(7));
+  EXPECT_EQ(c_node.get_driver_pin().get_bits(), 3);
+
+  EXPECT_TRUE(s_node.is_type_sub());
+  EXPECT_EQ(s_node.get_type_sub(), sub->get_lgid());
+  EXPECT_EQ(s_node.setup_driver_pin("z").get_bits(), 4);
+
+  ASSERT_EQ(sum_node.inp_edges().size(), 1);
+  EXPECT_EQ(sum_node.inp_edges()[0].driver.get_node(), s_node);
+  ASSERT_EQ(sum_node.out_edges().size(), 1);
+  EXPECT_TRUE(sum_node.out_edges()[0].sink.get_node().is_graph_output());
+}
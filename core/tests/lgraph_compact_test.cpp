@@ -0,0 +1,273 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ann_place.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+class Setup_lgraph_compact : public ::testing::Test {
+protected:
+  LGraph *          top;
+  LGraph *          sub;
+  std::vector<Node> nodes;
+  Lrand<int>        rint;
+
+  using Edge_key = std::tuple<std::string, Port_ID, std::string, Port_ID, uint32_t>;
+  using Node_key = std::tuple<std::string, int, std::string>;
+
+  void SetUp() override {
+    sub = LGraph::create("lgdb_lgraph_compact", "compact_sub", "test");
+    sub->add_graph_input("a", 1, 4);
+    sub->add_graph_output("z", 2, 4);
+
+    top = LGraph::create("lgdb_lgraph_compact", "compact_top", "test");
+    for (int i = 0; i < 4; ++i) {
+      top->add_graph_input(absl::StrCat("i", i), 1 + i, 1 + i);
+      top->add_graph_output(absl::StrCat("o", i), 10 + i, 1 + i);
+    }
+
+    nodes.clear();
+    for (int i = 0; i < 3000; ++i) {
+      Node node;
+      int  r = rint.max(20);
+      if (r == 0)
+        node = top->create_node_const(Lconst(i));
+      else if (r == 1)
+        node = top->create_node_sub(sub->get_lgid());
+      else if (r < 4)
+        node = top->create_node(Ntype_op::Sflop);
+      else
+        node = top->create_node(Ntype_op::Sum);
+
+      node.set_name(absl::StrCat("n", i));
+      nodes.emplace_back(node);
+    }
+
+    auto get_dpin = [this](Node &node) {
+      if (node.is_type_sub())
+        return node.setup_driver_pin("z");
+      return node.setup_driver_pin();
+    };
+    auto get_spin = [this](Node &node) {
+      if (node.is_type_sub())
+        return node.setup_sink_pin("a");
+      if (node.is_type_flop())
+        return node.setup_sink_pin("din");
+      return node.setup_sink_pin_raw(rint.max(2));
+    };
+
+    for (int i = 0; i < 9000; ++i) {
+      auto &sink = nodes[rint.max(nodes.size())];
+      if (sink.is_type_const())
+        continue;
+
+      if ((i & 31) == 0) {
+        top->get_graph_input(absl::StrCat("i", rint.max(4))).connect_sink(get_spin(sink));
+      } else {
+        auto dpin = get_dpin(nodes[rint.max(nodes.size())]);
+        dpin.connect_sink(get_spin(sink));
+        if ((i & 7) == 0) {
+          dpin.set_bits(1 + rint.max(16));
+          dpin.set_name(absl::StrCat("p", i));
+        }
+      }
+      if ((i & 63) == 0)
+        get_dpin(sink).connect_sink(top->get_graph_output(absl::StrCat("o", rint.max(4))));
+    }
+
+    // Delete half the nodes (cprop/firmap like)
+    std::vector<Node> alive;
+    for (auto &node : nodes) {
+      if (rint.max(2) == 0)
+        node.del_node();
+      else
+        alive.emplace_back(node);
+    }
+    nodes.swap(alive);
+  }
+
+  static std::string node_name(const Node &node) {
+    if (node.is_graph_input())
+      return "graph_input";
+    if (node.is_graph_output())
+      return "graph_output";
+    return std::string(node.get_name());
+  }
+
+  std::vector<Edge_key> collect_edges() {
+    std::vector<Edge_key> v;
+    auto                  add = [&v](const Node &node) {
+      for (auto &e : node.out_edges()) {
+        v.emplace_back(node_name(e.driver.get_node()),
+                       e.driver.get_pid(),
+                       node_name(e.sink.get_node()),
+                       e.sink.get_pid(),
+                       e.driver.get_bits());
+      }
+    };
+    for (auto node : top->fast()) add(node);
+    add(top->get_graph_input_node());
+    add(top->get_graph_output_node());
+
+    std::sort(v.begin(), v.end());
+    return v;
+  }
+
+  std::vector<Node_key> collect_nodes() {
+    std::vector<Node_key> v;
+    for (auto node : top->fast()) {
+      std::string extra;
+      if (node.is_type_const())
+        extra = node.get_type_const().to_pyrope();
+      else if (node.is_type_sub())
+        extra = std::to_string(node.get_type_sub());
+      for (auto &dpin : node.out_connected_pins()) {
+        if (dpin.has_name())
+          absl::StrAppend(&extra, ":", dpin.get_name());
+      }
+      v.emplace_back(std::string(node.get_name()), static_cast<int>(node.get_type_op()), extra);
+    }
+
+    std::sort(v.begin(), v.end());
+    return v;
+  }
+
+  void check_htree() {
+    auto &htree = top->get_htree();
+    for (auto node : top->fast()) {
+      if (!node.is_type_sub())
+        continue;
+      Node hnode(top, Hierarchy_tree::root_index(), node.get_compact_class());
+      auto child = htree.go_down(hnode);
+      EXPECT_EQ(htree.get_data(child).up_nid, node.get_compact_class().get_nid());
+      EXPECT_EQ(htree.get_data(child).lgid, sub->get_lgid());
+    }
+  }
+};
+
+TEST_F(Setup_lgraph_compact, orders) {
+  top->get_htree();  // created before compact, must be remapped
+
+  auto edges  = collect_edges();
+  auto nnodes = collect_nodes();
+  EXPECT_FALSE(edges.empty());
+  EXPECT_EQ(nnodes.size(), nodes.size());
+
+  auto i0_bits = top->get_graph_input("i0").get_bits();
+  auto o3_bits = top->get_graph_output_driver_pin("o3").get_bits();
+
+  auto size_before = top->size();
+  for (auto order : {LGraph::Compact_order::Keep, LGraph::Compact_order::BFS, LGraph::Compact_order::Topological}) {
+    auto epoch = top->get_edit_epoch();
+    top->compact(order);
+    EXPECT_GT(top->get_edit_epoch(), epoch);
+    EXPECT_LT(top->size(), size_before);
+
+    EXPECT_EQ(collect_edges(), edges);
+    EXPECT_EQ(collect_nodes(), nnodes);
+
+    EXPECT_EQ(top->get_graph_input("i0").get_bits(), i0_bits);
+    EXPECT_EQ(top->get_graph_output_driver_pin("o3").get_bits(), o3_bits);
+    EXPECT_TRUE(top->get_graph_input("i2").has_name());
+
+    check_htree();
+  }
+
+  // Topological: a combinational driver always has a lower nid than its sink
+  // (but inside combinational loops)
+  const auto &levels     = top->get_levelization();
+  auto        loop_level = levels.get_num_loop_nodes() ? levels.get_num_levels() - 1 : Graph_level::invalid_level;
+  for (auto node : top->fast()) {
+    if (node.is_type_loop_breaker() || levels.get_level(node) == loop_level)
+      continue;
+    for (auto &e : node.inp_edges()) {
+      auto dnode = e.driver.get_node();
+      if (dnode.is_graph_io() || dnode.is_type_loop_breaker())
+        continue;
+      EXPECT_LT(dnode.get_compact_class().get_nid(), node.get_compact_class().get_nid());
+    }
+  }
+}
+
+TEST_F(Setup_lgraph_compact, traversal) {
+  auto traverse = [this]() {
+    size_t n = 0;
+    for (int i = 0; i < 20; ++i) {
+      for (auto node : top->forward()) {
+        n += node.get_num_inp_edges();
+      }
+    }
+    return n;
+  };
+
+  size_t n_before;
+  {
+    Lbench b("core.LGRAPH_COMPACT_before");
+    n_before = traverse();
+  }
+  {
+    Lbench b("core.LGRAPH_COMPACT_compact");
+    top->compact(LGraph::Compact_order::Topological);
+  }
+  size_t n_after;
+  {
+    Lbench b("core.LGRAPH_COMPACT_after");
+    n_after = traverse();
+  }
+
+  EXPECT_EQ(n_before, n_after);
+}
+
+TEST_F(Setup_lgraph_compact, hierarchical_attributes) {
+  // sub nodes with a hole before each one, compact renumbers them
+  std::vector<Node> sub_nodes;
+  for (int i = 0; i < 100; ++i) {
+    auto hole = sub->create_node(Ntype_op::Sum);
+    auto node = sub->create_node(Ntype_op::Sum);
+    node.set_name(absl::StrCat("s", i));
+    hole.del_node();
+    sub_nodes.emplace_back(node);
+  }
+
+  Node inst;
+  for (auto &node : nodes) {
+    if (node.is_type_sub()) {
+      inst = node;
+      break;
+    }
+  }
+  ASSERT_FALSE(inst.is_invalid());
+
+  // Placed through a top instance: the key is in the top tables
+  auto hidx = inst.hierarchy_go_down();
+  for (int i = 0; i < 100; ++i) {
+    Node hnode(top, hidx, sub_nodes[i].get_compact_class());
+    hnode.ref_place()->replace(i, 2 * i);
+  }
+
+  sub->compact(LGraph::Compact_order::Keep);
+
+  hidx = inst.hierarchy_go_down();
+  int n_found = 0;
+  for (auto node : sub->fast()) {
+    if (!node.has_name())
+      continue;
+    auto name = node.get_name();
+    int  i    = std::stoi(std::string(name.substr(1)));
+
+    Node hnode(top, hidx, node.get_compact_class());
+    ASSERT_TRUE(hnode.has_place());
+    EXPECT_EQ(hnode.get_place().get_x(), i);
+    EXPECT_EQ(hnode.get_place().get_y(), 2 * i);
+    ++n_found;
+  }
+  EXPECT_EQ(n_found, 100);
+}
@@ -1,11 +1,16 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
@@ -257,3 +262,64 @@ TEST_F(Setup_graphs_test, No_each_output) {
 
   EXPECT_TRUE(true);
 }
+
+TEST_F(Setup_graphs_test, edge_ranges) {
+  auto check = [](const XEdge_iterator &ref, const XEdge_range &range) {
+    XEdge_iterator v;
+    for (const auto &e : range) v.emplace_back(e);
+    EXPECT_EQ(v.size(), ref.size());
+    EXPECT_TRUE(std::is_permutation(v.begin(), v.end(), ref.begin(), ref.end()));
+  };
+
+  for (auto &parent : lgs) {
+    for (auto hier : {false, true}) {
+      for (auto node : parent->fast(hier)) {
+        check(node.out_edges(), node.out_edges_range());
+        check(node.inp_edges(), node.inp_edges_range());
+      }
+      auto inp_node = parent->get_graph_input_node(hier);
+      auto out_node = parent->get_graph_output_node(hier);
+      check(inp_node.out_edges(), inp_node.out_edges_range());
+      check(out_node.inp_edges(), out_node.inp_edges_range());
+    }
+  }
+}
+
+TEST_F(Setup_graphs_test, each_node_parallel) {
+  for (int i = 0; i < 2000; ++i) {
+    auto node = top->create_node(Ntype_op::Sum);
+    if ((i % 3) == 0)
+      node.set_name(absl::StrCat("par_", i));
+  }
+
+  for (auto &lg : lgs) {
+    absl::flat_hash_set<Node::Compact_class> ref;
+    int                                      ref_named = 0;
+    for (auto node : lg->fast()) {
+      ref.insert(node.get_compact_class());
+      if (node.has_name())
+        ++ref_named;
+    }
+
+    for (auto grain : {1, 300, 4096}) {
+      std::mutex                               lock;
+      absl::flat_hash_set<Node::Compact_class> visited;
+      std::atomic<int>                         n_visits(0);
+      std::atomic<int>                         n_named(0);
+
+      lg->each_node_parallel(
+          [&](const Node &node) {
+            n_visits++;
+            if (node.has_name())  // attribute read from the workers
+              n_named++;
+            std::lock_guard<std::mutex> guard(lock);
+            visited.insert(node.get_compact_class());
+          },
+          grain);
+
+      EXPECT_EQ(n_visits, ref.size());
+      EXPECT_EQ(n_named, ref_named);
+      EXPECT_EQ(visited, ref);
+    }
+  }
+}
@@ -0,0 +1,264 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+
+class Setup_lgraph_extract : public ::testing::Test {
+protected:
+  LGraph *top;
+  Node    n1;  // And(a,b), drives n2 and n4
+  Node    n2;  // Or(n1,c)
+  Node    n3;  // And(n2,a) -> z
+  Node    n4;  // Xor(n1,c) -> y
+
+  void SetUp() override {
+    top = LGraph::create("lgdb_lgraph_extract", "extract_top", "test");
+
+    auto a = top->add_graph_input("a", 1, 8);
+    auto b = top->add_graph_input("b", 2, 8);
+    auto c = top->add_graph_input("c", 3, 8);
+    top->add_graph_output("z", 4, 8);
+    top->add_graph_output("y", 5, 8);
+
+    n1 = top->create_node(Ntype_op::And, 8);
+    a.connect_sink(n1.setup_sink_pin("A"));
+    b.connect_sink(n1.setup_sink_pin("A"));
+    n1.setup_driver_pin().set_name("t1");
+    n1.setup_driver_pin().set_offset(2);
+
+    n2 = top->create_node(Ntype_op::Or, 8);
+    n1.setup_driver_pin().connect_sink(n2.setup_sink_pin("A"));
+    c.connect_sink(n2.setup_sink_pin("A"));
+    n2.set_name("orn");
+
+    n3 = top->create_node(Ntype_op::And, 8);
+    n2.setup_driver_pin().connect_sink(n3.setup_sink_pin("A"));
+    a.connect_sink(n3.setup_sink_pin("A"));
+    n3.setup_driver_pin().connect_sink(top->get_graph_output("z"));
+
+    n4 = top->create_node(Ntype_op::Xor, 8);
+    n1.setup_driver_pin().connect_sink(n4.setup_sink_pin("A"));
+    c.connect_sink(n4.setup_sink_pin("A"));
+    n4.setup_driver_pin().connect_sink(top->get_graph_output("y"));
+  }
+
+  static int count(LGraph *lg, Ntype_op op) {
+    int n = 0;
+    for (auto node : lg->fast()) {
+      if (node.get_type_op() == op)
+        ++n;
+    }
+    return n;
+  }
+
+  static std::vector<std::string> driver_names(const Node_pin &spin) {
+    std::vector<std::string> names;
+    for (auto &e : spin.inp_edges()) {
+      names.emplace_back(e.driver.has_name() ? e.driver.get_name() : "");
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+};
+
+TEST_F(Setup_lgraph_extract, cone) {
+  LGraph::Node_set fanin;
+  top->add_cone(n3, true, fanin);
+  EXPECT_EQ(fanin.size(), 3);
+  EXPECT_TRUE(fanin.contains(n1.get_compact_class()));
+  EXPECT_FALSE(fanin.contains(n4.get_compact_class()));
+
+  LGraph::Node_set fanout;
+  top->add_cone(n1, false, fanout);
+  EXPECT_EQ(fanout.size(), 4);
+}
+
+TEST_F(Setup_lgraph_extract, extract) {
+  LGraph::Node_set nodes;
+  top->add_cone(n2, true, nodes);
+  ASSERT_EQ(nodes.size(), 2);
+
+  auto *region = top->extract(nodes, "extract_region");
+  ASSERT_NE(region, nullptr);
+
+  // Inputs keep the outside driver names, outputs the inside ones
+  EXPECT_TRUE(region->is_graph_input("a"));
+  EXPECT_TRUE(region->is_graph_input("b"));
+  EXPECT_TRUE(region->is_graph_input("c"));
+  EXPECT_TRUE(region->is_graph_output("t1"));
+  EXPECT_TRUE(region->is_graph_output("extract_out_1"));
+  EXPECT_FALSE(region->is_graph_output("z"));
+
+  EXPECT_EQ(count(region, Ntype_op::And), 1);
+  EXPECT_EQ(count(region, Ntype_op::Or), 1);
+  EXPECT_EQ(count(region, Ntype_op::Xor), 0);
+
+  for (auto node : region->fast()) {
+    if (node.get_type_op() == Ntype_op::Or) {
+      EXPECT_EQ(node.get_name(), "orn");
+      EXPECT_EQ(node.get_driver_pin().get_bits(), 8);
+      // t1 is the graph output name now, the And driver pin has none
+      EXPECT_EQ(driver_names(node.get_sink_pin("A")), std::vector<std::string>({"", "c"}));
+    } else {
+      EXPECT_EQ(driver_names(node.get_sink_pin("A")), std::vector<std::string>({"a", "b"}));
+    }
+  }
+
+  auto t1 = region->get_graph_output("t1").get_driver_pin();
+  EXPECT_EQ(t1.get_node().get_type_op(), Ntype_op::And);
+  EXPECT_EQ(t1.get_offset(), 2);
+  EXPECT_EQ(region->get_graph_input("a").get_bits(), 8);
+}
+
+TEST_F(Setup_lgraph_extract, stitch_back) {
+  LGraph::Node_set nodes;
+  top->add_cone(n2, true, nodes);
+
+  auto *region = top->extract(nodes, "extract_region");
+
+  // "Optimize" the region: the Or becomes a Xor
+  for (auto node : region->fast()) {
+    if (node.get_type_op() != Ntype_op::Or)
+      continue;
+    auto xor_node = region->create_node(Ntype_op::Xor, 8);
+    for (auto &e : node.inp_edges()) {
+      e.driver.connect_sink(xor_node.setup_sink_pin("A"));
+    }
+    for (auto &e : node.out_edges()) {
+      xor_node.setup_driver_pin().connect_sink(e.sink);
+    }
+    node.del_node();
+    break;
+  }
+
+  top->stitch_back(nodes, region);
+
+  EXPECT_EQ(count(top, Ntype_op::Or), 0);
+  EXPECT_EQ(count(top, Ntype_op::Xor), 2);
+  EXPECT_EQ(count(top, Ntype_op::And), 2);
+
+  // The outside sinks are driven by the new nodes
+  auto n3_drivers = driver_names(n3.get_sink_pin("A"));
+  EXPECT_EQ(n3_drivers.size(), 2);
+  for (auto &e : n3.get_sink_pin("A").inp_edges()) {
+    if (e.driver.get_node().is_graph_input())
+      continue;
+    EXPECT_EQ(e.driver.get_node().get_type_op(), Ntype_op::Xor);
+    EXPECT_EQ(driver_names(e.driver.get_node().get_sink_pin("A")), std::vector<std::string>({"c", "t1"}));
+  }
+
+  auto t1 = Node_pin::find_driver_pin(top, "t1");
+  ASSERT_FALSE(t1.is_invalid());
+  EXPECT_EQ(t1.get_offset(), 2);
+  EXPECT_EQ(driver_names(t1.get_node().get_sink_pin("A")), std::vector<std::string>({"a", "b"}));
+  EXPECT_EQ(driver_names(n4.get_sink_pin("A")), std::vector<std::string>({"c", "t1"}));
+}
+
+TEST_F(Setup_lgraph_extract, stitch_back_const) {
+  auto k = top->create_node_const(Lconst(3));
+  k.setup_driver_pin().connect_sink(n4.setup_sink_pin("A"));
+
+  LGraph::Node_set nodes;
+  top->add_cone(n2, true, nodes);
+
+  auto *region = top->extract(nodes, "extract_region");
+
+  auto fold = [region](Ntype_op op, Node &knode) {
+    for (auto node : region->fast()) {
+      if (node.get_type_op() != op)
+        continue;
+      for (auto &e : node.out_edges()) {
+        knode.setup_driver_pin().connect_sink(e.sink);
+      }
+      node.del_node();
+      break;
+    }
+  };
+
+  // The Or folds to the same value as k (pooled), the And to a named const
+  auto k_or = region->create_node_const(Lconst(3));
+  fold(Ntype_op::Or, k_or);
+  auto k_and = region->create_node();
+  k_and.set_type_const(Lconst(3));
+  fold(Ntype_op::And, k_and);
+  k_and.setup_driver_pin().set_name("k_and");
+  k_and.setup_driver_pin().set_offset(2);
+
+  top->stitch_back(nodes, region);
+
+  // The outside const keeps its pin as it was
+  EXPECT_FALSE(k.get_driver_pin().has_name());
+  EXPECT_EQ(k.get_driver_pin().get_offset(), 0);
+
+  auto kpin = Node_pin::find_driver_pin(top, "k_and");
+  ASSERT_FALSE(kpin.is_invalid());
+  EXPECT_NE(kpin.get_node(), k);
+  EXPECT_EQ(kpin.get_offset(), 2);
+  EXPECT_EQ(driver_names(n4.get_sink_pin("A")), std::vector<std::string>({"", "c", "k_and"}));
+
+  for (auto &e : n3.get_sink_pin("A").inp_edges()) {
+    if (!e.driver.get_node().is_graph_input())
+      EXPECT_TRUE(e.driver.get_node().get_type_const() == Lconst(3));
+  }
+}
+
+TEST_F(Setup_lgraph_extract, stitch_back_undriven) {
+  LGraph::Node_set nodes;
+  top->add_cone(n2, true, nodes);
+
+  auto *region = top->extract(nodes, "extract_region");
+  for (auto node : region->fast()) {
+    if (node.get_type_op() == Ntype_op::Or) {
+      node.del_node();
+      break;
+    }
+  }
+
+  // n3 would lose its driver, nothing is stitched
+  EXPECT_THROW(top->stitch_back(nodes, region), std::runtime_error);
+  EXPECT_EQ(count(top, Ntype_op::Or), 1);
+  EXPECT_EQ(driver_names(n3.get_sink_pin("A")).size(), 2);
+}
+
+TEST_F(Setup_lgraph_extract, large) {
+  constexpr int n_chain = 20000;
+
+  auto *lg = LGraph::create("lgdb_lgraph_extract", "extract_large", "test");
+  auto  a  = lg->add_graph_input("a", 1, 8);
+  lg->add_graph_output("z", 2, 8);
+
+  auto dpin = a;
+  for (int i = 0; i < n_chain; ++i) {
+    auto node = lg->create_node(Ntype_op::Xor, 8);
+    dpin.connect_sink(node.setup_sink_pin("A"));
+    a.connect_sink(node.setup_sink_pin("A"));
+    dpin = node.setup_driver_pin();
+  }
+  dpin.connect_sink(lg->get_graph_output("z"));
+
+  LGraph::Node_set nodes;
+  lg->add_cone(dpin.get_node(), true, nodes);
+  EXPECT_EQ(nodes.size(), n_chain);
+
+  LGraph *region;
+  {
+    Lbench b("core.LGRAPH_EXTRACT_large");
+    region = lg->extract(nodes, "extract_large_region");
+  }
+  EXPECT_EQ(count(region, Ntype_op::Xor), n_chain);
+
+  {
+    Lbench b("core.LGRAPH_EXTRACT_stitch_back");
+    lg->stitch_back(nodes, region);
+  }
+  EXPECT_EQ(count(lg, Ntype_op::Xor), n_chain);
+  EXPECT_EQ(lg->get_graph_output("z").get_driver_pin().get_node().get_type_op(), Ntype_op::Xor);
+}
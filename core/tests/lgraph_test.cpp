@@ -242,3 +242,69 @@ TEST_F(Setup_lgraph, add_remove_inputs) {
   });
   EXPECT_EQ(conta, posused.size());
 }
+
+TEST_F(Setup_lgraph, lazy_open) {
+  std::string_view lgdb = "lgdb_lgraph_lazy";
+
+  Eprp_utils::clean_dir(lgdb);
+
+  // Enough IO pins to fill the first node page
+  auto *lg = LGraph::create(lgdb, "lazy", "-");
+  for (int i = 0; i < 200; ++i) {
+    lg->add_graph_input(absl::StrCat("inp_", i), i + 1, 4);
+  }
+  EXPECT_TRUE(lg->is_empty());
+  delete lg;
+
+  lg = LGraph::open(lgdb, "lazy");
+  ASSERT_NE(lg, nullptr);
+  EXPECT_TRUE(lg->is_empty());
+  EXPECT_EQ(lg->get_self_sub_node().get_io_pins().size(), 200);
+
+  auto node = lg->create_node(Ntype_op::And, 4);
+  lg->get_graph_input("inp_7").connect_sink(node.setup_sink_pin("A"));
+  EXPECT_FALSE(lg->is_empty());
+  delete lg;
+
+  lg = LGraph::open(lgdb, "lazy");
+  EXPECT_FALSE(lg->is_empty());
+
+  int conta = 0;
+  for (auto n : lg->fast()) {
+    EXPECT_EQ(n.get_type_op(), Ntype_op::And);
+    ++conta;
+  }
+  EXPECT_EQ(conta, 1);
+}
+
+TEST_F(Setup_lgraph, lazy_open_bench) {
+  constexpr int n_graphs = 2000;
+
+  std::string_view lgdb = "lgdb_lgraph_lazy_bench";
+
+  Eprp_utils::clean_dir(lgdb);
+
+  for (int i = 0; i < n_graphs; ++i) {
+    auto *lg = LGraph::create(lgdb, absl::StrCat("g", i), "-");
+    auto  a  = lg->add_graph_input("a", 1, 8);
+    lg->add_graph_output("z", 2, 8);
+    for (int j = 0; j < 8; ++j) {
+      auto node = lg->create_node(Ntype_op::And, 8);
+      a.connect_sink(node.setup_sink_pin("A"));
+    }
+    delete lg;
+  }
+
+  Lbench b("core.LGRAPH_lazy_open");
+
+  int n_empty = 0;
+  int n_io    = 0;
+  for (int i = 0; i < n_graphs; ++i) {
+    auto *lg = LGraph::open(lgdb, absl::StrCat("g", i));
+    ASSERT_NE(lg, nullptr);
+    n_empty += lg->is_empty();
+    n_io += lg->get_self_sub_node().get_io_pins().size();
+  }
+  EXPECT_EQ(n_empty, 0);
+  EXPECT_EQ(n_io, 2 * n_graphs);
+}
@@ -0,0 +1,122 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+
+#include "annotate.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "name_map.hpp"
+
+class Setup_name_intern : public ::testing::Test {
+protected:
+  LGraph *lg1;
+  LGraph *lg2;
+
+  void SetUp() override {
+    lg1 = LGraph::create("lgdb_name_intern", "intern_lg1", "test");
+    lg2 = LGraph::create("lgdb_name_intern", "intern_lg2", "test");
+  }
+};
+
+TEST_F(Setup_name_intern, shared_names) {
+  auto n1 = lg1->create_node(Ntype_op::And, 4);
+  auto n2 = lg2->create_node(Ntype_op::Or, 4);
+
+  n1.set_name("top.mid.foo");
+  n1.setup_driver_pin().set_name("top.mid.foo");
+  n2.setup_driver_pin().set_name("top.mid.foo");
+
+  EXPECT_EQ(n1.get_name(), "top.mid.foo");
+  EXPECT_EQ(n1.get_driver_pin().get_name(), "top.mid.foo");
+  EXPECT_EQ(n2.get_driver_pin().get_name(), "top.mid.foo");
+
+  // One string for the three names
+  auto id1 = Ann_node_name::ref(lg1)->get_val_id(n1.get_compact_class());
+  auto id2 = Ann_node_pin_name::ref(lg1)->get_val_id(n1.get_driver_pin().get_compact_class_driver());
+  auto id3 = Ann_node_pin_name::ref(lg2)->get_val_id(n2.get_driver_pin().get_compact_class_driver());
+  EXPECT_EQ(id1, id2);
+  EXPECT_EQ(id1, id3);
+
+  auto dpin = Node_pin::find_driver_pin(lg2, "top.mid.foo");
+  ASSERT_FALSE(dpin.is_invalid());
+  EXPECT_EQ(dpin.get_node(), n2);
+  EXPECT_TRUE(Node_pin::find_driver_pin(lg2, "top.mid.bar").is_invalid());
+
+  // A rename in one lgraph does not change the others
+  n2.setup_driver_pin().set_name("top.mid.bar");
+  EXPECT_EQ(n2.get_driver_pin().get_name(), "top.mid.bar");
+  EXPECT_EQ(Node_pin::find_driver_pin(lg2, "top.mid.bar"), n2.get_driver_pin());
+  EXPECT_EQ(n1.get_driver_pin().get_name(), "top.mid.foo");
+  EXPECT_EQ(Node_pin::find_driver_pin(lg1, "top.mid.foo"), n1.get_driver_pin());
+}
+
+TEST_F(Setup_name_intern, persistence) {
+  auto n1 = lg1->create_node(Ntype_op::Xor, 4);
+  n1.setup_driver_pin().set_name("persist_pin");
+  n1.set_name("persist_node");
+  auto compact = n1.get_compact_class();
+  lg1->sync();
+
+  auto *lg = LGraph::open("lgdb_name_intern", "intern_lg1");
+  ASSERT_NE(lg, nullptr);
+  Node node(lg, compact);
+  EXPECT_EQ(node.get_name(), "persist_node");
+  EXPECT_EQ(node.get_driver_pin().get_name(), "persist_pin");
+}
+
+TEST_F(Setup_name_intern, name_map) {
+  Name_map<Node_pin> name2dpin(Graph_library::instance("lgdb_name_intern"));
+
+  auto n1 = lg1->create_node(Ntype_op::And, 4);
+  EXPECT_EQ(name2dpin.find("map_a"), name2dpin.end());
+  EXPECT_FALSE(name2dpin.contains("map_a"));
+
+  name2dpin["map_a"] = n1.setup_driver_pin();
+  name2dpin.emplace("map_b", n1.setup_driver_pin());
+  EXPECT_TRUE(name2dpin.contains("map_a"));
+  EXPECT_EQ(name2dpin.size(), 2);
+
+  auto it = name2dpin.find(std::string("map_") + "b");
+  ASSERT_NE(it, name2dpin.end());
+  EXPECT_EQ(it->second, n1.get_driver_pin());
+  EXPECT_EQ(name2dpin.get_name(it->first), "map_b");
+
+  EXPECT_EQ(name2dpin.erase("map_a"), 1);
+  EXPECT_EQ(name2dpin.erase("map_never"), 0);
+  EXPECT_EQ(name2dpin.size(), 1);
+}
+
+TEST_F(Setup_name_intern, bench) {
+  constexpr int n_nodes = 50000;
+
+  auto *lg = LGraph::create("lgdb_name_intern", "intern_bench", "test");
+  {
+    Lbench b("core.NAME_INTERN_set");
+    for (int i = 0; i < n_nodes; ++i) {
+      auto node = lg->create_node(Ntype_op::And, 4);
+      auto name = absl::StrCat("top.inst", std::to_string(i % 64), ".wire", std::to_string(i));
+      node.set_name(name);
+      node.setup_driver_pin().set_name(name);
+    }
+  }
+
+  size_t total = 0;
+  {
+    Lbench b("core.NAME_INTERN_get");
+    for (auto node : lg->fast()) {
+      total += node.get_name().size() + node.get_driver_pin().get_name().size();
+    }
+  }
+  EXPECT_GT(total, 0);
+
+  {
+    Lbench b("core.NAME_INTERN_find");
+    for (int i = 0; i < n_nodes; i += 7) {
+      auto name = absl::StrCat("top.inst", std::to_string(i % 64), ".wire", std::to_string(i));
+      EXPECT_FALSE(Node_pin::find_driver_pin(lg, name).is_invalid());
+    }
+  }
+}
@@ -73,7 +73,7 @@ void Graphviz::do_hierarchy(LGraph *g) {
   // include a font name to get graph to render properly with kgraphviewer
   std::string data = "digraph {\n node [fontname = \"Source Code Pro\"];\n";
 
-  const auto &root_tree = g->get_htree();
+  auto &root_tree = g->get_htree();
 
   absl::flat_hash_set<std::pair<Hierarchy_index,Hierarchy_index>> added;
 
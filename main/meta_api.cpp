@@ -62,6 +62,18 @@ void Meta_api::copy(Eprp_var &var) {
   glibrary->copy_lgraph(name, dest);
 }
 
+void Meta_api::library_json(Eprp_var &var) {
+  auto path = var.get("path");
+  auto file = var.get("file");
+  assert(!file.empty());
+
+  const auto *glibrary = Graph_library::instance(path);
+  if (glibrary == nullptr)
+    return;
+
+  glibrary->export_json(file);
+}
+
 void Meta_api::match(Eprp_var &var) {
   auto path  = var.get("path");
   auto match = var.get("match");
@@ -236,4 +248,11 @@ void Meta_api::setup(Eprp &eprp) {
   m11.add_label_required("dest", "lgraph destination name");
 
   eprp.register_method(m11);
+
+  //---------------------
+  Eprp_method m12("lgraph.library_json", "export the lgraph library as JSON", &Meta_api::library_json);
+  m12.add_label_optional("path", "lgraph path", "lgdb");
+  m12.add_label_required("file", "JSON output file");
+
+  eprp.register_method(m12);
 }
@@ -8,6 +8,7 @@ protected:
   static void create(Eprp_var &var);
   static void rename(Eprp_var &var);
   static void copy(Eprp_var &var);
+  static void library_json(Eprp_var &var);
 
   static void match(Eprp_var &var);
 
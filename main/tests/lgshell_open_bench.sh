@@ -0,0 +1,66 @@
+#!/bin/bash
+# This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+# Time to first result of quick queries (open, IO listing) on a lgdb with
+# many graphs. The lgraphs are opened lazily, the node tables are not mapped
+# unless the query needs them (lgraph.stats).
+
+LGSHELL=./bazel-bin/main/lgshell
+
+if [ ! -f ${LGSHELL} ]; then
+  if [ -f ./main/lgshell ]; then
+    LGSHELL=./main/lgshell
+  else
+    echo "could not find lgshell on $(pwd)"
+    exit 1
+  fi
+fi
+
+NMODULES=2000
+if [ "$1" != "" ]; then
+  NMODULES=$1
+fi
+
+BENCH_DIR=./lgshell_open_bench
+LGDB=${BENCH_DIR}/lgdb
+rm -rf ${BENCH_DIR}
+mkdir -p ${BENCH_DIR}
+
+VFILE=${BENCH_DIR}/many_modules.v
+for i in $(seq 1 ${NMODULES})
+do
+  echo "module mod_${i}(input [7:0] a, input [7:0] b, output [7:0] z);"
+  echo "  assign z = (a & b) ^ 8'd$((i % 256));"
+  echo "endmodule"
+done >${VFILE}
+
+echo "inou.yosys.tolg files:${VFILE} path:${LGDB}" | ${LGSHELL} -q >${BENCH_DIR}/tolg.log
+if [ $? -ne 0 ]; then
+  echo "FAIL: lgshell_open_bench could not create ${LGDB}"
+  exit 1
+fi
+
+# bench name, lgshell command
+run_bench() {
+  local start=$(date +%s%N)
+  echo "$2" | ${LGSHELL} -q >${BENCH_DIR}/$1.log
+  local ret=$?
+  local end=$(date +%s%N)
+  if [ ${ret} -ne 0 ]; then
+    echo "FAIL: lgshell_open_bench $1 failed"
+    exit 1
+  fi
+  echo "lgshell_open_bench $1 modules:${NMODULES} ms:$(( (end - start) / 1000000 ))"
+}
+
+run_bench open_one "lgraph.open path:${LGDB} name:mod_${NMODULES} |> dump"
+run_bench match    "lgraph.match path:${LGDB} |> dump"
+run_bench stats    "lgraph.match path:${LGDB} |> lgraph.stats"
+
+n=$(grep -c "${LGDB}/mod_" ${BENCH_DIR}/match.log)
+if [ ${n} -ne ${NMODULES} ]; then
+  echo "FAIL: lgshell_open_bench match found ${n} of ${NMODULES} lgraphs"
+  exit 1
+fi
+
+exit 0
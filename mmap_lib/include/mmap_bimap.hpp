@@ -7,40 +7,63 @@
 #include "mmap_map.hpp"
 
 namespace mmap_lib {
+// Two index maps. An array_serializable (string_view) key or value is stored
+// once, in the txt of the map that uses it as key. The other map only keeps
+// its position (get_sview).
 template <typename Key, typename T>
 class bimap {
+protected:
+  static constexpr bool shared_val = is_array_serializable<T>::value;
+  static constexpr bool shared_key = is_array_serializable<Key>::value;
+
+  static std::string key2val_name(std::string_view _map_name) {
+    return std::string(_map_name) + (shared_val ? "_k2p" : "_k2v");  // _k2p: not the old file layout
+  }
+  static std::string val2key_name(std::string_view _map_name) {
+    return std::string(_map_name) + (shared_key ? "_v2p" : "_v2k");
+  }
+
 public:
-  using Key2val_type = typename mmap_lib::map<Key, T>;
-  using Val2key_type = typename mmap_lib::map<T, Key>;
+  using Key2val_type = typename mmap_lib::map<Key, typename std::conditional<shared_val, uint32_t, T>::type>;
+  using Val2key_type = typename mmap_lib::map<T, typename std::conditional<shared_key, uint32_t, Key>::type>;
   Key2val_type key2val;
   Val2key_type val2key;
 
   using iterator       = typename Key2val_type::iterator;
   using const_iterator = typename Key2val_type::const_iterator;
 
-  explicit bimap(std::string_view _map_name) : key2val(std::string(_map_name) + "_k2v"), val2key(std::string(_map_name) + "_v2k") {}
+  explicit bimap(std::string_view _map_name) : key2val(key2val_name(_map_name)), val2key(val2key_name(_map_name)) {}
   explicit bimap(std::string_view _path, std::string_view _map_name)
-      : key2val(_path, std::string(_map_name) + "_k2v"), val2key(_path, std::string(_map_name) + "_v2k") {}
+      : key2val(_path, key2val_name(_map_name)), val2key(_path, val2key_name(_map_name)) {}
 
   void clear() {
     key2val.clear();
     val2key.clear();
   }
-  const_iterator set(Key &&key, T &&val) {
-    val2key.set(val, key);
-    return key2val.set(key, val);
+  void preload() const {
+    key2val.preload();
+    val2key.preload();
   }
-  const_iterator set(const Key &key, T &&val) {
-    val2key.set(val, key);
-    return key2val.set(key, val);
+  void gc_pin() const {
+    key2val.gc_pin();
+    val2key.gc_pin();
   }
-  const_iterator set(const Key &key, const T &val) {
-    val2key.set(val, key);
-    return key2val.set(key, val);
+  void gc_unpin() const {
+    val2key.gc_unpin();
+    key2val.gc_unpin();
   }
-  const_iterator set(Key &&key, const T &val) {
-    val2key.set(val, key);
-    return key2val.set(key, val);
+  const_iterator set(const Key &key, const T &val) {
+    if constexpr (shared_val) {
+      auto it = val2key.set(val, key);
+      return key2val.set(key, it->first);
+    } else if constexpr (shared_key) {
+      auto it = key2val.set(key, val);
+      val2key.set(val, it->first);
+      return it;
+    } else {
+      val2key.set(val, key);
+      return key2val.set(key, val);
+    }
   }
 
   [[nodiscard]] bool has_key(const Key &key) const { return key2val.has(key); }
@@ -49,18 +72,22 @@ public:
   template<typename T_ = T, typename = std::enable_if_t<!is_array_serializable<T_>::value>>
   [[nodiscard]] const T &        get_val(const Key &key) const { return key2val.get(key); }
   template<typename T_ = T, typename = std::enable_if_t<is_array_serializable<T_>::value>>
-  [[nodiscard]] T                get_val(const Key &key) const { return key2val.get(key); }
-
-  [[nodiscard]] Key              get_key(const T &val) const { return val2key.get(val); }
+  [[nodiscard]] T                get_val(const Key &key) const { return val2key.get_sview(key2val.get(key)); }
+
+  [[nodiscard]] Key get_key(const T &val) const {
+    if constexpr (shared_key) {
+      return key2val.get_sview(val2key.get(val));
+    } else {
+      return val2key.get(val);
+    }
+  }
 
   [[nodiscard]] iterator       find(const Key &key) { return key2val.find(key); }
   [[nodiscard]] const_iterator find(const Key &key) const { return key2val.find(key); }
   [[nodiscard]] const_iterator find_val(const T &val) const {
-    const auto it = val2key.find(val);
-    if (it == val2key.end()) return key2val.end();
+    if (!val2key.has(val)) return key2val.end();
 
-    const Key  key = val2key.get(it);
-    const auto it2 = key2val.find(key);
+    const auto it2 = key2val.find(get_key(val));
     assert(it2 != key2val.end());
     return it2;
   }
@@ -74,12 +101,12 @@ public:
   [[nodiscard]] const_iterator cend() const { return key2val.cend(); }
 
   iterator erase(const_iterator pos) {
-    val2key.erase(key2val.get(pos));
+    val2key.erase(get_val(pos));
     return key2val.erase(pos);
   }
 
   iterator erase(iterator pos) {
-    val2key.erase(key2val.get(pos));
+    val2key.erase(get_val(pos));
     return key2val.erase(pos);
   }
 
@@ -111,9 +138,9 @@ public:
   [[nodiscard]] const T &        get_val(const const_iterator &it) const { return key2val.get(it); }
 
   template<typename T_ = T, typename = std::enable_if_t<is_array_serializable<T_>::value>>
-  [[nodiscard]] T                get_val(const iterator &it) const { return key2val.get(it); }
+  [[nodiscard]] T                get_val(const iterator &it) const { return val2key.get_sview(it->second); }
   template<typename T_ = T, typename = std::enable_if_t<is_array_serializable<T_>::value>>
-  [[nodiscard]] T                get_val(const const_iterator &it) const { return key2val.get(it); }
+  [[nodiscard]] T                get_val(const const_iterator &it) const { return val2key.get_sview(it->second); }
 };
 
 }  // namespace mmap_lib
@@ -0,0 +1,215 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+#include "mmap_map.hpp"
+
+namespace mmap_lib {
+// mmap_lib::map for multi-threaded passes. There are 2^Shard_bits independent
+// maps (shards) picked by the upper bits of the key hash, each with a
+// reader/writer lock. Threads only wait for each other when they touch the
+// same shard and one of them writes.
+//
+// * get returns a copy. A string_view value points to the shard txt, it is
+//   valid until the next set in the same shard.
+// * The iterators (begin/end, get_key(it), get(it)) do not lock. Use them
+//   when nobody writes (like Attribute::remap). each() holds the read lock
+//   of each shard in turn.
+// * Shards are pinned (mmap_gc does not recycle them under a reader). The
+//   lazy mmap of a shard is set up once with the write lock.
+//
+// Each shard is a file: <map_name>_s<shard id>
+template <typename Key, typename T, typename Hash = hash<Key>, int Shard_bits = 4>
+class concurrent_map {
+public:
+  using Shard_map = map<Key, T, Hash>;
+  using key_type  = Key;
+
+  static constexpr size_t n_shards = size_t(1) << Shard_bits;
+
+protected:
+  struct alignas(64) Shard {  // no false sharing between shard locks
+    mutable std::shared_mutex  lock;
+    mutable std::atomic<bool>  loaded{false};
+    std::unique_ptr<Shard_map> data;
+  };
+  std::array<Shard, n_shards> shards;
+
+  static size_t get_shard_id(const Key &key) {
+    // hash<uint32_t> is 32 bits and the map uses the lower bits, mix them up
+    const uint64_t h = static_cast<uint64_t>(Hash{}(key)) * UINT64_C(0x9E3779B97F4A7C15);
+    return h >> (64 - Shard_bits);
+  }
+
+  // fn runs with the shard read lock. The first access maps the shard with
+  // the write lock (the lazy mmap setup is not thread safe).
+  template <typename FN>
+  static auto read_shard(const Shard &s, FN &&fn) {
+    if (MMAP_LIB_LIKELY(s.loaded.load(std::memory_order_acquire))) {
+      std::shared_lock<std::shared_mutex> guard(s.lock);
+      if (MMAP_LIB_LIKELY(s.loaded.load(std::memory_order_relaxed)))
+        return fn(static_cast<const Shard_map &>(*s.data));
+    }
+
+    std::unique_lock<std::shared_mutex> guard(s.lock);
+    s.data->preload();
+    s.loaded.store(true, std::memory_order_release);
+    return fn(static_cast<const Shard_map &>(*s.data));
+  }
+
+  template <typename FN>
+  static auto write_shard(Shard &s, FN &&fn) {
+    std::unique_lock<std::shared_mutex> guard(s.lock);
+    s.data->preload();
+    s.loaded.store(true, std::memory_order_release);
+    return fn(*s.data);
+  }
+
+public:
+  class const_iterator {
+  public:
+    using Inner = typename Shard_map::const_iterator;
+
+    const_iterator(const concurrent_map *_cmap, size_t _shard_id, Inner _it) : cmap(_cmap), shard_id(_shard_id), it(_it) {
+      skip_empty();
+    }
+    const_iterator(const const_iterator &o) = default;
+    const_iterator &operator=(const const_iterator &o) = default;
+
+    const_iterator &operator++() {
+      ++it;
+      skip_empty();
+      return *this;
+    }
+
+    decltype(auto) operator*() const { return *it; }
+    decltype(auto) operator->() const { return it.operator->(); }
+
+    bool operator==(const const_iterator &o) const { return shard_id == o.shard_id && it == o.it; }
+    bool operator!=(const const_iterator &o) const { return !(*this == o); }
+
+  private:
+    void skip_empty() {
+      while (it == cmap->shards[shard_id].data->cend() && shard_id + 1 < n_shards) {
+        ++shard_id;
+        it = cmap->shards[shard_id].data->cbegin();
+      }
+    }
+
+    friend class concurrent_map;
+    const concurrent_map *cmap;
+    size_t                shard_id;
+    Inner                 it;
+  };
+  using iterator = const_iterator;
+
+  explicit concurrent_map() {
+    for (auto &s : shards) {
+      s.data = std::make_unique<Shard_map>();
+      s.data->gc_pin();
+    }
+  }
+
+  explicit concurrent_map(std::string_view _path, std::string_view _map_name) {
+    for (size_t i = 0; i < n_shards; ++i) {
+      shards[i].data = std::make_unique<Shard_map>(_path, std::string(_map_name) + "_s" + std::to_string(i));
+      shards[i].data->gc_pin();
+    }
+  }
+
+  ~concurrent_map() {
+    for (auto &s : shards) {
+      s.data->gc_unpin();
+    }
+  }
+
+  concurrent_map(const concurrent_map &o) = delete;
+  concurrent_map &operator=(const concurrent_map &o) = delete;
+
+  // The shards are always pinned (constructor), for the gc_pin API of map
+  void gc_pin() const {}
+  void gc_unpin() const {}
+
+  void preload() const {
+    for (const auto &s : shards) {
+      read_shard(s, [](const Shard_map &m) { return m.size(); });
+    }
+  }
+
+  void clear() {
+    for (auto &s : shards) {
+      std::unique_lock<std::shared_mutex> guard(s.lock);
+      s.data->clear();
+      s.loaded.store(false, std::memory_order_release);
+    }
+  }
+
+  void set(const Key &key, const T &val) {
+    write_shard(shards[get_shard_id(key)], [&](Shard_map &m) {
+      m.set(key, val);
+      return true;
+    });
+  }
+
+  size_t erase(const Key &key) {
+    return write_shard(shards[get_shard_id(key)], [&](Shard_map &m) { return m.erase(key); });
+  }
+
+  [[nodiscard]] bool has(const Key &key) const {
+    return read_shard(shards[get_shard_id(key)], [&](const Shard_map &m) { return m.has(key); });
+  }
+
+  [[nodiscard]] T get(const Key &key) const {
+    return read_shard(shards[get_shard_id(key)], [&](const Shard_map &m) { return T(m.get(key)); });
+  }
+
+  // fn(key, value) for each entry, with the read lock of the shard being visited
+  template <typename FN>
+  void each(FN &&fn) const {
+    for (const auto &s : shards) {
+      read_shard(s, [&](const Shard_map &m) {
+        for (auto it = m.cbegin(), end = m.cend(); it != end; ++it) {
+          fn(m.get_key(it), m.get(it));
+        }
+        return true;
+      });
+    }
+  }
+
+  [[nodiscard]] size_t size() const {
+    size_t sz = 0;
+    for (const auto &s : shards) {
+      sz += read_shard(s, [](const Shard_map &m) { return m.size(); });
+    }
+    return sz;
+  }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  [[nodiscard]] size_t capacity() const {
+    size_t sz = 0;
+    for (const auto &s : shards) {
+      sz += read_shard(s, [](const Shard_map &m) { return m.capacity(); });
+    }
+    return sz;
+  }
+
+  [[nodiscard]] const_iterator begin() const { return const_iterator(this, 0, shards[0].data->cbegin()); }
+  [[nodiscard]] const_iterator end() const {
+    return const_iterator(this, n_shards - 1, shards[n_shards - 1].data->cend());
+  }
+  [[nodiscard]] const_iterator cbegin() const { return begin(); }
+  [[nodiscard]] const_iterator cend() const { return end(); }
+
+  [[nodiscard]] Key get_key(const const_iterator &it) const { return shards[it.shard_id].data->get_key(it.it); }
+  [[nodiscard]] T   get(const const_iterator &it) const { return T(shards[it.shard_id].data->get(it.it)); }
+};
+
+}  // namespace mmap_lib
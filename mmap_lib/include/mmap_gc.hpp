@@ -6,10 +6,13 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <climits>
 #include <functional>
 #include <map>
+#include <mutex>
 
 #include "absl/container/flat_hash_map.h"
 
@@ -28,11 +31,13 @@ struct mmap_gc_entry {
     age  = global_age++;
     size = 0;
     fd   = -1;
+    pins = nullptr;
   }
   std::string                       name;  // Mostly for debugging
   int                               fd;
   size_t                            size;
   void *                            base;
+  const std::atomic<int> *          pins;  // owner gc_pin count (nullptr if it can not be pinned)
   std::function<bool(void *, bool)> gc_function;
 };
 
@@ -41,6 +46,10 @@ protected:
   using gc_pool_type = absl::flat_hash_map<void *, mmap_gc_entry>;  // pointer stability for delete
   static inline gc_pool_type mmap_gc_pool;
 
+  // The pool and counters are shared by all threads (a concurrent_map grows
+  // shards from several threads). Recursive: gc_function may call back.
+  static inline std::recursive_mutex gc_lock;
+
   static inline int n_open_mmaps = 0;
   static inline int n_open_fds   = 0;
 
@@ -57,6 +66,7 @@ protected:
     for (auto it : mmap_gc_pool) {
       if (it.second.fd < 0) continue;
       if (it.second.base == nullptr) continue; // just open, no mmap
+      if (it.second.pins && *it.second.pins) continue; // not even the force pass recycles a pinned mmap
 
       may_recycle_fds++;
       if (it.second.base) may_recycle_mmaps++;
@@ -135,7 +145,7 @@ protected:
       << " n_open_mmaps:" << n_open_mmaps << " n_max_mmaps:" << n_max_mmaps
       << " n_open_fds:" << n_open_fds << " n_max_fds:" << n_max_fds << "\n";
 #endif
-    assert(n_gc);
+    assert(n_gc || sorted.empty());  // everything pinned: keep going over the soft limits
   }
 
   static bool recycle_int(gc_pool_type::iterator it, bool force_recycle) {
@@ -225,6 +235,7 @@ protected:
 public:
   /* LCOV_EXCL_START */
   static void dump() {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
     for (auto it : mmap_gc_pool) {
       std::cerr << "name:" << it.second.name << " base:" << it.first << " age:" << it.second.age << " fd:" << it.second.fd
                 << std::endl;
@@ -232,7 +243,26 @@ public:
   }
   /* LCOV_EXCL_STOP */
 
+  // Creates the directory for the mmap files if it is not there. Every
+  // vector/map/tree constructor calls it (an lgraph has many), so the last
+  // path is remembered to avoid a stat per constructor. If the directory is
+  // removed afterwards, open creates it again.
+  static void setup_path(const std::string &path) {
+    static thread_local std::string last_path;
+    if (path == last_path)
+      return;
+
+    struct stat sb;
+    if (stat(path.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) {
+      int e = mkdir(path.c_str(), 0755);
+      assert(e >= 0);
+      (void)e;
+    }
+    last_path = path;
+  }
+
   static void delete_file(void *base) {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
     auto it = mmap_gc_pool.find(base);
     assert(it != mmap_gc_pool.end());
     assert(it->second.fd >= 0);
@@ -247,6 +277,7 @@ public:
   // mmap_map.hpp:    mmap_txt_fd = mmap_gc::open(mmap_name + "txt");
   // mmap_vector.hpp: mmap_fd     = mmap_gc::open(mmap_name);
   static int open(const std::string &name) {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
 #if 0
     std::cerr << "mmap_gc_pool open filename:" << name 
       << " n_open_fds=" << n_open_fds
@@ -269,6 +300,17 @@ public:
       n_open_fds++;
       return fd;
     }
+    if (errno == ENOENT) {  // directory removed after setup_path remembered it
+      auto pos = name.rfind('/');
+      if (pos != std::string::npos && pos) {
+        ::mkdir(name.substr(0, pos).c_str(), 0755);
+        fd = ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd >= 0) {
+          n_open_fds++;
+          return fd;
+        }
+      }
+    }
     try_collect_fd();
     fd = ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
     if (fd >= 0) {
@@ -287,6 +329,7 @@ public:
   // mmap_map.hpp:    mmap_gc::recycle(mmap_base);
   // mmap_vector.hpp: mmap_gc::recycle(mmap_base);
   static void recycle(void *base) {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
     // Remove from gc
     auto it = mmap_gc_pool.find(base);
     assert(it != mmap_gc_pool.end());
@@ -302,7 +345,8 @@ public:
   // this, std::placeholders::_1)); mmap_map.hpp:    std::tie(base, size)      = mmap_gc::mmap(mmap_name, fd, size,
   // std::bind(&map<MaxLoadFactor100, Key, T, Hash>::gc_function, this, std::placeholders::_1));
   static std::tuple<void *, size_t> mmap(std::string_view name, int fd, size_t size,
-                                         std::function<bool(void *, bool)> gc_function) {
+                                         std::function<bool(void *, bool)> gc_function, const std::atomic<int> *pins = nullptr) {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
     auto [base, final_size] = mmap_step(name, fd, size);
     if (base == MAP_FAILED) {
       try_collect_mmap();
@@ -322,6 +366,7 @@ public:
     entry.size        = final_size;
     entry.gc_function = gc_function;
     entry.base        = base;
+    entry.pins        = pins;
 
     assert(mmap_gc_pool.find(base) == mmap_gc_pool.end());
     // std::cerr << "mmap_gc_pool add name:" << name << " fd:" << fd << " base:" << base << std::endl;
@@ -333,6 +378,7 @@ public:
   // mmap_vector.hpp: mmap_base     = reinterpret_cast<uint8_t *>(mmap_gc::remap(mmap_name, mmap_base, old_mmap_size, mmap_size));
   // mmap_map.hpp:    mmap_txt_base = reinterpret_cast<uint64_t *>(mmap_gc::remap(mmap_name, mmap_txt_base, mmap_txt_size, size));
   static std::tuple<void *, size_t> remap(std::string_view mmap_name, void *mmap_old_base, size_t old_size, size_t new_size) {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
     if (new_size & 0xFFF) {
       new_size >>= 12;
       new_size++;
@@ -407,6 +453,7 @@ public:
   }
 
   static void try_collect_fd() {
+    std::lock_guard<std::recursive_mutex> guard(gc_lock);
     // std::cerr << "try_collect_fd\n";
     if (n_open_fds < n_max_fds) {  // readjust max
       n_max_fds = 1 + 3 * n_open_fds / 4;
@@ -45,8 +45,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -55,6 +57,7 @@
 
 #include "mmap_gc.hpp"
 #include "mmap_hash.hpp"
+#include "mmap_vector.hpp"
 
 //#define mmap_map_LOG_ENABLED
 #ifdef mmap_map_LOG_ENABLED
@@ -411,6 +414,22 @@ struct hash<std::vector<T>> {
 	}
 };
 
+// Keys that are (close to) contiguous ids, like node ids. The map can
+// switch to a dense layout where the id is the slot (no hash, no probing).
+// The id must be unique per key.
+template<typename T>
+struct dense_id {
+	static constexpr bool enabled = false;
+};
+
+template <>
+struct dense_id<uint32_t> {
+	static constexpr bool enabled = true;
+	constexpr size_t operator()(uint32_t const& obj) const {
+		return obj;
+	}
+};
+
 
 namespace detail {
 
@@ -438,6 +457,17 @@ namespace detail {
 // for a idx
 //   variable.
 //
+// * dense: When the key has a dense_id and the ids are close to contiguous,
+//   the Node for id is at mKeyVals[id] (same layout, info is not used). The
+//   rehash picks dense or sparse (robin hood) based on the max id.
+//
+// * wide values (more than 16 bytes): the Node has the position in a
+//   mmap_lib::vector (file with "data" suffix), like string_view values that
+//   are in the "txt" file. Probing does not walk the values. The iterators
+//   still return the value (a copy, use ref to update it). The table file has
+//   an "_ool" suffix, an inline layout file with the plain name (older lgdb)
+//   is migrated on open.
+//
 // According to STL, order of templates has effect on throughput. That's why I've moved the boolean
 // to the front.
 // https://www.reddit.com/r/cpp/comments/ahp6iu/compile_time_binary_size_reductions_and_cs_future/eeguck4/
@@ -456,6 +486,9 @@ private:
   static constexpr bool    using_key_sview      = is_array_serializable<Key>::value;
   static constexpr bool    using_val_sview      = is_array_serializable<T>::value;
   static constexpr bool    using_sview          = using_key_sview || using_val_sview;
+  static constexpr bool    using_val_ool        = !using_val_sview && sizeof(T) > 16;
+  static constexpr bool    using_val_pos        = using_val_sview || using_val_ool;
+  static constexpr bool    dense_capable        = dense_id<Key>::enabled && std::is_same<::mmap_lib::hash<Key>, Hash>::value;
 	static constexpr size_t  InitialNumElements   = 1024;
 	static constexpr int     InitialInfoNumBits   = 5;
 	static constexpr uint8_t InitialInfoInc       = 1 << InitialInfoNumBits;
@@ -468,7 +501,10 @@ public:
 	using key_type    = Key;
 	using array_type  = typename std::conditional<is_array_serializable<Key>::value, Key, T>::type;
 	using value_type  = mmap_lib::pair<typename std::conditional<is_array_serializable<Key>::value, uint32_t, Key>::type
-                                    ,typename std::conditional<is_array_serializable<T  >::value, uint32_t, T  >::type>;
+                                    ,typename std::conditional<using_val_pos, uint32_t, T>::type>;
+	// What the iterators return. Wide values return the value (a copy read
+	// from the data vector), not the position kept in the Node.
+	using iter_value_type = typename std::conditional<using_val_ool, mmap_lib::pair<typename value_type::first_type, T>, value_type>::type;
 	using size_type   = size_t;
 	using hasher      = Hash;
 	using Self        = map<MaxLoadFactor100, key_type, T, hasher>;
@@ -557,17 +593,24 @@ private:
 				using NodePtr = typename std::conditional<IsConst, Node const*, Node*>::type;
 
 			public:
+				// operator-> for wide values, keeps the copy alive for it->second
+				struct Arrow {
+					typename Self::iter_value_type val;
+					typename Self::iter_value_type const* operator->() const { return &val; }
+				};
+
 				using difference_type = std::ptrdiff_t;
-				using value_type = typename Self::value_type;
-				using reference = typename std::conditional<IsConst, value_type const&, value_type&>::type;
-				using pointer = typename std::conditional<IsConst, value_type const*, value_type*>::type;
+				using value_type = typename Self::iter_value_type;
+				using reference = typename std::conditional<using_val_ool, value_type const,
+				                  typename std::conditional<IsConst, value_type const&, value_type&>::type>::type;
+				using pointer = typename std::conditional<using_val_ool, Arrow,
+				                typename std::conditional<IsConst, value_type const*, value_type*>::type>::type;
 				using iterator_category = std::forward_iterator_tag;
 
 				// default constructed iterator can be compared to itself, but WON'T return true when
 				// compared to end().
 				Iter()
 					: mKeyVals(nullptr)
-					, mInfo(nullptr)
           , map_ptr(nullptr) {
         }
 
@@ -578,34 +621,43 @@ private:
         }
 
         void operator=(const Iter &other) {
+          if (map_ptr && map_ptr->iter_cntr>0) {
+            map_ptr->iter_free();
+          }
 					mKeyVals = other.mKeyVals;
-					mInfo    = other.mInfo;
           map_ptr  = other.map_ptr;
           if (map_ptr) {
             map_ptr->iter_new();
           }
         }
 
-				// both const_iterator and iterator can be constructed from a non-const iterator
+				// Copies count as live iterators too (the destructor frees one)
+				Iter(const Iter &other)
+					: mKeyVals(other.mKeyVals)
+          , map_ptr(other.map_ptr) {
+          if (map_ptr) {
+            map_ptr->iter_new();
+          }
+        }
+
+				// a const_iterator can be constructed from a non-const iterator
+				template <bool C = IsConst, typename = typename std::enable_if<C>::type>
 				Iter(Iter<false> const& other)
 					: mKeyVals(other.mKeyVals)
-					, mInfo(other.mInfo)
           , map_ptr(other.map_ptr) {
           if (map_ptr) {
             map_ptr->iter_new();
           }
         }
 
-				Iter(const map *_map_ptr, NodePtr valPtr, uint8_t const* infoPtr)
+				Iter(const map *_map_ptr, NodePtr valPtr)
 					: mKeyVals(valPtr)
-					, mInfo(infoPtr)
           , map_ptr(_map_ptr) {
           map_ptr->iter_new();
         }
 
-				Iter(const map *_map_ptr, NodePtr valPtr, uint8_t const* infoPtr, fast_forward_tag mmap_map_UNUSED(tag) /*unused*/)
+				Iter(const map *_map_ptr, NodePtr valPtr, fast_forward_tag mmap_map_UNUSED(tag) /*unused*/)
 					: mKeyVals(valPtr)
-				  , mInfo(infoPtr)
           , map_ptr(_map_ptr) {
           map_ptr->iter_new();
           fastForward();
@@ -615,18 +667,25 @@ private:
 				Iter& operator++() {
           assert(map_ptr); // true iter should have ptr to avoid gc
           assert(map_ptr->mmap_base); // no gc
-					mInfo++;
 					mKeyVals++;
 					fastForward();
 					return *this;
 				}
 
 				reference operator*() const {
-					return **mKeyVals;
+					if constexpr (using_val_ool) {
+						return value_type(mKeyVals->getFirst(), (*map_ptr->mVals)[mKeyVals->getSecond()]);
+					} else {
+						return **mKeyVals;
+					}
 				}
 
 				pointer operator->() const {
-					return &**mKeyVals;
+					if constexpr (using_val_ool) {
+						return Arrow{**this};
+					} else {
+						return &**mKeyVals;
+					}
 				}
 
 				template <bool O>
@@ -640,33 +699,25 @@ private:
 					}
 
 			private:
-				// fast forward to the next non-free info byte
+				// fast forward to the next valid slot. The valid bitmap skips 64 empty
+				// slots per word, the sentinel bit after the last slot stops at end().
         void fastForward() {
-#ifdef FAST_MISS_ALIGNED_CPU
-          int inc;
-					do {
-						auto const n = detail::unaligned_load<uint64_t>(mInfo);
-#if mmap_map_LITTLE_ENDIAN
-						inc = mmap_map_COUNT_TRAILING_ZEROES(n) / 8;
-#else
-						inc = mmap_map_COUNT_LEADING_ZEROES(n) / 8;
-#endif
-						mInfo += inc;
-						mKeyVals += inc;
-					} while (MMAP_LIB_UNLIKELY(inc == sizeof(uint64_t)));
-#else
-          while(true) {
-						if (*mInfo)
-              return;
-						mInfo++;
-						mKeyVals++;
-					}
-#endif
+          size_t          idx   = mKeyVals - map_ptr->mKeyVals;
+          const uint64_t *valid = map_ptr->mValid;
+
+          size_t   word = idx >> 6;
+          uint64_t bits = valid[word] >> (idx & 63);
+          if (bits == 0) {
+            do {
+              bits = valid[++word];
+            } while (bits == 0);
+            idx = word << 6;
+          }
+          mKeyVals = map_ptr->mKeyVals + idx + mmap_map_COUNT_TRAILING_ZEROES(bits);
 				}
 
 				friend class map<MaxLoadFactor100, key_type, T, hasher>;
 				NodePtr mKeyVals;
-				uint8_t const *mInfo;
         const map     *map_ptr;
 		};
 
@@ -683,17 +734,22 @@ private:
 		assert(s / sizeof(Node) == numElements);
 		return s;
 	}
+	size_t calcNumBytesValid(size_t numElements) const noexcept {
+		// 1 bit per slot and a sentinel word, +8 to align it after the nodes
+		return (numElements / 64 + 1) * sizeof(uint64_t) + sizeof(uint64_t);
+	}
 	size_t calcNumBytesTotal(size_t numElements) const noexcept {
 		const size_t si = calcNumBytesInfo(numElements);
 		const size_t sn = calcNumBytesNode(numElements);
-		const size_t s = si + sn;
+		const size_t sv = calcNumBytesValid(numElements);
+		const size_t s = si + sn + sv;
 		assert(!(s <= si || s <= sn));
 		return s;
 	}
 
   // gc_done can be called for mmap_base or mmap_txt_base
 	bool gc_done(void *base, bool force_recycle) const noexcept {
-    if (iter_cntr && !force_recycle)
+    if ((iter_cntr || n_pins) && !force_recycle)
       return true;
 
     if (mmap_base != base) {  // WARNING: Possible because 2 mmaps can be active during rehash
@@ -702,6 +758,7 @@ private:
 
     if(mmap_fd >= 0 && empty()) {
       unlink(mmap_name.c_str());
+      mmap_size = 0;  // the reload creates a new file, do not reuse the size
     }
 
     mmap_base = nullptr;
@@ -713,7 +770,7 @@ private:
 	}
 
 	bool gc_txt_done(void *base, bool force_recycle) const {
-    if (iter_cntr && !force_recycle)
+    if ((iter_cntr || n_pins) && !force_recycle)
       return true; // abort
 
     assert(using_sview);
@@ -751,7 +808,7 @@ private:
     auto gc_func = std::bind(&map<MaxLoadFactor100, Key, T, Hash>::gc_done, this, std::placeholders::_1, std::placeholders::_2);
 
     void *base = nullptr;
-    std::tie(base, size) = mmap_gc::mmap(name, fd, size, gc_func);
+    std::tie(base, size) = mmap_gc::mmap(name, fd, size, gc_func, &n_pins);
 
 		return std::make_tuple(reinterpret_cast<uint64_t *>(base),size);
 	}
@@ -797,7 +854,7 @@ private:
     {
       auto  gc_func             = std::bind(&map<MaxLoadFactor100, Key, T, Hash>::gc_done, this, std::placeholders::_1, std::placeholders::_2);
       void* base                = nullptr;
-      std::tie(base, mmap_size) = mmap_gc::mmap(mmap_name, mmap_fd, new_mmap_size, gc_func);
+      std::tie(base, mmap_size) = mmap_gc::mmap(mmap_name, mmap_fd, new_mmap_size, gc_func, &n_pins);
       mmap_base                 = reinterpret_cast<uint64_t*>(base);
     }
 
@@ -806,6 +863,8 @@ private:
 		mMaxNumElementsAllowed = &mmap_base[2];
 		mInfoInc               = reinterpret_cast<InfoType *>(&mmap_base[3]);
 		mInfoHashShift         = reinterpret_cast<InfoType *>(&mmap_base[4]);
+		mPeakBits              = reinterpret_cast<uint32_t *>(&mmap_base[4]) + 1; // upper half unused by InfoType
+		mDense                 = reinterpret_cast<uint32_t *>(&mmap_base[3]) + 1;
 
 		mInfo = reinterpret_cast<uint8_t*>(&mmap_base[5]);
 		if (*mMask == n_entries - 1 || n_entries==0) {
@@ -813,6 +872,10 @@ private:
 			assert(calc_mmap_size(*mMask+1)<=mmap_size);
 			assert(mInfo[*mMask+1] == 1); // Sentinel
 			mKeyVals = reinterpret_cast<Node*>(&mmap_base[5+(*mMask+9)/sizeof(uint64_t)]);
+			setup_valid();
+			if (!(mValid[(*mMask + 1) / 64] & 1)) {
+				rebuild_valid();  // file from before the valid bitmap
+			}
     }else{
 			assert(*mMaxNumElementsAllowed <= n_entries); // less due to load factor
 			assert(*mNumElements==0);
@@ -822,10 +885,37 @@ private:
 			mInfo[n_entries] = 1; // Sentinel
       *mInfoInc       = InitialInfoInc;
       *mInfoHashShift = InitialInfoHashShift;
+      *mPeakBits      = mmap_map_COUNT_TRAILING_ZEROES(n_entries);
+      *mDense         = dense_capable;  // new maps start dense, the first rehash decides
 			mKeyVals = reinterpret_cast<Node*>(&mmap_base[5+(*mMask+9)/sizeof(uint64_t)]); // 9 to be 8 byte aligned
+			setup_valid();
+			mValid[n_entries / 64] = 1;  // Sentinel
+		}
+	}
+
+	// The valid bitmap goes after the nodes (8 byte aligned)
+	void setup_valid() const {
+		auto end = reinterpret_cast<uintptr_t>(&mKeyVals[*mMask + 1]);
+		mValid   = reinterpret_cast<uint64_t *>((end + 7) & ~static_cast<uintptr_t>(7));
+	}
+
+	void rebuild_valid() const {
+		const size_t n_words = (*mMask + 1) / 64;
+		for (size_t w = 0; w < n_words; ++w) {
+			uint64_t bits = 0;
+			for (size_t i = 0; i < 64; ++i) {
+				if (mInfo[w * 64 + i])
+					bits |= UINT64_C(1) << i;
+			}
+			mValid[w] = bits;
 		}
+		mValid[n_words] = 1;  // Sentinel
 	}
 
+	void set_valid(size_t idx) { mValid[idx >> 6] |= UINT64_C(1) << (idx & 63); }
+	void clear_valid(size_t idx) { mValid[idx >> 6] &= ~(UINT64_C(1) << (idx & 63)); }
+	[[nodiscard]] bool is_valid(size_t idx) const { return (mValid[idx >> 6] >> (idx & 63)) & 1; }
+
   __attribute__((noinline,cold)) void setup_mmap_txt() const {
     if constexpr (!using_sview) {
       return;
@@ -897,9 +987,12 @@ private:
 
     reload();
 
-    idx = Hash::operator()(key) * bad_hash_prevention;
-		info = static_cast<InfoType>(*mInfoInc + static_cast<InfoType>(idx >> *mInfoHashShift));
-		idx &= *mMask;
+    // size_t: the info bits come from the top of the hash (mInfoHashShift is
+    // relative to 64 bits). With an int they could be negative, and shiftDown
+    // would leave an entry behind its home.
+    const size_t h = Hash::operator()(key) * bad_hash_prevention;
+		info = static_cast<InfoType>(*mInfoInc + static_cast<InfoType>(h >> *mInfoHashShift));
+		idx  = static_cast<int>(h & *mMask);
 	}
 
 	// forwards the index by one, wrapping around at the end
@@ -958,19 +1051,37 @@ private:
 		}
 	}
 
+	void eraseDense(size_t idx) {
+		if constexpr (using_val_ool) {
+			free_val(mKeyVals[idx].getSecond());
+		}
+		mKeyVals[idx].destroy(*this);
+		mKeyVals[idx].~Node();
+		clear_valid(idx);
+		--(*mNumElements);
+	}
+
 	void shiftDown(int idx) {
 		// until we find one that is either empty or has zero offset.
 		// TODO we don't need to move everything, just the last one for the same bucket.
+		if constexpr (using_val_ool) {
+			free_val(mKeyVals[idx].getSecond());
+		}
 		mKeyVals[idx].destroy(*this);
 
-		while (mInfo[idx+1] >= 2 * *mInfoInc) {
-			mInfo[idx] = static_cast<uint8_t>(mInfo[idx+1] - *mInfoInc);
-			//mKeyVals[idx] = std::move(mKeyVals[idx+1]);
-      std::memmove(&mKeyVals[idx], &mKeyVals[idx+1], sizeof(Node));
-			++idx;
+		// wrap around like insert/shiftUp, or entries wrapped to the start
+		// become unreachable
+		int next = next_idx(idx);
+		while (mInfo[next] >= 2 * *mInfoInc) {
+			mInfo[idx] = static_cast<uint8_t>(mInfo[next] - *mInfoInc);
+			//mKeyVals[idx] = std::move(mKeyVals[next]);
+      std::memmove(&mKeyVals[idx], &mKeyVals[next], sizeof(Node));
+			idx  = next;
+			next = next_idx(idx);
 		}
 
 		mInfo[idx] = 0;
+		clear_valid(idx);
 		// don't destroy, we've moved it
 		// mKeyVals[idx].destroy(*this);
 		mKeyVals[idx].~Node();
@@ -991,6 +1102,14 @@ private:
 	template <typename Other>
 		int findIdx(Other const& key) const {
       reload();
+			if constexpr (dense_capable) {
+				if (*mDense) {
+					const size_t id = dense_id<Key>{}(key);
+					if (id <= *mMask && is_valid(id))
+						return id;
+					return -1;
+				}
+			}
 			int idx;
 			InfoType info;
 			keyToIdx(key, idx, info);
@@ -1013,6 +1132,15 @@ private:
 			return -1; //*mMask == 0 ? 0 : *mMask + 1;
 		}
 
+	// insert_move for the dense layout
+	void insert_move_dense(Node&& keyval) {
+		const size_t id = dense_id<Key>{}(keyval.getFirst());
+		assert(id <= *mMask && !is_valid(id));
+		std::memmove(&mKeyVals[id], &keyval, sizeof(Node));
+		set_valid(id);
+		++(*mNumElements);
+	}
+
 	// inserts a keyval that is guaranteed to be new, e.g. when the hashmap is resized.
 	// @return index where the element was created
 	size_t insert_move(Node&& keyval) {
@@ -1065,8 +1193,9 @@ private:
 
 		// put at empty spot
 		mInfo[insertion_idx] = insertion_info;
+		set_valid(idx);  // the empty spot is used (directly or by the shift)
 #ifndef NDEBUG
-		static int conta=0;
+		static thread_local int conta=0;  // concurrent_map shards insert from several threads
 		if (((++conta)&0xFFFF)==0 && *mNumElements>100) {
 			if (conflict_factor()>0.05) {
 				std::cerr << "potential bad hash for mmap_name:" << mmap_name << ", conflicts " << conflicts << "try to debug it\n";
@@ -1083,6 +1212,104 @@ private:
   static inline uint64_t static_mMaxNumElementsAllowed = 0;
   static inline InfoType static_InitialInfoInc         = InitialInfoInc;
   static inline InfoType static_InitialInfoHashShift   = InitialInfoHashShift;
+  static inline uint32_t static_mPeakBits              = 0;
+  static inline uint32_t static_mDense                 = 0;
+
+  // Out of line values change the Node layout, so those maps use the "_ool"
+  // file. A file with the plain name has the values inline (written before
+  // out of line values). Copy its entries and remove it. A file that does not
+  // look like a map is left alone (with a warning), the map starts empty.
+  __attribute__((noinline,cold)) void migrate_inline_file(const std::string &name) {
+    struct stat sb;
+    if (stat(name.c_str(), &sb) != 0 || sb.st_size == 0)
+      return;
+    if (stat(mmap_name.c_str(), &sb) == 0) {
+      std::cerr << "mmap_lib::map WARNING " << name << " (inline values) ignored, " << mmap_name << " already exists\n";
+      return;
+    }
+
+    using Inline_node = mmap_lib::pair<typename value_type::first_type, T>;
+
+    auto map_file = [](const std::string &fname, size_t &size) -> const uint64_t * {
+      int fd = ::open(fname.c_str(), O_RDONLY);
+      if (fd < 0)
+        return nullptr;
+      struct stat fsb;
+      void       *base = MAP_FAILED;
+      if (fstat(fd, &fsb) == 0 && fsb.st_size > 0) {
+        size = fsb.st_size;
+        base = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      ::close(fd);
+      return base == MAP_FAILED ? nullptr : reinterpret_cast<const uint64_t *>(base);
+    };
+
+    size_t      size = 0;
+    const auto *base = map_file(name, size);
+    if (base == nullptr) {
+      std::cerr << "mmap_lib::map WARNING could not read " << name << " (inline values), not migrated\n";
+      return;
+    }
+
+    // Same layout as setup_mmap/setup_valid, with Inline_node nodes
+    const size_t n_entries = base[0] + 1;
+    const size_t nodes_pos = 5 + (base[0] + 9) / sizeof(uint64_t);
+    const size_t valid_end = (nodes_pos * sizeof(uint64_t) + n_entries * sizeof(Inline_node) + 7) / sizeof(uint64_t) + n_entries / 64 + 1;
+    const bool   dense     = size >= 5 * sizeof(uint64_t) && reinterpret_cast<const uint32_t *>(&base[3])[1];
+
+    bool ok = size >= 5 * sizeof(uint64_t) && n_entries && (n_entries & (n_entries - 1)) == 0
+              && n_entries < size / sizeof(Inline_node)  // no overflow in the next check
+              && nodes_pos * sizeof(uint64_t) + n_entries * sizeof(Inline_node) <= size
+              && (!dense || valid_end * sizeof(uint64_t) <= size);
+    if (!ok) {
+      std::cerr << "mmap_lib::map WARNING " << name << " is not a map with " << sizeof(T) << " byte values, not migrated\n";
+      munmap(const_cast<uint64_t *>(base), size);
+      return;
+    }
+
+    const auto *info  = reinterpret_cast<const uint8_t *>(&base[5]);
+    const auto *nodes = reinterpret_cast<const Inline_node *>(&base[nodes_pos]);
+    const auto *valid = &base[valid_end - (n_entries / 64 + 1)];
+
+    size_t          txt_size = 0;
+    const uint64_t *txt      = nullptr;
+    if constexpr (using_key_sview) {
+      txt = map_file(name + "txt", txt_size);
+      if (txt == nullptr) {
+        std::cerr << "mmap_lib::map WARNING " << name << "txt is missing, " << name << " not migrated\n";
+        munmap(const_cast<uint64_t *>(base), size);
+        return;
+      }
+    }
+
+    for (size_t i = 0; i < n_entries; ++i) {
+      bool used = dense ? ((valid[i >> 6] >> (i & 63)) & 1) : info[i] != 0;
+      if (!used)
+        continue;
+
+      if constexpr (using_key_sview) {
+        using tt      = typename array_type::value_type;
+        const auto &n = nodes[i];
+        if (n.first + 1 >= txt_size / sizeof(uint64_t) || txt[n.first] > txt_size - (n.first + 1) * sizeof(uint64_t))
+          continue;  // not a txt entry
+        const char *c = reinterpret_cast<const char *>(&txt[n.first + 1]);
+        if constexpr (std::is_same_v<array_type, std::string_view>) {
+          set(Key(c, txt[n.first]), n.second);
+        } else {
+          set(Key(reinterpret_cast<const tt *>(c), reinterpret_cast<const tt *>(c + txt[n.first])), n.second);
+        }
+      } else {
+        set(nodes[i].first, nodes[i].second);
+      }
+    }
+
+    munmap(const_cast<uint64_t *>(base), size);
+    if constexpr (using_key_sview) {
+      munmap(const_cast<uint64_t *>(txt), txt_size);
+      unlink((name + "txt").c_str());
+    }
+    unlink(name.c_str());
+  }
 
   void setup_pointers() {
 
@@ -1093,6 +1320,8 @@ private:
 		mMaxNumElementsAllowed = &static_mMaxNumElementsAllowed;
 		mInfoInc               = &static_InitialInfoInc;
 		mInfoHashShift         = &static_InitialInfoHashShift;
+		mPeakBits              = &static_mPeakBits;
+		mDense                 = &static_mDense;
 
 #if 0
     for(auto &ent:memoize_sview_insert) {
@@ -1107,25 +1336,65 @@ public:
 	explicit map(std::string_view _path, std::string_view _map_name)
 		: Hash{Hash{}}
 	  , mmap_path(_path.empty()?".":_path)
-	  , mmap_name{_map_name.empty()?"":(std::string(_path) + std::string("/") + std::string(_map_name))} {
+	  , mmap_name{_map_name.empty()?"":(std::string(_path) + std::string("/") + std::string(_map_name) + (using_val_ool ? "_ool" : ""))} {
 
     if (mmap_path != ".") {
-			struct stat sb;
-      if (stat(mmap_path.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) {
-        int e = mkdir(mmap_path.c_str(), 0755);
-        assert(e>=0);
+      mmap_gc::setup_path(mmap_path);
+    }
+
+    if constexpr (using_val_ool) {
+      if (mmap_name.empty()) {
+        mVals = std::make_unique<vals_type>();
+      } else {
+        mVals = std::make_unique<vals_type>(_path, std::string(_map_name) + "data");
       }
     }
 
     setup_pointers();
+
+    if constexpr (using_val_ool) {
+      if (!mmap_name.empty()) {
+        migrate_inline_file(std::string(_path) + std::string("/") + std::string(_map_name));
+      }
+    }
 	}
 
 	explicit map()
 		: Hash{Hash{}} {
 
+    if constexpr (using_val_ool) {
+      mVals = std::make_unique<vals_type>();
+    }
+
     setup_pointers();
 	}
 
+  // The mmap is lazy (first access). Map it now, so that later concurrent
+  // readers (find/get/has) do not race setting it up.
+  void preload() const {
+    reload();
+    if constexpr (using_val_ool) {
+      (void)mVals->size();  // maps it
+    }
+  }
+
+  // While pinned, mmap_gc does not recycle the mmap, not even when out of
+  // fds/mmaps (a live iterator may be forced), so other threads do not find
+  // it unmapped.
+  void gc_pin() const {
+    n_pins++;
+    if constexpr (using_val_ool) {
+      mVals->gc_pin();
+    }
+  }
+  void gc_unpin() const {
+    assert(n_pins > 0);
+    n_pins--;
+    if constexpr (using_val_ool) {
+      mVals->gc_unpin();
+    }
+  }
+
 	map(map&& o) = delete;
 	map& operator=(map&& o) = delete;
 	map(const map& o) = delete;
@@ -1141,6 +1410,11 @@ public:
     }
     mmap_base = nullptr;
     mmap_size = 0;
+    setup_pointers();  // size()/empty() do not reload, do not point to the recycled mmap
+
+    if constexpr (using_val_ool) {
+      mVals->clear();
+    }
 
     if constexpr (using_sview) {
       assert(using_sview);
@@ -1238,7 +1512,11 @@ public:
     const auto idx = findIdx(key);
     assert(idx>=0);
 
-    return mKeyVals[idx].getSecond();
+    if constexpr (using_val_ool) {
+      return (*mVals)[mKeyVals[idx].getSecond()];
+    }else{
+      return mKeyVals[idx].getSecond();
+    }
   }
 
   template<typename T_ = T, typename = std::enable_if_t<is_array_serializable<T_>::value>>
@@ -1256,7 +1534,11 @@ public:
   template<typename T_ = T, typename = std::enable_if_t<!is_array_serializable<T_>::value>>
 	[[nodiscard]] const T &get(const const_iterator &it) const {
     static_assert(!using_val_sview,"mmap_lib::map::get should not be called when 'value' is array_serializable. Use get_sview instead.\n");
-    return it->second;
+    if constexpr (using_val_ool) {
+      return (*mVals)[it.mKeyVals->getSecond()];
+    }else{
+      return it->second;
+    }
 	}
 
 	[[nodiscard]] Key get_key(const const_iterator &it) const {
@@ -1266,7 +1548,7 @@ public:
       return it->first;
     }
 	}
-	[[nodiscard]] Key get_key(const value_type &it) const {
+	[[nodiscard]] Key get_key(const iter_value_type &it) const {
 		if constexpr (using_key_sview) {
       return get_sview(it.first);
     }else{
@@ -1280,25 +1562,34 @@ public:
 		auto idx = findIdx(key);
 		assert(idx>=0);
 
-    return &mKeyVals[idx].getSecond();
+    if constexpr (using_val_ool) {
+      return mVals->ref(mKeyVals[idx].getSecond());
+    }else{
+      return &mKeyVals[idx].getSecond();
+    }
 	}
 
 	[[nodiscard]] T *ref(const value_type& it) {
     static_assert(!using_val_sview,"mmap_lib::map::ref can not be called for array_serializable. Use get_sview instead.\n");
+    static_assert(!using_val_ool,"mmap_lib::map::ref the iterator value is a copy for wide values. Use ref(iterator) or ref(key) instead.\n");
 
     return &it.second;
 	}
 
 	[[nodiscard]] T *ref(iterator &it) {
     static_assert(!using_val_sview,"mmap_lib::map::ref can not be called for array_serializable. Use get_sview instead.\n");
-    return &it->second;
+    if constexpr (using_val_ool) {
+      return mVals->ref(it.mKeyVals->getSecond());
+    }else{
+      return &it->second;
+    }
 	}
 
 	[[nodiscard]] const_iterator find(const key_type& key) const {
 		const auto idx = findIdx(key);
     if (idx<0)
       return end();
-		return const_iterator{this, mKeyVals + idx, mInfo + idx};
+		return const_iterator{this, mKeyVals + idx};
 	}
 
 	template <typename OtherKey>
@@ -1306,14 +1597,14 @@ public:
 			const auto idx = findIdx(key);
       if (idx<0)
         return cend();
-			return const_iterator{this, mKeyVals + idx, mInfo + idx};
+			return const_iterator{this, mKeyVals + idx};
 		}
 
 	[[nodiscard]] iterator find(const key_type& key) {
 		const auto idx = findIdx(key);
     if (idx<0)
       return end();
-		return iterator{this, mKeyVals + idx, mInfo + idx};
+		return iterator{this, mKeyVals + idx};
 	}
 
 	template <typename OtherKey>
@@ -1321,7 +1612,7 @@ public:
 			const auto idx = findIdx(key);
       if (idx<0)
         return end();
-			return iterator{this, mKeyVals + idx, mInfo + idx};
+			return iterator{this, mKeyVals + idx};
 		}
 
 	[[nodiscard]] iterator begin() {
@@ -1330,7 +1621,7 @@ public:
 		if (empty()) {
 			return end();
 		}
-		return iterator{this, mKeyVals, mInfo, fast_forward_tag{}};
+		return iterator{this, mKeyVals, fast_forward_tag{}};
 	}
 	[[nodiscard]] const_iterator begin() const {
 		return cbegin();
@@ -1341,26 +1632,26 @@ public:
 		if (empty()) {
 			return cend();
 		}
-		return const_iterator{this, mKeyVals, mInfo, fast_forward_tag{}};
+		return const_iterator{this, mKeyVals, fast_forward_tag{}};
 	}
 
 	[[nodiscard]] iterator end() {
     reload();
 		// no need to supply valid info pointer: end() must not be dereferenced, and only node
 		// pointer is compared.
-		return iterator{this, reinterpret_cast<Node*>(&mKeyVals[*mMask+1]), nullptr};
+		return iterator{this, reinterpret_cast<Node*>(&mKeyVals[*mMask+1])};
 	}
 	[[nodiscard]] const_iterator end() const {
 		return cend();
 	}
 	[[nodiscard]] const_iterator cend() const {
     reload();
-		return const_iterator{this, reinterpret_cast<Node*>(&mKeyVals[*mMask+1]), nullptr};
+		return const_iterator{this, reinterpret_cast<Node*>(&mKeyVals[*mMask+1])};
 	}
 
 	iterator erase(const_iterator &pos) {
 		// its safe to perform const cast here
-		return erase(iterator{nullptr, const_cast<Node*>(pos.mKeyVals), const_cast<uint8_t*>(pos.mInfo)});
+		return erase(iterator{this, const_cast<Node*>(pos.mKeyVals)});
 	}
 
 	// Erases element at pos, returns iterator to the next element.
@@ -1368,10 +1659,17 @@ public:
 		// we assume that pos always points to a valid entry, and not end().
 		auto const idx = static_cast<size_t>(pos.mKeyVals - mKeyVals);
 
+		if constexpr (dense_capable) {
+			if (*mDense) {
+				eraseDense(idx);
+				return ++pos;
+			}
+		}
+
 		shiftDown(idx);
 		--(*mNumElements);
 
-		if (*pos.mInfo) {
+		if (is_valid(idx)) {
 			// we've backward shifted, return this again
 			return pos;
 		}
@@ -1381,6 +1679,18 @@ public:
 	}
 
 	size_t erase(const key_type& key) {
+		if constexpr (dense_capable) {
+			reload();
+			if (*mDense) {
+				const size_t id = dense_id<Key>{}(key);
+				if (id > *mMask || !is_valid(id))
+					return 0;
+				// No shrink, the max id does not go down (next rehash may go sparse)
+				eraseDense(id);
+				return 1;
+			}
+		}
+
 		int idx;
 		InfoType info;
 		keyToIdx(key, idx, info);
@@ -1390,6 +1700,9 @@ public:
 			if (info == mInfo[idx] && equals(key, mKeyVals[idx].getFirst())) {
 				shiftDown(idx);
 				--(*mNumElements);
+				if (MMAP_LIB_UNLIKELY(*mNumElements < *mMaxNumElementsAllowed / 8)) {
+					try_decrease_size();
+				}
 				return 1;
 			}
       idx  = next_idx(idx);
@@ -1427,6 +1740,15 @@ public:
 		return calcMaxNumElementsAllowed(InitialNumElements);
 	}
 
+	// Slots directly indexed by the key id (no hashing)
+	[[nodiscard]] bool is_dense() const {
+		if constexpr (dense_capable) {
+			reload();
+			return *mDense;
+		}
+		return false;
+	}
+
 	[[nodiscard]] float max_load_factor() const {
 		return MaxLoadFactor100 / 100.0f;
 	}
@@ -1453,14 +1775,37 @@ public:
 #endif
 
 private:
-	void rehash(size_t numBuckets) {
+	// numBuckets is the sparse size. new_id is the id being inserted (dense)
+	void rehash(size_t numBuckets, size_t new_id = 0) {
 		assert(MMAP_LIB_UNLIKELY((numBuckets & (numBuckets - 1)) == 0)); // rehash only allowed for power of two
 
     reload();
 
 		const size_t oldMaxElements = *mMask + 1;
-		if (oldMaxElements >= numBuckets)
-			return; // done
+		bool dense = false;
+		if constexpr (dense_capable) {
+			// Dense if the table indexed by id is at most 2x the sparse one
+			size_t max_id = new_id;
+			for (size_t w = 0; w < oldMaxElements / 64; ++w) {
+				for (auto bits = mValid[w]; bits; bits &= bits - 1) {
+					auto i = w * 64 + mmap_map_COUNT_TRAILING_ZEROES(bits);
+					max_id = std::max(max_id, static_cast<size_t>(dense_id<Key>{}(mKeyVals[i].getFirst())));
+				}
+			}
+			size_t denseBuckets = InitialNumElements;
+			while (denseBuckets <= max_id) {
+				denseBuckets *= 2;
+			}
+			if (denseBuckets <= 2 * numBuckets) {
+				dense       = true;
+				numBuckets  = denseBuckets;
+			}
+			if (oldMaxElements == numBuckets && dense == static_cast<bool>(*mDense))
+				return; // done
+		} else {
+			if (oldMaxElements == numBuckets)
+				return; // done
+		}
 
     if (mmap_fd >= 0) {
       mmap_gc::delete_file(mmap_base);
@@ -1471,7 +1816,8 @@ private:
 		const size_t  old_mmap_size = mmap_size;
 
 		Node* const oldKeyVals        = mKeyVals;
-		uint8_t const* const oldInfo  = mInfo;
+		uint64_t const* const oldValid = mValid;
+		const uint32_t oldPeakBits     = *mPeakBits;
 
     assert(mmap_fd == -1);
     mmap_base = nullptr;
@@ -1479,16 +1825,27 @@ private:
 
     assert(old_mmap_base != mmap_base);
     assert(oldKeyVals != mKeyVals);
-    assert(oldInfo != mInfo);
+    assert(oldValid != mValid);
 		assert(*mNumElements == 0);
 		assert(*mMask == numBuckets - 1);
 		assert(*mMaxNumElementsAllowed == calcMaxNumElementsAllowed(numBuckets));
+		if (oldPeakBits > *mPeakBits)
+			*mPeakBits = oldPeakBits;
+		*mDense = dense;
 
 		//std::cout << "resize sz:" << numBuckets << " mmap_name:" << mmap_name << "\n";
 
-		for (size_t i = 0; i < oldMaxElements; ++i) {
-			if (oldInfo[i] != 0) {
-				insert_move(std::move(oldKeyVals[i]));
+		for (size_t w = 0; w < oldMaxElements / 64; ++w) {
+			for (auto bits = oldValid[w]; bits; bits &= bits - 1) {
+				auto i = w * 64 + mmap_map_COUNT_TRAILING_ZEROES(bits);
+				if constexpr (dense_capable) {
+					if (dense)
+						insert_move_dense(std::move(oldKeyVals[i]));
+					else
+						insert_move(std::move(oldKeyVals[i]));
+				} else {
+					insert_move(std::move(oldKeyVals[i]));
+				}
 				// destroy the node but DON'T destroy the data.
 				oldKeyVals[i].~Node();
 			}
@@ -1568,9 +1925,77 @@ private:
 		return insert_point;
 	}
 
+	// Out of line values. Erased slots are reused (free list in the vector
+	// config data, the next free is stored in the slot)
+	template <typename Data>
+	uint32_t set_val(bool found, size_t idx, Data&& val) {
+		if (found) {
+			uint32_t pos = mKeyVals[idx].getSecond();
+			T *ptr = mVals->ref(pos);
+			ptr->~T();
+			::new (static_cast<void *>(ptr)) T(std::forward<Data>(val));
+			return pos;
+		}
+
+		auto *free_head = mVals->ref_config_data(8);
+		if (*free_head) {
+			uint32_t pos = *free_head - 1;
+			T *ptr = mVals->ref(pos);
+			uint32_t next;
+			std::memcpy(&next, static_cast<void *>(ptr), sizeof(next));
+			*free_head = next;
+			::new (static_cast<void *>(ptr)) T(std::forward<Data>(val));
+			return pos;
+		}
+
+		mVals->emplace_back(std::forward<Data>(val));
+		return mVals->size() - 1;
+	}
+
+	void free_val(uint32_t pos) {
+		auto *free_head = mVals->ref_config_data(8);
+		uint32_t next = *free_head;
+		T *ptr = mVals->ref(pos);
+		ptr->~T();
+		std::memcpy(static_cast<void *>(ptr), &next, sizeof(next));
+		*free_head = pos + 1;
+	}
+
 	template <typename Arg, typename Data>
 		iterator doCreate(Arg&& key, Data&& val) {
 			while (true) {
+				if constexpr (dense_capable) {
+					reload();
+					if (*mDense) {
+						const size_t id = dense_id<Key>{}(key);
+						if (MMAP_LIB_UNLIKELY(id > *mMask)) {
+							increase_size_dense(id);
+							continue;
+						}
+						// overwrite if found (like the sparse path)
+						if constexpr (using_val_ool) {
+							uint32_t val_pos = set_val(is_valid(id), id, val);
+							::new (static_cast<void*>(&mKeyVals[id]))
+								Node(*this, std::piecewise_construct,
+										std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
+						}else if constexpr (using_val_sview) {
+							uint32_t val_pos = allocate_sview_id(val);
+							::new (static_cast<void*>(&mKeyVals[id]))
+								Node(*this, std::piecewise_construct,
+										std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
+						}else{
+							::new (static_cast<void*>(&mKeyVals[id]))
+								Node(*this, std::piecewise_construct,
+										std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val));
+						}
+						if (!is_valid(id)) {
+							set_valid(id);
+							++(*mNumElements);
+						}
+						return iterator{this, mKeyVals + id};
+					}
+				}
+
 				int idx;
 				InfoType info;
 				keyToIdx(key, idx, info);
@@ -1613,7 +2038,19 @@ private:
 				if (idx == insertion_idx) {
 					// put at empty spot. This forwards all arguments into the node where the object is
 					// constructed exactly where it is needed.
-					if constexpr (using_key_sview) {
+					if constexpr (using_val_ool) {
+						uint32_t val_pos = set_val(found, insertion_idx, val);
+						if constexpr (using_key_sview) {
+							uint32_t key_pos = allocate_sview_id(key);
+							::new (static_cast<void*>(&l))
+								Node(*this, std::piecewise_construct,
+										std::forward_as_tuple(key_pos), std::forward_as_tuple(val_pos));
+						}else{
+							::new (static_cast<void*>(&l))
+								Node(*this, std::piecewise_construct,
+										std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
+						}
+					}else if constexpr (using_key_sview) {
 						uint32_t key_pos = allocate_sview_id(key);
 						::new (static_cast<void*>(&l))
 							Node(*this, std::piecewise_construct,
@@ -1631,7 +2068,17 @@ private:
 				} else {
           assert(!found);
 					shiftUp(idx, insertion_idx);
-					if constexpr (using_key_sview) {
+					if constexpr (using_val_ool) {
+						uint32_t val_pos = set_val(false, insertion_idx, val);
+						if constexpr (using_key_sview) {
+							uint32_t key_pos = allocate_sview_id(key);
+							::new (&l) Node(*this, std::piecewise_construct,
+									std::forward_as_tuple(key_pos), std::forward_as_tuple(val_pos));
+						}else{
+							::new (&l) Node(*this, std::piecewise_construct,
+									std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
+						}
+					}else if constexpr (using_key_sview) {
 						uint32_t key_pos = allocate_sview_id(key);
             ::new (&l) Node(*this, std::piecewise_construct,
 								std::forward_as_tuple(key_pos), std::forward_as_tuple(val));
@@ -1648,11 +2095,12 @@ private:
         if (!found) {
           // mKeyVals[idx].getFirst() = std::move(key);
           mInfo[insertion_idx] = static_cast<uint8_t>(insertion_info);
+          set_valid(idx);  // the empty spot is used (directly or by the shift)
 
           ++(*mNumElements);
         }
 
-				return iterator{this, mKeyVals + insertion_idx, mInfo + insertion_idx};
+				return iterator{this, mKeyVals + insertion_idx};
         //return;
 			}
 		}
@@ -1712,7 +2160,39 @@ private:
 		// it seems we have a really bad hash function! don't try to resize again
 		assert(*mNumElements * 2 >= calcMaxNumElementsAllowed(*mMask + 1));
 
-		rehash((*mMask + 1) * 2);
+		// Quad expansion when the map was (at least) that big before a
+		// decrease_size: it is likely to go back to the same size.
+		auto const bits = mmap_map_COUNT_TRAILING_ZEROES(*mMask + 1);
+		if (*mPeakBits >= static_cast<uint32_t>(bits + 2))
+			rehash((*mMask + 1) * 4);
+		else
+			rehash((*mMask + 1) * 2);
+	}
+
+	// id does not fit in the dense table. Rehash to dense (if still dense
+	// enough) or to sparse
+	void increase_size_dense(size_t id) {
+		size_t numBuckets = InitialNumElements;
+		while (calcMaxNumElementsAllowed(numBuckets) <= *mNumElements) {
+			numBuckets *= 2;
+		}
+		rehash(numBuckets, id);
+	}
+
+	// Called when the load drops under 10% (erase). The file keeps its
+	// peak size otherwise (mmap and page cache). Rehash to the smallest size
+	// with 40% load (no resize ping-pong), the new file is smaller.
+	// Iterators would be invalidated, so skip while any is alive.
+	void try_decrease_size() {
+		if (*mMask + 1 <= InitialNumElements || iter_cntr)
+			return;
+
+		size_t newSize = InitialNumElements;
+		while (calcMaxNumElementsAllowed(newSize) / 2 < *mNumElements) {
+			newSize *= 2;
+		}
+		if (newSize <= (*mMask + 1) / 2)
+			rehash(newSize);
 	}
 
 	void destroy() {
@@ -1738,17 +2218,23 @@ private:
 
 	mutable Node      *mKeyVals = nullptr;
 	mutable uint8_t   *mInfo = nullptr;
+	mutable uint64_t  *mValid = nullptr;  // 1 bit per slot (iteration)
 	mutable uint64_t  *mNumElements;
 	mutable uint64_t  *mMask;
 	mutable uint64_t  *mMaxNumElementsAllowed;
 	mutable InfoType  *mInfoInc;
 	mutable InfoType  *mInfoHashShift;
+	mutable uint32_t  *mPeakBits;  // log2 of the largest mask+1 (quad expansion)
+	mutable uint32_t  *mDense;     // 1 when mKeyVals is indexed by dense_id
+	using vals_type = vector<typename std::conditional<using_val_ool, T, uint8_t>::type>;
+	std::unique_ptr<vals_type> mVals;  // out of line values (using_val_ool)
 	const std::string  mmap_name;
 	const std::string  mmap_path;
 	mutable int        mmap_fd       = -1;
 	mutable size_t     mmap_size     = 0;
 	mutable uint64_t  *mmap_base     = 0;
-  mutable int        iter_cntr     = 0;
+	mutable std::atomic<int> iter_cntr{0};  // concurrent readers create iterators too
+	mutable std::atomic<int> n_pins{0};     // gc_pin
 	mutable int        mmap_txt_fd   = -1;
 	mutable size_t     mmap_txt_size = 0;
 	mutable uint64_t  *mmap_txt_base = 0;
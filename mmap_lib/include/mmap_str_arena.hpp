@@ -0,0 +1,152 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "mmap_hash.hpp"
+#include "mmap_vector.hpp"
+
+namespace mmap_lib {
+
+// Append only string interning arena. Each different string is stored once
+// and gets a 32 bit id (0 is invalid), id to string_view is a direct access.
+//
+// _txt:   [len][chars padded to 8 bytes] per string, the id is the position
+// _table: open addressing hash of ids (0 empty), power of 2, rebuilt from
+//         _txt when it grows
+//
+// Strings are never removed (clear drops all). Like mmap_lib::map string
+// values, a string_view may move when a new string is added (the txt grows).
+// Not thread safe.
+class str_arena {
+protected:
+  static constexpr size_t min_table_size = 1024;
+
+  mutable vector<uint64_t> txt;
+  mutable vector<uint32_t> table;
+
+  uint64_t *ref_n_strings() const { return table.ref_config_data(8); }
+
+  static uint32_t hash(std::string_view str) { return static_cast<uint32_t>(hash64(str.data(), str.size())); }
+
+  uint32_t next_id(uint32_t id) const { return id + 1 + (txt[id] + 7) / 8; }
+
+  // Position in table of str, or the empty entry where it goes
+  size_t lookup(std::string_view str) const {
+    const auto *base = table.begin();
+    size_t      mask = table.size() - 1;
+    for (size_t pos = hash(str) & mask;; pos = (pos + 1) & mask) {
+      auto id = base[pos];
+      if (id == 0 || get(id) == str)
+        return pos;
+    }
+  }
+
+  void insert_id(uint32_t id) {
+    auto  *base = table.begin();
+    size_t mask = table.size() - 1;
+    size_t pos  = hash(get(id)) & mask;
+    while (base[pos] != 0) {
+      pos = (pos + 1) & mask;
+    }
+    base[pos] = id;
+  }
+
+  void rehash(size_t sz) {
+    auto n = *ref_n_strings();
+    table.clear();
+    table.reserve(sz);
+    for (size_t i = 0; i < sz; ++i) {
+      table.emplace_back(0);
+    }
+    *ref_n_strings() = n;
+
+    for (uint32_t id = 1, end = txt.size(); id < end; id = next_id(id)) {
+      insert_id(id);
+    }
+  }
+
+public:
+  explicit str_arena(std::string_view _path, std::string_view _map_name)
+      : txt(_path, std::string(_map_name) + "_txt"), table(_path, std::string(_map_name) + "_table") {}
+
+  explicit str_arena() {}  // anonymous (not persisted)
+
+  [[nodiscard]] uint32_t find(std::string_view str) const {
+    if (table.empty())
+      return 0;
+    return table[lookup(str)];
+  }
+
+  [[nodiscard]] bool has(std::string_view str) const { return find(str) != 0; }
+
+  // Id of str, added if it was not there
+  uint32_t intern(std::string_view str) {
+    if (table.empty()) {
+      rehash(min_table_size);
+    }
+
+    auto pos = lookup(str);
+    if (table[pos] != 0)
+      return table[pos];
+
+    auto n_words = 1 + (str.size() + 7) / 8;
+    if (txt.empty()) {
+      txt.emplace_back(0);  // id 0 is invalid
+    }
+    assert(txt.size() + n_words < UINT32_MAX);
+
+    uint32_t id = txt.size();
+    txt.reserve(id + n_words);
+    for (size_t i = 0; i < n_words; ++i) {
+      txt.emplace_back(0);
+    }
+    auto *data = txt.ref(id);
+    data[0]    = str.size();
+    std::memcpy(&data[1], str.data(), str.size());
+
+    table.begin()[pos] = id;
+    auto n             = ++(*ref_n_strings());
+    if (2 * n > table.size()) {
+      rehash(2 * table.size());
+    }
+
+    return id;
+  }
+
+  [[nodiscard]] std::string_view get(uint32_t id) const {
+    assert(id > 0 && id < txt.size());
+    const auto *data = txt.ref(id);
+    return std::string_view(reinterpret_cast<const char *>(&data[1]), data[0]);
+  }
+
+  [[nodiscard]] size_t size() const { return table.empty() ? 0 : *ref_n_strings(); }
+  [[nodiscard]] bool   empty() const { return size() == 0; }
+
+  // Bytes used by the strings
+  [[nodiscard]] size_t txt_size() const { return txt.size() * sizeof(uint64_t); }
+
+  void preload() const {
+    txt.begin();
+    table.begin();
+  }
+  void gc_pin() const {
+    txt.gc_pin();
+    table.gc_pin();
+  }
+  void gc_unpin() const {
+    table.gc_unpin();
+    txt.gc_unpin();
+  }
+
+  void clear() {
+    txt.clear();
+    table.clear();
+  }
+};
+
+}  // namespace mmap_lib
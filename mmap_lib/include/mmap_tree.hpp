@@ -650,11 +650,7 @@ template <typename X>
 tree<X>::tree(std::string_view _path, std::string_view _map_name)
     : mmap_path(_path.empty() ? "." : _path), mmap_name{std::string(_path) + std::string("/") + std::string(_map_name)} {
   if (mmap_path != ".") {
-    struct stat sb;
-    if (stat(mmap_path.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) {
-      int e = mkdir(mmap_path.c_str(), 0755);
-      I(e >= 0);
-    }
+    mmap_gc::setup_path(mmap_path);
   }
 
   pending_parent = -1;  // Nobody pending
@@ -7,7 +7,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstring>
 #include <functional>
 #include <iostream>
 
@@ -92,7 +95,8 @@ protected:
 
     void *base;
     std::tie(base, mmap_size) = mmap_gc::mmap(mmap_name, mmap_fd, mmap_size,
-                                              std::bind(&vector<T>::gc_done, this, std::placeholders::_1, std::placeholders::_2));
+                                              std::bind(&vector<T>::gc_done, this, std::placeholders::_1, std::placeholders::_2),
+                                              &n_pins);
 
     entries_capacity = (mmap_size - 4096) / sizeof(T);
     mmap_base        = reinterpret_cast<uint8_t *>(base);
@@ -146,10 +150,14 @@ protected:
   mutable int       mmap_fd;
   const std::string mmap_path;
   const std::string mmap_name;
+  mutable std::atomic<int> n_pins{0};  // gc_pin (concurrent readers)
 
   bool gc_done(void *base, bool force_recycle) const {
     assert(base == mmap_base);
 
+    if (n_pins && !force_recycle)
+      return true;  // abort
+
     if (mmap_fd >= 0 && *entries_size == 0) {
       unlink(mmap_name.c_str());
     }
@@ -194,11 +202,7 @@ public:
       , mmap_path(_path.empty() ? "." : _path)
       , mmap_name{std::string(_path) + std::string("/") + std::string(_map_name)} {
     if (mmap_path != ".") {
-      struct stat sb;
-      if (stat(mmap_path.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) {
-        int e = mkdir(mmap_path.c_str(), 0755);
-        assert(e >= 0);
-      }
+      mmap_gc::setup_path(mmap_path);
     }
   }
 
@@ -211,8 +215,18 @@ public:
     }
   }
 
+  // While pinned, mmap_gc does not recycle the mmap, not even when out of fds/mmaps (other threads may read it)
+  void gc_pin() const { n_pins++; }
+  void gc_unpin() const {
+    assert(n_pins > 0);
+    n_pins--;
+  }
+
   // Allocates space, but it does not touch contents
-  void reserve(size_t n) const { reserve_int(n); }
+  void reserve(size_t n) const {
+    ref_base();  // map the existing file first (also after clear/recycle, mmap_size is stale then)
+    reserve_int(n);
+  }
 
   void emplace_back() {
     ref_base();
@@ -234,6 +248,23 @@ public:
     (*entries_size)++;
   }
 
+  // Appends n entries copied from data (grows once, T must be trivially copyable)
+  void append(const T *data, size_t n) {
+    auto *base = ref_base();
+    if (MMAP_LIB_UNLIKELY(capacity() <= *entries_size + n)) {
+      base = reserve_int(size() + n);
+    }
+
+    memcpy(static_cast<void *>(&base[*entries_size]), data, n * sizeof(T));
+    (*entries_size) += n;
+  }
+
+  void pop_back() {
+    ref_base();
+    assert(*entries_size);
+    (*entries_size)--;
+  }
+
 #if 0
   template <typename Data>
     T *doCreate(const size_t idx, Data&& val) {
@@ -316,6 +347,13 @@ public:
     assert(entries_size == nullptr);
   }
 
+  // Unmaps and closes the file (it stays unless empty). The next access maps it
+  // again, for a file replaced on disk (rename over it).
+  void unmap() const {
+    if (mmap_base != nullptr)
+      mmap_gc::recycle(mmap_base);
+  }
+
   [[nodiscard]] inline std::string_view get_name() const { return mmap_name; }
   [[nodiscard]] inline std::string_view get_path() const { return mmap_path; }
 
@@ -340,6 +378,64 @@ public:
   }
 
   bool empty() const { return size() == 0; }
+
+  [[nodiscard]] bool is_mapped() const { return mmap_base != nullptr; }
+
+  // Copies up to n entries starting at pos to buf (stops at size()), returns
+  // how many were copied. If the vector is not mapped yet, it reads the file
+  // (pread) and leaves it unmapped: a quick query on many files does not
+  // mmap (and gc recycle) each of them. Entries keep their offset in the
+  // 4096 byte pages, if buf is page aligned and pos is a multiple of
+  // 4096/sizeof(T), pointer arithmetic within a page works like in the mmap.
+  size_t peek(size_t pos, size_t n, T *buf) const {
+    if (mmap_base != nullptr || mmap_name.empty()) {
+      auto sz = size();
+      if (pos >= sz)
+        return 0;
+      n = std::min(n, sz - pos);
+      memcpy(static_cast<void *>(buf), &ref_base()[pos], n * sizeof(T));
+      return n;
+    }
+
+    int fd = ::open(mmap_name.c_str(), O_RDONLY);
+    if (fd < 0)
+      return 0;  // not created yet (empty)
+
+    uint64_t sz = 0;
+    if (pread(fd, &sz, sizeof(sz), 0) != sizeof(sz) || pos >= sz) {
+      ::close(fd);
+      return 0;
+    }
+    n = std::min<size_t>(n, sz - pos);
+
+    auto bytes = pread(fd, static_cast<void *>(buf), n * sizeof(T), 4096 + pos * sizeof(T));
+    ::close(fd);
+    if (bytes < 0)
+      return 0;
+
+    return static_cast<size_t>(bytes) / sizeof(T);
+  }
+
+  // ref_config_data value, read like peek when the file is not mapped (0 if
+  // the file does not exist yet).
+  uint64_t peek_config_data(int offset) const {
+    assert(offset < 4096 / 8);
+    assert(offset > 0);
+
+    if (mmap_base != nullptr || mmap_name.empty())
+      return *ref_config_data(offset);
+
+    int fd = ::open(mmap_name.c_str(), O_RDONLY);
+    if (fd < 0)
+      return 0;
+
+    uint64_t val = 0;
+    if (pread(fd, &val, sizeof(val), offset) != sizeof(val))
+      val = 0;
+    ::close(fd);
+
+    return val;
+  }
 };
 
 }  // namespace mmap_lib
@@ -0,0 +1,113 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fmt/format.h"
+#include "lbench.hpp"
+#include "lrand.hpp"
+#include "mmap_concurrent_map.hpp"
+#include "mmap_map.hpp"
+
+/*
+ * Multi-threaded pass over a map: each thread sets its share of the keys,
+ * and then does 9 lookups per set (most are misses). Same work with 1..N
+ * threads, for the sharded concurrent_map and for a map with a global lock.
+ */
+static uint32_t bench_key(int t, int i) { return (static_cast<uint32_t>(i) << 5) | t; }  // up to 32 threads
+
+template <typename Set_fn, typename Has_fn>
+static uint64_t run_threads(int n_threads, int max, Set_fn set_fn, Has_fn has_fn) {
+  std::vector<uint64_t>    found(n_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t) {
+    threads.emplace_back([&, t] {
+      Lrand<int> rng;
+      for (int i = t; i < max; i += n_threads) {
+        set_fn(bench_key(t, i), i);
+        for (int n = 1; n < 10; ++n) {
+          auto pos = rng.max(max);
+          found[t] += has_fn(bench_key(pos % n_threads, pos));
+        }
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+
+  uint64_t total = 0;
+  for (auto f : found) total += f;
+  return total;
+}
+
+void concurrent_map(int n_threads, int max) {
+  mmap_lib::concurrent_map<uint32_t, uint32_t> map("lgdb_bench", "bench_concurrent_map");
+  map.clear();
+
+  uint64_t total;
+  {
+    Lbench b("mmap.concurrent_map_" + std::to_string(n_threads) + "t_" + std::to_string(max));
+    total = run_threads(
+        n_threads,
+        max,
+        [&map](uint32_t key, int i) { map.set(key, i); },
+        [&map](uint32_t key) { return map.has(key); });
+  }
+  fmt::print("concurrent_map threads:{} size:{} found:{}\n", n_threads, map.size(), total);
+}
+
+void locked_map(int n_threads, int max) {
+  mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "bench_locked_map");
+  map.clear();
+  std::mutex lock;
+
+  uint64_t total;
+  {
+    Lbench b("mmap.locked_map_" + std::to_string(n_threads) + "t_" + std::to_string(max));
+    total = run_threads(
+        n_threads,
+        max,
+        [&](uint32_t key, int i) {
+          std::lock_guard<std::mutex> guard(lock);
+          map.set(key, i);
+        },
+        [&](uint32_t key) {
+          std::lock_guard<std::mutex> guard(lock);
+          return map.has(key);
+        });
+  }
+  fmt::print("locked_map threads:{} size:{} found:{}\n", n_threads, map.size(), total);
+}
+
+int main(int argc, char **argv) {
+  bool run_concurrent_map = true;
+  bool run_locked_map     = true;
+
+  if (argc > 1 && strcasecmp(argv[1], "all") != 0) {  // [all|concurrent|locked] [max threads]
+    run_concurrent_map = strcasecmp(argv[1], "concurrent") == 0;
+    run_locked_map     = strcasecmp(argv[1], "locked") == 0;
+  }
+
+  int max_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+  if (argc > 2)
+    max_threads = std::atoi(argv[2]);
+  max_threads = std::clamp(max_threads, 1, 32);
+
+  const std::vector<int> nums = {100000, 1000000};
+
+  for (auto max : nums) {
+    for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+      if (run_concurrent_map)
+        concurrent_map(n_threads, max);
+
+      if (run_locked_map)
+        locked_map(n_threads, max);
+    }
+  }
+
+  return 0;
+}
@@ -4,6 +4,8 @@
 #include "iassert.hpp"
 
 
+#include <sys/stat.h>
+
 #include <vector>
 
 #include "lrand.hpp"
@@ -199,6 +201,165 @@ void random_vector_map(int max) {
   }
 }
 
+/*
+ * Iterates a sparse map (1 of 64 entries left after erase). mmap_lib::map
+ * skips empty slots with the valid bitmap, 64 at a time (and shrinks once
+ * the load drops under 10%)
+ */
+void sparse_iter_map(int max) {
+  Lrand<int> rng;
+  uint64_t   total = 0;
+  {
+    mmap_lib::map<uint32_t,uint32_t> map;
+    for (int i = 0; i < max; ++i) {
+      map.set(i, i);
+    }
+    for (int i = 0; i < max; ++i) {
+      if (rng.max(64))
+        map.erase(i);
+    }
+
+    Lbench b("mmap.sparse_iter_mmap_map_" + std::to_string(max));
+    for (int n = 1; n < 100; ++n) {
+      for (const auto &it : map) {
+        total += it.second;
+      }
+    }
+  }
+  {
+    robin_hood::unordered_map<uint32_t,uint32_t> map;
+    for (int i = 0; i < max; ++i) {
+      map[i] = i;
+    }
+    for (int i = 0; i < max; ++i) {
+      if (rng.max(64))
+        map.erase(i);
+    }
+
+    Lbench b("mmap.sparse_iter_robin_map_" + std::to_string(max));
+    for (int n = 1; n < 100; ++n) {
+      for (const auto &it : map) {
+        total += it.second;
+      }
+    }
+  }
+  fmt::print("sparse_iter total:{}\n", total);
+}
+
+// Same hash, but not mmap_lib::hash<uint32_t>: the map never goes dense
+struct Sparse_hash : public mmap_lib::hash<uint32_t> {};
+
+/*
+ * Keys are close to contiguous ids (1 of 10 missing), like node ids. The
+ * dense layout indexes by id, the sparse one hashes and probes.
+ */
+template <typename Map>
+uint64_t dense_ids_map_bench(Map &map, const std::string &name, int max) {
+  Lrand<int> rng;
+  uint64_t   total = 0;
+
+  Lbench b(name + std::to_string(max));
+  for (int i = 0; i < max; ++i) {
+    if (rng.max(10))
+      map.set(i, i);
+  }
+  for (int n = 1; n < 10; ++n) {
+    for (int i = 0; i < max; ++i) {
+      if (map.has(i))
+        total += map.get(i);
+    }
+  }
+  return total;
+}
+
+void dense_ids_map(int max) {
+  uint64_t total = 0;
+  {
+    mmap_lib::map<uint32_t, uint32_t> map;
+    total += dense_ids_map_bench(map, "mmap.dense_ids_mmap_map_dense_", max);
+    I(map.is_dense());
+  }
+  {
+    mmap_lib::map<uint32_t, uint32_t, Sparse_hash> map;
+    total += dense_ids_map_bench(map, "mmap.dense_ids_mmap_map_sparse_", max);
+    I(!map.is_dense());
+  }
+  fmt::print("dense_ids total:{}\n", total);
+}
+
+struct Wide_value {  // more than 16 bytes, out of the Node
+  uint32_t f[16];
+  Wide_value(uint32_t x) {
+    for (auto &e : f) e = x;
+  }
+};
+
+/*
+ * Wide values. The probe (has/find) only walks keys and value positions, the
+ * value is read once when found.
+ */
+void wide_value_map(int max) {
+  Lrand<int> rng;
+  uint64_t   total = 0;
+
+  mmap_lib::map<uint32_t, Wide_value> map;
+  {
+    Lbench b("mmap.wide_value_mmap_map_set_" + std::to_string(max));
+    for (int i = 0; i < max; ++i) {
+      uint32_t key = rng.max(0xFFFFFF);
+      map.set(key, key);
+    }
+  }
+  {
+    Lbench b("mmap.wide_value_mmap_map_find_" + std::to_string(max));
+    for (int n = 1; n < 10; ++n) {
+      for (int i = 0; i < max; ++i) {
+        uint32_t key = rng.max(0xFFFFFF);  // most are misses
+        if (map.has(key))
+          total += map.get(key).f[15];
+      }
+    }
+  }
+  fmt::print("wide_value total:{}\n", total);
+}
+
+/*
+ * Erase most entries of a persistent map (like after an optimization pass),
+ * and insert them back. The file shrinks, and grows back with quad expansion
+ */
+void shrink_mmap_map(int max) {
+  auto file_size = [](const char *name) {
+    struct stat sb;
+    if (stat(name, &sb) != 0)
+      return static_cast<off_t>(0);
+    return sb.st_size;
+  };
+
+  auto key = [](int i) { return static_cast<uint32_t>(i) * 1'000'003; };  // not dense
+
+  mmap_lib::map<uint32_t,uint32_t> map("lgdb_bench", "shrink_mmap_map");
+  map.clear();
+  for (int i = 0; i < max; ++i) {
+    map.set(key(i), i);
+  }
+  auto peak_size = file_size("lgdb_bench/shrink_mmap_map");
+
+  {
+    Lbench b("mmap.shrink_mmap_map_erase_" + std::to_string(max));
+    for (int i = max / 20; i < max; ++i) {
+      map.erase(key(i));
+    }
+  }
+  auto small_size = file_size("lgdb_bench/shrink_mmap_map");
+
+  {
+    Lbench b("mmap.shrink_mmap_map_regrow_" + std::to_string(max));
+    for (int i = max / 20; i < max; ++i) {
+      map.set(key(i), i);
+    }
+  }
+  fmt::print("shrink_mmap_map {} file peak:{}KB after_erase:{}KB\n", max, peak_size / 1024, small_size / 1024);
+}
 
 int main(int argc, char **argv) {
   
@@ -210,6 +371,10 @@ int main(int argc, char **argv) {
   bool run_random_abseil_map  = false;
   bool run_random_ska_map     = false;
   bool run_random_vector_map  = false;
+  bool run_sparse_iter_map    = false;
+  bool run_shrink_mmap_map    = false;
+  bool run_dense_ids_map      = false;
+  bool run_wide_value_map     = false;
 
   if (argc>1) {
     if (strcasecmp(argv[1],"std")==0)
@@ -226,6 +391,14 @@ int main(int argc, char **argv) {
       run_random_ska_map = true;
     else if (strcasecmp(argv[1],"vector")==0)
       run_random_vector_map = true;
+    else if (strcasecmp(argv[1],"sparse_iter")==0)
+      run_sparse_iter_map = true;
+    else if (strcasecmp(argv[1],"shrink")==0)
+      run_shrink_mmap_map = true;
+    else if (strcasecmp(argv[1],"dense")==0)
+      run_dense_ids_map = true;
+    else if (strcasecmp(argv[1],"wide")==0)
+      run_wide_value_map = true;
   }else{
     run_random_std_map     = true;
     run_random_robin_map   = true;
@@ -234,6 +407,10 @@ int main(int argc, char **argv) {
     run_random_abseil_map  = true;
     run_random_ska_map     = true;
     run_random_vector_map  = true;
+    run_sparse_iter_map    = true;
+    run_shrink_mmap_map    = true;
+    run_dense_ids_map      = true;
+    run_wide_value_map     = true;
   }
 
   //const std::vector<int> nums = {100000, 500000, 1000000, 2000000, 3000000, 4000000, 5000000, 6000000, 7000000, 8000000, 9000000, 10000000};
@@ -260,6 +437,18 @@ int main(int argc, char **argv) {
 
     if (run_random_mmap_map)
       random_mmap_map(i);
+
+    if (run_sparse_iter_map)
+      sparse_iter_map(i * 10);
+
+    if (run_shrink_mmap_map)
+      shrink_mmap_map(i * 10);
+
+    if (run_dense_ids_map)
+      dense_ids_map(i * 10);
+
+    if (run_wide_value_map)
+      wide_value_map(i * 10);
   }
 
   return 0;
@@ -0,0 +1,121 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+#include "mmap_concurrent_map.hpp"
+
+class Setup_concurrent_map_test : public ::testing::Test {
+protected:
+  void SetUp() override {
+  }
+
+  void TearDown() override {
+  }
+};
+
+static constexpr int n_threads = 8;
+
+TEST_F(Setup_concurrent_map_test, set_get_threads) {
+  const uint32_t n_keys = 40'000;  // per thread
+  {
+    mmap_lib::concurrent_map<uint32_t, uint32_t> map("lgdb_bench", "concurrent_map_test");
+    map.clear();
+
+    std::atomic<int>         n_bad(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+      threads.emplace_back([&, t] {
+        // each thread writes its keys, and reads the keys of the previous thread while it writes them
+        for (uint32_t i = 0; i < n_keys; ++i) {
+          uint32_t key = i * n_threads + t;
+          map.set(key, key + 1);
+          if (map.get(key) != key + 1)
+            n_bad++;
+
+          uint32_t other = i * n_threads + (t + n_threads - 1) % n_threads;  // odd ones may be erased meanwhile
+          if ((i & 1) == 0 && map.has(other) && map.get(other) != other + 1)
+            n_bad++;
+        }
+        // erase the odd keys
+        for (uint32_t i = 1; i < n_keys; i += 2) {
+          if (map.erase(i * n_threads + t) != 1)
+            n_bad++;
+        }
+      });
+    }
+    for (auto &th : threads) th.join();
+
+    EXPECT_EQ(n_bad, 0);
+    EXPECT_EQ(map.size(), n_threads * n_keys / 2);
+  }
+
+  // Persistent: reopen, each thread reads a different part
+  mmap_lib::concurrent_map<uint32_t, uint32_t> map("lgdb_bench", "concurrent_map_test");
+
+  std::atomic<int>         n_bad(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (uint32_t i = 0; i < n_keys; ++i) {
+        uint32_t key = i * n_threads + t;
+        if (map.has(key) != ((i & 1) == 0))
+          n_bad++;
+        else if ((i & 1) == 0 && map.get(key) != key + 1)
+          n_bad++;
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+  EXPECT_EQ(n_bad, 0);
+
+  // Iterators and each visit all the shards
+  size_t conta = 0;
+  for (auto it = map.begin(), end = map.end(); it != end; ++it) {
+    EXPECT_EQ(map.get(it), map.get_key(it) + 1);
+    EXPECT_EQ(it->first + 1, it->second);
+    ++conta;
+  }
+  EXPECT_EQ(conta, n_threads * n_keys / 2);
+
+  conta = 0;
+  map.each([&conta](uint32_t key, uint32_t val) {
+    EXPECT_EQ(key + 1, val);
+    ++conta;
+  });
+  EXPECT_EQ(conta, n_threads * n_keys / 2);
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST_F(Setup_concurrent_map_test, string_view_values) {
+  mmap_lib::concurrent_map<uint32_t, std::string_view> map;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (uint32_t i = 0; i < 5'000; ++i) {
+        uint32_t key = i * n_threads + t;
+        map.set(key, "v" + std::to_string(key));
+      }
+    });
+  }
+  for (auto &th : threads) th.join();
+
+  absl::flat_hash_map<uint32_t, std::string> map2;
+  map.each([&map2](uint32_t key, std::string_view val) { map2[key] = std::string(val); });
+  EXPECT_EQ(map2.size(), n_threads * 5'000);
+  for (const auto &it : map2) {
+    EXPECT_EQ(it.second, "v" + std::to_string(it.first));
+    EXPECT_EQ(map.get(it.first), it.second);
+  }
+}
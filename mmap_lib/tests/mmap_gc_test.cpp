@@ -72,6 +72,7 @@ static bool trigger_clean(void *base, bool force_recycle) {
 }
 
 static bool trigger_clean2(void *base, bool force_recycle) {
+  (void)force_recycle;  // never aborts
   for (auto e : open_tracks) {
     if (e.base != base)
       continue;
@@ -219,3 +220,46 @@ TEST_F(Setup_mmap_gc_test, fd_limit) {
     std::tie(base, size) = mmap_lib::mmap_gc::mmap(entry.name, entry.fd, 1024, trigger_clean2);
   }
 }
+
+static int pinned_called;
+static bool pinned_clean(void *base, bool force_recycle) {
+  (void)base;
+  (void)force_recycle;
+  pinned_called++;
+  return false;
+}
+
+static bool abort_unless_forced(void *base, bool force_recycle) {
+  (void)base;
+  return !force_recycle;
+}
+
+TEST_F(Setup_mmap_gc_test, pinned) {
+  struct rlimit rval;  // few fds, so opening triggers the gc
+  rval.rlim_cur = 32;
+  rval.rlim_max = 32;
+  int err = setrlimit(RLIMIT_NOFILE, &rval);
+  ASSERT_EQ(err, 0);
+
+  std::atomic<int> pins{1};
+
+  std::string name("mmap_gc_test_file_pinned");
+  int         fd = mmap_lib::mmap_gc::open(name);
+  void *      pinned_base;
+  size_t      size;
+  std::tie(pinned_base, size) = mmap_lib::mmap_gc::mmap(name, fd, 4096, pinned_clean, &pins);
+
+  // The others abort unless forced, so the gc needs the force pass. It
+  // recycles the older first, but not the pinned one.
+  pinned_called = 0;
+  for (int i = 0; i < 256; ++i) {
+    std::string name2 = "mmap_gc_test_file_pin" + std::to_string(i);
+    int         fd2   = mmap_lib::mmap_gc::open(name2);
+    mmap_lib::mmap_gc::mmap(name2, fd2, 4096, abort_unless_forced);
+  }
+  EXPECT_EQ(pinned_called, 0);
+
+  pins = 0;
+  mmap_lib::mmap_gc::recycle(pinned_base);
+  EXPECT_EQ(pinned_called, 1);
+}
@@ -1,5 +1,6 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "gmock/gmock.h"
@@ -504,3 +505,316 @@ TEST_F(Setup_mmap_map_test, serializable) {
 
 
 }
+
+TEST_F(Setup_mmap_map_test, sparse_iteration) {
+  Lrand<int> rng;
+
+  absl::flat_hash_map<uint32_t, uint32_t> map2;
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_sparse");
+    map.clear();
+
+    for (uint32_t i = 0; i < 100'000; ++i) {
+      map.set(i * 7, i);
+    }
+    // Leave few entries, most 64 slot words empty
+    for (uint32_t i = 0; i < 100'000; ++i) {
+      if (rng.max(100) == 0)
+        map2[i * 7] = i;
+      else
+        map.erase(i * 7);
+    }
+    EXPECT_EQ(map.size(), map2.size());
+
+    size_t conta = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+      EXPECT_EQ(map2[it->first], it->second);
+      ++conta;
+    }
+    EXPECT_EQ(conta, map2.size());
+
+    // Erase while iterating (backward shifts)
+    for (auto it = map.begin(); it != map.end();) {
+      if (it->second & 1) {
+        map2.erase(it->first);
+        it = map.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    EXPECT_EQ(map.size(), map2.size());
+  }
+
+  mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_sparse");
+  size_t conta = 0;
+  for (const auto &it : map) {
+    EXPECT_EQ(it.second & 1, 0);
+    EXPECT_EQ(map2[it.first], it.second);
+    ++conta;
+  }
+  EXPECT_EQ(conta, map2.size());
+}
+
+TEST_F(Setup_mmap_map_test, decrease_size) {
+  auto file_size = [](const std::string &name) {
+    struct stat sb;
+    if (stat(name.c_str(), &sb) != 0)
+      return static_cast<off_t>(0);
+    return sb.st_size;
+  };
+  const std::string fname("lgdb_bench/mmap_map_shift");
+  auto key = [](uint32_t i) { return i * 1'000'003; };  // not dense
+
+  off_t peak_size;
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_shift");
+    map.clear();
+
+    for (uint32_t i = 0; i < 200'000; ++i) {
+      map.set(key(i), i + 1);
+    }
+    EXPECT_EQ(map.capacity(), 262144 * 80 / 100);
+    peak_size = file_size(fname);
+
+    // Like an optimization pass followed by a compact: only low ids remain
+    for (uint32_t i = 1000; i < 200'000; ++i) {
+      map.erase(key(i));
+    }
+    EXPECT_EQ(map.size(), 1000);
+    EXPECT_EQ(map.capacity(), 4096 * 80 / 100);
+    EXPECT_LT(file_size(fname) * 32, peak_size);
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+      EXPECT_EQ(map.get(key(i)), i + 1);
+    }
+  }
+
+  mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_shift");
+  size_t conta = 0;
+  for (const auto &it : map) {
+    EXPECT_LE(it.second, 1000);
+    EXPECT_EQ(key(it.second - 1), it.first);
+    ++conta;
+  }
+  EXPECT_EQ(conta, 1000);
+
+  // It was that big before, grow with quad expansion (4096 -> 16384)
+  for (uint32_t i = 1000; i < 3500; ++i) {
+    map.set(key(i), i + 1);
+  }
+  EXPECT_EQ(map.capacity(), 16384 * 80 / 100);
+
+  for (uint32_t i = 3500; i < 200'000; ++i) {
+    map.set(key(i), i + 1);
+  }
+  EXPECT_EQ(map.capacity(), 262144 * 80 / 100);
+  for (uint32_t i = 0; i < 200'000; ++i) {
+    EXPECT_EQ(map.get(key(i)), i + 1);
+  }
+}
+
+TEST_F(Setup_mmap_map_test, dense) {
+  Lrand<int> rng;
+
+  absl::flat_hash_map<uint32_t, uint32_t> map2;
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_dense");
+    map.clear();
+
+    // Close to contiguous ids (like node ids)
+    for (uint32_t i = 0; i < 100'000; ++i) {
+      if (rng.max(10) == 0)
+        continue;
+      map.set(i, i + 3);
+      map2[i] = i + 3;
+    }
+    EXPECT_TRUE(map.is_dense());
+    EXPECT_EQ(map.size(), map2.size());
+
+    for (uint32_t i = 0; i < 100'000; ++i) {
+      if (rng.max(4) == 0) {
+        EXPECT_EQ(map.erase(i), map2.erase(i));
+      }
+    }
+    for (uint32_t i = 0; i < 100'010; ++i) {
+      EXPECT_EQ(map.has(i), map2.contains(i));
+      if (map2.contains(i)) {
+        EXPECT_EQ(map.get(i), map2[i]);
+      }
+    }
+    EXPECT_EQ(map.size(), map2.size());
+  }
+
+  mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_dense");
+  EXPECT_TRUE(map.is_dense());
+  const auto n_before = map2.size();
+  size_t     conta    = 0;
+  for (auto it = map.begin(); it != map.end();) {
+    EXPECT_EQ(map2[it->first], it->second);
+    ++conta;
+    if (it->first & 1) {
+      map2.erase(it->first);
+      it = map.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  EXPECT_EQ(conta, n_before);
+  EXPECT_EQ(map.size(), map2.size());
+
+  // Far away id, not worth a dense table
+  map.set(1'000'000'000, 7);
+  map2[1'000'000'000] = 7;
+  EXPECT_FALSE(map.is_dense());
+  EXPECT_EQ(map.size(), map2.size());
+  for (const auto &it : map2) {
+    EXPECT_EQ(map.get(it.first), it.second);
+  }
+
+  mmap_lib::map<uint32_t, uint32_t> sparse;
+  for (uint32_t i = 0; i < 10'000; ++i) {
+    sparse.set(i * 1'000'003, i);
+  }
+  EXPECT_FALSE(sparse.is_dense());
+  for (uint32_t i = 0; i < 10'000; ++i) {
+    EXPECT_EQ(sparse.get(i * 1'000'003), i);
+  }
+}
+
+struct Wide_entry {  // more than 16 bytes, stored out of the Node
+  uint32_t f[6];
+  Wide_entry() : f{0, 0, 0, 0, 0, 0} {}
+  Wide_entry(uint32_t x) : f{x, x + 1, x + 2, x + 3, x + 4, x + 5} {}
+};
+
+TEST_F(Setup_mmap_map_test, wide_value) {
+  Lrand<int> rng;
+
+  absl::flat_hash_map<uint32_t, uint32_t> map2;
+  {
+    mmap_lib::map<uint32_t, Wide_entry> map("lgdb_bench", "mmap_map_wide");
+    map.clear();
+
+    for (int i = 0; i < 20'000; ++i) {
+      uint32_t key = rng.max(0xFFFFFF) * 7;
+      if (map2.contains(key) && rng.max(2)) {
+        EXPECT_EQ(map.erase(key), map2.erase(key));
+        continue;
+      }
+      map.set(key, key + i);  // set again overwrites in place
+      map2[key] = key + i;
+    }
+    EXPECT_EQ(map.size(), map2.size());
+
+    // erased slots in the value file are reused
+    const auto n_vals = map2.size();
+    for (auto it = map2.begin(); it != map2.end();) {
+      map.erase(it->first);
+      map2.erase(it++);
+      if (map2.size() < n_vals / 2)
+        break;
+    }
+    for (uint32_t i = 0; map2.size() < n_vals; ++i) {
+      uint32_t key = i * 7 + 1;  // not used before (keys above are multiples of 7)
+      map.set(key, key);
+      map2[key] = key;
+    }
+    EXPECT_EQ(map.size(), map2.size());
+
+    for (const auto &it : map2) {
+      const auto &e = map.get(it.first);
+      EXPECT_EQ(e.f[0], it.second);
+      EXPECT_EQ(e.f[5], it.second + 5);
+    }
+    map.ref(map2.begin()->first)->f[5] = 3;
+    map2.begin()->second               = 0xFFFFFFFF;  // marks the ref update
+  }
+
+  mmap_lib::map<uint32_t, Wide_entry> map("lgdb_bench", "mmap_map_wide");
+  size_t conta = 0;
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    const auto &e = map.get(it);
+    EXPECT_EQ(it->second.f[5], e.f[5]);  // the iterator returns the value too
+    ASSERT_TRUE(map2.contains(it->first));
+    if (map2[it->first] == 0xFFFFFFFF) {
+      EXPECT_EQ(e.f[5], 3);
+    } else {
+      EXPECT_EQ(e.f[0], map2[it->first]);
+      EXPECT_EQ(e.f[5], map2[it->first] + 5);
+    }
+    ++conta;
+  }
+  EXPECT_EQ(conta, map2.size());
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  map.set(3, 4);
+  EXPECT_EQ(map.get(3).f[1], 5);
+}
+
+TEST_F(Setup_mmap_map_test, wide_value_layout) {
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_layout");  // inline values
+    map.clear();
+    map.set(1, 2);
+  }
+
+  {
+    // Same name with out of line values: not a file with Wide_entry nodes,
+    // it is not migrated (nor misread)
+    mmap_lib::map<uint32_t, Wide_entry> map("lgdb_bench", "mmap_map_layout");
+    EXPECT_TRUE(map.empty());
+    map.clear();
+  }
+
+  mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_layout");
+  EXPECT_EQ(map.get(1), 2);
+  map.clear();
+
+  mmap_lib::map<uint32_t, Wide_entry> map2("lgdb_bench", "mmap_map_layout");
+  map2.set(3, 4);
+  EXPECT_EQ(map2.get(3).f[1], 5);
+  map2.clear();
+}
+
+TEST_F(Setup_mmap_map_test, wide_value_migrate) {
+  unlink("lgdb_bench/mmap_map_migrate");
+  {
+    mmap_lib::map<uint32_t, Wide_entry> map("lgdb_bench", "mmap_map_migrate");
+    map.clear();
+  }
+
+  // A map written before out of line values: Wide_entry in the Node
+  using Inline_node              = mmap_lib::pair<uint32_t, Wide_entry>;
+  constexpr uint64_t n_entries   = 1024;
+  constexpr uint64_t nodes_pos   = 5 + (n_entries + 8) / sizeof(uint64_t);
+  std::vector<uint64_t> file(nodes_pos + n_entries * sizeof(Inline_node) / sizeof(uint64_t) + 64, 0);
+  file[0] = n_entries - 1;
+  file[1] = 3;
+
+  auto *info  = reinterpret_cast<uint8_t *>(&file[5]);
+  auto *nodes = reinterpret_cast<Inline_node *>(&file[nodes_pos]);
+  for (uint32_t slot : {7, 100, 900}) {
+    info[slot]  = 1;
+    nodes[slot] = Inline_node(slot * 3, Wide_entry(slot * 10));
+  }
+  info[n_entries] = 1;  // Sentinel
+
+  FILE *fp = fopen("lgdb_bench/mmap_map_migrate", "w");
+  ASSERT_NE(fp, nullptr);
+  fwrite(file.data(), sizeof(uint64_t), file.size(), fp);
+  fclose(fp);
+
+  mmap_lib::map<uint32_t, Wide_entry> map("lgdb_bench", "mmap_map_migrate");
+  EXPECT_EQ(map.size(), 3);
+  for (uint32_t slot : {7, 100, 900}) {
+    EXPECT_TRUE(map.has(slot * 3));
+    EXPECT_EQ(map.get(slot * 3).f[0], slot * 10);
+  }
+  for (const auto &it : map) {
+    EXPECT_EQ(it.second.f[1], it.first / 3 * 10 + 1);
+  }
+  EXPECT_NE(access("lgdb_bench/mmap_map_migrate", F_OK), 0);  // replaced by the _ool file
+
+  map.clear();
+}
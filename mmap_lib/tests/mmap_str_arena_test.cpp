@@ -0,0 +1,100 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "mmap_str_arena.hpp"
+
+class Setup_str_arena_test : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mmap_lib::str_arena arena("lgdb_str_arena", "arena_test");
+    arena.clear();
+  }
+};
+
+TEST_F(Setup_str_arena_test, intern) {
+  mmap_lib::str_arena arena("lgdb_str_arena", "arena_test");
+
+  EXPECT_TRUE(arena.empty());
+  EXPECT_EQ(arena.find("foo"), 0);
+
+  auto foo = arena.intern("foo");
+  auto bar = arena.intern("top.mid.bar");
+  auto nil = arena.intern("");
+
+  EXPECT_NE(foo, 0);
+  EXPECT_NE(foo, bar);
+  EXPECT_NE(nil, 0);
+  EXPECT_EQ(arena.intern("foo"), foo);
+  EXPECT_EQ(arena.find("top.mid.bar"), bar);
+  EXPECT_FALSE(arena.has("top.mid"));
+
+  EXPECT_EQ(arena.get(foo), "foo");
+  EXPECT_EQ(arena.get(bar), "top.mid.bar");
+  EXPECT_EQ(arena.get(nil), "");
+  EXPECT_EQ(arena.size(), 3);
+}
+
+TEST_F(Setup_str_arena_test, persistence) {
+  std::vector<uint32_t> ids;
+  {
+    mmap_lib::str_arena arena("lgdb_str_arena", "arena_test");
+    for (int i = 0; i < 5000; ++i) {
+      ids.emplace_back(arena.intern("name_" + std::to_string(i)));
+    }
+  }
+
+  mmap_lib::str_arena arena("lgdb_str_arena", "arena_test");
+  EXPECT_EQ(arena.size(), 5000);
+  for (int i = 0; i < 5000; ++i) {
+    auto name = "name_" + std::to_string(i);
+    EXPECT_EQ(arena.find(name), ids[i]);
+    EXPECT_EQ(arena.get(ids[i]), name);
+  }
+  EXPECT_EQ(arena.intern("name_7"), ids[7]);
+  EXPECT_EQ(arena.size(), 5000);
+}
+
+TEST_F(Setup_str_arena_test, bench) {
+  constexpr int n_names = 200000;
+
+  std::vector<std::string> names;
+  for (int i = 0; i < n_names; ++i) {
+    names.emplace_back("top.inst" + std::to_string(i % 100) + ".sub" + std::to_string(i / 100) + ".wire");
+  }
+
+  mmap_lib::str_arena   arena("lgdb_str_arena", "arena_test");
+  std::vector<uint32_t> ids;
+  {
+    Lbench b("mmap.STR_ARENA_intern");
+    for (const auto &n : names) {
+      ids.emplace_back(arena.intern(n));
+    }
+  }
+
+  size_t total = 0;
+  {
+    Lbench b("mmap.STR_ARENA_get");
+    for (auto id : ids) {
+      total += arena.get(id).size();
+    }
+  }
+
+  {
+    Lbench b("mmap.STR_ARENA_find");
+    for (int i = 0; i < n_names; ++i) {
+      EXPECT_EQ(arena.find(names[i]), ids[i]);
+    }
+  }
+
+  size_t expected = 0;
+  for (const auto &n : names) {
+    expected += n.size();
+  }
+  EXPECT_EQ(total, expected);
+  EXPECT_EQ(arena.size(), n_names);
+}
@@ -1,5 +1,7 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <unistd.h>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -75,3 +77,48 @@ TEST_F(Setup_map_test, iter_test_set) {
   dense.set(100, 100);
 }
 
+
+TEST_F(Setup_map_test, peek) {
+  {
+    mmap_lib::vector<int> dense("lgdb_bench", "mmap_vector_test_peek");
+    dense.clear();
+    for (int i = 0; i < 2000; ++i) {
+      dense.emplace_back(i * 3);
+    }
+  }
+
+  mmap_lib::vector<int> dense("lgdb_bench", "mmap_vector_test_peek");
+
+  int buf[16];
+  EXPECT_EQ(dense.peek(1990, 16, buf), 10);  // stops at the end
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(buf[i], (1990 + i) * 3);
+  }
+  EXPECT_EQ(dense.peek(2000, 16, buf), 0);
+  EXPECT_FALSE(dense.is_mapped());
+
+  EXPECT_EQ(dense.size(), 2000);  // maps it
+  EXPECT_TRUE(dense.is_mapped());
+  EXPECT_EQ(dense.peek(0, 4, buf), 4);
+  EXPECT_EQ(buf[3], 9);
+
+  mmap_lib::vector<int> never("lgdb_bench", "mmap_vector_test_peek_never");
+  never.clear();
+  EXPECT_EQ(never.peek(0, 16, buf), 0);
+}
+
+TEST_F(Setup_map_test, removed_path) {
+  {
+    mmap_lib::vector<int> dense("lgdb_removed_path", "mmap_vector_test_removed");
+    dense.clear();
+    dense.emplace_back(1);
+  }
+  unlink("lgdb_removed_path/mmap_vector_test_removed");
+  ASSERT_EQ(rmdir("lgdb_removed_path"), 0);
+
+  // Same path again: setup_path remembers it, the open creates it back
+  mmap_lib::vector<int> dense("lgdb_removed_path", "mmap_vector_test_removed");
+  EXPECT_EQ(dense.size(), 0);
+  dense.emplace_back(3);
+  EXPECT_EQ(dense[0], 3);
+}
@@ -52,7 +52,7 @@ void Bitwidth::process_flop(Node &node) {
   }
 }
 
-void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_not(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  // Dangling???
 
   Lconst max_val;
@@ -75,7 +75,7 @@ void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
   bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
 }
 
-void Bitwidth::process_mux(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_mux(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  // Dangling???
 
   Lconst max_val;
@@ -105,7 +105,7 @@ void Bitwidth::process_mux(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_shl(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);
 
   auto a_dpin = node.get_sink_pin("a").get_driver_pin();
@@ -147,7 +147,7 @@ void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Bitwidth::process_sra(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_sra(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);
 
   auto a_dpin = node.get_sink_pin("a").get_driver_pin();
@@ -201,7 +201,7 @@ void Bitwidth::process_sra(Node &node, XEdge_iterator &inp_edges) {
   }
 }
 
-void Bitwidth::process_sum(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_sum(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  // Dangling sum??? (delete)
 
   Lconst max_val;
@@ -229,7 +229,7 @@ void Bitwidth::process_sum(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Bitwidth::process_mult(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_mult(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  // Dangling sum??? (delete)
 
   int max_val;
@@ -251,7 +251,7 @@ void Bitwidth::process_mult(Node &node, XEdge_iterator &inp_edges) {
   bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(Lconst(min_val), Lconst(max_val)));
 }
 
-void Bitwidth::process_tposs(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_tposs(Node &node, XEdge_small_iterator &inp_edges) {
   Lconst max_val;
   Lconst min_val;
 
@@ -282,7 +282,7 @@ void Bitwidth::process_comparator(Node &node) {
   bwmap.insert_or_assign(node.get_driver_pin().get_compact(), bw);
 }
 
-void Bitwidth::process_logic_or_xor(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_logic_or_xor(Node &node, XEdge_small_iterator &inp_edges) {
   if (inp_edges.size() >= 1) {
     Bits_t max_bits = 0;
 
@@ -316,7 +316,7 @@ void Bitwidth::process_logic_or_xor(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Bitwidth::process_logic_and(Node &node, XEdge_iterator &inp_edges) {
+void Bitwidth::process_logic_and(Node &node, XEdge_small_iterator &inp_edges) {
   // note: the goal is to get the min requiered bits in advance of final global BW and calculate the min range of (max, min)
   if (inp_edges.size() >= 1) {
     Bits_t min_sbits = Bits_max;
@@ -556,7 +556,7 @@ void Bitwidth::process_attr_set_new_attr(Node &node_attr, Fwd_edge_iterator::Fwd
 
       bw.set_sbits_range(val.to_i()); //note: still set sbits range and rely on the Tposs to turn max/min to positive
       bool tposs_existed = false;
-      for (auto e : node_attr.out_edges()) {
+      for (auto e : node_attr.out_edges_range()) {
         if (e.sink.get_node().get_type_op() == Ntype_op::Tposs) {
           tposs_existed = true;
           break;
@@ -726,8 +726,9 @@ void Bitwidth::bw_pass(LGraph *lg) {
   for (auto fwd_it = lgit.begin(); fwd_it != lgit.end() ; ++fwd_it) {
     auto node = *fwd_it;
     fmt::print("{}\n", node.debug_name());
-    auto inp_edges = node.inp_edges();
-    auto op        = node.get_type_op();
+    auto                 inp_range = node.inp_edges_range();
+    XEdge_small_iterator inp_edges(inp_range.begin(), inp_range.end());
+    auto                 op = node.get_type_op();
 
     if (inp_edges.empty() && (op != Ntype_op::Const && op != Ntype_op::Sub && op != Ntype_op::LUT && op != Ntype_op::TupKey)) {
       fmt::print("BW-> removing dangling node:{}\n", node.debug_name());
@@ -931,7 +932,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
           auto min = bw.get_min();
 
           bool any_tposs_sink = false;
-          for (auto e : dpin.out_edges()) {
+          for (auto e : dpin.out_edges_range()) {
             if (e.sink.get_node().get_type_op() == Ntype_op::Tposs)
               any_tposs_sink = true;
           }
@@ -24,18 +24,18 @@ protected:
   BWMap &bwmap; // reference the global bwmap outside
 
   void process_const(Node &node);
-  void process_not(Node &node, XEdge_iterator &inp_edges);
+  void process_not(Node &node, XEdge_small_iterator &inp_edges);
   void process_flop(Node &node);
-  void process_mux(Node &node, XEdge_iterator &inp_edges);
-  void process_sra(Node &node, XEdge_iterator &inp_edges);
-  void process_shl(Node &node, XEdge_iterator &inp_edges);
-  void process_sum(Node &node, XEdge_iterator &inp_edges);
-  void process_mult(Node &node, XEdge_iterator &inp_edges);
-  void process_tposs(Node &node, XEdge_iterator &inp_edges);
+  void process_mux(Node &node, XEdge_small_iterator &inp_edges);
+  void process_sra(Node &node, XEdge_small_iterator &inp_edges);
+  void process_shl(Node &node, XEdge_small_iterator &inp_edges);
+  void process_sum(Node &node, XEdge_small_iterator &inp_edges);
+  void process_mult(Node &node, XEdge_small_iterator &inp_edges);
+  void process_tposs(Node &node, XEdge_small_iterator &inp_edges);
   void process_comparator(Node &node);
-  void process_logic_or_xor(Node &node, XEdge_iterator &inp_edges);
-  void process_ror(Node &node, XEdge_iterator &inp_edges);
-  void process_logic_and(Node &node, XEdge_iterator &inp_edges);
+  void process_logic_or_xor(Node &node, XEdge_small_iterator &inp_edges);
+  void process_ror(Node &node, XEdge_small_iterator &inp_edges);
+  void process_logic_and(Node &node, XEdge_small_iterator &inp_edges);
   void process_attr_get(Node &node);
   void process_attr_set_dp_assign(Node &node, Fwd_edge_iterator::Fwd_iter &fwd_it);
   void process_attr_set_new_attr(Node &node, Fwd_edge_iterator::Fwd_iter &fwd_it);
@@ -43,7 +43,7 @@ protected:
   void process_attr_set(Node &node, Fwd_edge_iterator::Fwd_iter &fwd_it);
   void insert_tposs_nodes(Node &node_attr, Fwd_edge_iterator::Fwd_iter &fwd_it);
 
-  void garbage_collect_support_structures(XEdge_iterator &inp_edges);
+  void garbage_collect_support_structures(XEdge_small_iterator &inp_edges);
   void forward_adjust_dpin(Node_pin &dpin, Bitwidth_range &bw);
   void set_graph_boundary(Node_pin &dpin, Node_pin &spin);
   void debug_unconstrained_msg(Node &node, Node_pin &d_dpin);
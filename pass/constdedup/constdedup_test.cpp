@@ -0,0 +1,173 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+
+#include "absl/container/flat_hash_set.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "pass_constdedup.hpp"
+
+class Setup_constdedup : public ::testing::Test {
+protected:
+  LGraph *lg;
+
+  void SetUp() override { lg = LGraph::create("lgdb_constdedup", "constdedup_top", "test"); }
+
+  int count_const() const {
+    int n = 0;
+    for (auto node : lg->fast()) {
+      if (node.is_type_const())
+        ++n;
+    }
+    return n;
+  }
+
+  // A folded node: retyped in place, not through the pool
+  Node folded_const(const Lconst &val) {
+    auto node = lg->create_node(Ntype_op::Or);
+    node.set_type_const(val);
+    return node;
+  }
+};
+
+TEST_F(Setup_constdedup, pool) {
+  auto c1 = lg->create_node_const(Lconst(7));
+  for (int i = 0; i < 100; ++i) {
+    lg->create_node_const(Lconst(100 + i));
+  }
+  EXPECT_EQ(lg->create_node_const(Lconst(7)), c1);
+  EXPECT_NE(lg->create_node_const(Lconst(8)), c1);
+  EXPECT_EQ(count_const(), 102);
+
+  // Persisted with the lgraph
+  auto compact = c1.get_compact_class();
+  lg->sync();
+  auto *lg2 = LGraph::open("lgdb_constdedup", "constdedup_top");
+  EXPECT_EQ(lg2->create_node_const(Lconst(7)).get_compact_class(), compact);
+
+  // A deleted constant is not reused
+  c1.del_node();
+  auto c2 = lg->create_node_const(Lconst(7));
+  EXPECT_NE(c2.get_compact_class(), compact);
+  EXPECT_EQ(c2.get_type_const(), Lconst(7));
+}
+
+TEST_F(Setup_constdedup, merge) {
+  auto a = lg->add_graph_input("a", 1, 8);
+  lg->add_graph_output("z", 2, 8);
+
+  auto c = lg->create_node_const(Lconst(3));
+  auto sum = lg->create_node(Ntype_op::Sum, 8);
+  a.connect_sink(sum.setup_sink_pin("A"));
+  c.setup_driver_pin().connect_sink(sum.setup_sink_pin("A"));
+
+  for (int i = 0; i < 10; ++i) {
+    auto f = folded_const(Lconst(3));
+    if (i == 5)
+      f.setup_driver_pin().set_name("three");
+    f.setup_driver_pin().connect_sink(sum.setup_sink_pin("A"));
+  }
+  auto other = folded_const(Lconst(4));
+  other.setup_driver_pin().connect_sink(sum.setup_sink_pin("A"));
+  sum.setup_driver_pin().connect_sink(lg->get_graph_output("z"));
+
+  EXPECT_EQ(count_const(), 12);
+  EXPECT_EQ(Pass_constdedup::dedup(lg), 10);
+  EXPECT_EQ(count_const(), 2);
+
+  absl::flat_hash_set<Node::Compact> drivers;
+  for (auto &e : sum.get_sink_pin("A").inp_edges()) {
+    if (e.driver.get_node().is_type_const())
+      drivers.insert(e.driver.get_node().get_compact());
+  }
+  EXPECT_EQ(drivers.size(), 2);  // the 3 and the 4
+
+  auto three = Node_pin::find_driver_pin(lg, "three");
+  ASSERT_FALSE(three.is_invalid());
+  EXPECT_TRUE(three.get_node().is_type_const());
+
+  // The pool points to the kept node
+  EXPECT_EQ(lg->create_node_const(Lconst(3)), three.get_node());
+  EXPECT_EQ(lg->create_node_const(Lconst(4)), other.get_driver_pin().get_node());
+  EXPECT_EQ(count_const(), 2);
+}
+
+TEST_F(Setup_constdedup, names) {
+  auto sum = lg->create_node(Ntype_op::Sum, 8);
+
+  for (int i = 0; i < 4; ++i) {
+    auto f = folded_const(Lconst(5));
+    if (i == 1)
+      f.setup_driver_pin().set_name("five_a");
+    if (i == 3)
+      f.setup_driver_pin().set_name("five_b");
+    f.setup_driver_pin().connect_sink(sum.setup_sink_pin("A"));
+  }
+
+  // The first one takes five_a, five_b stays in its own node
+  EXPECT_EQ(Pass_constdedup::dedup(lg), 2);
+  EXPECT_EQ(count_const(), 2);
+
+  auto five_a = Node_pin::find_driver_pin(lg, "five_a");
+  auto five_b = Node_pin::find_driver_pin(lg, "five_b");
+  ASSERT_FALSE(five_a.is_invalid());
+  ASSERT_FALSE(five_b.is_invalid());
+  EXPECT_NE(five_a.get_node(), five_b.get_node());
+  EXPECT_EQ(five_a.get_node().out_edges().size(), 3);
+  EXPECT_EQ(five_b.get_node().out_edges().size(), 1);
+}
+
+TEST_F(Setup_constdedup, pool_bits_retype) {
+  // A constant resized after creation is not returned for its value
+  auto c = lg->create_node_const(Lconst(6));
+  c.setup_driver_pin().set_bits(12);
+  auto c2 = lg->create_node_const(Lconst(6));
+  EXPECT_NE(c2, c);
+  EXPECT_EQ(c2.get_driver_pin().get_bits(), Lconst(6).get_bits());
+  EXPECT_EQ(lg->create_node_const(Lconst(6)), c2);
+
+  // A former Sub (or LUT) retyped to Const leaves no Sub (LUT) data
+  auto *sub = LGraph::create("lgdb_constdedup", "constdedup_sub", "test");
+  auto  s   = lg->create_node_sub(sub->get_lgid());
+  EXPECT_EQ(lg->get_down_nodes_map().size(), 1);
+  s.set_type_const(Lconst(9));
+  EXPECT_EQ(lg->get_down_nodes_map().size(), 0);
+
+  int n_subs = 0;
+  lg->each_sub_fast([&n_subs](Node &node, Lg_type_id lgid) {
+    (void)node;
+    (void)lgid;
+    ++n_subs;
+  });
+  EXPECT_EQ(n_subs, 0);
+  EXPECT_EQ(s.get_type_const(), Lconst(9));
+}
+
+TEST_F(Setup_constdedup, bench) {
+  constexpr int n_nodes  = 20000;
+  constexpr int n_values = 64;
+
+  auto a = lg->add_graph_input("a", 1, 8);
+  {
+    Lbench b("pass.CONSTDEDUP_create");
+    for (int i = 0; i < n_nodes; ++i) {
+      auto node = lg->create_node(Ntype_op::And, 8);
+      a.connect_sink(node.setup_sink_pin("A"));
+      lg->create_node_const(Lconst(i % n_values)).setup_driver_pin().connect_sink(node.setup_sink_pin("A"));
+    }
+  }
+  EXPECT_EQ(count_const(), n_values);
+
+  for (int i = 0; i < n_nodes; ++i) {
+    folded_const(Lconst(i % n_values));
+  }
+  {
+    Lbench b("pass.CONSTDEDUP_dedup");
+    EXPECT_EQ(Pass_constdedup::dedup(lg), n_nodes);
+  }
+  EXPECT_EQ(count_const(), n_values);
+}
@@ -0,0 +1,88 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "pass_constdedup.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+
+static Pass_plugin sample("pass_constdedup", Pass_constdedup::setup);
+
+void Pass_constdedup::setup() {
+  Eprp_method m1("pass.constdedup", "merge the constant nodes with the same value and bits", &Pass_constdedup::work);
+
+  register_pass(m1);
+}
+
+Pass_constdedup::Pass_constdedup(const Eprp_var &var) : Pass("pass.constdedup", var) {}
+
+void Pass_constdedup::work(Eprp_var &var) {
+  Lbench b("pass.CONSTDEDUP");
+
+  for (auto *lg : var.lgs) {
+    auto n = dedup(lg);
+    if (n)
+      fmt::print("pass.constdedup lgraph:{} removed {} constants\n", lg->get_name(), n);
+  }
+}
+
+size_t Pass_constdedup::dedup(LGraph *lg) {
+  // The value is the serialized Lconst (the bits are part of it). A driver
+  // pin with other bits (set_bits after creation) is a different constant.
+  using Key = std::pair<Lconst::Container, Bits_t>;
+
+  // A driver pin has one name. Two named constants are not merged, the
+  // kept node takes the name of (at most) one duplicate.
+  struct Kept {
+    Node node;
+    bool named;
+  };
+  absl::flat_hash_map<Key, Kept>     key2node;
+  std::vector<std::pair<Node, Node>> merges;  // duplicate, kept node
+
+  for (auto node : lg->fast()) {
+    if (!node.is_type_const())
+      continue;
+
+    auto dpin  = node.get_driver_pin();
+    bool named = dpin.has_name();
+
+    Key  key(node.get_type_const().serialize(), dpin.get_bits());
+    auto [it, inserted] = key2node.try_emplace(std::move(key), Kept{node, named});
+    if (inserted)
+      continue;
+
+    if (named) {
+      if (it->second.named)
+        continue;  // both named, both stay
+      it->second.named = true;
+    }
+    merges.emplace_back(node, it->second.node);
+  }
+
+  for (auto &[dup, keep] : merges) {
+    auto dpin      = dup.get_driver_pin();
+    auto keep_dpin = keep.setup_driver_pin();
+
+    for (auto &e : dup.out_edges()) {
+      keep_dpin.connect_sink(e.sink);
+    }
+
+    if (dpin.has_name()) {
+      I(!keep_dpin.has_name());
+      std::string name(dpin.get_name());
+      dpin.del_name();
+      keep_dpin.set_name(name);
+    }
+
+    dup.del_node();
+  }
+
+  lg->rebuild_const_pool();
+
+  return merges.size();
+}
@@ -0,0 +1,19 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include "lgraph.hpp"
+#include "pass.hpp"
+
+// Merges the Const nodes with the same value and bits into one. The
+// create_node_const pool avoids new duplicates, this cleans the ones already
+// in a graph (lgdbs from before the pool, Node::set_type_const).
+class Pass_constdedup : public Pass {
+protected:
+  static void work(Eprp_var &var);
+
+public:
+  explicit Pass_constdedup(const Eprp_var &var);
+  static void setup();
+
+  static size_t dedup(LGraph *lg);  // returns the number of nodes removed
+};
@@ -15,7 +15,7 @@
 
 Cprop::Cprop (bool _hier, bool _at_gioc) : hier(_hier), at_gioc(_at_gioc) {}
 
-void Cprop::collapse_forward_same_op(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::collapse_forward_same_op(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   auto op = node.get_type_op();
 
   bool all_done = true;
@@ -58,7 +58,7 @@ void Cprop::collapse_forward_same_op(Node &node, XEdge_iterator &inp_edges_order
   }
 }
 
-void Cprop::collapse_forward_sum(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::collapse_forward_sum(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   auto op = node.get_type_op();
   I(op == Ntype_op::Sum);
   bool all_edges_deleted = true;
@@ -112,7 +112,7 @@ void Cprop::collapse_forward_shiftleft(Node &node) {
 #endif
 
 // Collase forward single node but only for pid!=0 (not reduction ops)
-void Cprop::collapse_forward_always_pin0(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::collapse_forward_always_pin0(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   bool can_delete = true;
 
   auto op = node.get_type_op();
@@ -146,7 +146,7 @@ void Cprop::collapse_forward_for_pin(Node &node, Node_pin &new_dpin) {
   node.del_node();
 }
 
-void Cprop::try_constant_prop(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::try_constant_prop(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   int n_inputs_constant = 0;
   int n_inputs          = 0;
   for (auto e : inp_edges_ordered) {
@@ -167,7 +167,7 @@ void Cprop::try_constant_prop(Node &node, XEdge_iterator &inp_edges_ordered) {
   }
 }
 
-void Cprop::try_collapse_forward(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::try_collapse_forward(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   // No need to collapse things like const -> join because the Lconst will be forward eval
   auto op = node.get_type_op();
 
@@ -184,7 +184,7 @@ void Cprop::try_collapse_forward(Node &node, XEdge_iterator &inp_edges_ordered)
         return;
       }else if (op == Ntype_op::Ror) {
         auto prev_node = inp_edges_ordered[0].driver.get_node();
-        auto prev_inp_edges = prev_node.inp_edges();
+        auto prev_inp_edges = prev_node.inp_edges_ordered_small();
         collapse_forward_always_pin0(prev_node, prev_inp_edges);
       }
     }
@@ -205,7 +205,7 @@ void Cprop::try_collapse_forward(Node &node, XEdge_iterator &inp_edges_ordered)
   }
 }
 
-void Cprop::replace_part_inputs_const(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::replace_part_inputs_const(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   auto op = node.get_type_op();
   if (op == Ntype_op::Mux) {
     auto s_node = inp_edges_ordered[0].driver.get_node();
@@ -256,7 +256,7 @@ void Cprop::replace_part_inputs_const(Node &node, XEdge_iterator &inp_edges_orde
   }
 }
 
-void Cprop::replace_all_inputs_const(Node &node, XEdge_iterator &inp_edges_ordered) {
+void Cprop::replace_all_inputs_const(Node &node, XEdge_small_iterator &inp_edges_ordered) {
   // simple constant propagation
   auto op = node.get_type_op();
   if (op == Ntype_op::SHL) {
@@ -730,7 +730,7 @@ void Cprop::process_tuple_add(Node &node) {
   node2tuple[node.get_compact()] = ctup;
 
   //FIXME: should move to line 779 to avoid checking every TA, but there is a bug in line that cannot retreive the tuple in line 779??
-  if (node.out_edges().begin()->sink.is_graph_output()) {
+  if ((*node.out_edges_range().begin()).sink.is_graph_output()) {
     auto lg = node.get_class_lgraph();
     try_create_graph_output(lg, ctup);
   }
@@ -774,7 +774,7 @@ void Cprop::do_trans(LGraph *lg) {
     }
 
     // Normal copy prop and strength reduction
-    auto inp_edges_ordered = node.inp_edges_ordered();
+    auto inp_edges_ordered = node.inp_edges_ordered_small();
     try_constant_prop(node, inp_edges_ordered);
 
     if (node.is_invalid())
@@ -16,16 +16,16 @@ protected:
   absl::flat_hash_map<Node::Compact, std::shared_ptr<Lgtuple>> node2tuple;  // node to the most up-to-dated tuple chain
   absl::flat_hash_map<std::string_view, Node_pin> oname2dpin;
 
-  void collapse_forward_same_op(Node &node, XEdge_iterator &inp_edges_ordered);
-  void collapse_forward_sum(Node &node, XEdge_iterator &inp_edges_ordered);
-  void collapse_forward_always_pin0(Node &node, XEdge_iterator &inp_edges_ordered);
+  void collapse_forward_same_op(Node &node, XEdge_small_iterator &inp_edges_ordered);
+  void collapse_forward_sum(Node &node, XEdge_small_iterator &inp_edges_ordered);
+  void collapse_forward_always_pin0(Node &node, XEdge_small_iterator &inp_edges_ordered);
   void collapse_forward_for_pin(Node &node, Node_pin &new_dpin);
 
-  void try_constant_prop(Node &node, XEdge_iterator &inp_edges_ordered);
-  void try_collapse_forward(Node &node, XEdge_iterator &inp_edges_ordered);
+  void try_constant_prop(Node &node, XEdge_small_iterator &inp_edges_ordered);
+  void try_collapse_forward(Node &node, XEdge_small_iterator &inp_edges_ordered);
 
-  void replace_part_inputs_const(Node &node, XEdge_iterator &inp_edges_ordered);
-  void replace_all_inputs_const(Node &node, XEdge_iterator &inp_edges_ordered);
+  void replace_part_inputs_const(Node &node, XEdge_small_iterator &inp_edges_ordered);
+  void replace_all_inputs_const(Node &node, XEdge_small_iterator &inp_edges_ordered);
   void replace_node(Node &node, const Lconst &result);
   void replace_logic_node(Node &node, const Lconst &result, const Lconst &result_reduced);
 
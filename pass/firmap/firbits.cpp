@@ -80,7 +80,8 @@ void Firmap::analysis_lg_flop(Node &node) {
 }
 
 void Firmap::analysis_lg_mux(Node &node) {
-  auto inp_edges = node.inp_edges();
+  auto                 inp_range = node.inp_edges_range();
+  XEdge_small_iterator inp_edges(inp_range.begin(), inp_range.end());
   I(inp_edges.size());  // Dangling???
 
   Bits_t max_bits = 0;
@@ -252,7 +253,8 @@ Firmap::Attr Firmap::get_key_attr(std::string_view key) {
 
 
 void Firmap::analysis_fir_ops(Node &node, std::string_view op) {
-  auto inp_edges = node.inp_edges();
+  auto                 inp_range = node.inp_edges_range();
+  XEdge_small_iterator inp_edges(inp_range.begin(), inp_range.end());
   if (op == "__fir_add" || op == "__fir_sub") {
     analysis_fir_add_sub(node, inp_edges);
   } else if (op == "__fir_mul") {
@@ -300,7 +302,7 @@ void Firmap::analysis_fir_ops(Node &node, std::string_view op) {
   }
 }
 
-void Firmap::analysis_fir_tail(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_tail(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -322,7 +324,7 @@ void Firmap::analysis_fir_tail(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_head(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_head(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits2;
@@ -344,7 +346,7 @@ void Firmap::analysis_fir_head(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_bits_extract(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_bits_extract(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 3);  
 
   Bits_t hi, lo;
@@ -368,7 +370,7 @@ void Firmap::analysis_fir_bits_extract(Node &node, XEdge_iterator &inp_edges) {
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(hi - lo + 1, false));
 }
 
-void Firmap::analysis_fir_cat(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_cat(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -393,7 +395,7 @@ void Firmap::analysis_fir_cat(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_bitwire_reduction(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_bitwire_reduction(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 1);  
   for (auto e : inp_edges) {
     auto it = fbmap.find(e.driver.get_compact());
@@ -406,7 +408,7 @@ void Firmap::analysis_fir_bitwire_reduction(Node &node, XEdge_iterator &inp_edge
   }
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(1, false));
 }
-void Firmap::analysis_fir_bitwise(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_bitwise(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -431,7 +433,7 @@ void Firmap::analysis_fir_bitwise(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_not(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_not(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 1);  
   
   Bits_t bits1;
@@ -452,7 +454,7 @@ void Firmap::analysis_fir_not(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_neg(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_neg(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 1);  
   
   Bits_t bits1;
@@ -473,7 +475,7 @@ void Firmap::analysis_fir_neg(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_cvt(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_cvt(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 1);  
   
   Bits_t bits1;
@@ -500,7 +502,7 @@ void Firmap::analysis_fir_cvt(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_dshr(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_dshr(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -524,7 +526,7 @@ void Firmap::analysis_fir_dshr(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_dshl(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_dshl(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -546,7 +548,7 @@ void Firmap::analysis_fir_dshl(Node &node, XEdge_iterator &inp_edges) {
   }
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(bits1 + std::pow(2, bits2) - 1, sign));
 }
-void Firmap::analysis_fir_shr(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_shr(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -574,7 +576,7 @@ void Firmap::analysis_fir_shr(Node &node, XEdge_iterator &inp_edges) {
   }
 }
 
-void Firmap::analysis_fir_shl(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_shl(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -597,7 +599,7 @@ void Firmap::analysis_fir_shl(Node &node, XEdge_iterator &inp_edges) {
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(bits1 + bits2, sign));
 }
 
-void Firmap::analysis_fir_as_sint(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_as_sint(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 1);  
 
   Bits_t bits1;
@@ -616,7 +618,7 @@ void Firmap::analysis_fir_as_sint(Node &node, XEdge_iterator &inp_edges) {
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(bits1, true));
 }
 
-void Firmap::analysis_fir_as_uint(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_as_uint(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 1);  
 
   Bits_t bits1;
@@ -635,7 +637,7 @@ void Firmap::analysis_fir_as_uint(Node &node, XEdge_iterator &inp_edges) {
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(bits1, false));
 }
 
-void Firmap::analysis_fir_pad(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_pad(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -658,7 +660,7 @@ void Firmap::analysis_fir_pad(Node &node, XEdge_iterator &inp_edges) {
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(std::max(bits1, bits2), sign));
 }
 
-void Firmap::analysis_fir_comp(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_comp(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  
   bool sign;
 
@@ -680,7 +682,7 @@ void Firmap::analysis_fir_comp(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_rem(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_rem(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  
 
   Bits_t bits1, bits2;
@@ -704,7 +706,7 @@ void Firmap::analysis_fir_rem(Node &node, XEdge_iterator &inp_edges) {
   fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(std::min(bits1, bits2), sign));
 }
 
-void Firmap::analysis_fir_div(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_div(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size());  
 
   Bits_t bits1;
@@ -732,7 +734,7 @@ void Firmap::analysis_fir_div(Node &node, XEdge_iterator &inp_edges) {
     fbmap.insert_or_assign(node.get_driver_pin("Y").get_compact(), Firrtl_bits(bits1, sign));
 }
 
-void Firmap::analysis_fir_mul(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_mul(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
@@ -758,7 +760,7 @@ void Firmap::analysis_fir_mul(Node &node, XEdge_iterator &inp_edges) {
 }
 
 
-void Firmap::analysis_fir_add_sub(Node &node, XEdge_iterator &inp_edges) {
+void Firmap::analysis_fir_add_sub(Node &node, XEdge_small_iterator &inp_edges) {
   I(inp_edges.size() == 2);  
 
   Bits_t bits1, bits2;
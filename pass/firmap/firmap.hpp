@@ -28,27 +28,27 @@ protected:
   void analysis_lg_mux                (Node &node);
   void analysis_fir_ops               (Node &node, std::string_view op);
   //fir_op
-  void analysis_fir_add_sub           (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_mul               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_div               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_rem               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_comp              (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_pad               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_as_uint           (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_as_sint           (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_shl               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_shr               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_dshl              (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_dshr              (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_cvt               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_neg               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_not               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_bitwise           (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_bitwire_reduction (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_bits_extract      (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_cat               (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_head              (Node &node, XEdge_iterator &inp_edges);
-  void analysis_fir_tail              (Node &node, XEdge_iterator &inp_edges);
+  void analysis_fir_add_sub           (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_mul               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_div               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_rem               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_comp              (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_pad               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_as_uint           (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_as_sint           (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_shl               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_shr               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_dshl              (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_dshr              (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_cvt               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_neg               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_not               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_bitwise           (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_bitwire_reduction (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_bits_extract      (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_cat               (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_head              (Node &node, XEdge_small_iterator &inp_edges);
+  void analysis_fir_tail              (Node &node, XEdge_small_iterator &inp_edges);
 
 
   //fir_op->lg_ops 
@@ -0,0 +1,95 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lgraph_builder.hpp"
+#include "pass_flatten.hpp"
+
+// Flattens a 3 level hierarchy (top, n_inst mid, n_inst leaf each) with
+// n_cells cells once flat. The default is the 10M cell target, an argument
+// changes it (flatten_bench 1000000).
+
+constexpr int n_inst = 100;
+
+// a chain of Sum cells from a, b (or instances of sub in a chain) to z
+static LGraph *create_module(std::string_view name, Lg_type_id sub, int n) {
+  auto *lg = LGraph::create("lgdb_flatten_bench", name, "bench");
+  lg->add_graph_input("a", 1, 16);
+  lg->add_graph_input("b", 2, 16);
+  lg->add_graph_output("z", 3, 16);
+
+  LGraph_builder builder(lg);
+  builder.reserve(n + 2, 2 * n + 1);
+
+  auto    inp = builder.add_node(lg->get_graph_input_node());
+  auto    out = builder.add_node(lg->get_graph_output_node());
+  auto    a   = lg->get_self_sub_node().get_instance_pid("a");
+  auto    b   = lg->get_self_sub_node().get_instance_pid("b");
+  auto    z   = lg->get_self_sub_node().get_instance_pid("z");
+
+  auto    prev     = inp;
+  Port_ID prev_pid = a;
+  for (int i = 0; i < n; ++i) {
+    if (sub == 0) {
+      auto h = builder.add_node(Ntype_op::Sum);
+      builder.add_edge(prev, prev_pid, h, Ntype::get_sink_pid(Ntype_op::Sum, "A"), 16);
+      builder.add_edge(inp, b, h, Ntype::get_sink_pid(Ntype_op::Sum, "A"));
+      prev     = h;
+      prev_pid = 0;
+    } else {
+      const auto &sub_node = lg->get_library().get_sub(sub);
+
+      auto h = builder.add_node_sub(sub);
+      builder.add_edge(prev, prev_pid, h, sub_node.get_instance_pid("a"));
+      builder.add_edge(inp, b, h, sub_node.get_instance_pid("b"));
+      prev     = h;
+      prev_pid = sub_node.get_instance_pid("z");
+    }
+  }
+  builder.add_edge(prev, prev_pid, out, z);
+  builder.commit();
+
+  return lg;
+}
+
+int main(int argc, char **argv) {
+  size_t n_cells = 10'000'000;
+  if (argc > 1)
+    n_cells = std::strtoull(argv[1], nullptr, 10);
+
+  int n_leaf = std::max<size_t>(1, n_cells / (n_inst * n_inst));
+
+  LGraph *top;
+  {
+    Lbench b("pass.FLATTEN_bench_create");
+
+    auto *leaf = create_module("bench_leaf", 0, n_leaf);
+    auto *mid  = create_module("bench_mid", leaf->get_lgid(), n_inst);
+    top        = create_module("bench_top", mid->get_lgid(), n_inst);
+  }
+
+  Eprp_var var;
+  var.add(top);
+
+  LGraph *flat;
+  {
+    Lbench       b("pass.FLATTEN_bench");
+    Pass_flatten p(var);
+    flat = p.flatten(top, "bench_top_flat");
+  }
+
+  size_t n = 0;
+  for (auto node : flat->fast()) {
+    (void)node;
+    ++n;
+  }
+  fmt::print("flatten_bench cells:{} flat nodes:{}\n", static_cast<size_t>(n_leaf) * n_inst * n_inst, n);
+
+  return n == static_cast<size_t>(n_leaf) * n_inst * n_inst ? 0 : 1;
+}
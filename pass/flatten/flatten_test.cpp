@@ -0,0 +1,214 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "pass_flatten.hpp"
+
+class Setup_flatten : public ::testing::Test {
+protected:
+  static constexpr int n_mid = 100;
+
+  LGraph *top;
+  LGraph *mid;
+  LGraph *leaf;
+
+  // leaf: z = a & b, y = a (feed-through)
+  // mid:  2 leaf in a chain, z = leaf1.z ^ leaf0.y
+  // top:  n_mid mid, all driven by the top inputs, z = or of all mid.z
+  void SetUp() override {
+    leaf = LGraph::create("lgdb_flatten", "flat_leaf", "test");
+    {
+      auto a = leaf->add_graph_input("a", 1, 4);
+      auto b = leaf->add_graph_input("b", 2, 4);
+      leaf->add_graph_output("z", 3, 4);
+      leaf->add_graph_output("y", 4, 4);
+
+      auto and_node = leaf->create_node(Ntype_op::And, 4);
+      a.connect_sink(and_node.setup_sink_pin("A"));
+      b.connect_sink(and_node.setup_sink_pin("A"));
+      and_node.setup_driver_pin().set_name("leaf_and");
+      and_node.setup_driver_pin().connect_sink(leaf->get_graph_output("z"));
+      a.connect_sink(leaf->get_graph_output("y"));
+    }
+
+    mid = LGraph::create("lgdb_flatten", "flat_mid", "test");
+    {
+      auto a = mid->add_graph_input("a", 1, 4);
+      auto b = mid->add_graph_input("b", 2, 4);
+      mid->add_graph_output("z", 3, 4);
+
+      auto l0 = mid->create_node_sub(leaf->get_lgid());
+      l0.set_name("l0");
+      a.connect_sink(l0.setup_sink_pin("a"));
+      b.connect_sink(l0.setup_sink_pin("b"));
+
+      auto l1 = mid->create_node_sub(leaf->get_lgid());
+      l1.set_name("l1");
+      l0.setup_driver_pin("z").connect_sink(l1.setup_sink_pin("a"));
+      b.connect_sink(l1.setup_sink_pin("b"));
+
+      auto xor_node = mid->create_node(Ntype_op::Xor, 4);
+      l1.setup_driver_pin("z").connect_sink(xor_node.setup_sink_pin("A"));
+      l0.setup_driver_pin("y").connect_sink(xor_node.setup_sink_pin("A"));
+      xor_node.setup_driver_pin().connect_sink(mid->get_graph_output("z"));
+    }
+
+    top = LGraph::create("lgdb_flatten", "flat_top", "test");
+    {
+      auto a = top->add_graph_input("a", 1, 4);
+      auto b = top->add_graph_input("b", 2, 4);
+      top->add_graph_output("z", 3, 4);
+
+      auto or_node = top->create_node(Ntype_op::Or, 4);
+      for (int i = 0; i < n_mid; ++i) {
+        auto m = top->create_node_sub(mid->get_lgid());
+        a.connect_sink(m.setup_sink_pin("a"));
+        b.connect_sink(m.setup_sink_pin("b"));
+        m.setup_driver_pin("z").connect_sink(or_node.setup_sink_pin("A"));
+      }
+      or_node.setup_driver_pin().connect_sink(top->get_graph_output("z"));
+    }
+  }
+
+  static int count(LGraph *lg, Ntype_op op) {
+    int n = 0;
+    for (auto node : lg->fast()) {
+      if (node.get_type_op() == op)
+        ++n;
+    }
+    return n;
+  }
+
+  LGraph *run(std::string_view depth, std::string_view area) {
+    Eprp_var var;
+    var.add(top);
+    var.add("depth", depth);
+    var.add("area", area);
+
+    Pass_flatten p(var);
+    Lbench       b("pass.FLATTEN_test");
+    return p.flatten(top, "flat_top_flat");
+  }
+};
+
+TEST_F(Setup_flatten, all) {
+  auto *flat = run("0", "0");
+
+  EXPECT_EQ(count(flat, Ntype_op::Sub), 0);
+  EXPECT_EQ(count(flat, Ntype_op::And), 2 * n_mid);
+  EXPECT_EQ(count(flat, Ntype_op::Xor), n_mid);
+  EXPECT_EQ(count(flat, Ntype_op::Or), 1);
+  EXPECT_TRUE(flat->is_graph_input("a"));
+  EXPECT_TRUE(flat->is_graph_output("z"));
+
+  for (auto node : flat->fast()) {
+    if (node.get_type_op() != Ntype_op::Xor)
+      continue;
+
+    // leaf1.z (and of leaf0.z and b) and leaf0.y (the feed-through of a)
+    int n_and = 0;
+    int n_a   = 0;
+    for (auto &e : node.inp_edges()) {
+      if (e.driver.get_node().get_type_op() == Ntype_op::And) {
+        ++n_and;
+        EXPECT_EQ(e.driver.get_bits(), 4);
+        EXPECT_THAT(std::string(e.driver.get_name()), testing::EndsWith(".l1.leaf_and"));
+        auto n_inner = 0;
+        for (auto &e2 : e.driver.get_node().inp_edges()) {
+          if (e2.driver.get_node().get_type_op() == Ntype_op::And)
+            ++n_inner;
+          else
+            EXPECT_EQ(e2.driver.get_name(), "b");
+        }
+        EXPECT_EQ(n_inner, 1);
+      } else {
+        ++n_a;
+        EXPECT_EQ(e.driver.get_name(), "a");
+      }
+    }
+    EXPECT_EQ(n_and, 1);
+    EXPECT_EQ(n_a, 1);
+    EXPECT_EQ(node.out_edges().size(), 1);
+  }
+
+  EXPECT_EQ(flat->get_graph_output("z").get_driver_pin().get_node().get_type_op(), Ntype_op::Or);
+}
+
+TEST_F(Setup_flatten, depth) {
+  auto *flat = run("1", "0");
+
+  // mid inlined, leaf kept
+  EXPECT_EQ(count(flat, Ntype_op::Sub), 2 * n_mid);
+  EXPECT_EQ(count(flat, Ntype_op::Xor), n_mid);
+  EXPECT_EQ(count(flat, Ntype_op::And), 0);
+
+  for (auto node : flat->fast()) {
+    if (node.is_type_sub()) {
+      EXPECT_EQ(node.get_type_sub(), leaf->get_lgid());
+    }
+  }
+}
+
+TEST_F(Setup_flatten, area) {
+  // mid is 3 cells once flat, leaf is 1
+  auto *flat = run("0", "2");
+
+  EXPECT_EQ(count(flat, Ntype_op::Sub), n_mid);
+  EXPECT_EQ(count(flat, Ntype_op::And), 0);
+
+  // The mid definition is not touched
+  EXPECT_EQ(count(mid, Ntype_op::Sub), 2);
+}
+
+TEST_F(Setup_flatten, parallel) {
+  constexpr int n_leaf  = 64;
+  constexpr int n_cells = 200;
+  constexpr int n_inst  = 10;
+
+  // Independent leaves, flattened by different threads
+  auto *ptop = LGraph::create("lgdb_flatten", "flat_ptop", "test");
+  auto  a    = ptop->add_graph_input("a", 1, 4);
+  ptop->add_graph_output("z", 2, 4);
+  auto or_node = ptop->create_node(Ntype_op::Or, 4);
+
+  for (int l = 0; l < n_leaf; ++l) {
+    auto *pleaf = LGraph::create("lgdb_flatten", absl::StrCat("flat_pleaf", std::to_string(l)), "test");
+    auto  la    = pleaf->add_graph_input("a", 1, 4);
+    pleaf->add_graph_output("z", 2, 4);
+    auto dpin = la;
+    for (int i = 0; i < n_cells; ++i) {
+      auto node = pleaf->create_node(Ntype_op::Xor, 4);
+      dpin.connect_sink(node.setup_sink_pin("A"));
+      la.connect_sink(node.setup_sink_pin("A"));
+      dpin = node.setup_driver_pin();
+    }
+    dpin.connect_sink(pleaf->get_graph_output("z"));
+
+    for (int i = 0; i < n_inst; ++i) {
+      auto inst = ptop->create_node_sub(pleaf->get_lgid());
+      a.connect_sink(inst.setup_sink_pin("a"));
+      inst.setup_driver_pin("z").connect_sink(or_node.setup_sink_pin("A"));
+    }
+  }
+  or_node.setup_driver_pin().connect_sink(ptop->get_graph_output("z"));
+
+  Eprp_var var;
+  var.add(ptop);
+  Pass_flatten p(var);
+
+  LGraph *flat;
+  {
+    Lbench b("pass.FLATTEN_parallel");
+    flat = p.flatten(ptop, "flat_ptop_flat");
+  }
+
+  EXPECT_EQ(count(flat, Ntype_op::Sub), 0);
+  EXPECT_EQ(count(flat, Ntype_op::Xor), n_leaf * n_inst * n_cells);
+  EXPECT_EQ(or_node.get_sink_pin("A").inp_edges().size(), n_leaf * n_inst);
+  EXPECT_EQ(flat->get_graph_output("z").get_driver_pin().get_node().inp_edges().size(), n_leaf * n_inst);
+}
@@ -0,0 +1,425 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "pass_flatten.hpp"
+
+#include <algorithm>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph_builder.hpp"
+#include "thread_pool.hpp"
+
+static Pass_plugin sample("pass_flatten", Pass_flatten::setup);
+
+void Pass_flatten::setup() {
+  Eprp_method m1("pass.flatten", "inline the Sub instances, the flat <name>_flat lgraphs replace the inputs", &Pass_flatten::work);
+
+  m1.add_label_optional("depth", "hierarchy levels to inline (0 all)", "0");
+  m1.add_label_optional("area", "largest instance to inline, in cells once flattened (0 any)", "0");
+
+  register_pass(m1);
+}
+
+Pass_flatten::Pass_flatten(const Eprp_var &var) : Pass("pass.flatten", var) {
+  auto depth_txt = var.get("depth");
+  auto area_txt  = var.get("area");
+
+  int depth = 0;
+  if (!depth_txt.empty() && (!absl::SimpleAtoi(depth_txt, &depth) || depth < 0)) {
+    error("pass.flatten depth:{} should be zero or positive", depth_txt);
+    return;
+  }
+  max_depth = depth == 0 ? no_depth_limit : depth;
+
+  uint64_t area = 0;
+  if (!area_txt.empty() && !absl::SimpleAtoi(area_txt, &area)) {
+    error("pass.flatten area:{} should be zero or positive", area_txt);
+    return;
+  }
+  max_area = area == 0 ? std::numeric_limits<size_t>::max() : area;
+}
+
+void Pass_flatten::work(Eprp_var &var) {
+  Lbench       b("pass.FLATTEN");
+  Pass_flatten p(var);
+
+  for (auto &lg : var.lgs) {
+    lg = p.flatten(lg, absl::StrCat(lg->get_name(), "_flat"));
+  }
+}
+
+int Pass_flatten::collect(LGraph *lg, int depth) {
+  const Module_key key(lg->get_lgid().value, depth);
+
+  const auto it = modules.find(key);
+  if (it != modules.end())
+    return it->second.height;
+
+  int                   height = 0;
+  std::vector<Module *> children;
+  if (depth > 0) {
+    lg->each_sub_unique_fast([this, lg, depth, &height, &children](Node &node, Lg_type_id lgid) {
+      (void)node;
+      auto *sub_lg = lg->get_library().try_find_lgraph(lgid);
+      if (sub_lg != nullptr) {  // black boxes (or not open) stay as Sub
+        height = std::max(height, collect(sub_lg, next_depth(depth)) + 1);
+
+        auto &child = modules.at(Module_key(lgid.value, next_depth(depth)));
+        child.n_parents++;
+        children.emplace_back(&child);
+      }
+      return true;
+    });
+  }
+
+  modules.emplace(key, Module{lg, depth, height, {}, std::move(children), 0, {}, {}});
+
+  return height;
+}
+
+void Pass_flatten::read(Module &mod) const {
+  auto *lg    = mod.lg;
+  auto &fm    = mod.flat;
+  auto &alias = mod.alias;
+
+  absl::flat_hash_map<Node_pin::Compact_class_driver, uint32_t> dpin_map;
+
+  auto add_dpin = [&fm, &alias, &dpin_map](uint32_t cell, const Node_pin &dpin, bool is_alias) {
+    uint32_t id = fm.dpins.size();
+    fm.dpins.emplace_back(Flat_module::Dpin{cell, dpin.get_pid(), dpin.get_bits(), dpin.get_offset()});
+    alias.emplace_back(is_alias ? no_driver : id);
+    dpin_map.emplace(dpin.get_compact_class_driver(), id);
+    return id;
+  };
+
+  lg->each_graph_input([&add_dpin](Node_pin &pin) { add_dpin(Flat_module::input_cell, pin, false); });
+
+  std::vector<Node> cell_nodes;
+  std::vector<Node> inst_nodes;
+
+  for (auto node : lg->fast()) {
+    if (node.is_type_sub() && mod.depth > 0) {
+      const auto it = modules.find(Module_key(node.get_type_sub().value, next_depth(mod.depth)));
+      if (it != modules.end() && it->second.flat.cells.size() <= max_area) {
+        Flat_inst inst{&it->second.flat, {}, {}, {}};
+        if (node.has_name()) {
+          inst.prefix = absl::StrCat(node.get_name(), ".");
+        } else {  // Same as Node::create_name, without setting it
+          inst.prefix
+              = absl::StrCat("lg_", Ntype::get_name(Ntype_op::Sub), std::to_string(node.get_compact_class().get_nid().value), ".");
+        }
+        for (const auto &dpin : node.out_connected_pins()) {
+          auto id = add_dpin(0, dpin, true);  // set once the instance is spliced
+          if (dpin.has_name())
+            fm.dpin_names.emplace_back(id, dpin.get_name());  // before the instance ones, parent names win
+          inst.outputs.emplace_back(dpin.get_pid(), id);
+        }
+        mod.insts.emplace_back(std::move(inst));
+        inst_nodes.emplace_back(node);
+        continue;
+      }
+    }
+
+    uint32_t cell = fm.cells.size();
+    auto     op   = node.get_type_op();
+    uint32_t data = 0;
+    if (op == Ntype_op::Sub) {
+      data = node.get_type_sub().value;
+    } else if (op == Ntype_op::Const) {
+      data = fm.lconsts.size();
+      fm.lconsts.emplace_back(node.get_type_const());
+    } else if (op == Ntype_op::LUT) {
+      data = fm.lconsts.size();
+      fm.lconsts.emplace_back(node.get_type_lut());
+    }
+    fm.cells.emplace_back(Flat_module::Cell{op, data});
+    cell_nodes.emplace_back(node);
+
+    if (node.has_name())
+      fm.cell_names.emplace_back(cell, node.get_name());
+
+    for (const auto &dpin : node.out_connected_pins()) {
+      auto id = add_dpin(cell, dpin, false);
+      if (dpin.has_name())
+        fm.dpin_names.emplace_back(id, dpin.get_name());
+    }
+  }
+
+  auto get_dpin = [&dpin_map](const Node_pin &dpin) {
+    const auto it = dpin_map.find(dpin.get_compact_class_driver());
+    I(it != dpin_map.end());
+    return it->second;
+  };
+
+  for (auto i = 0u; i < cell_nodes.size(); ++i) {
+    for (auto &e : cell_nodes[i].inp_edges()) {
+      fm.edges.emplace_back(Flat_module::Edge{get_dpin(e.driver), i, e.sink.get_pid()});
+    }
+  }
+  for (auto i = 0u; i < inst_nodes.size(); ++i) {
+    for (auto &e : inst_nodes[i].inp_edges()) {
+      mod.insts[i].inputs.emplace_back(e.sink.get_pid(), get_dpin(e.driver));
+    }
+  }
+
+  lg->each_graph_output([&fm, &get_dpin](Node_pin &pin) {
+    uint32_t driver = no_driver;
+    for (auto &e : pin.get_sink_from_output().inp_edges()) {
+      driver = get_dpin(e.driver);
+    }
+    fm.outputs.emplace_back(pin.get_pid(), driver);
+  });
+}
+
+void Pass_flatten::splice(Module &mod) const {
+  auto &fm    = mod.flat;
+  auto &alias = mod.alias;
+
+  for (const auto &inst : mod.insts) {
+    absl::flat_hash_map<Port_ID, uint32_t> inp_drivers(inst.inputs.begin(), inst.inputs.end());
+    absl::flat_hash_map<Port_ID, uint32_t> out_dpins(inst.outputs.begin(), inst.outputs.end());
+
+    const auto &child       = *inst.flat;
+    uint32_t    cell_base   = fm.cells.size();
+    uint32_t    dpin_base   = fm.dpins.size();
+    uint32_t    lconst_base = fm.lconsts.size();
+
+    fm.lconsts.insert(fm.lconsts.end(), child.lconsts.begin(), child.lconsts.end());
+    for (const auto &c : child.cells) {
+      auto data = (c.op == Ntype_op::Const || c.op == Ntype_op::LUT) ? c.data + lconst_base : c.data;
+      fm.cells.emplace_back(Flat_module::Cell{c.op, data});
+    }
+    for (const auto &[cell, name] : child.cell_names) {
+      fm.cell_names.emplace_back(cell + cell_base, absl::StrCat(inst.prefix, name));
+    }
+
+    for (const auto &d : child.dpins) {
+      if (d.cell == Flat_module::input_cell) {
+        const auto it = inp_drivers.find(d.pid);
+        alias.emplace_back(it == inp_drivers.end() ? no_driver : it->second);
+        fm.dpins.emplace_back(d);
+      } else {
+        alias.emplace_back(fm.dpins.size());
+        fm.dpins.emplace_back(Flat_module::Dpin{d.cell + cell_base, d.pid, d.bits, d.offset});
+      }
+    }
+    for (const auto &[dpin, name] : child.dpin_names) {
+      fm.dpin_names.emplace_back(dpin + dpin_base, absl::StrCat(inst.prefix, name));
+    }
+
+    for (const auto &e : child.edges) {
+      fm.edges.emplace_back(Flat_module::Edge{e.dpin + dpin_base, e.cell + cell_base, e.pid});
+    }
+
+    for (const auto &[pid, driver] : child.outputs) {
+      const auto it = out_dpins.find(pid);
+      if (it != out_dpins.end())
+        alias[it->second] = driver == no_driver ? no_driver : driver + dpin_base;
+    }
+  }
+
+  // Resolve the aliases (with path compression). A loop of instance
+  // feed-throughs has no driver.
+  constexpr uint32_t in_path = no_driver - 1;
+  std::vector<uint32_t> path;
+  auto resolve = [&alias, &path](uint32_t id) {
+    path.clear();
+    while (id != no_driver && alias[id] != id) {
+      auto next = alias[id];
+      if (next == in_path) {
+        id = no_driver;
+        break;
+      }
+      alias[id] = in_path;
+      path.emplace_back(id);
+      id = next;
+    }
+    for (auto p : path) {
+      alias[p] = id;
+    }
+    return id;
+  };
+
+  std::vector<uint32_t> remap(fm.dpins.size(), no_driver);
+  for (auto &e : fm.edges) {
+    e.dpin = resolve(e.dpin);
+    if (e.dpin != no_driver)
+      remap[e.dpin] = 0;
+  }
+  for (auto &[pid, driver] : fm.outputs) {
+    driver = resolve(driver);
+    if (driver != no_driver)
+      remap[driver] = 0;
+  }
+
+  // Only the used dpins stay, in the same order
+  std::vector<Flat_module::Dpin> dpins;
+  for (auto i = 0u; i < remap.size(); ++i) {
+    if (remap[i] == no_driver)
+      continue;
+    remap[i] = dpins.size();
+    dpins.emplace_back(fm.dpins[i]);
+  }
+  fm.dpins.swap(dpins);
+
+  fm.edges.erase(std::remove_if(fm.edges.begin(), fm.edges.end(), [](const Flat_module::Edge &e) { return e.dpin == no_driver; }),
+                 fm.edges.end());
+  for (auto &e : fm.edges) {
+    e.dpin = remap[e.dpin];
+  }
+  for (auto &[pid, driver] : fm.outputs) {
+    if (driver != no_driver)
+      driver = remap[driver];
+  }
+
+  std::vector<std::pair<uint32_t, std::string>> dpin_names;
+  std::vector<bool>                             named(fm.dpins.size(), false);
+  for (auto &[id, name] : fm.dpin_names) {
+    auto r = resolve(id);
+    if (r == no_driver || remap[r] == no_driver || named[remap[r]])
+      continue;
+    named[remap[r]] = true;
+    dpin_names.emplace_back(remap[r], std::move(name));
+  }
+  fm.dpin_names.swap(dpin_names);
+
+  mod.insts.clear();
+  mod.alias.clear();
+}
+
+void Pass_flatten::commit(const Module &mod, LGraph *flat_lg) const {
+  const auto &fm       = mod.flat;
+  const auto &top_sub  = mod.lg->get_self_sub_node();
+  const auto &flat_sub = flat_lg->get_self_sub_node();
+
+  LGraph_builder builder(flat_lg);
+  builder.reserve(fm.cells.size() + 2, fm.edges.size() + fm.outputs.size());
+
+  std::vector<LGraph_builder::Handle> cells;
+  cells.reserve(fm.cells.size());
+  for (const auto &c : fm.cells) {
+    if (c.op == Ntype_op::Sub) {
+      cells.emplace_back(builder.add_node_sub(Lg_type_id(c.data)));
+    } else if (c.op == Ntype_op::Const) {
+      cells.emplace_back(builder.add_node_const(fm.lconsts[c.data]));
+    } else if (c.op == Ntype_op::LUT) {
+      cells.emplace_back(builder.add_node_lut(fm.lconsts[c.data]));
+    } else {
+      cells.emplace_back(builder.add_node(c.op));
+    }
+  }
+  auto inp = builder.add_node(flat_lg->get_graph_input_node());
+  auto out = builder.add_node(flat_lg->get_graph_output_node());
+
+  // Cell pins keep their pid (Sub pins are instance pids too), the graph IO
+  // pins are matched by name
+  auto flat_io_pid = [&top_sub, &flat_sub](Port_ID pid) {
+    return flat_sub.get_instance_pid(top_sub.get_name_from_instance_pid(pid));
+  };
+  auto add_edge = [&](uint32_t driver, LGraph_builder::Handle sink, Port_ID sink_pid) {
+    const auto &d = fm.dpins[driver];
+    if (d.cell == Flat_module::input_cell)
+      builder.add_edge(inp, flat_io_pid(d.pid), sink, sink_pid);
+    else
+      builder.add_edge(cells[d.cell], d.pid, sink, sink_pid);
+  };
+  for (const auto &e : fm.edges) {
+    add_edge(e.dpin, cells[e.cell], e.pid);
+  }
+  for (const auto &[pid, driver] : fm.outputs) {
+    if (driver != no_driver)
+      add_edge(driver, out, flat_io_pid(pid));
+  }
+
+  builder.commit();
+
+  for (const auto &[cell, name] : fm.cell_names) {
+    builder.get_node(cells[cell]).set_name(name);
+  }
+
+  // Sub pins are set up by name
+  auto setup_driver = [](const Node &node, Port_ID pid) {
+    if (node.is_type_sub())
+      return node.setup_driver_pin(node.get_type_sub_node().get_name_from_instance_pid(pid));
+    return node.setup_driver_pin_raw(pid);
+  };
+
+  std::vector<Node_pin> dpins;
+  dpins.reserve(fm.dpins.size());
+  for (const auto &d : fm.dpins) {
+    if (d.cell == Flat_module::input_cell) {
+      dpins.emplace_back(flat_lg->get_graph_input(top_sub.get_name_from_instance_pid(d.pid)));
+      continue;
+    }
+    auto dpin = setup_driver(builder.get_node(cells[d.cell]), d.pid);
+    dpin.set_bits(d.bits);
+    dpin.set_offset(d.offset);
+    dpins.emplace_back(dpin);
+  }
+  for (const auto &[id, name] : fm.dpin_names) {
+    if (Node_pin::find_driver_pin(flat_lg, name).is_invalid())
+      dpins[id].set_name(name);
+  }
+}
+
+LGraph *Pass_flatten::flatten(LGraph *top, std::string_view flat_name) {
+  modules.clear();
+  auto top_height = collect(top, max_depth);
+
+  // Modules only depend on lower ones. The modules of a level are read and
+  // spliced in parallel (each one reads its own LGraph), the top one is
+  // written to flat_lg with one LGraph_builder commit.
+  std::vector<std::vector<Module *>> levels(top_height + 1);
+  for (auto &it : modules) {
+    levels[it.second.height].emplace_back(&it.second);
+  }
+
+  {
+    Thread_pool pool;
+    for (auto &level : levels) {
+      // In batches, the LGraphs in concurrent read mode are pinned (mmap_gc
+      // can not recycle them). The same LGraph can be in a level twice
+      // (reached at two depths).
+      for (size_t start = 0; start < level.size(); start += max_batch) {
+        const auto end = std::min(level.size(), start + max_batch);
+
+        absl::flat_hash_set<LGraph *> lgs;
+        for (auto i = start; i < end; ++i) {
+          lgs.insert(level[i]->lg);
+        }
+        for (auto *lg : lgs) {
+          lg->begin_concurrent_read();
+        }
+        for (auto i = start; i < end; ++i) {
+          pool.add([this, mod = level[i]] {
+            read(*mod);
+            splice(*mod);
+          });
+        }
+        pool.wait_all();
+        for (auto *lg : lgs) {
+          lg->end_concurrent_read();
+        }
+      }
+
+      // A child copy is only needed until all its parents are spliced
+      for (auto *mod : level) {
+        for (auto *child : mod->children) {
+          if (--child->n_parents == 0)
+            child->flat = Flat_module();
+        }
+      }
+    }
+  }
+
+  auto *flat_lg = top->clone_skeleton(flat_name);
+  commit(modules.at(Module_key(top->get_lgid().value, max_depth)), flat_lg);
+
+  modules.clear();
+
+  return flat_lg;
+}
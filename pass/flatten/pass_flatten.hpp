@@ -0,0 +1,97 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/node_hash_map.h"
+#include "lconst.hpp"
+#include "lgraph.hpp"
+#include "pass.hpp"
+
+class Pass_flatten : public Pass {
+protected:
+  static constexpr int      no_depth_limit = std::numeric_limits<int>::max();
+  static constexpr uint32_t no_driver      = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t   max_batch      = 64;  // modules read (LGraphs pinned) at once
+
+  // Staging buffer with the flattened contents of a module. The module is
+  // read from its LGraph (in concurrent read mode), then the instances are
+  // spliced without touching any LGraph, so that independent modules are
+  // flattened by different threads. Cells and pins are vector indexes.
+  struct Flat_module {
+    static constexpr uint32_t input_cell = std::numeric_limits<uint32_t>::max();  // dpin is a graph input (pid)
+
+    struct Cell {
+      Ntype_op op;
+      uint32_t data;  // Sub lgid, or Const/LUT index in lconsts
+    };
+    struct Dpin {
+      uint32_t cell;
+      Port_ID  pid;
+      Bits_t   bits;
+      Bits_t   offset;
+    };
+    struct Edge {
+      uint32_t dpin;
+      uint32_t cell;
+      Port_ID  pid;
+    };
+
+    std::vector<Cell>   cells;
+    std::vector<Dpin>   dpins;
+    std::vector<Edge>   edges;
+    std::vector<Lconst> lconsts;
+
+    std::vector<std::pair<uint32_t, std::string>> cell_names;
+    std::vector<std::pair<uint32_t, std::string>> dpin_names;
+
+    std::vector<std::pair<Port_ID, uint32_t>> outputs;  // graph output pid, driver dpin (or no_driver)
+  };
+
+  // Instance to inline, with its IO as dpin indexes of the parent
+  struct Flat_inst {
+    const Flat_module                        *flat;
+    std::string                               prefix;   // instance name and "."
+    std::vector<std::pair<Port_ID, uint32_t>> inputs;   // sink pid, parent driver dpin
+    std::vector<std::pair<Port_ID, uint32_t>> outputs;  // driver pid, parent alias dpin
+  };
+
+  // One per module and remaining depth (the same module can be reached at
+  // several depths when the depth is limited)
+  using Module_key = std::pair<uint32_t, int>;
+  struct Module {
+    LGraph     *lg;
+    int         depth;   // remaining levels to flatten below
+    int         height;  // longest path to a leaf module, flatten order
+    Flat_module flat;
+
+    std::vector<Module *> children;   // modules of the Sub nodes (once each)
+    int                   n_parents;  // not spliced yet, flat is freed at 0
+
+    // Between read and splice
+    std::vector<Flat_inst> insts;
+    std::vector<uint32_t>  alias;  // per dpin: itself, another dpin (instance IO) or no_driver
+  };
+
+  int    max_depth;
+  size_t max_area;  // cells of a flattened instance
+
+  absl::node_hash_map<Module_key, Module> modules;
+
+  int  next_depth(int depth) const { return depth == no_depth_limit ? depth : depth - 1; }
+  int  collect(LGraph *lg, int depth);
+  void read(Module &mod) const;
+  void splice(Module &mod) const;
+  void commit(const Module &mod, LGraph *flat_lg) const;
+
+  static void work(Eprp_var &var);
+
+public:
+  explicit Pass_flatten(const Eprp_var &var);
+  static void setup();
+
+  LGraph *flatten(LGraph *top, std::string_view flat_name);
+};
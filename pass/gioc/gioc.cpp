@@ -13,7 +13,8 @@
 #define TRACE(x)
 //#define TRACE(x) x
 
-Gioc::Gioc(std::string_view _path) : path(_path){}
+Gioc::Gioc(std::string_view _path)
+    : path(_path), name2dpin(Graph_library::instance(_path)), field2dpin(Graph_library::instance(_path)) {}
 
 //FIXME->sh: traverse whole graph just for searching sub-graph node? slow!?
 void Gioc::do_trans(LGraph *lg) {
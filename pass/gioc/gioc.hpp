@@ -3,15 +3,16 @@
 
 #include "lconst.hpp"
 #include "lgtuple.hpp"
+#include "name_map.hpp"
 #include "node.hpp"
 #include "pass.hpp"
 
 class Gioc {
 private:
   std::string_view path;
-  absl::flat_hash_map<std::string, Node_pin> name2dpin;      
-  absl::flat_hash_map<std::string, Node_pin> field2dpin;
-  std::vector<Node_pin>                      tgs_spins_from_unified_ta;
+  Name_map<Node_pin>    name2dpin;
+  Name_map<Node_pin>    field2dpin;
+  std::vector<Node_pin> tgs_spins_from_unified_ta;
 protected:
 
   std::vector<std::string_view> split_name (std::string_view hier_name, std::string_view delimiter);
@@ -105,7 +105,7 @@ void Pass_lnast_fromlg::begin_transformation(LGraph* lg, Lnast& lnast, Lnast_nid
 
   auto out_node = lg->get_graph_output_node();
   out_node.set_color(BLACK);
-  for (const auto& inp : out_node.inp_edges()) {
+  for (const auto& inp : out_node.inp_edges_range()) {
     auto gpio_dpin = out_node.get_driver_pin_raw(inp.sink.get_pid());
     I(gpio_dpin.has_name());
 
@@ -136,7 +136,7 @@ void Pass_lnast_fromlg::handle_source_node(LGraph* lg, Node_pin& pin, Lnast& lna
      * din value (ex. x = x - 1). We will have to traverse through
      * the grey nodes and forcibly insert them into the LNAST. (For
      * examples of this, see inou/yosys/tests/loop_in_lg.v and loop2_in_lg2.v)*/
-    for (const auto& inp : pin.get_node().inp_edges()) {
+    for (const auto& inp : pin.get_node().inp_edges_range()) {
       auto editable_pin = inp.driver;
       if (editable_pin.get_node().get_color() == GREY || editable_pin.get_node().get_color() == WHITE) {
         auto ntype = editable_pin.get_node().get_type_op();
@@ -156,7 +156,7 @@ void Pass_lnast_fromlg::handle_source_node(LGraph* lg, Node_pin& pin, Lnast& lna
   I(pin.get_node().get_color() == WHITE);
   pin.get_node().set_color(GREY);
 
-  for (const auto& inp : pin.get_node().inp_edges()) {
+  for (const auto& inp : pin.get_node().inp_edges_range()) {
     auto editable_pin = inp.driver;
     I(!inp.driver.get_node().is_hierarchical());
     //if (editable_pin.get_node().get_color() == WHITE || editable_pin.get_node().get_color() == GREY) {
@@ -268,7 +268,7 @@ void Pass_lnast_fromlg::handle_io(LGraph* lg, Lnast_nid& parent_lnast_node, Lnas
 
   auto inp_io_node = lg->get_graph_input_node();
   absl::flat_hash_set<std::string_view> inps_visited;
-  for (const auto edge : inp_io_node.out_edges()) {
+  for (const auto edge : inp_io_node.out_edges_range()) {
     I(edge.driver.has_name());
     auto pin_name = edge.driver.get_name();
     if (inps_visited.contains(pin_name)) {
@@ -292,7 +292,7 @@ void Pass_lnast_fromlg::handle_io(LGraph* lg, Lnast_nid& parent_lnast_node, Lnas
   }
 
   auto out_io_node = lg->get_graph_output_node();
-  for (const auto edge : out_io_node.inp_edges()) {
+  for (const auto edge : out_io_node.inp_edges_range()) {
     auto sink_pid = edge.sink.get_pid();
     auto out_pin = edge.sink.get_node().get_driver_pin_raw(sink_pid);
     I(out_pin.has_name());
@@ -326,7 +326,7 @@ void Pass_lnast_fromlg::attach_sum_node(Lnast& lnast, Lnast_nid& parent_node, co
 
   // Determine if we're doing an add, sub, or both.
   auto pin_name = lnast.add_string(dpin_get_name(pin));
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     auto spin = inp.sink;
     if (spin.get_pid() == 0) {
       add_count++;
@@ -363,7 +363,7 @@ void Pass_lnast_fromlg::attach_sum_node(Lnast& lnast, Lnast_nid& parent_node, co
   }
 
   // Attach the name of each of the node's inputs to the Lnast operation node we just made.
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     auto dpin = inp.driver;
     auto spin = inp.sink;
     // This if statement is used to figure out if the inp_edge is for plus or minus.
@@ -423,7 +423,7 @@ void Pass_lnast_fromlg::attach_binary_reduc(Lnast& lnast, Lnast_nid& parent_node
   std::queue<Node_pin> dpins;
   auto                 bits_to_shift = 0;
   uint32_t             total_bits = 0;
-  for (auto &inp_edge : pid1_pin.get_node().inp_edges()) {
+  for (const auto &inp_edge : pid1_pin.get_node().inp_edges_range()) {
     dpins.push(inp_edge.driver);
     bits_to_shift += inp_edge.driver.get_bits();
     total_bits += inp_edge.driver.get_bits();
@@ -632,7 +632,7 @@ void Pass_lnast_fromlg::attach_compar_node(Lnast& lnast, Lnast_nid& parent_node,
   /* For each A pin, we have to compare that against each B pin.
    * We know which is which based off the inp_edge's sink pin pid. */
   std::vector<Node_pin> a_pins, b_pins;
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     if (inp.sink.get_pid() == 0) {
       a_pins.push_back(inp.driver);
     } else {
@@ -776,7 +776,7 @@ void Pass_lnast_fromlg::attach_flop_node(Lnast& lnast, Lnast_nid& parent_node, c
   bool     has_pola  = false;
   bool     has_init  = false;
   Node_pin clk_pin, din_pin, en_pin, reset_pin, set_v_pin, pola_pin, init_pin;
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     if (inp.sink.get_pid() == 2) {
       I(!has_clk);
       has_clk = true;
@@ -935,7 +935,7 @@ void Pass_lnast_fromlg::attach_latch_node(Lnast& lnast, Lnast_nid& parent_node,
   bool     has_din   = false;
   bool     has_en    = false;
   Node_pin din_pin, en_pin;
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     if (inp.sink.get_pid() == 3) {
       I(!has_din);
       has_din = true;
@@ -1009,7 +1009,7 @@ void Pass_lnast_fromlg::attach_subgraph_node(Lnast& lnast, Lnast_nid& parent_nod
   auto args_idx = lnast.add_child(parent_node, Lnast_node::create_tuple("args_tuple"));
   lnast.add_child(args_idx, Lnast_node::create_ref(inp_tup_name));
   //attach_child(lnast, args_idx, const Node_pin &dpin)
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     auto port_name = inp.sink.get_type_sub_pin_name();
     auto idx_asg = lnast.add_child(args_idx, Lnast_node::create_assign("sb_arg_set"));
     lnast.add_child(idx_asg, Lnast_node::create_ref(lnast.add_string(port_name)));
@@ -1055,7 +1055,7 @@ void Pass_lnast_fromlg::attach_memory_node(Lnast& lnast, Lnast_nid& parent_node,
        is_one_en    = false, is_one_fwd  = false, is_one_lat   = false,
        is_one_wmask = false, is_one_pose = false, is_one_wmode = false;
   Node_pin size_dpin, bits_dpin;
-  for (const auto& inp : pin.get_node().inp_edges_ordered()) {
+  for (const auto& inp : pin.get_node().inp_edges_ordered_small()) {
     switch (inp.sink.get_pid()) {
       case 0:  // addr
         addr_q.push(inp.driver);
@@ -1189,7 +1189,7 @@ void Pass_lnast_fromlg::attach_memory_node(Lnast& lnast, Lnast_nid& parent_node,
 
 //------------- Helper Functions ------------
 void Pass_lnast_fromlg::attach_children_to_node(Lnast& lnast, Lnast_nid& op_node, const Node_pin& pin) {
-  for (const auto inp : pin.get_node().inp_edges()) {
+  for (const auto inp : pin.get_node().inp_edges_range()) {
     auto dpin = inp.driver;
     attach_child(lnast, op_node, dpin);
   }
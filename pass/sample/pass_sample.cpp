@@ -1,4 +1,6 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#include <array>
+#include <atomic>
 #include <string>
 
 #include "pass_sample.hpp"
@@ -115,38 +117,45 @@ void Pass_sample::do_wirecount(LGraph *g, int indent) {
 void Pass_sample::compute_histogram(LGraph *g) {
   Lbench b("pass.SAMPLE_compute_histogram");
 
-  std::map<Ntype_op, int> histogram;
+  std::array<std::atomic<int>, static_cast<size_t>(Ntype_op::Last_invalid)> histogram{};
 
-  int cells = 0;
-  for (const auto node : g->forward()) {
+  std::atomic<int> cells(0);
+  g->each_node_parallel([&histogram, &cells](const Node &node) {  // read-only sweep, order does not matter
     cells++;
     auto type = node.get_type_op();
 
-    histogram[type]++;
-  }
+    histogram[static_cast<size_t>(type)]++;
+  });
 
-  for (auto it = histogram.begin(); it != histogram.end(); it++) {
-    fmt::print("{} {}\n", it->first, it->second);
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    if (histogram[i] == 0)
+      continue;
+    fmt::print("{} {}\n", static_cast<Ntype_op>(i), histogram[i].load());
   }
 
-  fmt::print("Pass: cells {}\n", cells);
+  fmt::print("Pass: cells {}\n", cells.load());
 }
 
 void Pass_sample::compute_max_depth(LGraph *g) {
   Lbench b("pass.SAMPLE_max_depth");
 
-  absl::flat_hash_map<Node::Compact, int> depth;
+  absl::flat_hash_map<uint32_t, int> depth;  // driver pin root idx to the depth of its node
+
+  const auto &csr    = g->freeze();            // read-only pass, scan the CSR snapshot
+  const auto &levels = g->get_levelization();  // cached topological order
 
   int max_depth = 0;
-  for (const auto node : g->forward()) {
+  for (const auto node : levels.get_order()) {
     int local_max = 0;
-    for (const auto &edge : node.inp_edges()) {
-      int d = depth[edge.driver.get_node().get_compact()];
+    for (const auto &e : csr.inp_edges(node)) {
+      int d = depth[e.driver_idx];
       if (local_max <= d)
         local_max = d + 1;
     }
     fmt::print("{} {}\n", node.debug_name(), local_max);
-    depth[node.get_compact()] = local_max;
+    for (const auto &e : csr.out_edges(node)) {
+      depth[e.driver_idx] = local_max;
+    }
   }
 
   fmt::print("Pass: max_depth {}\n", max_depth);
@@ -46,6 +46,7 @@ class Thread_pool {
 
   std::atomic<int>  jobs_left;
   std::atomic<bool> finishing;
+  std::atomic_flag  spawn_lock = ATOMIC_FLAG_INIT;  // per pool, not static (several pools can coexist)
 
   size_t thread_count;
 
@@ -53,18 +54,14 @@ class Thread_pool {
   std::mutex              queue_mutex;
 
   void task() {
-    static std::atomic_flag lock = ATOMIC_FLAG_INIT;
-
-    if (!lock.test_and_set(std::memory_order_acquire)) {
+    if (!spawn_lock.test_and_set(std::memory_order_acquire)) {
       for(unsigned i = 1; i < thread_count; ++i)
         threads.push_back(std::thread([this] { this->task(); }));
     }
 
     while(!finishing) {
-      while(!queue.empty()) {
-        next_job()();
-        jobs_left.fetch_sub(1, std::memory_order_relaxed);
-      }
+      next_job()(); // blocks while the queue is empty, do not spin idle pools
+      jobs_left.fetch_sub(1, std::memory_order_relaxed);
     }
   }
 
@@ -98,8 +95,12 @@ class Thread_pool {
     }
     //++n_thread;
     jobs_left.fetch_add(1, std::memory_order_relaxed);
-    queue.enqueue(job);
-    job_available_var.notify_one();
+    {
+      // With the lock, a worker between its empty check and wait can not miss the notify
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      queue.enqueue(job);
+      job_available_var.notify_one();
+    }
   }
 
 public:
@@ -113,7 +114,8 @@ public:
       , finishing(false) {
 
     thread_count = _thread_count;
-    size_t lim   = (std::thread::hardware_concurrency() - 1); // -1 for calling thread
+    size_t hw    = std::thread::hardware_concurrency();
+    size_t lim   = hw > 1 ? hw - 1 : 1; // -1 for calling thread (at least one worker in single core machines)
 
     if(thread_count > lim || thread_count == 0)
       thread_count = lim;